@@ -171,6 +171,145 @@ float BoundingBox::getCircumscribedSphereRadius() const
   return lRadius;
 }
 
+// Corner with the largest coordinates (origin if not initialized)
+Vector3D BoundingBox::getMaximum() const
+{
+  if (aInitialized) {
+    return Vector3D(aMaxX, aMaxY, aMaxZ);
+  }
+  return Vector3D(0.0f, 0.0f, 0.0f);
+}
+
+// Corner with the smallest coordinates (origin if not initialized)
+Vector3D BoundingBox::getMinimum() const
+{
+  if (aInitialized) {
+    return Vector3D(aMinX, aMinY, aMinZ);
+  }
+  return Vector3D(0.0f, 0.0f, 0.0f);
+}
+
+// Product of the current OpenGL projection and modelview
+// matrices (column major, as OpenGL)
+static void getClipMatrix(GLfloat pClip[16])
+{
+  GLfloat lModelview [16];
+  GLfloat lProjection[16];
+
+  glGetFloatv(GL_MODELVIEW_MATRIX,  lModelview );
+  glGetFloatv(GL_PROJECTION_MATRIX, lProjection);
+
+  for (int lCol=0; lCol<4; ++lCol) {
+    for (int lRow=0; lRow<4; ++lRow) {
+      pClip[lCol*4+lRow] = (lProjection[0*4+lRow]*lModelview[lCol*4+0] +
+                            lProjection[1*4+lRow]*lModelview[lCol*4+1] +
+                            lProjection[2*4+lRow]*lModelview[lCol*4+2] +
+                            lProjection[3*4+lRow]*lModelview[lCol*4+3]);
+    }
+  }
+}
+
+// Position of the BoundingBox relative to the view frustum defined by
+// the current OpenGL projection and modelview matrices. The test is
+// conservative: a box reported as intersecting might still be outside.
+// An empty BoundingBox is outside.
+BoundingBox::FrustumVisibility BoundingBox::getFrustumVisibility() const
+{
+  if (!aInitialized) {
+    return frustumVisibility_outside;
+  }
+
+  GLfloat lClip[16];
+  getClipMatrix(lClip);
+
+  // For each of the 6 clipping planes (-w <= x,y,z <= w), count
+  // the corners on the outer side
+  int  lNbOutside[6] = {0, 0, 0, 0, 0, 0};
+  bool lAllInside    = true;
+
+  for (int i=0; i<8; ++i) {
+
+    const float lX = (i & 1) ? aMaxX : aMinX;
+    const float lY = (i & 2) ? aMaxY : aMinY;
+    const float lZ = (i & 4) ? aMaxZ : aMinZ;
+
+    float lP[4];
+    for (int lRow=0; lRow<4; ++lRow) {
+      lP[lRow] = lClip[lRow]*lX + lClip[4+lRow]*lY + lClip[8+lRow]*lZ + lClip[12+lRow];
+    }
+
+    for (int lAxis=0; lAxis<3; ++lAxis) {
+      if (lP[lAxis] < -lP[3]) {
+        ++lNbOutside[2*lAxis];
+        lAllInside = false;
+      }
+      if (lP[lAxis] > lP[3]) {
+        ++lNbOutside[2*lAxis+1];
+        lAllInside = false;
+      }
+    }
+  }
+
+  for (int lPlane=0; lPlane<6; ++lPlane) {
+    if (lNbOutside[lPlane] == 8) {
+      return frustumVisibility_outside;
+    }
+  }
+
+  if (lAllInside) {
+    return frustumVisibility_inside;
+  }
+
+  return frustumVisibility_intersecting;
+}
+
+// Size in pixels of the BoundingBox projected in the current OpenGL
+// viewport: the largest side of the rectangle around its corners.
+// A BoundingBox reaching behind the camera can cover any part of
+// the screen, so its size is the largest float. An empty BoundingBox
+// has a size of 0.
+float BoundingBox::getProjectedSize() const
+{
+  if (!aInitialized) {
+    return 0.0f;
+  }
+
+  GLfloat lClip[16];
+  getClipMatrix(lClip);
+
+  GLint lViewport[4];
+  glGetIntegerv(GL_VIEWPORT, lViewport);
+
+  float lMinX = std::numeric_limits<float>::max();
+  float lMinY = std::numeric_limits<float>::max();
+  float lMaxX = -std::numeric_limits<float>::max();
+  float lMaxY = -std::numeric_limits<float>::max();
+
+  for (int i=0; i<8; ++i) {
+
+    const float lX = (i & 1) ? aMaxX : aMinX;
+    const float lY = (i & 2) ? aMaxY : aMinY;
+    const float lZ = (i & 4) ? aMaxZ : aMinZ;
+
+    float lP[4];
+    for (int lRow=0; lRow<4; ++lRow) {
+      lP[lRow] = lClip[lRow]*lX + lClip[4+lRow]*lY + lClip[8+lRow]*lZ + lClip[12+lRow];
+    }
+
+    if (lP[3] <= 0.0f) {
+      return std::numeric_limits<float>::max();
+    }
+
+    lMinX = std::min(lMinX, lP[0]/lP[3]);
+    lMinY = std::min(lMinY, lP[1]/lP[3]);
+    lMaxX = std::max(lMaxX, lP[0]/lP[3]);
+    lMaxY = std::max(lMaxY, lP[1]/lP[3]);
+  }
+
+  // The normalized device coordinates go from -1 to 1
+  return 0.5f*std::max((lMaxX-lMinX)*lViewport[2], (lMaxY-lMinY)*lViewport[3]);
+}
+
 BoundingBox& BoundingBox::operator=(const BoundingBox& pBoundingBox)
 {
   if (&pBoundingBox != this) {
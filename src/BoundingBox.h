@@ -38,6 +38,10 @@ class BoundingBox
 {
 public:
 
+  enum FrustumVisibility {frustumVisibility_inside,
+                          frustumVisibility_intersecting,
+                          frustumVisibility_outside};
+
   BoundingBox         ();
   BoundingBox         (const BoundingBox& pBoundingBox);
   explicit BoundingBox(const Vector3D&    pPoint);
@@ -51,6 +55,11 @@ public:
 
   Vector3D     getCenter                   () const;
   float        getCircumscribedSphereRadius() const;
+  Vector3D     getMaximum                  () const;
+  Vector3D     getMinimum                  () const;
+
+  FrustumVisibility getFrustumVisibility() const;
+  float             getProjectedSize    () const;
 
   BoundingBox&  operator= (const BoundingBox& pBoundingBox);
   BoundingBox   operator+ (const BoundingBox& pBoundingBox) const;
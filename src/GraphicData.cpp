@@ -19,12 +19,14 @@
  *****************************************************************************/
 
 #include "GraphicData.h"
+#include "arena_utils.h"
 #include "assert_glv.h"
 #include "glinclude.h"
 #include "Matrix4x4.h"
 #include "Object.h"
 #include "Parser.h"
 #include "RenderParameters.h"
+#include "SoftwareRasterizer.h"
 #include "string_utils.h"
 
 #include <fcntl.h>
@@ -37,6 +39,7 @@ std::string extractCommandWord(const std::string& pCommand,unsigned int& pEndWor
 GraphicData::GraphicData()
   : aFlagCheckStdin(false),
     aFlagNewData   (false),
+    aFlagParseCache(true),
     aFlagSmoothing (false),
     aOptimizerValue(100),
     aParser        (0),
@@ -58,6 +61,8 @@ GraphicData::~GraphicData()
 
   delete aRootObject;
   delete aParser;
+
+  releaseArena();
 }
 
 // Delete the display lists of the root Object and all its SubObjects.
@@ -70,6 +75,16 @@ void GraphicData::deleteDisplayLists()
   aRootObject->deleteDisplayLists();
 }
 
+// Always parse the data files, without using the
+// on-disk parse cache
+void GraphicData::disableParseCache()
+{
+  aFlagParseCache = false;
+
+  GLV_ASSERT(aParser != 0);
+  aParser->disableParseCache();
+}
+
 // Dump in ASCII the caracteristics of the GraphicData
 void GraphicData::dumpCharacteristics(std::ostream&       pOstream,
                                       const std::string&  pIndentation)
@@ -124,6 +139,18 @@ bool GraphicData::newDataParsed()
   return aParser->newDataParsed();
 }
 
+// Same as render, but with pRasterizer instead of OpenGL
+void GraphicData::rasterize(SoftwareRasterizer& pRasterizer,
+                            RenderParameters&   pParams)
+{
+  GLV_ASSERT(aRootObject != 0);
+
+  pParams.aFlagSmoothNormals       = aFlagSmoothing;
+  pParams.aPrimitiveOptimizerValue = aOptimizerValue;
+
+  aRootObject->rasterize(pRasterizer, pParams);
+}
+
 // Read a command file.
 // If pError.empty() is true on exit, then everything was fine
 void GraphicData::readDataFile(const std::string& pFilename,
@@ -135,6 +162,17 @@ void GraphicData::readDataFile(const std::string& pFilename,
   aParser->parseInputFile(pFilename, pError);
 }
 
+// Read commands from an already opened stream, until its end.
+// If pError.empty() is true on exit, then everything was fine
+void GraphicData::readDataStream(FILE*        pFilePtr,
+                                 std::string& pError)
+{
+  GLV_ASSERT(pError.empty());
+
+  GLV_ASSERT(aParser != 0);
+  aParser->readNewDataFromStream(pFilePtr, pError);
+}
+
 // Render the accumulated graphic data.
 void GraphicData::render(RenderParameters& pParams)
 {
@@ -160,6 +198,9 @@ void GraphicData::reset()
   delete aRootObject;
   delete aParser;
 
+  // The nodes of the scene are all free now
+  releaseArena();
+
   aRootObject = new Object;
   aParser     = new Parser;
 
@@ -167,6 +208,10 @@ void GraphicData::reset()
   GLV_ASSERT(aParser     != 0);
   aParser->pushObject(aRootObject);
 
+  if (!aFlagParseCache) {
+    aParser->disableParseCache();
+  }
+
   aFlagNewData = false;
 }
 
@@ -175,6 +220,14 @@ void GraphicData::setOptimizerValue(const int pOptimizerValue)
   aOptimizerValue = pOptimizerValue;
 }
 
+// Show all the objects hidden by hide_object
+void GraphicData::showHiddenObjects()
+{
+  GLV_ASSERT(aRootObject != 0);
+
+  aRootObject->showSubObjects();
+}
+
 // Timer callback - checks on the stdin if there is new commands to be read
 bool GraphicData::timerCallback()
 {
@@ -21,12 +21,14 @@
 #ifndef GRAPHICDATA_H
 #define GRAPHICDATA_H
 
+#include <stdio.h>
 #include <string>
 
 class BoundingBox;
 class Object;
 class Parser;
 class RenderParameters;
+class SoftwareRasterizer;
 
 class GraphicData {
 public:
@@ -36,6 +38,8 @@ public:
 
   void                deleteDisplayLists   ();
 
+  void                disableParseCache    ();
+
   void                dumpCharacteristics  (std::ostream&      pOstream,
                                             const std::string& pIndentation);
 
@@ -49,15 +53,23 @@ public:
 
   bool                newDataParsed        ();
 
+  void                rasterize            (SoftwareRasterizer& pRasterizer,
+                                            RenderParameters&   pParams);
+
   void                readDataFile         (const std::string& pFilename,
                                             std::string&       pError);
 
+  void                readDataStream       (FILE*              pFilePtr,
+                                            std::string&       pError);
+
   void                render               (RenderParameters&  pParams);
 
   void                reset                ();
 
   void                setOptimizerValue    (const int          pOptimizerValue);
 
+  void                showHiddenObjects    ();
+
   bool                timerCallback        ();
 
 private:
@@ -68,6 +80,7 @@ private:
 
   bool    aFlagCheckStdin;
   bool    aFlagNewData;
+  bool    aFlagParseCache;
   bool    aFlagSmoothing;
   int     aOptimizerValue;
   Parser* aParser;
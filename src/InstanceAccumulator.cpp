@@ -0,0 +1,249 @@
+//  glv - OpenGL viewer command line tool
+/*****************************************************************************
+ * Copyright (C) 2003 Patrick Lagace <bl4cklight@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *****************************************************************************/
+
+#include "InstanceAccumulator.h"
+#include "arena_utils.h"
+#include "assert_glv.h"
+#include "cache_utils.h"
+#include "glinclude.h"
+#include "Object.h"
+#include "SoftwareRasterizer.h"
+#include <iostream>
+
+InstanceAccumulator::InstanceAccumulator(const int          pSubObjectId,
+                                         const unsigned int pSubObjectGeneration)
+  :
+    aInstances                  (),
+    aSubObjectGeneration        (pSubObjectGeneration),
+    aSubObjectId                (pSubObjectId)
+{
+  GLV_ASSERT(aSubObjectId >= 0);
+}
+
+InstanceAccumulator::~InstanceAccumulator()
+{
+}
+
+// The InstanceAccumulators are nodes of the scene, see arena_utils.h
+void* InstanceAccumulator::operator new(size_t pBytes)
+{
+  return allocateArena(pBytes);
+}
+
+void InstanceAccumulator::operator delete(void*  pPtr,
+                                          size_t pBytes)
+{
+  deallocateArena(pPtr, pBytes);
+}
+
+// Add an instance drawn with the color current
+// when the Object is rendered
+void InstanceAccumulator::addInstance(const Matrix4x4& pTransformation)
+{
+  Instance lInstance;
+  lInstance.aTransformation = pTransformation;
+  lInstance.aColor          = Vector3D();
+  lInstance.aFlagColor      = false;
+
+  aInstances.push_back(lInstance);
+}
+
+// Add an instance drawn in pColor; the primitives
+// of the prototype with their own colors keep them
+void InstanceAccumulator::addInstanceColored(const Matrix4x4& pTransformation,
+                                             const Vector3D&  pColor)
+{
+  Instance lInstance;
+  lInstance.aTransformation = pTransformation;
+  lInstance.aColor          = pColor;
+  lInstance.aFlagColor      = true;
+
+  aInstances.push_back(lInstance);
+}
+
+// Add the colors of the colored instances to pSum,
+// and their number to pNbColored
+void InstanceAccumulator::addColors(Vector3D& pSum,
+                                    double&   pNbColored) const
+{
+  Instances::const_iterator       lIter    = aInstances.begin();
+  const Instances::const_iterator lIterEnd = aInstances.end  ();
+
+  while (lIter != lIterEnd) {
+    if (lIter->aFlagColor) {
+      pSum       += lIter->aColor;
+      pNbColored += 1.0;
+    }
+    ++lIter;
+  }
+}
+
+// Release the unused capacity of the instances once the
+// Object is complete. Returns the number of bytes released
+size_t InstanceAccumulator::compact()
+{
+  return shrinkToFit(aInstances);
+}
+
+void InstanceAccumulator::dumpCharacteristics(std::ostream&       pOstream,
+                                              const std::string&  pIndentation) const
+{
+  pOstream << pIndentation << "InstanceAccumulator " << std::endl;
+  std::string lIndentation = pIndentation + "  ";
+
+#ifdef GLV_DUMP_MEMORY_USAGE
+  {
+    pOstream << lIndentation << "Memory used by the InstanceAccumulator = " << sizeof(*this) << std::endl;
+
+    pOstream << lIndentation << "Memory used by aInstances = " << getStringSizeAndCapacity(aInstances) << std::endl;
+  }
+#endif // #ifdef GLV_DUMP_MEMORY_USAGE
+
+  pOstream << lIndentation << "Prototype sub-object = " << aSubObjectId      << std::endl;
+  pOstream << lIndentation << "Number of instances  = " << aInstances.size() << std::endl;
+}
+
+// Returns the BoundingBox of all the instances, from the
+// BoundingBox of the prototype transformed by each instance
+BoundingBox InstanceAccumulator::getBoundingBox(const BoundingBox& pPrototypeBoundingBox) const
+{
+  BoundingBox lBoundingBox;
+
+  Instances::const_iterator       lIter    = aInstances.begin();
+  const Instances::const_iterator lIterEnd = aInstances.end  ();
+
+  while (lIter != lIterEnd) {
+    lBoundingBox += lIter->aTransformation * pPrototypeBoundingBox;
+    ++lIter;
+  }
+
+  return lBoundingBox;
+}
+
+double InstanceAccumulator::getNbInstances() const
+{
+  return static_cast<double>(aInstances.size());
+}
+
+unsigned int InstanceAccumulator::getSubObjectGeneration() const
+{
+  return aSubObjectGeneration;
+}
+
+int InstanceAccumulator::getSubObjectId() const
+{
+  return aSubObjectId;
+}
+
+// Same as render, but with pRasterizer instead of OpenGL
+void InstanceAccumulator::rasterize(Object&             pPrototype,
+                                    SoftwareRasterizer& pRasterizer,
+                                    RenderParameters&   pParams) const
+{
+  SoftwareRasterizer::State& lState = pRasterizer.getState();
+
+  Instances::const_iterator       lIter    = aInstances.begin();
+  const Instances::const_iterator lIterEnd = aInstances.end  ();
+
+  while (lIter != lIterEnd) {
+
+    const SoftwareRasterizer::State lSavedState = lState;
+
+    lState.aTransformation.multiply(lIter->aTransformation);
+    if (lIter->aFlagColor) {
+      lState.aColor = lIter->aColor;
+    }
+
+    pPrototype.rasterize(pRasterizer, pParams);
+
+    lState = lSavedState;
+    ++lIter;
+  }
+}
+
+// Read the instances written by writeCache.
+// Returns false if the file is corrupted
+bool InstanceAccumulator::readCache(FILE* pFilePtr)
+{
+  return (readCacheValue (pFilePtr, aSubObjectGeneration) &&
+          readCacheValue (pFilePtr, aSubObjectId        ) &&
+          aSubObjectId >= 0                               &&
+          readCacheVector(pFilePtr, aInstances          ));
+}
+
+// Render pPrototype once per instance. OpenGL 1.x has no
+// instanced arrays, so each instance calls the display lists
+// of the prototype under its own transformation; the
+// prototype does its own culling for each of them
+void InstanceAccumulator::render(Object&           pPrototype,
+                                 RenderParameters& pParams) const
+{
+  Instances::const_iterator       lIter    = aInstances.begin();
+  const Instances::const_iterator lIterEnd = aInstances.end  ();
+
+  GLfloat lGLMatrix[16];
+
+  while (lIter != lIterEnd) {
+
+    // The color of the instance is tracked by the material:
+    // GL_LIGHTING_BIT restores it with the current color
+    glPushMatrix();
+    glPushAttrib(GL_CURRENT_BIT | GL_POINT_BIT | GL_LINE_BIT | GL_POLYGON_BIT | GL_ENABLE_BIT | GL_LIGHTING_BIT);
+
+    lIter->aTransformation.getGLMatrix(lGLMatrix);
+    glMultMatrixf(lGLMatrix);
+
+    if (lIter->aFlagColor) {
+      glColorMaterial(GL_FRONT_AND_BACK,GL_DIFFUSE);
+      glEnable(GL_COLOR_MATERIAL);
+      glColor3f(lIter->aColor.x(), lIter->aColor.y(), lIter->aColor.z());
+    }
+
+    pPrototype.render(pParams);
+
+    glPopAttrib();
+    glPopMatrix();
+
+    ++lIter;
+  }
+}
+
+// Make room for the instances announced by the count of a raw_instance
+void InstanceAccumulator::reserveInstances(const size_t pNbInstances)
+{
+  aInstances.reserve(aInstances.size() + pNbInstances);
+}
+
+// Used when the sub-Objects of the Object are renumbered.
+// The generation of the prototype doesn't change
+void InstanceAccumulator::setSubObjectId(const int pSubObjectId)
+{
+  GLV_ASSERT(pSubObjectId >= 0);
+  aSubObjectId = pSubObjectId;
+}
+
+// Write the instances in the parse cache file
+// Returns false on a write error
+bool InstanceAccumulator::writeCache(FILE* pFilePtr) const
+{
+  return (writeCacheValue (pFilePtr, aSubObjectGeneration) &&
+          writeCacheValue (pFilePtr, aSubObjectId        ) &&
+          writeCacheVector(pFilePtr, aInstances          ));
+}
@@ -0,0 +1,108 @@
+//  glv - OpenGL viewer command line tool
+/*****************************************************************************
+ * Copyright (C) 2003 Patrick Lagace <bl4cklight@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *****************************************************************************/
+
+#ifndef INSTANCEACCUMULATOR_H
+#define INSTANCEACCUMULATOR_H
+
+#include "BoundingBox.h"
+#include "Matrix4x4.h"
+#include "mapped_utils.h"
+#include "RenderParameters.h"
+#include "Vector3D.h"
+#include <stdio.h>
+#include <string>
+
+class Object;
+class SoftwareRasterizer;
+
+// Class used to accumulate the instances of a prototype Object
+// (a sub-Object of the Object with the InstanceAccumulator): each
+// instance renders the prototype with its own transformation and,
+// optionally, its own color. Only the prototype stores primitives,
+// and its display list is called for every instance
+class InstanceAccumulator
+{
+public:
+
+  InstanceAccumulator (const int          pSubObjectId,
+                       const unsigned int pSubObjectGeneration);
+  ~InstanceAccumulator();
+
+  static void* operator new   (size_t pBytes);
+  static void  operator delete(void*  pPtr,
+                               size_t pBytes);
+
+  void  addInstance        (const Matrix4x4&    pTransformation);
+
+  void  addInstanceColored (const Matrix4x4&    pTransformation,
+                            const Vector3D&     pColor);
+
+  void  addColors          (Vector3D&           pSum,
+                            double&             pNbColored) const;
+
+  size_t compact           ();
+
+  void  dumpCharacteristics(std::ostream&       pOstream,
+                            const std::string&  pIndentation) const;
+
+  BoundingBox  getBoundingBox(const BoundingBox& pPrototypeBoundingBox) const;
+
+  double       getNbInstances() const;
+
+  unsigned int getSubObjectGeneration() const;
+
+  int          getSubObjectId() const;
+
+  void  rasterize          (Object&             pPrototype,
+                            SoftwareRasterizer& pRasterizer,
+                            RenderParameters&   pParams) const;
+
+  bool  readCache          (FILE*               pFilePtr);
+
+  void  render             (Object&             pPrototype,
+                            RenderParameters&   pParams) const;
+
+  void  setSubObjectId     (const int           pSubObjectId);
+
+  void  reserveInstances   (const size_t        pNbInstances);
+
+  bool  writeCache         (FILE*               pFilePtr) const;
+
+private:
+
+  // Block the use of those
+  InstanceAccumulator(const InstanceAccumulator&);
+  InstanceAccumulator& operator=(const InstanceAccumulator&);
+
+  struct Instance {
+    Matrix4x4 aTransformation;
+    Vector3D  aColor;
+    bool      aFlagColor;
+  };
+
+  typedef  MappedVector<Instance>::Type  Instances;
+
+
+  Instances     aInstances;
+  unsigned int  aSubObjectGeneration; // Handle of the prototype in the
+  int           aSubObjectId;         // sub-Objects, see Object::getSubObject
+};
+
+#endif // INSTANCEACCUMULATOR_H
@@ -49,6 +49,17 @@ Matrix4x4::Matrix4x4(const Matrix4x4& pMatrix4x4)
   aVals[2][3] = pMatrix4x4.aVals[2][3];
 }
 
+// Construct the matrix whose first three rows are pVals; the
+// last row is the one of an affine transformation (0 0 0 1)
+Matrix4x4::Matrix4x4(const float pVals[3][4])
+{
+  for (int i=0; i<3; ++i) {
+    for (int j=0; j<4; ++j) {
+      aVals[i][j] = pVals[i][j];
+    }
+  }
+}
+
 Matrix4x4& Matrix4x4::operator=(const Matrix4x4& pMatrix4x4)
 {
   if (this != &pMatrix4x4) {
@@ -71,6 +82,34 @@ Matrix4x4& Matrix4x4::operator=(const Matrix4x4& pMatrix4x4)
   return *this;
 }
 
+// Returns the matrix in the column-major
+// order of glMultMatrixf
+void Matrix4x4::getGLMatrix(float pGLMatrix[16]) const
+{
+  for (int j=0; j<4; ++j) {
+    pGLMatrix[4*j  ] = aVals[0][j];
+    pGLMatrix[4*j+1] = aVals[1][j];
+    pGLMatrix[4*j+2] = aVals[2][j];
+    pGLMatrix[4*j+3] = (j == 3) ? 1.0f : 0.0f;
+  }
+}
+
+// Multiplies to the right the current Matrix4x4
+// by pMatrix4x4
+void Matrix4x4::multiply(const Matrix4x4& pMatrix4x4)
+{
+  const Matrix4x4 lLeft(*this);
+
+  for (int i=0; i<3; ++i) {
+    for (int j=0; j<4; ++j) {
+      aVals[i][j] = (lLeft.aVals[i][0]*pMatrix4x4.aVals[0][j] +
+                     lLeft.aVals[i][1]*pMatrix4x4.aVals[1][j] +
+                     lLeft.aVals[i][2]*pMatrix4x4.aVals[2][j]);
+    }
+    aVals[i][3] += lLeft.aVals[i][3];
+  }
+}
+
 // Multiplies to the right the current Matrix4x4
 // by the rotation matrix of pAngleRadians about
 // pVector3D
@@ -154,6 +193,36 @@ void Matrix4x4::scale(const Vector3D& pScaling)
   aVals[2][0] *= x; aVals[2][1] *= y; aVals[2][2] *= z;
 }
 
+// Returns the normal pNormal transformed by the inverse
+// transpose of the linear part of the matrix, like OpenGL
+// does. We use the cofactor matrix, the result is
+// therefore not normalized.
+Vector3D Matrix4x4::transformNormal(const Vector3D& pNormal) const
+{
+  const float lC00 = aVals[1][1]*aVals[2][2] - aVals[1][2]*aVals[2][1];
+  const float lC01 = aVals[1][2]*aVals[2][0] - aVals[1][0]*aVals[2][2];
+  const float lC02 = aVals[1][0]*aVals[2][1] - aVals[1][1]*aVals[2][0];
+  const float lC10 = aVals[0][2]*aVals[2][1] - aVals[0][1]*aVals[2][2];
+  const float lC11 = aVals[0][0]*aVals[2][2] - aVals[0][2]*aVals[2][0];
+  const float lC12 = aVals[0][1]*aVals[2][0] - aVals[0][0]*aVals[2][1];
+  const float lC20 = aVals[0][1]*aVals[1][2] - aVals[0][2]*aVals[1][1];
+  const float lC21 = aVals[0][2]*aVals[1][0] - aVals[0][0]*aVals[1][2];
+  const float lC22 = aVals[0][0]*aVals[1][1] - aVals[0][1]*aVals[1][0];
+
+  // The sign of the determinant tells if the
+  // cofactor matrix flips the normal
+  const float lDeterminant = aVals[0][0]*lC00 + aVals[0][1]*lC01 + aVals[0][2]*lC02;
+  const float lSign        = (lDeterminant < 0.0f) ? -1.0f : 1.0f;
+
+  const float x = pNormal.x();
+  const float y = pNormal.y();
+  const float z = pNormal.z();
+
+  return Vector3D(lSign*(lC00*x + lC01*y + lC02*z),
+                  lSign*(lC10*x + lC11*y + lC12*z),
+                  lSign*(lC20*x + lC21*y + lC22*z));
+}
+
 // aVals is the GL transformation matrix
 // Returns: aVals * pVector3D
 Vector3D operator*(const Matrix4x4& pMatrix4x4,
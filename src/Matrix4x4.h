@@ -35,16 +35,21 @@ public:
 
   Matrix4x4 ();
   Matrix4x4 (const Matrix4x4& pMatrix4x4);
+  explicit Matrix4x4 (const float pVals[3][4]);
 
   ~Matrix4x4() {}
 
   Matrix4x4& operator=(const Matrix4x4& pMatrix4x4);
 
+  void getGLMatrix(float           pGLMatrix[16]) const;
+  void multiply   (const Matrix4x4& pMatrix4x4);
   void rotateAbout(const Vector3D& pVector3D,
                    const float     pAngleRadians);
   void translate  (const Vector3D& pTranslation);
   void scale      (const Vector3D& pScaling);
 
+  Vector3D transformNormal(const Vector3D& pNormal) const;
+
 private:
 
   friend Vector3D operator*(const Matrix4x4& pMatrix4x4,
@@ -0,0 +1,187 @@
+//  glv - OpenGL viewer command line tool
+/*****************************************************************************
+ * Copyright (C) 2003 Patrick Lagace <bl4cklight@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *****************************************************************************/
+
+#include "NormalCone.h"
+#include "assert_glv.h"
+#include "glinclude.h"
+
+#include <cmath>
+
+// By default, the cluster is never culled
+NormalCone::NormalCone()
+  : aAxis    (),
+    aSinAngle(2.0f)
+{}
+
+NormalCone::~NormalCone()
+{}
+
+// Compute the cone of the unit normals pNormals. A null normal
+// (degenerated face, or primitive that is not a face) prevents
+// the culling of the cluster
+void NormalCone::construct(const std::vector<Vector3D>& pNormals)
+{
+  aAxis     = Vector3D();
+  aSinAngle = 2.0f;
+
+  const Vector3D lNullVector(0.0f, 0.0f, 0.0f);
+
+  std::vector<Vector3D>::const_iterator       lIterNormals    = pNormals.begin();
+  const std::vector<Vector3D>::const_iterator lIterNormalsEnd = pNormals.end  ();
+
+  if (lIterNormals == lIterNormalsEnd) {
+    return;
+  }
+
+  Vector3D lAxis;
+
+  while (lIterNormals != lIterNormalsEnd) {
+    if (*lIterNormals == lNullVector) {
+      return;
+    }
+    lAxis += *lIterNormals;
+    ++lIterNormals;
+  }
+
+  if (lAxis == lNullVector) {
+    return;
+  }
+
+  lAxis.normalize();
+
+  float lMinCosAngle = 1.0f;
+
+  for (lIterNormals = pNormals.begin(); lIterNormals != lIterNormalsEnd; ++lIterNormals) {
+    lMinCosAngle = std::min(lMinCosAngle, lAxis.dotProduct(*lIterNormals));
+  }
+
+  // The faces of a cluster wider than a half-sphere
+  // can't all face away from the camera
+  if (lMinCosAngle <= 0.0f) {
+    return;
+  }
+
+  aAxis     = lAxis;
+  aSinAngle = sqrt(std::max(0.0f, 1.0f - lMinCosAngle*lMinCosAngle));
+}
+
+// Returns true if all the faces of the cluster, inside pBoundingBox,
+// are culled by OpenGL when seen from pEye (see getCulledFaces).
+// The test is conservative: every direction from pEye to the
+// bounding sphere must make more than 90 degrees with every
+// normal of the cone
+bool NormalCone::isCulled(const BoundingBox& pBoundingBox,
+                          const Vector3D&    pEye,
+                          const int          pCulledFaces) const
+{
+  if (pCulledFaces == 0 || aSinAngle > 1.0f) {
+    return false;
+  }
+
+  const Vector3D lToCenter = pBoundingBox.getCenter() - pEye;
+  const float    lRadius   = pBoundingBox.getCircumscribedSphereRadius();
+  const float    lDistance = lToCenter.getLength();
+
+  return (pCulledFaces*aAxis.dotProduct(lToCenter) - lRadius > aSinAngle*(lDistance + lRadius));
+}
+
+// Returns the faces culled by OpenGL with its current state:
+// 0 if none (or all) of them, 1 if the faces whose normal points
+// away from the camera, -1 if the ones whose normal points toward
+// it. In the last two cases, pEye is the position of the camera
+// in the current (modelview) coordinates
+int NormalCone::getCulledFaces(Vector3D& pEye)
+{
+  if (glIsEnabled(GL_CULL_FACE) == GL_FALSE) {
+    return 0;
+  }
+
+  GLint lCullFaceMode = GL_BACK;
+  GLint lFrontFace    = GL_CCW;
+
+  glGetIntegerv(GL_CULL_FACE_MODE, &lCullFaceMode);
+  glGetIntegerv(GL_FRONT_FACE,     &lFrontFace   );
+
+  if (lCullFaceMode == GL_FRONT_AND_BACK) {
+    return 0;
+  }
+
+  GLfloat lM[16];
+  glGetFloatv(GL_MODELVIEW_MATRIX, lM);
+
+  // The camera is at the origin of the eye coordinates: pEye is
+  // -A^-1 t, with A the linear part and t the translation of the
+  // modelview matrix (column-major). The projection is a perspective
+  const float lC00 = lM[5]*lM[10] - lM[9]*lM[6];
+  const float lC01 = lM[8]*lM[6]  - lM[4]*lM[10];
+  const float lC02 = lM[4]*lM[9]  - lM[8]*lM[5];
+  const float lDet = lM[0]*lC00 + lM[1]*lC01 + lM[2]*lC02;
+
+  if (lDet == 0.0f) {
+    return 0;
+  }
+
+  const float lInverse[9] = {lC00                         /lDet,
+                             (lM[9]*lM[2]  - lM[1]*lM[10])/lDet,
+                             (lM[1]*lM[6]  - lM[5]*lM[2]) /lDet,
+                             lC01                         /lDet,
+                             (lM[0]*lM[10] - lM[8]*lM[2]) /lDet,
+                             (lM[4]*lM[2]  - lM[0]*lM[6]) /lDet,
+                             lC02                         /lDet,
+                             (lM[8]*lM[1]  - lM[0]*lM[9]) /lDet,
+                             (lM[0]*lM[5]  - lM[4]*lM[1]) /lDet};
+
+  pEye = Vector3D(-(lInverse[0]*lM[12] + lInverse[3]*lM[13] + lInverse[6]*lM[14]),
+                  -(lInverse[1]*lM[12] + lInverse[4]*lM[13] + lInverse[7]*lM[14]),
+                  -(lInverse[2]*lM[12] + lInverse[5]*lM[13] + lInverse[8]*lM[14]));
+
+  // A mirroring transformation swaps the front and back faces
+  int lCulledFaces = (lCullFaceMode == GL_BACK ? 1 : -1);
+
+  if (lFrontFace == GL_CW) {
+    lCulledFaces = -lCulledFaces;
+  }
+  if (lDet < 0.0f) {
+    lCulledFaces = -lCulledFaces;
+  }
+
+  return lCulledFaces;
+}
+
+// Returns the facing of a face of normal pNormal: the axis closest
+// to the normal, times 2, plus 1 if the normal is toward the negative
+// side of the axis. Grouping the faces with the same facing in the
+// same clusters keeps their cones narrow. Returns 6 for a null normal
+int NormalCone::getFacing(const Vector3D& pNormal)
+{
+  int lAxis = 0;
+
+  for (int i=1; i<3; ++i) {
+    if (fabs(pNormal[i]) > fabs(pNormal[lAxis])) {
+      lAxis = i;
+    }
+  }
+
+  if (pNormal[lAxis] == 0.0f) {
+    return 6;
+  }
+
+  return 2*lAxis + (pNormal[lAxis] < 0.0f ? 1 : 0);
+}
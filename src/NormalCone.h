@@ -0,0 +1,56 @@
+//  glv - OpenGL viewer command line tool
+/*****************************************************************************
+ * Copyright (C) 2003 Patrick Lagace <bl4cklight@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *****************************************************************************/
+
+#ifndef NORMALCONE_H
+#define NORMALCONE_H
+
+#include "BoundingBox.h"
+#include "Vector3D.h"
+#include <vector>
+
+// Cone containing the normals of a cluster of faces. When OpenGL
+// culls the back faces, a cluster whose faces all face away from
+// the camera can be skipped before its primitives are sent.
+// The normals are the ones given by the order of the vertices
+// (counter-clockwise), not the normals used for the lighting.
+class NormalCone
+{
+public:
+
+  NormalCone ();
+  ~NormalCone();
+
+  void construct(const std::vector<Vector3D>& pNormals);
+
+  bool isCulled (const BoundingBox&           pBoundingBox,
+                 const Vector3D&              pEye,
+                 const int                    pCulledFaces) const;
+
+  static int getCulledFaces(Vector3D&        pEye);
+  static int getFacing     (const Vector3D&  pNormal);
+
+private:
+
+  Vector3D aAxis;
+  float    aSinAngle; // Sine of the half-angle of the cone; more than 1 if the cluster is never culled
+
+};
+
+#endif // NORMALCONE_H
@@ -20,32 +20,65 @@
 
 #include <cstring>
 #include "Object.h"
+#include "arena_utils.h"
 #include "assert_glv.h"
+#include "cache_utils.h"
 #include "glut_utils.h"
+#include "InstanceAccumulator.h"
 #include "limits_glv.h"
 #include "Matrix4x4.h"
 #include "Parser.h"
 #include "PrimitiveAccumulator.h"
+#include "SoftwareRasterizer.h"
 #include "string_utils.h"
 #include "Vector3D.h"
 #include "VertexAccumulator.h"
 #include "VertexedPrimitiveAccumulator.h"
+#include <algorithm>
 #include <iostream>
 #include <stdio.h>
+#include <vector>
 
 // Should be put in a header file
 std::string extractCommandWord(const std::string&      pLine,
                                std::string::size_type& pEndWord);
 
+// Incremented by each hide_object and show_object, see hasHiddenParts
+static unsigned int gNbVisibilityChanges = 0;
+
+// 32 bits FNV-1a hash of the name of a sub-Object
+static unsigned int hashName(const std::string& pName)
+{
+  unsigned int lHash = 2166136261u;
+
+  for (std::string::size_type i=0; i<pName.size(); ++i) {
+    lHash ^= static_cast<unsigned char>(pName[i]);
+    lHash *= 16777619u;
+  }
+  return lHash;
+}
+
 
 Object::Object()
   : aBoundingBox                          (),
     aCommands                             (),
+    aColorSum                             (),
+    aColorSumValid                        (false),
+    aFlagClusters                         (false),
+    aFlagHiddenParts                      (false),
+    aFlagSingleSided                      (false),
+    aFreeSubObjectSlot                    (-1),
     aFrozen                               (false),
     aGLDisplayListBoundingBox             (0),
     aGLDisplayListFast                    (0),
     aGLDisplayListFull                    (0),
+    aInstanceAccumulators                 (),
     aName                                 (),
+    aNbDeletedSubObjectCommands           (0),
+    aNbHiddenSubObjects                   (0),
+    aNbIndexedSubObjects                  (0),
+    aNbReferences                         (1),
+    aNbVisibilityChanges                  (0),
     aNewPrimitiveAccumulatorNeeded        (true),
     aNewVertexAccumulatorNeeded           (true),
     aNewVertexedPrimitiveAccumulatorNeeded(true),
@@ -53,10 +86,16 @@ Object::Object()
     aRawMode                              (rawMode_not_in_raw_section),
     aRawModeArrowTipNbPolygons            (-1),
     aRawModeArrowTipProportion            (-1.0f),
+    aSubObjectBuckets                     (),
     aSubObjects                           (),
+    aSubObjectSlots                       (),
     aVertexAccumulators                   (),
     aVertexedPrimitiveAccumulators        ()
-{}
+{
+#ifdef GLV_DUMP_MEMORY_USAGE
+  aReleasedBytes = 0;
+#endif // #ifdef GLV_DUMP_MEMORY_USAGE
+}
 
 Object::~Object()
 {
@@ -74,7 +113,9 @@ Object::~Object()
     SubObjects::iterator       lIter    = aSubObjects.begin();
     const SubObjects::iterator lIterEnd = aSubObjects.end  ();
     while (lIter != lIterEnd) {
-      delete *lIter;
+      if (*lIter != 0 && (*lIter)->removeReference()) {
+        delete *lIter;
+      }
       ++lIter;
     }
   }
@@ -106,6 +147,27 @@ Object::~Object()
     }
   }
 
+  {
+    InstanceAccumulators::iterator       lIter    = aInstanceAccumulators.begin();
+    const InstanceAccumulators::iterator lIterEnd = aInstanceAccumulators.end  ();
+    while (lIter != lIterEnd) {
+      delete *lIter;
+      ++lIter;
+    }
+  }
+
+}
+
+// The Objects are nodes of the scene, see arena_utils.h
+void* Object::operator new(size_t pBytes)
+{
+  return allocateArena(pBytes);
+}
+
+void Object::operator delete(void*  pPtr,
+                             size_t pBytes)
+{
+  deallocateArena(pPtr, pBytes);
 }
 
 // Delete the display lists of the current Object and all its SubObjects.
@@ -127,6 +189,24 @@ void Object::deleteDisplayLists()
     aGLDisplayListFast = 0;
   }
 
+  {
+    PrimitiveAccumulators::iterator       lIter    = aPrimitiveAccumulators.begin();
+    const PrimitiveAccumulators::iterator lIterEnd = aPrimitiveAccumulators.end  ();
+    while (lIter != lIterEnd) {
+      (*lIter)->deleteDisplayLists();
+      ++lIter;
+    }
+  }
+
+  {
+    VertexedPrimitiveAccumulators::iterator       lIter    = aVertexedPrimitiveAccumulators.begin();
+    const VertexedPrimitiveAccumulators::iterator lIterEnd = aVertexedPrimitiveAccumulators.end  ();
+    while (lIter != lIterEnd) {
+      (*lIter)->deleteDisplayLists();
+      ++lIter;
+    }
+  }
+
   SubObjects::iterator       lIter    = aSubObjects.begin();
   const SubObjects::iterator lIterEnd = aSubObjects.end  ();
 
@@ -187,6 +267,8 @@ void Object::dumpCharacteristics(std::ostream&       pOstream,
     pOstream << lIndentation << "Memory used by aCommands  = "
              << lCommandsSize << "/"
              << lCommandsCapacity << std::endl;
+
+    pOstream << lIndentation << "Memory released at object_end = " << aReleasedBytes << std::endl;
   }
 #endif // #ifdef GLV_DUMP_MEMORY_USAGE
 
@@ -246,21 +328,29 @@ void Object::dumpCharacteristics(std::ostream&       pOstream,
 
     }
     else if (lCommand == "execute_subobjects_id") {
-      GLV_ASSERT(countWords(lParameters) == 1);
-      int lSubObjectId = atoi(lParameters.c_str());
-      GLV_ASSERT(lSubObjectId >= 0);
-      GLV_ASSERT(lSubObjectId <  static_cast<int>(aSubObjects.size()));
+      GLV_ASSERT(countWords(lParameters) == 2);
+      Object* lSubObject = getSubObject(lParameters);
 
       // The sub-Object might have been deleted
-      if (aSubObjects[lSubObjectId] != 0) {
-        aSubObjects[lSubObjectId]->dumpCharacteristics(pOstream,
-                                                       lIndentation + "  ",
-                                                       lTransformation);
+      if (lSubObject != 0) {
+        lSubObject->dumpCharacteristics(pOstream,
+                                        lIndentation + "  ",
+                                        lTransformation);
       }
       else {
         pOstream << lIndentation << "  Object deleted" << std::endl;
       }
     }
+    else if (lCommand == "execute_instance_accumulator_id") {
+      GLV_ASSERT(countWords(lParameters) == 1);
+      int lInstanceAccumulatorId = atoi(lParameters.c_str());
+      GLV_ASSERT(lInstanceAccumulatorId >= 0);
+      GLV_ASSERT(lInstanceAccumulatorId <  static_cast<int>(aInstanceAccumulators.size()));
+      GLV_ASSERT(aInstanceAccumulators[lInstanceAccumulatorId] != 0);
+
+      aInstanceAccumulators[lInstanceAccumulatorId]->dumpCharacteristics(pOstream,
+                                                                         lIndentation + "  ");
+    }
     // DIRECT OPENGL CALLS
     else if(lCommand == "gltranslate") {
       float tx, ty, tz;
@@ -707,10 +797,80 @@ void Object::addCommand(const std::string& pCommand,
       lVertexAccumulator.addColor(Vector3D(r,g,b));
     }
 
+  }
+  else if (aRawMode == rawMode_instance) {
+
+    // Either a translation or the first three rows of
+    // the transformation matrix, optionally followed by a color
+    float       v[15];
+    const int   lNbWords = countWords(pParameters);
+    const char* lFormat  = "%f %f %f %f %f %f %f %f %f %f %f %f %f %f %f";
+    if (pCommand == "raw_end") {
+      if (!pParameters.empty()) {
+        addSyntaxError(pCommand, "", pCurrentParser, pError);
+      }
+      else {
+        aRawMode = rawMode_not_in_raw_section;
+      }
+    }
+    else if(pCommand != "raw_instance_item" ||
+            (lNbWords != 3 && lNbWords != 6 && lNbWords != 12 && lNbWords != 15) ||
+            lNbWords != sscanf(pParameters.c_str(), lFormat,
+                               &v[0], &v[1], &v[2 ], &v[3 ], &v[4 ], &v[5 ], &v[6], &v[7],
+                               &v[8], &v[9], &v[10], &v[11], &v[12], &v[13], &v[14])) {
+      addRawSectionError("raw_instance", "x y z [r g b] or a11 a12 a13 x a21 a22 a23 y a31 a32 a33 z [r g b]",
+                         pCurrentParser, pError);
+    }
+    else {
+      Matrix4x4 lTransformation;
+      int       lColorIndex = 3;
+
+      if (lNbWords >= 12) {
+        const float lRows[3][4] = {{v[0], v[1], v[2 ], v[3 ]},
+                                   {v[4], v[5], v[6 ], v[7 ]},
+                                   {v[8], v[9], v[10], v[11]}};
+        lTransformation = Matrix4x4(lRows);
+        lColorIndex     = 12;
+      }
+      else {
+        lTransformation.translate(Vector3D(v[0], v[1], v[2]));
+      }
+
+      GLV_ASSERT(!aInstanceAccumulators.empty());
+      GLV_ASSERT(aInstanceAccumulators.back() != 0);
+
+      if (lNbWords == lColorIndex) {
+        aInstanceAccumulators.back()->addInstance(lTransformation);
+      }
+      else {
+        const float r = v[lColorIndex];
+        const float g = v[lColorIndex+1];
+        const float b = v[lColorIndex+2];
+
+        if (r < 0.0 || r > 1.0 ||
+            g < 0.0 || g > 1.0 ||
+            b < 0.0 || b > 1.0) {
+          addError("Colors out of range in raw_instance", pCurrentParser, pError);
+        }
+        else {
+          aInstanceAccumulators.back()->addInstanceColored(lTransformation, Vector3D(r,g,b));
+        }
+      }
+    }
+
   }
   else {
     GLV_ASSERT(aRawMode == rawMode_not_in_raw_section);
 
+    // The header of a raw section may end with count=# to announce
+    // its number of items, so its storage is reserved at once
+    std::string   lRawParameters;
+    unsigned long lRawCount   = 0;
+    bool          lRawCountOk = true;
+    if (pCommand.compare(0, 4, "raw_") == 0) {
+      lRawParameters = pParameters;
+      lRawCountOk    = extractCountHint(lRawParameters, lRawCount);
+    }
 
     // SIMPLE PRIMITIVES
     if(pCommand == "arrow") {
@@ -972,11 +1132,12 @@ void Object::addCommand(const std::string& pCommand,
     }
     else if(pCommand == "raw_arrow") {
 
-      if (2 != countWords(pParameters) ||
-          2 != sscanf(pParameters.c_str(), "%f %d",
+      if (!lRawCountOk                     ||
+          2 != countWords(lRawParameters) ||
+          2 != sscanf(lRawParameters.c_str(), "%f %d",
                       &aRawModeArrowTipProportion,
                       &aRawModeArrowTipNbPolygons)) {
-        addSyntaxError(pCommand, "tipprop tippoly", pCurrentParser, pError);
+        addSyntaxError(pCommand, "tipprop tippoly [count=#]", pCurrentParser, pError);
       }
       else {
         if (aRawModeArrowTipProportion <= 0.0f ||
@@ -993,6 +1154,9 @@ void Object::addCommand(const std::string& pCommand,
           }
           else {
             aRawMode = rawMode_arrow;
+            if (lRawCount > 0) {
+              getCurrentPrimitiveAccumulator().reserveArrows(lRawCount, aRawModeArrowTipNbPolygons, false);
+            }
           }
         }
       }
@@ -1000,11 +1164,12 @@ void Object::addCommand(const std::string& pCommand,
     }
     else if(pCommand == "raw_arrow_colored") {
 
-      if (2 != countWords(pParameters) ||
-          2 != sscanf(pParameters.c_str(), "%f %d",
+      if (!lRawCountOk                     ||
+          2 != countWords(lRawParameters) ||
+          2 != sscanf(lRawParameters.c_str(), "%f %d",
                       &aRawModeArrowTipProportion,
                       &aRawModeArrowTipNbPolygons)) {
-        addSyntaxError(pCommand, "tipprop tippoly", pCurrentParser, pError);
+        addSyntaxError(pCommand, "tipprop tippoly [count=#]", pCurrentParser, pError);
       }
       else {
         if (aRawModeArrowTipProportion <= 0.0f ||
@@ -1021,6 +1186,9 @@ void Object::addCommand(const std::string& pCommand,
           }
           else {
             aRawMode = rawMode_arrow_colored;
+            if (lRawCount > 0) {
+              getCurrentPrimitiveAccumulator().reserveArrows(lRawCount, aRawModeArrowTipNbPolygons, true);
+            }
           }
         }
       }
@@ -1028,8 +1196,8 @@ void Object::addCommand(const std::string& pCommand,
     }
     else if(pCommand == "raw_point") {
 
-      if (!pParameters.empty()) {
-        addSyntaxError(pCommand, "", pCurrentParser, pError);
+      if (!lRawCountOk || !lRawParameters.empty()) {
+        addSyntaxError(pCommand, "[count=#]", pCurrentParser, pError);
       }
       else {
         if (aRawMode != rawMode_not_in_raw_section) {
@@ -1037,14 +1205,17 @@ void Object::addCommand(const std::string& pCommand,
         }
         else {
           aRawMode = rawMode_point;
+          if (lRawCount > 0) {
+            getCurrentPrimitiveAccumulator().reservePoints(lRawCount, false);
+          }
         }
       }
 
     }
     else if(pCommand == "raw_point_colored") {
 
-      if (!pParameters.empty()) {
-        addSyntaxError(pCommand, "", pCurrentParser, pError);
+      if (!lRawCountOk || !lRawParameters.empty()) {
+        addSyntaxError(pCommand, "[count=#]", pCurrentParser, pError);
       }
       else {
         if (aRawMode != rawMode_not_in_raw_section) {
@@ -1052,14 +1223,17 @@ void Object::addCommand(const std::string& pCommand,
         }
         else {
           aRawMode = rawMode_point_colored;
+          if (lRawCount > 0) {
+            getCurrentPrimitiveAccumulator().reservePoints(lRawCount, true);
+          }
         }
       }
 
     }
     else if(pCommand == "raw_point_v") {
 
-      if (!pParameters.empty()) {
-        addSyntaxError(pCommand, "", pCurrentParser, pError);
+      if (!lRawCountOk || !lRawParameters.empty()) {
+        addSyntaxError(pCommand, "[count=#]", pCurrentParser, pError);
       }
       else {
         if (aRawMode != rawMode_not_in_raw_section) {
@@ -1071,6 +1245,9 @@ void Object::addCommand(const std::string& pCommand,
           }
           else {
             aRawMode = rawMode_point_v;
+            if (lRawCount > 0) {
+              getCurrentVertexedPrimitiveAccumulator().reservePoints(lRawCount);
+            }
           }
         }
       }
@@ -1078,8 +1255,8 @@ void Object::addCommand(const std::string& pCommand,
     }
     else if(pCommand == "raw_line") {
 
-      if (!pParameters.empty()) {
-        addSyntaxError(pCommand, "", pCurrentParser, pError);
+      if (!lRawCountOk || !lRawParameters.empty()) {
+        addSyntaxError(pCommand, "[count=#]", pCurrentParser, pError);
       }
       else {
         if (aRawMode != rawMode_not_in_raw_section) {
@@ -1087,14 +1264,17 @@ void Object::addCommand(const std::string& pCommand,
         }
         else {
           aRawMode = rawMode_line;
+          if (lRawCount > 0) {
+            getCurrentPrimitiveAccumulator().reserveLines(lRawCount, false);
+          }
         }
       }
 
     }
     else if(pCommand == "raw_line_colored") {
 
-      if (!pParameters.empty()) {
-        addSyntaxError(pCommand, "", pCurrentParser, pError);
+      if (!lRawCountOk || !lRawParameters.empty()) {
+        addSyntaxError(pCommand, "[count=#]", pCurrentParser, pError);
       }
       else {
         if (aRawMode != rawMode_not_in_raw_section) {
@@ -1102,14 +1282,17 @@ void Object::addCommand(const std::string& pCommand,
         }
         else {
           aRawMode = rawMode_line_colored;
+          if (lRawCount > 0) {
+            getCurrentPrimitiveAccumulator().reserveLines(lRawCount, true);
+          }
         }
       }
 
     }
     else if(pCommand == "raw_line_v") {
 
-      if (!pParameters.empty()) {
-        addSyntaxError(pCommand, "", pCurrentParser, pError);
+      if (!lRawCountOk || !lRawParameters.empty()) {
+        addSyntaxError(pCommand, "[count=#]", pCurrentParser, pError);
       }
       else {
         if (aRawMode != rawMode_not_in_raw_section) {
@@ -1121,6 +1304,9 @@ void Object::addCommand(const std::string& pCommand,
           }
           else {
             aRawMode = rawMode_line_v;
+            if (lRawCount > 0) {
+              getCurrentVertexedPrimitiveAccumulator().reserveLines(lRawCount);
+            }
           }
         }
       }
@@ -1128,8 +1314,8 @@ void Object::addCommand(const std::string& pCommand,
     }
     else if(pCommand == "raw_triangle") {
 
-      if (!pParameters.empty()) {
-        addSyntaxError(pCommand, "", pCurrentParser, pError);
+      if (!lRawCountOk || !lRawParameters.empty()) {
+        addSyntaxError(pCommand, "[count=#]", pCurrentParser, pError);
       }
       else {
         if (aRawMode != rawMode_not_in_raw_section) {
@@ -1137,14 +1323,17 @@ void Object::addCommand(const std::string& pCommand,
         }
         else {
           aRawMode = rawMode_triangle;
+          if (lRawCount > 0) {
+            getCurrentPrimitiveAccumulator().reserveTriangles(lRawCount, false);
+          }
         }
       }
 
     }
     else if(pCommand == "raw_triangle_colored") {
 
-      if (!pParameters.empty()) {
-        addSyntaxError(pCommand, "", pCurrentParser, pError);
+      if (!lRawCountOk || !lRawParameters.empty()) {
+        addSyntaxError(pCommand, "[count=#]", pCurrentParser, pError);
       }
       else {
         if (aRawMode != rawMode_not_in_raw_section) {
@@ -1152,14 +1341,17 @@ void Object::addCommand(const std::string& pCommand,
         }
         else {
           aRawMode = rawMode_triangle_colored;
+          if (lRawCount > 0) {
+            getCurrentPrimitiveAccumulator().reserveTriangles(lRawCount, true);
+          }
         }
       }
 
     }
     else if(pCommand == "raw_triangle_v") {
 
-      if (!pParameters.empty()) {
-        addSyntaxError(pCommand, "", pCurrentParser, pError);
+      if (!lRawCountOk || !lRawParameters.empty()) {
+        addSyntaxError(pCommand, "[count=#]", pCurrentParser, pError);
       }
       else {
         if (aRawMode != rawMode_not_in_raw_section) {
@@ -1171,6 +1363,9 @@ void Object::addCommand(const std::string& pCommand,
           }
           else {
             aRawMode = rawMode_triangle_v;
+            if (lRawCount > 0) {
+              getCurrentVertexedPrimitiveAccumulator().reserveTriangles(lRawCount);
+            }
           }
         }
       }
@@ -1178,8 +1373,8 @@ void Object::addCommand(const std::string& pCommand,
     }
     else if(pCommand == "raw_quad") {
 
-      if (!pParameters.empty()) {
-        addSyntaxError(pCommand, "", pCurrentParser, pError);
+      if (!lRawCountOk || !lRawParameters.empty()) {
+        addSyntaxError(pCommand, "[count=#]", pCurrentParser, pError);
       }
       else {
         if (aRawMode != rawMode_not_in_raw_section) {
@@ -1187,13 +1382,16 @@ void Object::addCommand(const std::string& pCommand,
         }
         else {
           aRawMode = rawMode_quad;
+          if (lRawCount > 0) {
+            getCurrentPrimitiveAccumulator().reserveQuads(lRawCount, false);
+          }
         }
       }
     }
     else if(pCommand == "raw_quad_colored") {
 
-      if (!pParameters.empty()) {
-        addSyntaxError(pCommand, "", pCurrentParser, pError);
+      if (!lRawCountOk || !lRawParameters.empty()) {
+        addSyntaxError(pCommand, "[count=#]", pCurrentParser, pError);
       }
       else {
         if (aRawMode != rawMode_not_in_raw_section) {
@@ -1201,13 +1399,16 @@ void Object::addCommand(const std::string& pCommand,
         }
         else {
           aRawMode = rawMode_quad_colored;
+          if (lRawCount > 0) {
+            getCurrentPrimitiveAccumulator().reserveQuads(lRawCount, true);
+          }
         }
       }
     }
     else if(pCommand == "raw_quad_v") {
 
-      if (!pParameters.empty()) {
-        addSyntaxError(pCommand, "", pCurrentParser, pError);
+      if (!lRawCountOk || !lRawParameters.empty()) {
+        addSyntaxError(pCommand, "[count=#]", pCurrentParser, pError);
       }
       else {
         if (aRawMode != rawMode_not_in_raw_section) {
@@ -1219,14 +1420,17 @@ void Object::addCommand(const std::string& pCommand,
           }
           else {
             aRawMode = rawMode_quad_v;
+            if (lRawCount > 0) {
+              getCurrentVertexedPrimitiveAccumulator().reserveQuads(lRawCount);
+            }
           }
         }
       }
     }
     else if(pCommand == "raw_vertex") {
 
-      if (!pParameters.empty()) {
-        addSyntaxError(pCommand, "", pCurrentParser, pError);
+      if (!lRawCountOk || !lRawParameters.empty()) {
+        addSyntaxError(pCommand, "[count=#]", pCurrentParser, pError);
       }
       else {
         if (aRawMode != rawMode_not_in_raw_section) {
@@ -1235,14 +1439,17 @@ void Object::addCommand(const std::string& pCommand,
         else {
           aRawMode                               = rawMode_vertex;
           aNewVertexedPrimitiveAccumulatorNeeded = true;
+          if (lRawCount > 0) {
+            getCurrentVertexAccumulator().reserveVertices(lRawCount);
+          }
         }
       }
 
     }
     else if(pCommand == "raw_color_v") {
 
-      if (!pParameters.empty()) {
-        addSyntaxError(pCommand, "", pCurrentParser, pError);
+      if (!lRawCountOk || !lRawParameters.empty()) {
+        addSyntaxError(pCommand, "[count=#]", pCurrentParser, pError);
       }
       else {
         if (aRawMode != rawMode_not_in_raw_section) {
@@ -1254,6 +1461,52 @@ void Object::addCommand(const std::string& pCommand,
           }
           else {
             aRawMode = rawMode_color_v;
+            if (lRawCount > 0) {
+              getCurrentVertexAccumulator().reserveColors(lRawCount);
+            }
+          }
+        }
+      }
+
+    }
+    else if(pCommand == "raw_instance") {
+
+      if (!lRawCountOk || countWords(lRawParameters) != 1) {
+        addSyntaxError(pCommand, "OBJECTNAME [count=#]", pCurrentParser, pError);
+      }
+      else {
+        if (aRawMode != rawMode_not_in_raw_section) {
+          addError("Nested raw sections are not supported", pCurrentParser, pError);
+        }
+        else {
+
+          // Find the last object with the given name
+          std::vector<int> lSlots;
+          findSubObjects(lRawParameters, lSlots);
+
+          if (lSlots.empty()) {
+            addError("raw_instance: Can't find the named object in the current object sub-objects",
+                     pCurrentParser, pError);
+          }
+          else {
+
+            const int lSubObjectId = lSlots.back();
+
+            // The prototype was closed by its object_end
+            GLV_ASSERT(aSubObjects[lSubObjectId]->aFrozen);
+
+            aInstanceAccumulators.push_back(new InstanceAccumulator(lSubObjectId,
+                                                                    aSubObjectSlots[lSubObjectId].aGeneration));
+
+            char lCommand[64];
+            sprintf(lCommand, "execute_instance_accumulator_id %lu", aInstanceAccumulators.size()-1);
+            aCommands.push_back(lCommand);
+
+            aRawMode       = rawMode_instance;
+            aColorSumValid = false;
+            if (lRawCount > 0) {
+              aInstanceAccumulators.back()->reserveInstances(lRawCount);
+            }
           }
         }
       }
@@ -1263,60 +1516,57 @@ void Object::addCommand(const std::string& pCommand,
     else if (pCommand == "object_begin") {
 
       Object* lNewObject = new Object();
-      aSubObjects.push_back(lNewObject);
 
       // The name might be empty, but it doesn't matter
       lNewObject->aName = pParameters;
 
-      char lObjCommand[64];
-      sprintf(lObjCommand,"execute_subobjects_id %lu", aSubObjects.size()-1);
-      aCommands.push_back(lObjCommand);
+      addSubObject(lNewObject);
 
       pCurrentParser.pushObject(lNewObject);
 
     }
-    else if (pCommand == "execute_object") {
+    else if (pCommand == "prototype_begin") {
 
       if (countWords(pParameters) != 1) {
         addSyntaxError(pCommand, "OBJECTNAME", pCurrentParser, pError);
       }
       else {
 
-        // Find the object with the given id
-        const int lNbSubObjects = static_cast<int>(aSubObjects.size());
-        bool      lFound        = false;
+        // Same as object_begin, except that the Object is
+        // only rendered by the raw_instance sections using it
+        Object* lNewObject = new Object();
 
-        for(int i=0; i<lNbSubObjects; ++i) {
+        lNewObject->aName = pParameters;
 
-          Object* lSubObjectPtr = aSubObjects[i];
+        addSubObject(lNewObject, false);
 
-          if (lSubObjectPtr != 0) {
-            if(lSubObjectPtr->aName == pParameters) {
-              char lObjCommand[64];
-              sprintf(lObjCommand,"execute_subobjects_id %d", i);
-              aCommands.push_back(lObjCommand);
-              lFound = true;
-            }
-          }
+        pCurrentParser.pushObject(lNewObject);
+      }
+
+    }
+    else if (pCommand == "execute_object") {
+
+      if (countWords(pParameters) != 1) {
+        addSyntaxError(pCommand, "OBJECTNAME", pCurrentParser, pError);
+      }
+      else {
+
+        // Find the objects with the given name
+        std::vector<int> lSlots;
+        findSubObjects(pParameters, lSlots);
+
+        for (std::vector<int>::size_type i=0; i<lSlots.size(); ++i) {
+          addSubObjectCommand(lSlots[i]);
         }
 
-        if(lFound) {
+        if(!lSlots.empty()) {
 
-          // We have to recompute the display lists and
-          // the BoundingBox. So we force it to happen.
-          const bool lFrozen = aFrozen;
-          if (aGLDisplayListFull != 0) {
-            glDeleteLists(aGLDisplayListFull, 1);
-          }
-          if (aGLDisplayListBoundingBox != 0) {
-            glDeleteLists(aGLDisplayListBoundingBox, 1);
-          }
-          if (aGLDisplayListFast != 0) {
-            glDeleteLists(aGLDisplayListFast, 1);
-          }
-          aFrozen = false;
-          getBoundingBox();
-          aFrozen = lFrozen;
+          // The Object is still parsed: it has no display lists
+          // (see render) and its BoundingBox is computed when it is
+          // asked for (see getBoundingBox). The display lists of the
+          // other sub-Objects don't change
+          GLV_ASSERT(!aFrozen);
+          aColorSumValid = false;
         }
         else {
           addError("execute_object: Can't find the named object in the current object sub-objects",
@@ -1336,6 +1586,31 @@ void Object::addCommand(const std::string& pCommand,
       // BoundingBox for the last time
       getBoundingBox();
       aFrozen = true;
+
+      // The accumulators won't change anymore: split
+      // them in chunks for the frustum culling
+      PrimitiveAccumulators::iterator       lIter    = aPrimitiveAccumulators.begin();
+      const PrimitiveAccumulators::iterator lIterEnd = aPrimitiveAccumulators.end  ();
+
+      while (lIter != lIterEnd) {
+        GLV_ASSERT(*lIter != 0);
+        (*lIter)->constructHierarchy();
+        ++lIter;
+      }
+
+      VertexedPrimitiveAccumulators::iterator       lIterVertexed    = aVertexedPrimitiveAccumulators.begin();
+      const VertexedPrimitiveAccumulators::iterator lIterVertexedEnd = aVertexedPrimitiveAccumulators.end  ();
+
+      while (lIterVertexed != lIterVertexedEnd) {
+        GLV_ASSERT(*lIterVertexed != 0);
+        (*lIterVertexed)->constructClusters();
+        ++lIterVertexed;
+      }
+
+      aFlagClusters    = hasClusters();
+      aFlagSingleSided = hasSingleSidedFaces();
+
+      compact();
     }
     else if(pCommand == "delete_object") {
 
@@ -1344,41 +1619,24 @@ void Object::addCommand(const std::string& pCommand,
       }
       else {
 
-        // Find the object with the given id
-        SubObjects::iterator       lIterSubObjects    = aSubObjects.begin();
-        const SubObjects::iterator lIterSubObjectsEnd = aSubObjects.end  ();
-        bool                       lFound             = false;
+        // Find the objects with the given name
+        std::vector<int> lSlots;
+        findSubObjects(pParameters, lSlots);
 
-        while (lIterSubObjects != lIterSubObjectsEnd) {
-          Object* lSubObjectPtr = *lIterSubObjects;
+        for (std::vector<int>::size_type i=0; i<lSlots.size(); ++i) {
+          removeSubObject(lSlots[i]);
+        }
 
-          if (lSubObjectPtr != 0) {
-            if(lSubObjectPtr->aName == pParameters) {
-              delete lSubObjectPtr;
-              *lIterSubObjects = 0;
-              lFound = true;
-            }
-          }
-          ++lIterSubObjects;
+        // Their commands are removed once they are the majority
+        if (2*aNbDeletedSubObjectCommands > static_cast<int>(aCommands.size())) {
+          purgeDeletedSubObjectCommands();
         }
 
-        if(lFound) {
+        if(!lSlots.empty()) {
 
-          // We have to recompute the display lists and
-          // the BoundingBox. So we force it to happen.
-          const bool lFrozen = aFrozen;
-          if (aGLDisplayListFull != 0) {
-            glDeleteLists(aGLDisplayListFull, 1);
-          }
-          if (aGLDisplayListBoundingBox != 0) {
-            glDeleteLists(aGLDisplayListBoundingBox, 1);
-          }
-          if (aGLDisplayListFast != 0) {
-            glDeleteLists(aGLDisplayListFast, 1);
-          }
-          aFrozen = false;
-          getBoundingBox();
-          aFrozen = lFrozen;
+          // Same as execute_object
+          GLV_ASSERT(!aFrozen);
+          aColorSumValid = false;
         }
         else {
           addError("delete_object: Can't find the named object in the current object sub-objects",
@@ -1386,6 +1644,17 @@ void Object::addCommand(const std::string& pCommand,
         }
       }
     }
+    else if(pCommand == "hide_object" ||
+            pCommand == "show_object"   ) {
+
+      if (countWords(pParameters) != 1) {
+        addSyntaxError(pCommand, "OBJECTNAME", pCurrentParser, pError);
+      }
+      else if (!setSubObjectsHidden(pParameters, pCommand == "hide_object")) {
+        addError(pCommand + ": Can't find the named object in the current object sub-objects",
+                 pCurrentParser, pError);
+      }
+    }
     // DIRECT OPENGL CALLS
     // DRAWING PARAMETERS
     else if(pCommand == "glcolor") {
@@ -1538,6 +1807,69 @@ void Object::addCommand(const std::string& pCommand,
   }
 }
 
+// Add a parent to the frozen Object (an included file parsed only
+// once, see Parser::parseInputFile). It is deleted with its last parent
+void Object::addReference()
+{
+  GLV_ASSERT(aFrozen);
+  GLV_ASSERT(aNbReferences >= 1);
+
+  ++aNbReferences;
+}
+
+// Add pSubObject at the end of the Object, as object_begin
+// does; or as prototype_begin does if pFlagExecute is false.
+// *this takes the ownership of pSubObject
+void Object::addSubObject(Object*    pSubObject,
+                          const bool pFlagExecute)
+{
+  GLV_ASSERT(pSubObject != 0);
+
+  if (2*(aNbIndexedSubObjects+1) > static_cast<int>(aSubObjectBuckets.size())) {
+    growSubObjectIndex();
+  }
+
+  // Reuse the slot of a deleted sub-Object, if any. Its
+  // generation tells its old commands from the new ones
+  int lSlot = aFreeSubObjectSlot;
+
+  if (lSlot >= 0) {
+    GLV_ASSERT(aSubObjects[lSlot] == 0);
+    aFreeSubObjectSlot = aSubObjectSlots[lSlot].aNext;
+    aSubObjects[lSlot] = pSubObject;
+  }
+  else {
+    lSlot = static_cast<int>(aSubObjects.size());
+    aSubObjects    .push_back(pSubObject);
+    aSubObjectSlots.push_back(SubObjectSlot());
+  }
+
+  // The last sub-Objects added are first in their bucket
+  const unsigned int lBucket = hashName(pSubObject->aName) & static_cast<unsigned int>(aSubObjectBuckets.size() - 1);
+
+  aSubObjectSlots[lSlot].aNext = aSubObjectBuckets[lBucket];
+  aSubObjectBuckets[lBucket]   = lSlot;
+  ++aNbIndexedSubObjects;
+
+  if (pFlagExecute) {
+    addSubObjectCommand(lSlot);
+  }
+}
+
+// Add the command rendering the sub-Object of pSlot
+void Object::addSubObjectCommand(const int pSlot)
+{
+  GLV_ASSERT(aSubObjects[pSlot] != 0);
+
+  SubObjectSlot& lSlot = aSubObjectSlots[pSlot];
+
+  char lObjCommand[64];
+  sprintf(lObjCommand,"execute_subobjects_id %d %u", pSlot, lSlot.aGeneration);
+  aCommands.push_back(lObjCommand);
+
+  ++lSlot.aNbCommands;
+}
+
 const BoundingBox& Object::getBoundingBox()
 {
 
@@ -1552,7 +1884,8 @@ const BoundingBox& Object::getBoundingBox()
     aBoundingBox = BoundingBox();
 
     // At first, we set the transformation to the identity
-    Matrix4x4 lTM;
+    Matrix4x4              lTM;
+    std::vector<Matrix4x4> lMatrixStack;
 
     Commands::const_iterator       lIterCommands    = aCommands.begin();
     const Commands::const_iterator lIterCommandsEnd = aCommands.end  ();
@@ -1598,22 +1931,55 @@ const BoundingBox& Object::getBoundingBox()
 
       }
       else if (lCommand == "execute_subobjects_id") {
-        GLV_ASSERT(countWords(lParameters) == 1);
-        int lSubObjectId = atoi(lParameters.c_str());
-        GLV_ASSERT(lSubObjectId >= 0);
-        GLV_ASSERT(lSubObjectId <  static_cast<int>(aSubObjects.size()));
+        GLV_ASSERT(countWords(lParameters) == 2);
+        Object* lSubObject = getSubObject(lParameters);
 
         // The sub-Object might have been deleted
-        if (aSubObjects[lSubObjectId] != 0) {
-          BoundingBox lBoundingBox = aSubObjects[lSubObjectId]->getBoundingBox();
+        if (lSubObject != 0) {
+          BoundingBox lBoundingBox = lSubObject->getBoundingBox();
 
           // Apply the transformation to the Bounding box
           // and add it to the object bounding box
           aBoundingBox += lTM * lBoundingBox;
         }
 
+      }
+      else if (lCommand == "execute_instance_accumulator_id") {
+        GLV_ASSERT(countWords(lParameters) == 1);
+        int lInstanceAccumulatorId = atoi(lParameters.c_str());
+        GLV_ASSERT(lInstanceAccumulatorId >= 0);
+        GLV_ASSERT(lInstanceAccumulatorId <  static_cast<int>(aInstanceAccumulators.size()));
+        GLV_ASSERT(aInstanceAccumulators[lInstanceAccumulatorId] != 0);
+
+        const InstanceAccumulator& lInstanceAccumulator = *aInstanceAccumulators[lInstanceAccumulatorId];
+
+        // The prototype might have been deleted
+        Object* lPrototype = getPrototype(lInstanceAccumulator);
+
+        if (lPrototype != 0) {
+          aBoundingBox += lTM * lInstanceAccumulator.getBoundingBox(lPrototype->getBoundingBox());
+        }
+
       }
       // DIRECT OPENGL CALLS
+      else if(lCommand == "glpushmatrix") {
+        lMatrixStack.push_back(lTM);
+
+      }
+      else if(lCommand == "glpopmatrix") {
+        if (!lMatrixStack.empty()) {
+          lTM = lMatrixStack.back();
+          lMatrixStack.pop_back();
+        }
+
+      }
+      else if(lCommand == "glvertex") {
+        float x, y, z;
+        sscanf(lParameters.c_str(), "%f %f %f", &x, &y, &z);
+
+        aBoundingBox += lTM * Vector3D(x, y, z);
+
+      }
       else if(lCommand == "gltranslate") {
         float tx, ty, tz;
         sscanf(lParameters.c_str(), "%f %f %f", &tx, &ty, &tz);
@@ -1649,44 +2015,17 @@ const BoundingBox& Object::getBoundingBox()
   return aBoundingBox;
 }
 
-void Object::render(RenderParameters& pParams)
+// Renders the Object with pRasterizer instead of OpenGL.
+// The commands are interpreted the same way as in
+// executeCommand, except for the text which is ignored
+void Object::rasterize(SoftwareRasterizer& pRasterizer,
+                       RenderParameters&   pParams)
 {
-  GLuint& lGLDisplayList = getGLDisplayList(pParams);
-
-  if (lGLDisplayList == 0) {
-    if (aFrozen) {
-      constructDisplayList(pParams);
-    }
-  }
-
-  if (lGLDisplayList != 0) {
-    glCallList(lGLDisplayList);
-  }
-  else {
-    // The Object is not frozen *or* GL doesn't want
-    // to return a valid aGLDisplayList*. So we just
-    // execute the commands
-    Commands::const_iterator       lIterCommands    = aCommands.begin();
-    const Commands::const_iterator lIterCommandsEnd = aCommands.end  ();
-
-    while (lIterCommands != lIterCommandsEnd) {
-      executeCommand(*lIterCommands, pParams);
-      ++lIterCommands;
-    }
-  }
-}
+  SoftwareRasterizer::State& lState = pRasterizer.getState();
+  std::vector<Matrix4x4>     lMatrixStack;
 
-void Object::constructDisplayList(RenderParameters& pParams)
-{
-  // First, we make sure that all the display lists for that
-  // RenderParameters::RenderMode for all the children are constructed
-  // We have to loop on the aCommands and not directly on aSubObjects
-  // because some commands change the attributes of pParams and
-  // influence the rendering
   Commands::const_iterator       lIterCommands    = aCommands.begin();
   const Commands::const_iterator lIterCommandsEnd = aCommands.end  ();
-  bool                           lAllChildrenOk   = true;
-  RenderParameters               lParams          = pParams;
 
   while (lIterCommands != lIterCommandsEnd) {
 
@@ -1698,15 +2037,904 @@ void Object::constructDisplayList(RenderParameters& pParams)
       lParameters = trimString(lIterCommands->substr(lEndWord+1), " \t\n");
     }
 
-    if (lCommand == "execute_subobjects_id") {
+    GLV_ASSERT(!lCommand.empty());
 
+    if (lCommand == "execute_primitive_accumulator_id") {
       GLV_ASSERT(countWords(lParameters) == 1);
-      int lSubObjectId = atoi(lParameters.c_str());
-      GLV_ASSERT(lSubObjectId >= 0);
-      GLV_ASSERT(lSubObjectId <  static_cast<int>(aSubObjects.size()));
-
-      Object* lSubObject = aSubObjects[lSubObjectId];
-
+      int lPrimitiveAccumulatorId = atoi(lParameters.c_str());
+      GLV_ASSERT(lPrimitiveAccumulatorId >= 0);
+      GLV_ASSERT(lPrimitiveAccumulatorId <  static_cast<int>(aPrimitiveAccumulators.size()));
+      GLV_ASSERT(aPrimitiveAccumulators[lPrimitiveAccumulatorId] != 0);
+
+      aPrimitiveAccumulators[lPrimitiveAccumulatorId]->rasterize(pRasterizer, pParams);
+
+    }
+    else if (lCommand == "execute_vertex_primitive_accumulator_id") {
+      GLV_ASSERT(countWords(lParameters) == 1);
+      int lVertexedPrimitiveAccumulatorId = atoi(lParameters.c_str());
+      GLV_ASSERT(lVertexedPrimitiveAccumulatorId >= 0);
+      GLV_ASSERT(lVertexedPrimitiveAccumulatorId <  static_cast<int>(aVertexedPrimitiveAccumulators.size()));
+      GLV_ASSERT(aVertexedPrimitiveAccumulators[lVertexedPrimitiveAccumulatorId] != 0);
+
+      aVertexedPrimitiveAccumulators[lVertexedPrimitiveAccumulatorId]->rasterize(pRasterizer, pParams);
+
+    }
+    else if (lCommand == "execute_subobjects_id") {
+      GLV_ASSERT(countWords(lParameters) == 2);
+      Object* lSubObject = getSubObject(lParameters, true);
+
+      // The sub-Object might have been deleted or hidden
+      if (lSubObject != 0) {
+
+        // Equivalent of the glPushMatrix/glPushAttrib
+        // done in executeCommand
+        const SoftwareRasterizer::State lSavedState = lState;
+
+        lSubObject->rasterize(pRasterizer, pParams);
+
+        lState = lSavedState;
+      }
+
+    }
+    else if (lCommand == "execute_instance_accumulator_id") {
+      GLV_ASSERT(countWords(lParameters) == 1);
+      int lInstanceAccumulatorId = atoi(lParameters.c_str());
+      GLV_ASSERT(lInstanceAccumulatorId >= 0);
+      GLV_ASSERT(lInstanceAccumulatorId <  static_cast<int>(aInstanceAccumulators.size()));
+      GLV_ASSERT(aInstanceAccumulators[lInstanceAccumulatorId] != 0);
+
+      const InstanceAccumulator& lInstanceAccumulator = *aInstanceAccumulators[lInstanceAccumulatorId];
+
+      // The prototype might have been deleted or hidden
+      Object* lPrototype = getPrototype(lInstanceAccumulator, true);
+
+      if (lPrototype != 0) {
+        lInstanceAccumulator.rasterize(*lPrototype, pRasterizer, pParams);
+      }
+
+    }
+    // DIRECT OPENGL CALLS
+    else if(lCommand == "glcolor") {
+      float r,g,b;
+      sscanf(lParameters.c_str(), "%f %f %f", &r, &g, &b);
+      lState.aColor = Vector3D(r, g, b);
+
+    }
+    else if(lCommand == "glpushmatrix") {
+      GLV_ASSERT(lParameters == "");
+      lMatrixStack.push_back(lState.aTransformation);
+
+    }
+    else if(lCommand == "glpopmatrix") {
+      GLV_ASSERT(lParameters == "");
+      if (!lMatrixStack.empty()) {
+        lState.aTransformation = lMatrixStack.back();
+        lMatrixStack.pop_back();
+      }
+
+    }
+    else if(lCommand == "glbegin_triangles") {
+      GLV_ASSERT(lParameters == "");
+      pRasterizer.beginPrimitive(SoftwareRasterizer::primitiveMode_triangles);
+
+    }
+    else if(lCommand == "glbegin_lines") {
+      GLV_ASSERT(lParameters == "");
+      pRasterizer.beginPrimitive(SoftwareRasterizer::primitiveMode_lines);
+
+    }
+    else if(lCommand == "glbegin_points") {
+      GLV_ASSERT(lParameters == "");
+      pRasterizer.beginPrimitive(SoftwareRasterizer::primitiveMode_points);
+
+    }
+    else if(lCommand == "glend") {
+      GLV_ASSERT(lParameters == "");
+      pRasterizer.endPrimitive();
+
+    }
+    else if(lCommand == "glvertex") {
+      float x,y,z;
+      sscanf(lParameters.c_str(), "%f %f %f", &x, &y, &z);
+      pRasterizer.addVertex(Vector3D(x, y, z));
+
+    }
+    else if(lCommand == "gltranslate") {
+      float x,y,z;
+      sscanf(lParameters.c_str(), "%f %f %f", &x, &y, &z);
+      lState.aTransformation.translate(Vector3D(x, y, z));
+
+    }
+    else if(lCommand == "glscale") {
+      float x,y,z;
+      sscanf(lParameters.c_str(), "%f %f %f", &x, &y, &z);
+      lState.aTransformation.scale(Vector3D(x, y, z));
+
+    }
+    else if(lCommand == "glpointsize") {
+      sscanf(lParameters.c_str(), "%f", &lState.aPointSize);
+
+    }
+    else if(lCommand == "gllinewidth") {
+      sscanf(lParameters.c_str(), "%f", &lState.aLineWidth);
+
+    }
+    // DRAWING PARAMETERS
+    else if(lCommand == "draw_single_sided") {
+      GLV_ASSERT(lParameters == "");
+      lState.aCullBackFaces    = true;
+      lState.aTwoSidedLighting = false;
+
+    }
+    else if(lCommand == "draw_double_sided") {
+      GLV_ASSERT(lParameters == "");
+      lState.aCullBackFaces    = false;
+      lState.aTwoSidedLighting = true;
+
+    }
+    else if(lCommand == "glenable_polygonoffset_fill") {
+      GLV_ASSERT(lParameters == "");
+      lState.aPolygonOffset = true;
+
+    }
+    else if(lCommand == "gldisable_polygonoffset_fill") {
+      GLV_ASSERT(lParameters == "");
+      lState.aPolygonOffset = false;
+
+    }
+    else if(lCommand == "draw_facetboundary_enable") {
+      pParams.aFlagRenderFacetFrame = true;
+      sscanf(lParameters.c_str(), "%f %f %f", &pParams.aFacetBoundaryR, &pParams.aFacetBoundaryG, &pParams.aFacetBoundaryB);
+      lState.aPolygonOffset = true;
+
+    }
+    else if(lCommand == "draw_facetboundary_disable") {
+      pParams.aFlagRenderFacetFrame = false;
+
+    }
+    else if(lCommand == "text") {
+      // The bitmap fonts are only available through GLUT
+
+    }
+    else {
+      GLV_ASSERT(false);
+    }
+
+    ++lIterCommands;
+  }
+}
+
+// Read an Object written by writeCache into this empty Object.
+// Returns false if the file is corrupted
+bool Object::readCache(FILE* pFilePtr)
+{
+  ReadObjects lReadObjects;
+
+  return readCache(pFilePtr, lReadObjects);
+}
+
+// Same as readCache, pReadObjects being the sub-Objects already
+// read, in the order of the indexes written by writeCache
+bool Object::readCache(FILE*        pFilePtr,
+                       ReadObjects& pReadObjects)
+{
+  GLV_ASSERT(aCommands.empty());
+  GLV_ASSERT(aSubObjects.empty());
+
+  unsigned long lNbCommands = 0;
+  int           lRawMode    = 0;
+
+  if (!readCacheString(pFilePtr, aName                                 ) ||
+      !readCacheValue (pFilePtr, lNbCommands                           ) ||
+      !readCacheValue (pFilePtr, aBoundingBox                          ) ||
+      !readCacheValue (pFilePtr, aFrozen                               ) ||
+      !readCacheValue (pFilePtr, aNewPrimitiveAccumulatorNeeded        ) ||
+      !readCacheValue (pFilePtr, aNewVertexAccumulatorNeeded           ) ||
+      !readCacheValue (pFilePtr, aNewVertexedPrimitiveAccumulatorNeeded) ||
+      !readCacheValue (pFilePtr, lRawMode                              ) ||
+      !readCacheValue (pFilePtr, aRawModeArrowTipNbPolygons            ) ||
+      !readCacheValue (pFilePtr, aRawModeArrowTipProportion            )) {
+    return false;
+  }
+
+  if (lRawMode < 0 || lRawMode > rawMode_not_in_raw_section) {
+    return false;
+  }
+  aRawMode = static_cast<RawMode>(lRawMode);
+
+  for (unsigned long i=0; i<lNbCommands; ++i) {
+    std::string lCommand;
+    if (!readCacheString(pFilePtr, lCommand)) {
+      return false;
+    }
+    aCommands.push_back(lCommand);
+  }
+
+  unsigned long lNbAccumulators = 0;
+
+  if (!readCacheValue(pFilePtr, lNbAccumulators)) {
+    return false;
+  }
+  for (unsigned long i=0; i<lNbAccumulators; ++i) {
+    aVertexAccumulators.push_back(new VertexAccumulator);
+    if (!aVertexAccumulators.back()->readCache(pFilePtr)) {
+      return false;
+    }
+  }
+
+  if (!readCacheValue(pFilePtr, lNbAccumulators)) {
+    return false;
+  }
+  for (unsigned long i=0; i<lNbAccumulators; ++i) {
+    aPrimitiveAccumulators.push_back(new PrimitiveAccumulator(true));
+    if (!aPrimitiveAccumulators.back()->readCache(pFilePtr)) {
+      return false;
+    }
+  }
+
+  if (!readCacheValue(pFilePtr, lNbAccumulators)) {
+    return false;
+  }
+  for (unsigned long i=0; i<lNbAccumulators; ++i) {
+
+    // Index of the shared VertexAccumulator
+    unsigned long lIndex = 0;
+    if (!readCacheValue(pFilePtr, lIndex) || lIndex >= aVertexAccumulators.size()) {
+      return false;
+    }
+
+    aVertexedPrimitiveAccumulators.push_back(new VertexedPrimitiveAccumulator(*aVertexAccumulators[lIndex]));
+    if (!aVertexedPrimitiveAccumulators.back()->readCache(pFilePtr)) {
+      return false;
+    }
+  }
+
+  if (!readCacheValue(pFilePtr, lNbAccumulators)) {
+    return false;
+  }
+  for (unsigned long i=0; i<lNbAccumulators; ++i) {
+    aInstanceAccumulators.push_back(new InstanceAccumulator(0, 0));
+    if (!aInstanceAccumulators.back()->readCache(pFilePtr)) {
+      return false;
+    }
+  }
+
+  unsigned long lNbSubObjects = 0;
+
+  if (!readCacheValue(pFilePtr, lNbSubObjects)) {
+    return false;
+  }
+  for (unsigned long i=0; i<lNbSubObjects; ++i) {
+
+    // Deleted sub-Objects are kept as null pointers (index -1),
+    // since the commands refer to the sub-Objects by slot.
+    // The shared sub-Objects are written only the first time,
+    // with the index of the next sub-Object read. The Objects
+    // read are complete: their name index stays empty
+    long lIndex = -1;
+    aSubObjectSlots.push_back(SubObjectSlot());
+    SubObjectSlot& lSlot = aSubObjectSlots.back();
+    if (!readCacheValue(pFilePtr, lSlot.aGeneration) ||
+        !readCacheValue(pFilePtr, lSlot.aHidden    ) ||
+        !readCacheValue(pFilePtr, lIndex           ) ||
+        lIndex < -1 || lIndex > static_cast<long>(pReadObjects.size())) {
+      return false;
+    }
+    if (lSlot.aHidden) {
+      ++aNbHiddenSubObjects;
+      ++gNbVisibilityChanges;
+    }
+
+    if (lIndex == -1) {
+      aSubObjects.push_back(0);
+    }
+    else if (lIndex < static_cast<long>(pReadObjects.size())) {
+      aSubObjects.push_back(pReadObjects[lIndex]);
+      aSubObjects.back()->addReference();
+    }
+    else {
+      aSubObjects.push_back(new Object);
+      if (!aSubObjects.back()->readCache(pFilePtr, pReadObjects)) {
+        return false;
+      }
+      pReadObjects.push_back(aSubObjects.back());
+    }
+  }
+
+  // The prototypes of the instances are sub-Objects
+  {
+    InstanceAccumulators::const_iterator       lIter    = aInstanceAccumulators.begin();
+    const InstanceAccumulators::const_iterator lIterEnd = aInstanceAccumulators.end  ();
+    while (lIter != lIterEnd) {
+      if ((*lIter)->getSubObjectId() >= static_cast<int>(aSubObjects.size())) {
+        return false;
+      }
+      ++lIter;
+    }
+  }
+
+  aFlagClusters    = hasClusters();
+  aFlagSingleSided = hasSingleSidedFaces();
+
+  return true;
+}
+
+// Remove a parent of the Object.
+// Returns true if it was the last one: the Object must be deleted
+bool Object::removeReference()
+{
+  GLV_ASSERT(aNbReferences >= 1);
+
+  --aNbReferences;
+
+  return (aNbReferences == 0);
+}
+
+void Object::render(RenderParameters& pParams)
+{
+  // Only the frozen Objects are culled: the BoundingBox of the
+  // others is out of date as soon as new data is parsed.
+  // The display list of the Object can't skip the parts outside
+  // of the frustum, so an Object partly inside the frustum renders
+  // its parts one by one instead
+  BoundingBox::FrustumVisibility lVisibility = BoundingBox::frustumVisibility_inside;
+
+  if (pParams.aFlagFrustumCulling && aFrozen) {
+    lVisibility = aBoundingBox.getFrustumVisibility();
+
+    if (lVisibility == BoundingBox::frustumVisibility_outside) {
+      return;
+    }
+  }
+
+  // An Object smaller than a few pixels on screen is only a point.
+  // Its sub-Objects can be small even if it's not, so they must
+  // be rendered one by one to be tested too
+  if (pParams.aSmallFeaturePixels > 0.0f && aFrozen) {
+    if (aBoundingBox.getProjectedSize() < pParams.aSmallFeaturePixels) {
+      renderAsPoint();
+      return;
+    }
+    if (!aSubObjects.empty()) {
+      lVisibility = BoundingBox::frustumVisibility_intersecting;
+    }
+  }
+
+  if (lVisibility == BoundingBox::frustumVisibility_intersecting) {
+    renderVisibleParts(pParams);
+    return;
+  }
+
+  // The level of detail of the accumulators depends on their size
+  // on screen, so it can't be recorded in the display list of the
+  // Object: the accumulators use their own display lists instead
+  if (pParams.aRenderMode == RenderParameters::renderMode_level_of_detail && aFrozen) {
+    renderVisibleParts(pParams);
+    return;
+  }
+
+  // Same thing for the clusters of faces culled by OpenGL
+  // (see PrimitiveAccumulator::renderHierarchy)
+  if (pParams.aFlagFrustumCulling && aFrozen && aFlagClusters &&
+      (aFlagSingleSided || glIsEnabled(GL_CULL_FACE))) {
+    renderVisibleParts(pParams);
+    return;
+  }
+
+  // The display list records the sub-Objects: it can't skip the
+  // hidden ones, so hiding an object doesn't change display lists
+  if (aFrozen && hasHiddenParts()) {
+    renderVisibleParts(pParams);
+    return;
+  }
+
+  GLuint lGLDisplayList = 0;
+
+  if (pParams.aRenderMode != RenderParameters::renderMode_level_of_detail) {
+    if (getGLDisplayList(pParams) == 0 && aFrozen) {
+      constructDisplayList(pParams);
+    }
+    lGLDisplayList = getGLDisplayList(pParams);
+  }
+
+  if (lGLDisplayList != 0) {
+    glCallList(lGLDisplayList);
+  }
+  else {
+    // The Object is not frozen *or* GL doesn't want
+    // to return a valid aGLDisplayList*. So we just
+    // execute the commands
+    Commands::const_iterator       lIterCommands    = aCommands.begin();
+    const Commands::const_iterator lIterCommandsEnd = aCommands.end  ();
+
+    while (lIterCommands != lIterCommandsEnd) {
+      executeCommand(*lIterCommands, pParams);
+      ++lIterCommands;
+    }
+  }
+}
+
+// Render the Object as a single point at the center of its
+// BoundingBox, in the mean color of its primitives
+void Object::renderAsPoint()
+{
+  GLV_ASSERT(aFrozen);
+
+  const ColorSum& lColorSum = getColorSum();
+
+  if (lColorSum.aNb == 0.0) {
+    return;
+  }
+
+  glPushAttrib(GL_CURRENT_BIT | GL_LIGHTING_BIT | GL_POINT_BIT);
+  glDisable(GL_LIGHTING);
+  glPointSize(1.0f);
+
+  GLfloat lCurrentColor[4];
+  glGetFloatv(GL_CURRENT_COLOR, lCurrentColor);
+
+  const Vector3D lColor = (lColorSum.aSum + Vector3D(lCurrentColor[0], lCurrentColor[1], lCurrentColor[2])*lColorSum.aNbInherited)/lColorSum.aNb;
+  const Vector3D lCenter = aBoundingBox.getCenter();
+
+  glBegin(GL_POINTS);
+  glColor3f (lColor .x(), lColor .y(), lColor .z());
+  glVertex3f(lCenter.x(), lCenter.y(), lCenter.z());
+  glEnd();
+
+  glPopAttrib();
+}
+
+// Render the parts of the Object (accumulators and sub-Objects)
+// that are not outside of the view frustum (if culling is enabled),
+// each with its own display list
+void Object::renderVisibleParts(RenderParameters& pParams)
+{
+  GLV_ASSERT(aFrozen);
+
+  Commands::const_iterator       lIterCommands    = aCommands.begin();
+  const Commands::const_iterator lIterCommandsEnd = aCommands.end  ();
+
+  while (lIterCommands != lIterCommandsEnd) {
+
+    std::string::size_type lEndWord = std::string::npos;
+    std::string            lCommand = extractCommandWord(*lIterCommands, lEndWord);
+
+    std::string lParameters;
+    if(lEndWord != std::string::npos) {
+      lParameters = trimString(lIterCommands->substr(lEndWord+1), " \t\n");
+    }
+
+    bool lVisible = true;
+
+    if (lCommand == "execute_primitive_accumulator_id") {
+      PrimitiveAccumulator* lPrimitiveAccumulator = aPrimitiveAccumulators[atoi(lParameters.c_str())];
+      GLV_ASSERT(lPrimitiveAccumulator != 0);
+
+      lVisible = (!pParams.aFlagFrustumCulling ||
+                  lPrimitiveAccumulator->getBoundingBox().getFrustumVisibility() != BoundingBox::frustumVisibility_outside);
+      if (lVisible) {
+        lPrimitiveAccumulator->constructDisplayList(pParams);
+      }
+    }
+    else if (lCommand == "execute_vertex_primitive_accumulator_id") {
+      VertexedPrimitiveAccumulator* lVertexedPrimitiveAccumulator = aVertexedPrimitiveAccumulators[atoi(lParameters.c_str())];
+      GLV_ASSERT(lVertexedPrimitiveAccumulator != 0);
+
+      lVisible = (!pParams.aFlagFrustumCulling ||
+                  lVertexedPrimitiveAccumulator->getBoundingBox().getFrustumVisibility() != BoundingBox::frustumVisibility_outside);
+      if (lVisible) {
+        lVertexedPrimitiveAccumulator->constructDisplayList(pParams);
+      }
+    }
+
+    // The sub-Objects are culled in their own render
+    if (lVisible) {
+      executeCommand(*lIterCommands, pParams);
+    }
+
+    ++lIterCommands;
+  }
+}
+
+// Replace the id of the commands "pCommand id" by pNewIds[id],
+// and remove them when it is negative
+void Object::renumberCommands(const std::string&      pCommand,
+                              const std::vector<int>& pNewIds)
+{
+  Commands::size_type lNbCommands = 0;
+
+  for (Commands::size_type i=0; i<aCommands.size(); ++i) {
+
+    std::string& lCommand = aCommands[i];
+    bool         lKeep    = true;
+
+    if (lCommand.size() > pCommand.size()                   &&
+        lCommand.compare(0, pCommand.size(), pCommand) == 0 &&
+        lCommand[pCommand.size()] == ' ') {
+
+      char*     lEnd = 0;
+      const int lId  = static_cast<int>(strtol(lCommand.c_str() + pCommand.size() + 1, &lEnd, 10));
+      GLV_ASSERT(lId >= 0);
+      GLV_ASSERT(lId <  static_cast<int>(pNewIds.size()));
+
+      if (pNewIds[lId] < 0) {
+        lKeep = false;
+      }
+      else if (pNewIds[lId] != lId) {
+        // What follows the id is kept, as the generation of a handle
+        char lNewCommand[64];
+        sprintf(lNewCommand, "%s %d", pCommand.c_str(), pNewIds[lId]);
+        lCommand = lNewCommand + std::string(lEnd);
+      }
+    }
+
+    if (lKeep) {
+      if (lNbCommands != i) {
+        aCommands[lNbCommands].swap(lCommand);
+      }
+      ++lNbCommands;
+    }
+  }
+
+  aCommands.resize(lNbCommands);
+}
+
+// Hide (or show, if pHidden is false) the sub-Objects named pName,
+// at any depth, as hide_object (or show_object) does. Only the bits
+// of their slots change, see hasHiddenParts. Their BoundingBox still
+// counts, so that showing them again doesn't change anything else.
+// Returns false if no sub-Object is named pName
+bool Object::setSubObjectsHidden(const std::string& pName,
+                                 const bool         pHidden)
+{
+  bool lFound = false;
+
+  for (SubObjects::size_type i=0; i<aSubObjects.size(); ++i) {
+
+    Object* lSubObject = aSubObjects[i];
+
+    if (lSubObject != 0) {
+      if (lSubObject->aName == pName) {
+        SubObjectSlot& lSlot = aSubObjectSlots[i];
+
+        if (lSlot.aHidden != pHidden) {
+          lSlot.aHidden         = pHidden;
+          aNbHiddenSubObjects += (pHidden ? 1 : -1);
+          ++gNbVisibilityChanges;
+        }
+        lFound = true;
+      }
+
+      if (lSubObject->setSubObjectsHidden(pName, pHidden)) {
+        lFound = true;
+      }
+    }
+  }
+
+  return lFound;
+}
+
+// Show all the hidden sub-Objects, at any depth
+void Object::showSubObjects()
+{
+  if (!hasHiddenParts()) {
+    return;
+  }
+
+  for (SubObjects::size_type i=0; i<aSubObjects.size(); ++i) {
+
+    Object* lSubObject = aSubObjects[i];
+
+    if (lSubObject != 0) {
+      if (aSubObjectSlots[i].aHidden) {
+        aSubObjectSlots[i].aHidden = false;
+        --aNbHiddenSubObjects;
+        ++gNbVisibilityChanges;
+      }
+      lSubObject->showSubObjects();
+    }
+  }
+}
+
+// Write the Object, its accumulators and its sub-Objects
+// in the parse cache file.
+// Returns false on a write error
+bool Object::writeCache(FILE* pFilePtr) const
+{
+  WrittenObjects lWrittenObjects;
+
+  return writeCache(pFilePtr, lWrittenObjects);
+}
+
+// Same as writeCache, pWrittenObjects being the index of
+// each sub-Object already written
+bool Object::writeCache(FILE*           pFilePtr,
+                        WrittenObjects& pWrittenObjects) const
+{
+  const unsigned long lNbCommands = aCommands.size();
+  const int           lRawMode    = aRawMode;
+
+  if (!writeCacheString(pFilePtr, aName                                 ) ||
+      !writeCacheValue (pFilePtr, lNbCommands                           ) ||
+      !writeCacheValue (pFilePtr, aBoundingBox                          ) ||
+      !writeCacheValue (pFilePtr, aFrozen                               ) ||
+      !writeCacheValue (pFilePtr, aNewPrimitiveAccumulatorNeeded        ) ||
+      !writeCacheValue (pFilePtr, aNewVertexAccumulatorNeeded           ) ||
+      !writeCacheValue (pFilePtr, aNewVertexedPrimitiveAccumulatorNeeded) ||
+      !writeCacheValue (pFilePtr, lRawMode                              ) ||
+      !writeCacheValue (pFilePtr, aRawModeArrowTipNbPolygons            ) ||
+      !writeCacheValue (pFilePtr, aRawModeArrowTipProportion            )) {
+    return false;
+  }
+
+  {
+    Commands::const_iterator       lIter    = aCommands.begin();
+    const Commands::const_iterator lIterEnd = aCommands.end  ();
+    while (lIter != lIterEnd) {
+      if (!writeCacheString(pFilePtr, *lIter)) {
+        return false;
+      }
+      ++lIter;
+    }
+  }
+
+  {
+    if (!writeCacheValue(pFilePtr, static_cast<unsigned long>(aVertexAccumulators.size()))) {
+      return false;
+    }
+
+    VertexAccumulators::const_iterator       lIter    = aVertexAccumulators.begin();
+    const VertexAccumulators::const_iterator lIterEnd = aVertexAccumulators.end  ();
+    while (lIter != lIterEnd) {
+      if (!(*lIter)->writeCache(pFilePtr)) {
+        return false;
+      }
+      ++lIter;
+    }
+  }
+
+  {
+    if (!writeCacheValue(pFilePtr, static_cast<unsigned long>(aPrimitiveAccumulators.size()))) {
+      return false;
+    }
+
+    PrimitiveAccumulators::const_iterator       lIter    = aPrimitiveAccumulators.begin();
+    const PrimitiveAccumulators::const_iterator lIterEnd = aPrimitiveAccumulators.end  ();
+    while (lIter != lIterEnd) {
+      if (!(*lIter)->writeCache(pFilePtr)) {
+        return false;
+      }
+      ++lIter;
+    }
+  }
+
+  {
+    if (!writeCacheValue(pFilePtr, static_cast<unsigned long>(aVertexedPrimitiveAccumulators.size()))) {
+      return false;
+    }
+
+    VertexedPrimitiveAccumulators::const_iterator       lIter    = aVertexedPrimitiveAccumulators.begin();
+    const VertexedPrimitiveAccumulators::const_iterator lIterEnd = aVertexedPrimitiveAccumulators.end  ();
+    while (lIter != lIterEnd) {
+
+      // Find the index of the shared VertexAccumulator
+      const VertexAccumulator* lVertexAccumulator = &(*lIter)->getVertexAccumulator();
+      unsigned long            lIndex             = 0;
+      while (aVertexAccumulators[lIndex] != lVertexAccumulator) {
+        ++lIndex;
+        GLV_ASSERT(lIndex < aVertexAccumulators.size());
+      }
+
+      if (!writeCacheValue(pFilePtr, lIndex) ||
+          !(*lIter)->writeCache(pFilePtr)) {
+        return false;
+      }
+      ++lIter;
+    }
+  }
+
+  {
+    if (!writeCacheValue(pFilePtr, static_cast<unsigned long>(aInstanceAccumulators.size()))) {
+      return false;
+    }
+
+    InstanceAccumulators::const_iterator       lIter    = aInstanceAccumulators.begin();
+    const InstanceAccumulators::const_iterator lIterEnd = aInstanceAccumulators.end  ();
+    while (lIter != lIterEnd) {
+      if (!(*lIter)->writeCache(pFilePtr)) {
+        return false;
+      }
+      ++lIter;
+    }
+  }
+
+  {
+    if (!writeCacheValue(pFilePtr, static_cast<unsigned long>(aSubObjects.size()))) {
+      return false;
+    }
+
+    SubObjects::const_iterator       lIter     = aSubObjects.begin();
+    const SubObjects::const_iterator lIterEnd  = aSubObjects.end  ();
+    SubObjectSlots::const_iterator   lIterSlot = aSubObjectSlots.begin();
+    while (lIter != lIterEnd) {
+
+      // See readCache. A new sub-Object gets its index
+      // once its own sub-Objects are written
+      long lIndex = -1;
+      bool lNew   = false;
+
+      if (*lIter != 0) {
+        const WrittenObjects::const_iterator lIterWritten = pWrittenObjects.find(*lIter);
+
+        lNew   = (lIterWritten == pWrittenObjects.end());
+        lIndex = (lNew ? static_cast<long>(pWrittenObjects.size()) : lIterWritten->second);
+      }
+
+      if (!writeCacheValue(pFilePtr, lIterSlot->aGeneration) ||
+          !writeCacheValue(pFilePtr, lIterSlot->aHidden    ) ||
+          !writeCacheValue(pFilePtr, lIndex                )) {
+        return false;
+      }
+
+      if (lNew) {
+        if (!(*lIter)->writeCache(pFilePtr, pWrittenObjects)) {
+          return false;
+        }
+
+        const long lNewIndex = static_cast<long>(pWrittenObjects.size());
+        pWrittenObjects[*lIter] = lNewIndex;
+      }
+
+      ++lIter;
+      ++lIterSlot;
+    }
+  }
+
+  return true;
+}
+
+// Release the memory that the frozen Object doesn't need anymore
+// (at object_end): the slots of the deleted sub-Objects and the
+// instances of the deleted prototypes, whose commands are removed
+// and the others renumbered, the name index of the sub-Objects,
+// and the unused capacity of the vectors and of the accumulators
+void Object::compact()
+{
+  GLV_ASSERT(aFrozen);
+
+  size_t lReleased = 0;
+
+  // The commands of the deleted sub-Objects might use
+  // slots reused since then: remove them first
+  if (aNbDeletedSubObjectCommands > 0) {
+    purgeDeletedSubObjectCommands();
+  }
+
+  // Drop the slots of the deleted sub-Objects
+  std::vector<int>      lNewSubObjectIds(aSubObjects.size(), -1);
+  SubObjects::size_type lNbSubObjects = 0;
+
+  for (SubObjects::size_type i=0; i<aSubObjects.size(); ++i) {
+    if (aSubObjects[i] != 0) {
+      lNewSubObjectIds[i]              = static_cast<int>(lNbSubObjects);
+      aSubObjectSlots[lNbSubObjects]   = aSubObjectSlots[i];
+      aSubObjects    [lNbSubObjects++] = aSubObjects[i];
+    }
+  }
+
+  // The instances of the deleted prototypes too
+  std::vector<int>                lNewInstanceAccumulatorIds(aInstanceAccumulators.size(), -1);
+  InstanceAccumulators::size_type lNbInstanceAccumulators = 0;
+
+  for (InstanceAccumulators::size_type i=0; i<aInstanceAccumulators.size(); ++i) {
+
+    InstanceAccumulator* lInstanceAccumulator = aInstanceAccumulators[i];
+    const int            lSubObjectId         = lNewSubObjectIds[lInstanceAccumulator->getSubObjectId()];
+
+    if (lSubObjectId < 0 ||
+        aSubObjectSlots[lSubObjectId].aGeneration != lInstanceAccumulator->getSubObjectGeneration()) {
+      // The prototype was deleted
+      delete lInstanceAccumulator;
+      lReleased += sizeof(InstanceAccumulator);
+    }
+    else {
+      lInstanceAccumulator->setSubObjectId(lSubObjectId);
+      lNewInstanceAccumulatorIds[i]                    = static_cast<int>(lNbInstanceAccumulators);
+      aInstanceAccumulators[lNbInstanceAccumulators++] = lInstanceAccumulator;
+    }
+  }
+
+  if (lNbSubObjects < aSubObjects.size()) {
+    aSubObjects    .resize(lNbSubObjects);
+    aSubObjectSlots.resize(lNbSubObjects);
+    renumberCommands("execute_subobjects_id", lNewSubObjectIds);
+  }
+
+  if (lNbInstanceAccumulators < aInstanceAccumulators.size()) {
+    aInstanceAccumulators.resize(lNbInstanceAccumulators);
+    renumberCommands("execute_instance_accumulator_id", lNewInstanceAccumulatorIds);
+  }
+
+  // No more sub-Objects are added or deleted
+  lReleased += aSubObjectBuckets.capacity() * sizeof(int);
+  SubObjectBuckets().swap(aSubObjectBuckets);
+  aFreeSubObjectSlot   = -1;
+  aNbIndexedSubObjects = 0;
+
+  {
+    Commands::iterator       lIter    = aCommands.begin();
+    const Commands::iterator lIterEnd = aCommands.end  ();
+    while (lIter != lIterEnd) {
+      const std::string::size_type lCapacity = lIter->capacity();
+      std::string(*lIter).swap(*lIter);
+      lReleased += lCapacity - lIter->capacity();
+      ++lIter;
+    }
+  }
+
+  for (InstanceAccumulators::size_type i=0; i<aInstanceAccumulators.size(); ++i) {
+    lReleased += aInstanceAccumulators[i]->compact();
+  }
+  for (PrimitiveAccumulators::size_type i=0; i<aPrimitiveAccumulators.size(); ++i) {
+    lReleased += aPrimitiveAccumulators[i]->compact();
+  }
+  for (VertexAccumulators::size_type i=0; i<aVertexAccumulators.size(); ++i) {
+    lReleased += aVertexAccumulators[i]->compact();
+  }
+  for (VertexedPrimitiveAccumulators::size_type i=0; i<aVertexedPrimitiveAccumulators.size(); ++i) {
+    lReleased += aVertexedPrimitiveAccumulators[i]->compact();
+  }
+
+  lReleased += (shrinkToFit(aCommands                     ) +
+                shrinkToFit(aInstanceAccumulators         ) +
+                shrinkToFit(aPrimitiveAccumulators        ) +
+                shrinkToFit(aSubObjects                   ) +
+                shrinkToFit(aSubObjectSlots               ) +
+                shrinkToFit(aVertexAccumulators           ) +
+                shrinkToFit(aVertexedPrimitiveAccumulators));
+
+#ifdef GLV_DUMP_MEMORY_USAGE
+  aReleasedBytes = lReleased;
+#endif // #ifdef GLV_DUMP_MEMORY_USAGE
+}
+
+void Object::constructDisplayList(RenderParameters& pParams)
+{
+  // First, we make sure that all the display lists for that
+  // RenderParameters::RenderMode for all the children are constructed
+  // We have to loop on the aCommands and not directly on aSubObjects
+  // because some commands change the attributes of pParams and
+  // influence the rendering
+  Commands::const_iterator       lIterCommands    = aCommands.begin();
+  const Commands::const_iterator lIterCommandsEnd = aCommands.end  ();
+  bool                           lAllChildrenOk   = true;
+  RenderParameters               lParams          = pParams;
+
+  while (lIterCommands != lIterCommandsEnd) {
+
+    std::string::size_type lEndWord = std::string::npos;
+    std::string            lCommand = extractCommandWord(*lIterCommands, lEndWord);
+
+    std::string lParameters;
+    if(lEndWord != std::string::npos) {
+      lParameters = trimString(lIterCommands->substr(lEndWord+1), " \t\n");
+    }
+
+    if (lCommand == "execute_subobjects_id" ||
+        lCommand == "execute_instance_accumulator_id") {
+
+      Object* lSubObject = 0;
+
+      // The instances call the display lists of their prototype
+      if (lCommand == "execute_instance_accumulator_id") {
+        GLV_ASSERT(countWords(lParameters) == 1);
+        lSubObject = getPrototype(*aInstanceAccumulators[atoi(lParameters.c_str())]);
+      }
+      else {
+        GLV_ASSERT(countWords(lParameters) == 2);
+        lSubObject = getSubObject(lParameters);
+      }
+
       // The sub-Object might have been deleted
       if (lSubObject != 0) {
 
@@ -1732,6 +2960,12 @@ void Object::constructDisplayList(RenderParameters& pParams)
 
       }
     }
+    else if (lCommand == "execute_primitive_accumulator_id") {
+      aPrimitiveAccumulators[atoi(lParameters.c_str())]->constructDisplayList(lParams);
+    }
+    else if (lCommand == "execute_vertex_primitive_accumulator_id") {
+      aVertexedPrimitiveAccumulators[atoi(lParameters.c_str())]->constructDisplayList(lParams);
+    }
     else if(lCommand == "draw_facetboundary_enable") {
       lParams.aFlagRenderFacetFrame = true;
     }
@@ -1772,12 +3006,17 @@ void Object::constructDisplayList(RenderParameters& pParams)
 
     if (lGLDisplayList != 0) {
 
+      // The display list must not depend on the current view
+      RenderParameters lListParams = pParams;
+      lListParams.aFlagFrustumCulling = false;
+      lListParams.aSmallFeaturePixels = 0.0f;
+
       glNewList(lGLDisplayList, GL_COMPILE);
 
       lIterCommands = aCommands.begin();
 
       while (lIterCommands != lIterCommandsEnd) {
-        executeCommand(*lIterCommands, pParams);
+        executeCommand(*lIterCommands, lListParams);
         ++lIterCommands;
       }
 
@@ -1818,7 +3057,13 @@ void Object::executeCommand(const std::string& pCommand,
     GLV_ASSERT(lPrimitiveAccumulatorId <  static_cast<int>(aPrimitiveAccumulators.size()));
     GLV_ASSERT(aPrimitiveAccumulators[lPrimitiveAccumulatorId] != 0);
 
-    aPrimitiveAccumulators[lPrimitiveAccumulatorId]->render(pParams);
+    // The accumulators of a frozen Object don't change anymore
+    if (aFrozen) {
+      aPrimitiveAccumulators[lPrimitiveAccumulatorId]->renderDisplayList(pParams);
+    }
+    else {
+      aPrimitiveAccumulators[lPrimitiveAccumulatorId]->render(pParams);
+    }
 
   }
   else if (lCommand == "execute_vertex_primitive_accumulator_id") {
@@ -1828,17 +3073,20 @@ void Object::executeCommand(const std::string& pCommand,
     GLV_ASSERT(lVertexedPrimitiveAccumulatorId <  static_cast<int>(aVertexedPrimitiveAccumulators.size()));
     GLV_ASSERT(aVertexedPrimitiveAccumulators[lVertexedPrimitiveAccumulatorId] != 0);
 
-    aVertexedPrimitiveAccumulators[lVertexedPrimitiveAccumulatorId]->render(pParams);
+    if (aFrozen) {
+      aVertexedPrimitiveAccumulators[lVertexedPrimitiveAccumulatorId]->renderDisplayList(pParams);
+    }
+    else {
+      aVertexedPrimitiveAccumulators[lVertexedPrimitiveAccumulatorId]->render(pParams);
+    }
 
   }
   else if (lCommand == "execute_subobjects_id") {
-    GLV_ASSERT(countWords(lParameters) == 1);
-    int lSubObjectId = atoi(lParameters.c_str());
-    GLV_ASSERT(lSubObjectId >= 0);
-    GLV_ASSERT(lSubObjectId <  static_cast<int>(aSubObjects.size()));
+    GLV_ASSERT(countWords(lParameters) == 2);
+    Object* lSubObject = getSubObject(lParameters, true);
 
-    // The sub-Object might have been deleted
-    if (aSubObjects[lSubObjectId] != 0) {
+    // The sub-Object might have been deleted or hidden
+    if (lSubObject != 0) {
 
       // We don't want the transformations of that
       // sub-Object to influence the transformation
@@ -1846,12 +3094,29 @@ void Object::executeCommand(const std::string& pCommand,
       glPushMatrix();
       glPushAttrib(GL_CURRENT_BIT | GL_POINT_BIT | GL_LINE_BIT | GL_POLYGON_BIT | GL_ENABLE_BIT);
 
-      aSubObjects[lSubObjectId]->render(pParams);
+      lSubObject->render(pParams);
 
       glPopAttrib();
       glPopMatrix();
     }
 
+  }
+  else if (lCommand == "execute_instance_accumulator_id") {
+    GLV_ASSERT(countWords(lParameters) == 1);
+    int lInstanceAccumulatorId = atoi(lParameters.c_str());
+    GLV_ASSERT(lInstanceAccumulatorId >= 0);
+    GLV_ASSERT(lInstanceAccumulatorId <  static_cast<int>(aInstanceAccumulators.size()));
+    GLV_ASSERT(aInstanceAccumulators[lInstanceAccumulatorId] != 0);
+
+    const InstanceAccumulator& lInstanceAccumulator = *aInstanceAccumulators[lInstanceAccumulatorId];
+
+    // The prototype might have been deleted or hidden
+    Object* lPrototype = getPrototype(lInstanceAccumulator, true);
+
+    if (lPrototype != 0) {
+      lInstanceAccumulator.render(*lPrototype, pParams);
+    }
+
   }
   // DIRECT OPENGL CALLS
   else if(lCommand == "glcolor") {
@@ -2060,6 +3325,111 @@ VertexedPrimitiveAccumulator& Object::getCurrentVertexedPrimitiveAccumulator()
   return *(aVertexedPrimitiveAccumulators.back());
 }
 
+// Add pColorSum, the ColorSum of a part of the Object, to aColorSum.
+// The primitives of that part without color use pColor if pFlagColor
+// is true (a glcolor command came before), or the color current when
+// the Object is rendered otherwise
+void Object::addColorSum(const ColorSum& pColorSum,
+                         const Vector3D& pColor,
+                         const bool      pFlagColor)
+{
+  aColorSum.aSum += pColorSum.aSum;
+  aColorSum.aNb  += pColorSum.aNb;
+
+  if (pFlagColor) {
+    aColorSum.aSum += pColor*pColorSum.aNbInherited;
+  }
+  else {
+    aColorSum.aNbInherited += pColorSum.aNbInherited;
+  }
+}
+
+// Returns the ColorSum of the Object, computed the first time
+// from its commands
+const Object::ColorSum& Object::getColorSum()
+{
+  GLV_ASSERT(aFrozen);
+
+  if (aColorSumValid) {
+    return aColorSum;
+  }
+
+  aColorSum = ColorSum();
+
+  Vector3D lColor;
+  bool     lFlagColor = false;
+
+  Commands::const_iterator       lIterCommands    = aCommands.begin();
+  const Commands::const_iterator lIterCommandsEnd = aCommands.end  ();
+
+  while (lIterCommands != lIterCommandsEnd) {
+
+    std::string::size_type lEndWord = std::string::npos;
+    std::string            lCommand = extractCommandWord(*lIterCommands, lEndWord);
+
+    std::string lParameters;
+    if(lEndWord != std::string::npos) {
+      lParameters = trimString(lIterCommands->substr(lEndWord+1), " \t\n");
+    }
+
+    ColorSum lColorSum;
+
+    if (lCommand == "glcolor") {
+      float r,g,b;
+      sscanf(lParameters.c_str(), "%f %f %f", &r, &g, &b);
+      lColor     = Vector3D(r, g, b);
+      lFlagColor = true;
+    }
+    else if (lCommand == "execute_primitive_accumulator_id") {
+      aPrimitiveAccumulators[atoi(lParameters.c_str())]->addColors(lColorSum.aSum, lColorSum.aNb, lColorSum.aNbInherited);
+      lColorSum.aNb += lColorSum.aNbInherited;
+      addColorSum(lColorSum, lColor, lFlagColor);
+    }
+    else if (lCommand == "execute_vertex_primitive_accumulator_id") {
+      aVertexedPrimitiveAccumulators[atoi(lParameters.c_str())]->addColors(lColorSum.aSum, lColorSum.aNb, lColorSum.aNbInherited);
+      lColorSum.aNb += lColorSum.aNbInherited;
+      addColorSum(lColorSum, lColor, lFlagColor);
+    }
+    else if (lCommand == "execute_subobjects_id") {
+      Object* lSubObject = getSubObject(lParameters);
+
+      // The sub-Object might have been deleted
+      if (lSubObject != 0) {
+        addColorSum(lSubObject->getColorSum(), lColor, lFlagColor);
+      }
+    }
+    else if (lCommand == "execute_instance_accumulator_id") {
+      const InstanceAccumulator& lInstanceAccumulator = *aInstanceAccumulators[atoi(lParameters.c_str())];
+
+      Object* lPrototype = getPrototype(lInstanceAccumulator);
+
+      // The prototype might have been deleted
+      if (lPrototype != 0) {
+
+        // The primitives of the prototype without color use
+        // the color of the instance, if it has one
+        const ColorSum& lPrototypeColorSum = lPrototype->getColorSum();
+        const double    lNbInstances       = lInstanceAccumulator.getNbInstances();
+        Vector3D        lInstancesSum;
+        double          lNbColored         = 0.0;
+
+        lInstanceAccumulator.addColors(lInstancesSum, lNbColored);
+
+        lColorSum.aSum         = lPrototypeColorSum.aSum*lNbInstances + lInstancesSum*lPrototypeColorSum.aNbInherited;
+        lColorSum.aNbInherited = lPrototypeColorSum.aNbInherited*(lNbInstances - lNbColored);
+        lColorSum.aNb          = lPrototypeColorSum.aNb*lNbInstances;
+        addColorSum(lColorSum, lColor, lFlagColor);
+      }
+    }
+
+    ++lIterCommands;
+  }
+
+  aColorSumValid = true;
+
+  return aColorSum;
+}
+
 GLuint& Object::getGLDisplayList(const RenderParameters& pParams)
 {
   switch (pParams.aRenderMode) {
@@ -2078,3 +3448,250 @@ GLuint& Object::getGLDisplayList(const RenderParameters& pParams)
   }
   return aGLDisplayListFast;
 }
+
+// Returns true if the Object, or one of its frozen sub-Objects,
+// has accumulators split in clusters that can be culled
+bool Object::hasClusters() const
+{
+  PrimitiveAccumulators::const_iterator       lIter    = aPrimitiveAccumulators.begin();
+  const PrimitiveAccumulators::const_iterator lIterEnd = aPrimitiveAccumulators.end  ();
+
+  while (lIter != lIterEnd) {
+    if (*lIter != 0 && (*lIter)->hasHierarchy()) {
+      return true;
+    }
+    ++lIter;
+  }
+
+  VertexedPrimitiveAccumulators::const_iterator       lIterVertexed    = aVertexedPrimitiveAccumulators.begin();
+  const VertexedPrimitiveAccumulators::const_iterator lIterVertexedEnd = aVertexedPrimitiveAccumulators.end  ();
+
+  while (lIterVertexed != lIterVertexedEnd) {
+    if (*lIterVertexed != 0 && (*lIterVertexed)->hasClusters()) {
+      return true;
+    }
+    ++lIterVertexed;
+  }
+
+  SubObjects::const_iterator       lIterSubObjects    = aSubObjects.begin();
+  const SubObjects::const_iterator lIterSubObjectsEnd = aSubObjects.end  ();
+
+  while (lIterSubObjects != lIterSubObjectsEnd) {
+    if (*lIterSubObjects != 0 && (*lIterSubObjects)->aFlagClusters) {
+      return true;
+    }
+    ++lIterSubObjects;
+  }
+
+  return false;
+}
+
+// Returns true if one of the sub-Objects, at any depth, is hidden.
+// The display lists of such an Object can't be used, since they
+// call the display lists of all the sub-Objects (see render).
+// Computed again only after a hide_object or a show_object
+bool Object::hasHiddenParts()
+{
+  if (aNbVisibilityChanges != gNbVisibilityChanges) {
+
+    aNbVisibilityChanges = gNbVisibilityChanges;
+    aFlagHiddenParts     = (aNbHiddenSubObjects > 0);
+
+    for (SubObjects::size_type i=0; i<aSubObjects.size() && !aFlagHiddenParts; ++i) {
+      aFlagHiddenParts = (aSubObjects[i] != 0 && aSubObjects[i]->hasHiddenParts());
+    }
+  }
+
+  return aFlagHiddenParts;
+}
+
+// Returns true if the Object, or one of its frozen sub-Objects,
+// culls the back faces: its display list can't skip the clusters
+// of faces culled by OpenGL then (see render)
+bool Object::hasSingleSidedFaces() const
+{
+  Commands::const_iterator       lIterCommands    = aCommands.begin();
+  const Commands::const_iterator lIterCommandsEnd = aCommands.end  ();
+
+  while (lIterCommands != lIterCommandsEnd) {
+    std::string::size_type lEndWord = std::string::npos;
+
+    if (extractCommandWord(*lIterCommands, lEndWord) == "draw_single_sided") {
+      return true;
+    }
+    ++lIterCommands;
+  }
+
+  SubObjects::const_iterator       lIterSubObjects    = aSubObjects.begin();
+  const SubObjects::const_iterator lIterSubObjectsEnd = aSubObjects.end  ();
+
+  while (lIterSubObjects != lIterSubObjectsEnd) {
+    if (*lIterSubObjects != 0 && (*lIterSubObjects)->aFlagSingleSided) {
+      return true;
+    }
+    ++lIterSubObjects;
+  }
+
+  return false;
+}
+
+// Find the sub-Objects named pName, in the order they were added
+void Object::findSubObjects(const std::string& pName,
+                            std::vector<int>&  pSlots) const
+{
+  pSlots.clear();
+
+  if (aSubObjectBuckets.empty()) {
+    return;
+  }
+
+  const unsigned int lBucket = hashName(pName) & static_cast<unsigned int>(aSubObjectBuckets.size() - 1);
+
+  for (int lSlot = aSubObjectBuckets[lBucket]; lSlot >= 0; lSlot = aSubObjectSlots[lSlot].aNext) {
+    GLV_ASSERT(aSubObjects[lSlot] != 0);
+    if (aSubObjects[lSlot]->aName == pName) {
+      pSlots.push_back(lSlot);
+    }
+  }
+
+  std::reverse(pSlots.begin(), pSlots.end());
+}
+
+// Returns the prototype of the instances of pInstanceAccumulator,
+// or 0 if it was deleted (or hidden, if pFlagVisibleOnly is true)
+Object* Object::getPrototype(const InstanceAccumulator& pInstanceAccumulator,
+                             const bool                 pFlagVisibleOnly) const
+{
+  return getSubObject(pInstanceAccumulator.getSubObjectId(),
+                      pInstanceAccumulator.getSubObjectGeneration(),
+                      pFlagVisibleOnly);
+}
+
+// Returns the sub-Object of the handle pSlot/pGeneration, or 0 if it
+// was deleted: the slot might hold a sub-Object added since then.
+// The hidden sub-Objects are found only if pFlagVisibleOnly is false
+Object* Object::getSubObject(const int          pSlot,
+                             const unsigned int pGeneration,
+                             const bool         pFlagVisibleOnly) const
+{
+  GLV_ASSERT(pSlot >= 0);
+  GLV_ASSERT(pSlot <  static_cast<int>(aSubObjects.size()));
+
+  const SubObjectSlot& lSlot = aSubObjectSlots[pSlot];
+
+  if (lSlot.aGeneration != pGeneration || (pFlagVisibleOnly && lSlot.aHidden)) {
+    return 0;
+  }
+  return aSubObjects[pSlot];
+}
+
+// Same as above, with the parameters of an execute_subobjects_id
+Object* Object::getSubObject(const std::string& pHandle,
+                             const bool         pFlagVisibleOnly) const
+{
+  int          lSlot       = -1;
+  unsigned int lGeneration = 0;
+
+  if (sscanf(pHandle.c_str(), "%d %u", &lSlot, &lGeneration) != 2) {
+    GLV_ASSERT(false);
+    return 0;
+  }
+  return getSubObject(lSlot, lGeneration, pFlagVisibleOnly);
+}
+
+// Double the number of buckets of the name index of the sub-Objects,
+// a hash table chaining the slots through SubObjectSlot::aNext
+void Object::growSubObjectIndex()
+{
+  SubObjectBuckets lBuckets(aSubObjectBuckets.empty() ? 64 : 2*aSubObjectBuckets.size(), -1);
+
+  const unsigned int lMask = static_cast<unsigned int>(lBuckets.size() - 1);
+  std::vector<int>   lChain;
+
+  for (SubObjectBuckets::size_type i=0; i<aSubObjectBuckets.size(); ++i) {
+
+    lChain.clear();
+    for (int lSlot = aSubObjectBuckets[i]; lSlot >= 0; lSlot = aSubObjectSlots[lSlot].aNext) {
+      lChain.push_back(lSlot);
+    }
+
+    // Keep the last sub-Objects added first, see findSubObjects
+    while (!lChain.empty()) {
+      const int          lSlot   = lChain.back();
+      const unsigned int lBucket = hashName(aSubObjects[lSlot]->aName) & lMask;
+
+      aSubObjectSlots[lSlot].aNext = lBuckets[lBucket];
+      lBuckets[lBucket]            = lSlot;
+      lChain.pop_back();
+    }
+  }
+
+  aSubObjectBuckets.swap(lBuckets);
+}
+
+// Remove the execute_subobjects_id of the deleted sub-Objects. Called
+// when they are the majority of the commands, so that creating and
+// deleting objects doesn't make the commands grow
+void Object::purgeDeletedSubObjectCommands()
+{
+  static const std::string lPrefix = "execute_subobjects_id ";
+
+  Commands::size_type lNbCommands = 0;
+
+  for (Commands::size_type i=0; i<aCommands.size(); ++i) {
+
+    std::string& lCommand = aCommands[i];
+
+    if (lCommand.compare(0, lPrefix.size(), lPrefix) != 0 ||
+        getSubObject(lCommand.substr(lPrefix.size())) != 0) {
+      if (lNbCommands != i) {
+        aCommands[lNbCommands].swap(lCommand);
+      }
+      ++lNbCommands;
+    }
+  }
+
+  aCommands.resize(lNbCommands);
+
+  aNbDeletedSubObjectCommands = 0;
+}
+
+// Delete the sub-Object of pSlot, as delete_object does. The
+// slot is reused by the next sub-Object added, with the next
+// generation; the commands of the deleted one do nothing
+void Object::removeSubObject(const int pSlot)
+{
+  Object* lSubObject = aSubObjects[pSlot];
+  GLV_ASSERT(lSubObject != 0);
+
+  // Unlink the slot from its bucket
+  int* lLink = &aSubObjectBuckets[hashName(lSubObject->aName) & static_cast<unsigned int>(aSubObjectBuckets.size() - 1)];
+
+  while (*lLink != pSlot) {
+    GLV_ASSERT(*lLink >= 0);
+    lLink = &aSubObjectSlots[*lLink].aNext;
+  }
+
+  SubObjectSlot& lSlot = aSubObjectSlots[pSlot];
+
+  *lLink = lSlot.aNext;
+  --aNbIndexedSubObjects;
+
+  if (lSubObject->removeReference()) {
+    delete lSubObject;
+  }
+  aSubObjects[pSlot] = 0;
+
+  aNbDeletedSubObjectCommands += lSlot.aNbCommands;
+
+  if (lSlot.aHidden) {
+    --aNbHiddenSubObjects;
+    ++gNbVisibilityChanges;
+  }
+
+  lSlot.aHidden      = false;
+  lSlot.aNbCommands  = 0;
+  lSlot.aNext        = aFreeSubObjectSlot;
+  aFreeSubObjectSlot = pSlot;
+  ++lSlot.aGeneration;
+}
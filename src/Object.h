@@ -21,15 +21,19 @@
 #ifndef OBJECT_H
 #define OBJECT_H
 
+#include "arena_utils.h"
 #include "BoundingBox.h"
 #include "glinclude.h"
 #include "RenderParameters.h"
 #include <map>
+#include <stdio.h>
 #include <string>
 #include <vector>
 
+class InstanceAccumulator;
 class Parser;
 class PrimitiveAccumulator;
+class SoftwareRasterizer;
 class VertexAccumulator;
 class VertexedPrimitiveAccumulator;
 
@@ -42,11 +46,20 @@ public:
   Object ();
   ~Object();
 
+  static void* operator new   (size_t pBytes);
+  static void  operator delete(void*  pPtr,
+                               size_t pBytes);
+
   void                addCommand         (const std::string& pCommand,
                                           const std::string& pParameters,
                                           Parser&            pCurrentParser,
                                           std::string&       pError);
 
+  void                addReference       ();
+
+  void                addSubObject       (Object*            pSubObject,
+                                          const bool         pFlagExecute = true);
+
   void                deleteDisplayLists ();
 
   void                dumpCharacteristics(std::ostream&      pOstream,
@@ -55,20 +68,37 @@ public:
 
   const BoundingBox&  getBoundingBox     ();
 
+  void                rasterize          (SoftwareRasterizer& pRasterizer,
+                                          RenderParameters&   pParams);
+
+  bool                readCache          (FILE*              pFilePtr);
+
+  bool                removeReference    ();
+
   void                render             (RenderParameters&  pParams);
 
+  bool                setSubObjectsHidden(const std::string& pName,
+                                          const bool         pHidden);
+
+  void                showSubObjects     ();
+
+  bool                writeCache         (FILE*              pFilePtr) const;
+
 private:
 
   // Block the use of those
   Object(const Object&);
   Object& operator=(const Object&);
 
-  typedef  std::vector<std::string>                    Commands;
-  typedef  std::map<std::string, Object*>              IndexNamedObjects;
-  typedef  std::vector<PrimitiveAccumulator*>          PrimitiveAccumulators;
-  typedef  std::vector<Object*>                        SubObjects;
-  typedef  std::vector<VertexAccumulator*>             VertexAccumulators;
-  typedef  std::vector<VertexedPrimitiveAccumulator*>  VertexedPrimitiveAccumulators;
+  typedef  std::vector<std::string, ArenaAllocator<std::string> >                                    Commands;
+  typedef  std::map<std::string, Object*>                                                             IndexNamedObjects;
+  typedef  std::vector<Object*>                                                                       ReadObjects;
+  typedef  std::map<const Object*, long>                                                              WrittenObjects;
+  typedef  std::vector<InstanceAccumulator*,          ArenaAllocator<InstanceAccumulator*> >          InstanceAccumulators;
+  typedef  std::vector<PrimitiveAccumulator*,         ArenaAllocator<PrimitiveAccumulator*> >         PrimitiveAccumulators;
+  typedef  std::vector<Object*,                       ArenaAllocator<Object*> >                       SubObjects;
+  typedef  std::vector<VertexAccumulator*,            ArenaAllocator<VertexAccumulator*> >            VertexAccumulators;
+  typedef  std::vector<VertexedPrimitiveAccumulator*, ArenaAllocator<VertexedPrimitiveAccumulator*> > VertexedPrimitiveAccumulators;
 
   enum RawMode {rawMode_arrow,
                 rawMode_arrow_colored,
@@ -86,9 +116,41 @@ private:
                 rawMode_quad_v,
                 rawMode_vertex,
                 rawMode_color_v,
+                rawMode_instance,
                 rawMode_not_in_raw_section};
 
 
+  // Colors of the primitives of a frozen Object and of its sub-Objects
+  struct ColorSum {
+    Vector3D aSum;         // Sum of the colors known from the Object
+    double   aNbInherited; // Primitives drawn with the color current when the Object is rendered
+    double   aNb;          // All the primitives
+
+    ColorSum() : aSum(), aNbInherited(0.0), aNb(0.0) {}
+  };
+
+  // Slot of a sub-Object in aSubObjects. The commands refer to a
+  // sub-Object by the handle "slot generation", see getSubObject
+  struct SubObjectSlot {
+    unsigned int aGeneration; // Incremented when the sub-Object is deleted
+    bool         aHidden;     // See setSubObjectsHidden
+    int          aNbCommands; // Commands using the current generation
+    int          aNext;       // Next slot of the bucket in the name index, or next free slot
+
+    SubObjectSlot() : aGeneration(0), aHidden(false), aNbCommands(0), aNext(-1) {}
+  };
+
+  typedef  std::vector<int,           ArenaAllocator<int> >           SubObjectBuckets;
+  typedef  std::vector<SubObjectSlot, ArenaAllocator<SubObjectSlot> > SubObjectSlots;
+
+  void                           addColorSum                           (const ColorSum&           pColorSum,
+                                                                        const Vector3D&           pColor,
+                                                                        const bool                pFlagColor);
+
+  void                           addSubObjectCommand                   (const int                 pSlot);
+
+  void                           compact                               ();
+
   void                           constructDisplayList                  (RenderParameters&         pParams);
 
   void                           executeCommand                        (const std::string&        pCommand,
@@ -100,16 +162,71 @@ private:
 
   VertexedPrimitiveAccumulator&  getCurrentVertexedPrimitiveAccumulator();
 
+  void                           findSubObjects                        (const std::string&        pName,
+                                                                        std::vector<int>&         pSlots) const;
+
+  const ColorSum&                getColorSum                           ();
+
   GLuint&                        getGLDisplayList                      (const RenderParameters&   pParams);
 
+  Object*                        getPrototype                          (const InstanceAccumulator& pInstanceAccumulator,
+                                                                        const bool                pFlagVisibleOnly = false) const;
+
+  Object*                        getSubObject                          (const int                 pSlot,
+                                                                        const unsigned int        pGeneration,
+                                                                        const bool                pFlagVisibleOnly = false) const;
+
+  Object*                        getSubObject                          (const std::string&        pHandle,
+                                                                        const bool                pFlagVisibleOnly = false) const;
+
+  void                           growSubObjectIndex                    ();
+
+  bool                           readCache                             (FILE*                     pFilePtr,
+                                                                        ReadObjects&              pReadObjects);
+
+  bool                           hasClusters                           () const;
+
+  bool                           hasHiddenParts                        ();
+
+  bool                           hasSingleSidedFaces                   () const;
+
+  void                           purgeDeletedSubObjectCommands         ();
+
+  void                           removeSubObject                       (const int                 pSlot);
+
+  void                           renderAsPoint                         ();
+
+  void                           renderVisibleParts                    (RenderParameters&         pParams);
+
+  void                           renumberCommands                      (const std::string&        pCommand,
+                                                                        const std::vector<int>&   pNewIds);
+
+  bool                           writeCache                            (FILE*                     pFilePtr,
+                                                                        WrittenObjects&           pWrittenObjects) const;
+
 
   BoundingBox                    aBoundingBox;
   Commands                       aCommands;
+  ColorSum                       aColorSum;
+  bool                           aColorSumValid;
+  bool                           aFlagClusters;    // See hasClusters
+  bool                           aFlagHiddenParts; // See hasHiddenParts
+  bool                           aFlagSingleSided; // See hasSingleSidedFaces
+  int                            aFreeSubObjectSlot; // First free slot, see removeSubObject
   bool                           aFrozen;
   GLuint                         aGLDisplayListBoundingBox;
   GLuint                         aGLDisplayListFast;
   GLuint                         aGLDisplayListFull;
+  InstanceAccumulators           aInstanceAccumulators;
   std::string                    aName;
+  int                            aNbDeletedSubObjectCommands; // See purgeDeletedSubObjectCommands
+  int                            aNbHiddenSubObjects;
+  int                            aNbIndexedSubObjects;
+  int                            aNbReferences; // Parents sharing the Object, see addReference
+  unsigned int                   aNbVisibilityChanges; // See hasHiddenParts
+#ifdef GLV_DUMP_MEMORY_USAGE
+  size_t                         aReleasedBytes; // By compact
+#endif // #ifdef GLV_DUMP_MEMORY_USAGE
   bool                           aNewPrimitiveAccumulatorNeeded;
   bool                           aNewVertexAccumulatorNeeded;
   bool                           aNewVertexedPrimitiveAccumulatorNeeded;
@@ -117,7 +234,9 @@ private:
   RawMode                        aRawMode;
   int                            aRawModeArrowTipNbPolygons;
   float                          aRawModeArrowTipProportion;
+  SubObjectBuckets               aSubObjectBuckets; // Name index of the sub-Objects, see growSubObjectIndex
   SubObjects                     aSubObjects;
+  SubObjectSlots                 aSubObjectSlots;
   VertexAccumulators             aVertexAccumulators;
   VertexedPrimitiveAccumulators  aVertexedPrimitiveAccumulators;
 
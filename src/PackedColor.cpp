@@ -0,0 +1,52 @@
+//  glv - OpenGL viewer command line tool
+/*****************************************************************************
+ * Copyright (C) 2003 Patrick Lagace <bl4cklight@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *****************************************************************************/
+
+#include "PackedColor.h"
+
+// Maps a byte back to [0, 1]
+const float PackedColor::aScale = 1.0f/255.0f;
+
+// Encodes a component clamped to [0, 1] in a byte
+static unsigned char packComponent(const float pVal)
+{
+  if (pVal <= 0.0f) {
+    return 0;
+  }
+  else if (pVal >= 1.0f) {
+    return 255;
+  }
+  return static_cast<unsigned char>(pVal*255.0f + 0.5f);
+}
+
+PackedColor::PackedColor()
+{
+  aVals[0] = 0;
+  aVals[1] = 0;
+  aVals[2] = 0;
+  aVals[3] = 255;
+}
+
+PackedColor::PackedColor(const Vector3D& pColor)
+{
+  aVals[0] = packComponent(pColor.x());
+  aVals[1] = packComponent(pColor.y());
+  aVals[2] = packComponent(pColor.z());
+  aVals[3] = 255;
+}
@@ -0,0 +1,57 @@
+//  glv - OpenGL viewer command line tool
+/*****************************************************************************
+ * Copyright (C) 2003 Patrick Lagace <bl4cklight@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *****************************************************************************/
+
+#ifndef PACKEDCOLOR_H
+#define PACKEDCOLOR_H
+
+#include "Vector3D.h"
+
+// Color stored in 4 bytes (RGBA8) instead of the 12 of a Vector3D.
+// The components are clamped to [0, 1], as OpenGL does for the
+// colors of the vertices, and decoded when converted back.
+class PackedColor
+{
+public:
+
+  PackedColor ();
+  PackedColor (const Vector3D& pColor);
+  ~PackedColor() {}
+
+  operator Vector3D() const {
+    return Vector3D(aVals[0]*aScale, aVals[1]*aScale, aVals[2]*aScale);
+  }
+
+private:
+
+  static const float aScale;
+
+  unsigned char aVals[4];
+
+};
+
+// Type of the colors stored in the accumulators. Compiling with
+// GLV_COMPACT_ATTRIBUTES trades their precision for memory.
+#ifdef GLV_COMPACT_ATTRIBUTES
+typedef PackedColor StoredColor;
+#else
+typedef Vector3D    StoredColor;
+#endif
+
+#endif // PACKEDCOLOR_H
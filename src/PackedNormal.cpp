@@ -0,0 +1,66 @@
+//  glv - OpenGL viewer command line tool
+/*****************************************************************************
+ * Copyright (C) 2003 Patrick Lagace <bl4cklight@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *****************************************************************************/
+
+#include "PackedNormal.h"
+
+#include <cmath>
+
+// Maps [-1, 1] on the signed 10 bits integers
+const float PackedNormal::aScale = 511.0f;
+
+// Encodes a component clamped to [-1, 1] on 10 bits
+static unsigned int packComponent(const float pVal,
+                                  const float pScale)
+{
+  float lVal = pVal;
+  if (lVal < -1.0f) {
+    lVal = -1.0f;
+  }
+  else if (lVal > 1.0f) {
+    lVal = 1.0f;
+  }
+  const int lInt = static_cast<int>(std::floor(lVal*pScale + 0.5f));
+  return static_cast<unsigned int>(lInt) & 0x3ff;
+}
+
+// Decodes the 10 bits starting at pShift, extending their sign
+static float unpackComponent(const unsigned int pVal,
+                             const int          pShift,
+                             const float        pScale)
+{
+  int lInt = static_cast<int>((pVal >> pShift) & 0x3ff);
+  if (lInt & 0x200) {
+    lInt -= 0x400;
+  }
+  return lInt/pScale;
+}
+
+PackedNormal::PackedNormal(const Vector3D& pNormal)
+  : aVal(packComponent(pNormal.x(), aScale)       |
+         packComponent(pNormal.y(), aScale) << 10 |
+         packComponent(pNormal.z(), aScale) << 20)
+{}
+
+PackedNormal::operator Vector3D() const
+{
+  return Vector3D(unpackComponent(aVal,  0, aScale),
+                  unpackComponent(aVal, 10, aScale),
+                  unpackComponent(aVal, 20, aScale));
+}
@@ -0,0 +1,56 @@
+//  glv - OpenGL viewer command line tool
+/*****************************************************************************
+ * Copyright (C) 2003 Patrick Lagace <bl4cklight@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *****************************************************************************/
+
+#ifndef PACKEDNORMAL_H
+#define PACKEDNORMAL_H
+
+#include "Vector3D.h"
+
+// Normal stored in 4 bytes instead of the 12 of a Vector3D, with
+// the 2-10-10-10 layout: each component is a signed 10 bits integer
+// mapping [-1, 1], the 2 upper bits are unused. Unlike an octahedral
+// encoding, the length is kept, since some normals (the base of the
+// arrow tips) are shortened on purpose to attenuate the lighting.
+class PackedNormal
+{
+public:
+
+  PackedNormal () : aVal(0) {}
+  PackedNormal (const Vector3D& pNormal);
+  ~PackedNormal() {}
+
+  operator Vector3D() const;
+
+private:
+
+  static const float aScale;
+
+  unsigned int aVal;
+
+};
+
+// Type of the normals stored in the accumulators, see StoredColor
+#ifdef GLV_COMPACT_ATTRIBUTES
+typedef PackedNormal StoredNormal;
+#else
+typedef Vector3D     StoredNormal;
+#endif
+
+#endif // PACKEDNORMAL_H
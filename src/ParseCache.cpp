@@ -0,0 +1,303 @@
+//  glv - OpenGL viewer command line tool
+/*****************************************************************************
+ * Copyright (C) 2003 Patrick Lagace <bl4cklight@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+*****************************************************************************/
+
+#include "ParseCache.h"
+#include "assert_glv.h"
+#include "cache_utils.h"
+#include "Object.h"
+#include "Vector3D.h"
+
+#include <cstring>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef WIN32
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif // #ifndef WIN32
+
+// Increment when the binary layout of the parsed data changes.
+// The compact attributes (see StoredColor) have their own layout
+#ifdef GLV_COMPACT_ATTRIBUTES
+const unsigned int ParseCache::aFormatVersion    = 1009;
+#else
+const unsigned int ParseCache::aFormatVersion    = 9;
+#endif
+
+// Smaller inputs are parsed faster than they are hashed and read back
+const long long    ParseCache::aMinimumInputSize = 1024*1024;
+
+static const char               gMagic[]  = "glv parse cache";
+static const unsigned long long gHashSeed = 14695981039346656037ULL;
+
+// 64 bits FNV-1a hash of pSize bytes, continuing from pHash
+static unsigned long long hashBytes(const unsigned char* pBytes,
+                                    const size_t         pSize,
+                                    unsigned long long   pHash)
+{
+  for (size_t i=0; i<pSize; ++i) {
+    pHash ^= pBytes[i];
+    pHash *= 1099511628211ULL;
+  }
+  return pHash;
+}
+
+// Find the cache directory and create it if needed.
+// The cache is disabled (empty aDirectory) if there's no
+// usable directory
+ParseCache::ParseCache()
+  : aDirectory()
+{
+#ifndef WIN32
+  std::string lBaseDirectory;
+
+  const char* lCacheHome = getenv("XDG_CACHE_HOME");
+  const char* lHomeDir   = getenv("HOME");
+
+  if (lCacheHome != 0 && lCacheHome[0] == '/') {
+    lBaseDirectory = lCacheHome;
+  }
+  else if (lHomeDir != 0) {
+    lBaseDirectory = std::string(lHomeDir) + "/.cache";
+  }
+
+  if (!lBaseDirectory.empty()) {
+    const std::string lDirectory = lBaseDirectory + "/glv";
+
+    mkdir(lBaseDirectory.c_str(), 0755);
+    mkdir(lDirectory    .c_str(), 0755);
+
+    if (access(lDirectory.c_str(), R_OK | W_OK | X_OK) == 0) {
+      aDirectory = lDirectory;
+    }
+  }
+#endif // #ifndef WIN32
+}
+
+ParseCache::~ParseCache()
+{}
+
+// Fill pObject with the cached version of the file pFilename
+// Returns false if there's no valid cache entry for the file,
+// in which case pObject must be discarded
+bool ParseCache::readObject(const std::string& pFilename,
+                            Object&            pObject) const
+{
+  const std::string lCacheFilename = getCacheFilename(pFilename);
+
+  if (lCacheFilename.empty()) {
+    return false;
+  }
+
+  FILE* lFilePtr = fopen(lCacheFilename.c_str(), "rb");
+
+  if (lFilePtr == 0) {
+    return false;
+  }
+
+  std::string   lMagic;
+  unsigned int  lFormatVersion   = 0;
+  unsigned int  lSizeOfLong      = 0;
+  unsigned int  lSizeOfVector3D  = 0;
+  unsigned long lNbInputFiles    = 0;
+
+  bool lValid = (readCacheString(lFilePtr, lMagic         ) &&
+                 readCacheValue (lFilePtr, lFormatVersion ) &&
+                 readCacheValue (lFilePtr, lSizeOfLong    ) &&
+                 readCacheValue (lFilePtr, lSizeOfVector3D) &&
+                 readCacheValue (lFilePtr, lNbInputFiles  ) &&
+                 lMagic          == gMagic                   &&
+                 lFormatVersion  == aFormatVersion           &&
+                 lSizeOfLong     == sizeof(long)             &&
+                 lSizeOfVector3D == sizeof(Vector3D));
+
+  // All the files read to build the Object must be unchanged
+  for (unsigned long i=0; lValid && i<lNbInputFiles; ++i) {
+
+    FileKey lCachedKey;
+    FileKey lCurrentKey;
+
+    lValid = (readCacheString(lFilePtr, lCachedKey.aPath            ) &&
+              readCacheValue (lFilePtr, lCachedKey.aSize            ) &&
+              readCacheValue (lFilePtr, lCachedKey.aModificationTime) &&
+              readCacheValue (lFilePtr, lCachedKey.aHash            ) &&
+              getFileKey(lCachedKey.aPath, lCurrentKey)               &&
+              lCurrentKey.aSize             == lCachedKey.aSize         &&
+              lCurrentKey.aModificationTime == lCachedKey.aModificationTime &&
+              lCurrentKey.aHash             == lCachedKey.aHash);
+  }
+
+  if (lValid) {
+    lValid = pObject.readCache(lFilePtr);
+  }
+
+  fclose(lFilePtr);
+
+  return lValid;
+}
+
+// Write pObject, the result of the parsing of pFilename, in the cache.
+// pInputFilenames are all the files read while parsing pFilename,
+// including pFilename itself.
+// Failures are silently ignored: the file will be parsed again next time
+void ParseCache::writeObject(const std::string&              pFilename,
+                             const std::vector<std::string>& pInputFilenames,
+                             const Object&                   pObject) const
+{
+  const std::string lCacheFilename = getCacheFilename(pFilename);
+
+  if (lCacheFilename.empty()) {
+    return;
+  }
+
+  std::vector<FileKey> lKeys(pInputFilenames.size());
+  long long            lInputSize = 0;
+
+  for (std::vector<std::string>::size_type i=0; i<pInputFilenames.size(); ++i) {
+    if (!getFileKey(pInputFilenames[i], lKeys[i])) {
+      return;
+    }
+    lInputSize += lKeys[i].aSize;
+  }
+
+  if (lInputSize < aMinimumInputSize) {
+    return;
+  }
+
+#ifndef WIN32
+  // Write in a temporary file first, so that another glv reading
+  // the cache never sees a partially written entry
+  char lPid[32];
+  sprintf(lPid, ".%d", static_cast<int>(getpid()));
+  const std::string lTemporaryFilename = lCacheFilename + lPid;
+
+  FILE* lFilePtr = fopen(lTemporaryFilename.c_str(), "wb");
+
+  if (lFilePtr == 0) {
+    return;
+  }
+
+  bool lOk = (writeCacheString(lFilePtr, gMagic                                                ) &&
+              writeCacheValue (lFilePtr, aFormatVersion                                        ) &&
+              writeCacheValue (lFilePtr, static_cast<unsigned int>(sizeof(long))              ) &&
+              writeCacheValue (lFilePtr, static_cast<unsigned int>(sizeof(Vector3D))          ) &&
+              writeCacheValue (lFilePtr, static_cast<unsigned long>(lKeys.size())             ));
+
+  std::vector<FileKey>::const_iterator       lIter    = lKeys.begin();
+  const std::vector<FileKey>::const_iterator lIterEnd = lKeys.end  ();
+
+  while (lOk && lIter != lIterEnd) {
+    lOk = (writeCacheString(lFilePtr, lIter->aPath            ) &&
+           writeCacheValue (lFilePtr, lIter->aSize            ) &&
+           writeCacheValue (lFilePtr, lIter->aModificationTime) &&
+           writeCacheValue (lFilePtr, lIter->aHash            ));
+    ++lIter;
+  }
+
+  if (lOk) {
+    lOk = pObject.writeCache(lFilePtr);
+  }
+
+  if (fclose(lFilePtr) != 0) {
+    lOk = false;
+  }
+
+  if (lOk && rename(lTemporaryFilename.c_str(), lCacheFilename.c_str()) == 0) {
+    std::cerr << "Cached    : " << pFilename << std::endl;
+  }
+  else {
+    unlink(lTemporaryFilename.c_str());
+  }
+#endif // #ifndef WIN32
+}
+
+// Name of the cache entry of pFilename: hash of its canonical path.
+// Returns an empty string if the cache is disabled
+std::string ParseCache::getCacheFilename(const std::string& pFilename) const
+{
+  if (aDirectory.empty()) {
+    return "";
+  }
+
+#ifdef WIN32
+  return "";
+#else // #ifdef WIN32
+  char lCanonicalPath[PATH_MAX];
+
+  if (realpath(pFilename.c_str(), lCanonicalPath) == 0) {
+    return "";
+  }
+
+  const unsigned long long lHash = hashBytes(reinterpret_cast<const unsigned char*>(lCanonicalPath),
+                                             strlen(lCanonicalPath),
+                                             gHashSeed);
+
+  char lName[64];
+  sprintf(lName, "/%08lx%08lx.cache",
+          static_cast<unsigned long>(lHash >> 32),
+          static_cast<unsigned long>(lHash & 0xffffffffUL));
+
+  return aDirectory + lName;
+#endif // #ifdef WIN32
+}
+
+// Compute the key of the file pFilename
+// Returns false if the file can't be read
+bool ParseCache::getFileKey(const std::string& pFilename,
+                            FileKey&           pKey)
+{
+#ifdef WIN32
+  return false;
+#else // #ifdef WIN32
+  char        lCanonicalPath[PATH_MAX];
+  struct stat lStat;
+
+  if (realpath(pFilename.c_str(), lCanonicalPath) == 0 ||
+      stat(lCanonicalPath, &lStat) != 0) {
+    return false;
+  }
+
+  FILE* lFilePtr = fopen(lCanonicalPath, "rb");
+
+  if (lFilePtr == 0) {
+    return false;
+  }
+
+  std::vector<unsigned char> lBuffer(64*1024);
+  unsigned long long         lHash = gHashSeed;
+  size_t                     lRead = 0;
+
+  while ((lRead = fread(&lBuffer[0], 1, lBuffer.size(), lFilePtr)) > 0) {
+    lHash = hashBytes(&lBuffer[0], lRead, lHash);
+  }
+
+  fclose(lFilePtr);
+
+  pKey.aPath             = lCanonicalPath;
+  pKey.aSize             = lStat.st_size;
+  pKey.aModificationTime = lStat.st_mtime;
+  pKey.aHash             = lHash;
+
+  return true;
+#endif // #ifdef WIN32
+}
@@ -0,0 +1,75 @@
+//  glv - OpenGL viewer command line tool
+/*****************************************************************************
+ * Copyright (C) 2003 Patrick Lagace <bl4cklight@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+*****************************************************************************/
+
+#ifndef PARSECACHE_H
+#define PARSECACHE_H
+
+#include <string>
+#include <vector>
+
+class Object;
+
+// On-disk cache of the parsed files (~/.cache/glv).
+// Once a large file is parsed, the Object created for it is
+// written in binary form with the key of every file read to
+// build it (the file itself and its includes): canonical path,
+// size, modification time and content hash. The next time the
+// file is read, the Object is loaded from the cache instead of
+// being parsed, unless one of the input files changed.
+class ParseCache
+{
+public:
+
+  ParseCache ();
+  ~ParseCache();
+
+  bool readObject (const std::string&              pFilename,
+                   Object&                         pObject) const;
+
+  void writeObject(const std::string&              pFilename,
+                   const std::vector<std::string>& pInputFilenames,
+                   const Object&                   pObject) const;
+
+private:
+
+  // Block the use of those
+  ParseCache(const ParseCache&);
+  ParseCache& operator=(const ParseCache&);
+
+  struct FileKey {
+    std::string        aPath;
+    long long          aSize;
+    long long          aModificationTime;
+    unsigned long long aHash;
+  };
+
+  std::string getCacheFilename(const std::string& pFilename) const;
+
+  static bool getFileKey      (const std::string& pFilename,
+                               FileKey&           pKey);
+
+  static const unsigned int aFormatVersion;
+  static const long long    aMinimumInputSize;
+
+  std::string aDirectory;
+
+};
+
+#endif // PARSECACHE_H
@@ -22,9 +22,16 @@
 #include "assert_glv.h"
 #include "Snapshot.h"
 #include "Object.h"
+#include "ParseCache.h"
 #include "string_utils.h"
 #include "WindowGLV.h"
 
+#ifndef WIN32
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#endif // #ifndef WIN32
+
 // For usleep
 #ifndef WIN32
 #include <unistd.h>
@@ -50,6 +57,32 @@ bool isBlank(const std::string& pLine)
   return pLine.find_first_not_of(" \n\t") == std::string::npos;
 }
 
+// Read a "<width>x<height>" geometry argument.
+// Returns false on a syntax error
+static
+bool readGeometry(const std::string& pGeometry,
+                  int&               pWidth,
+                  int&               pHeight)
+{
+  std::string::size_type lXIndex = pGeometry.find_first_of("xX");
+
+  std::string lWidthString;
+  std::string lHeightString;
+
+  if (lXIndex != std::string::npos) {
+    lWidthString  = pGeometry.substr(0, lXIndex);
+    lHeightString = pGeometry.substr(lXIndex+1);
+  }
+
+  pWidth  = -1;
+  pHeight = -1;
+
+  const int nb1 = sscanf(lWidthString .c_str(), "%i", &pWidth );
+  const int nb2 = sscanf(lHeightString.c_str(), "%i", &pHeight);
+
+  return nb1 == 1 && nb2 == 1;
+}
+
 // Extract the command word from the line, giving also the
 // position of the blank after the word.
 std::string extractCommandWord(const std::string&      pLine,
@@ -71,17 +104,45 @@ Parser::Parser()
     aFilenameStack   (),
     aFlagIgnoreErrors(false),
     aFlagNewData     (false),
-    aObjectStack     ()
+    aFlagSideEffects (false),
+    aIncludedFiles   (),
+    aInputFilenames  (),
+    aObjectStack     (),
+    aParseCache      (0)
 {
   // Add one default filename that represents stdin and line number.
   // This way, we won't have to check that !aFilenameStack.empty()
   // every time we want to display add an error message
   aFilenameStack  .push_back("stdin");
   aLineNumberStack.push_back(1);
+
+  aParseCache = new ParseCache;
+  GLV_ASSERT(aParseCache != 0);
 }
 
 Parser::~Parser()
-{}
+{
+  delete aParseCache;
+
+  // The Objects of the included files are deleted with their last
+  // parent; the root Object is usually deleted before the Parser
+  IncludedFiles::iterator       lIter    = aIncludedFiles.begin();
+  const IncludedFiles::iterator lIterEnd = aIncludedFiles.end  ();
+
+  while (lIter != lIterEnd) {
+    if (lIter->second.aObject->removeReference()) {
+      delete lIter->second.aObject;
+    }
+    ++lIter;
+  }
+}
+
+// Always parse the files, without using or filling the cache
+void Parser::disableParseCache()
+{
+  delete aParseCache;
+  aParseCache = 0;
+}
 
 void Parser::enableIgnoreErrorMode()
 {
@@ -117,6 +178,69 @@ void Parser::parseInputFile(const std::string& pFilename,
 {
   GLV_ASSERT(pError.empty());
 
+  // Only the files given on the command line (not the included
+  // ones) are cached. The cache is not used in the ignore errors
+  // mode, so that the errors are reported at every reading
+  const bool lUseParseCache = (aParseCache != 0              &&
+                               aFilenameStack.size() == 1    &&
+                               !aFlagIgnoreErrors);
+
+  // The included files already parsed are shared instead of
+  // being parsed again (unless they changed since then). Same
+  // thing as the parse cache for the ignore errors mode
+  const bool lUseIncludedFiles = (aFilenameStack.size() > 1 &&
+                                  !aFlagIgnoreErrors);
+
+  std::string lCanonicalPath;
+  long long   lSize             = 0;
+  long long   lModificationTime = 0;
+
+  if (lUseIncludedFiles &&
+      getFileStamp(pFilename, lCanonicalPath, lSize, lModificationTime)) {
+
+    const IncludedFiles::iterator lIter = aIncludedFiles.find(lCanonicalPath);
+
+    if (lIter != aIncludedFiles.end()) {
+
+      IncludedFile& lIncludedFile = lIter->second;
+
+      if (lIncludedFile.aSize             == lSize &&
+          lIncludedFile.aModificationTime == lModificationTime) {
+        lIncludedFile.aObject->addReference();
+        aObjectStack.back()->addSubObject(lIncludedFile.aObject);
+        aInputFilenames.insert(aInputFilenames.end(),
+                               lIncludedFile.aInputFilenames.begin(),
+                               lIncludedFile.aInputFilenames.end());
+        aFlagNewData = true;
+        return;
+      }
+
+      // The file changed: the parents already using
+      // the old version keep it
+      if (lIncludedFile.aObject->removeReference()) {
+        delete lIncludedFile.aObject;
+      }
+      aIncludedFiles.erase(lIter);
+    }
+  }
+
+  if (lUseParseCache) {
+
+    Object* lCachedObject = new Object;
+
+    if (aParseCache->readObject(pFilename, *lCachedObject)) {
+      std::cerr << "Reading (cached) : " << pFilename << std::endl;
+      aObjectStack.back()->addSubObject(lCachedObject);
+      aFlagNewData = true;
+      return;
+    }
+
+    delete lCachedObject;
+
+    aInputFilenames .clear();
+    aFlagSideEffects = false;
+  }
+
   // Extract the path and object name from the filename
   std::string            lDirectory;
   std::string            lObjectName;
@@ -225,9 +349,18 @@ void Parser::parseInputFile(const std::string& pFilename,
 
     GLV_ASSERT(lFilePtr != 0);
 
+    // The side effects of the file itself are needed to know
+    // if its Object can be shared by the next includes
+    const std::vector<std::string>::size_type lFirstInputFilename = aInputFilenames.size();
+    const std::vector<Object*>::size_type     lObjectStackSize    = aObjectStack   .size();
+    const bool                                lFlagSideEffects    = aFlagSideEffects;
+
+    aFlagSideEffects = false;
+
     aLineNumberStack.push_back(1);
     aFilenameStack  .push_back(pFilename);
     aDirectoryStack .push_back(lDirectory);
+    aInputFilenames .push_back(pFilename);
 
     // We want to have a separate object for each file
     // Extract the name of the object from the filename
@@ -238,6 +371,8 @@ void Parser::parseInputFile(const std::string& pFilename,
                                     *this,
                                     lLocalError);
 
+    Object* lFileObject = aObjectStack.back();
+
     // Read file
     readNewDataFromStream(lFilePtr, pError);
 
@@ -247,6 +382,30 @@ void Parser::parseInputFile(const std::string& pFilename,
                                     *this,
                                     lLocalError);
 
+    // Share the Object with the next includes of the file. A file
+    // with unbalanced object_begin/object_end can't be shared:
+    // lFileObject isn't the Object closed by the object_end above
+    if (!lCanonicalPath.empty() && pError.empty() && !aFlagSideEffects &&
+        aObjectStack.size() == lObjectStackSize) {
+
+      IncludedFile& lIncludedFile = aIncludedFiles[lCanonicalPath];
+
+      lIncludedFile.aModificationTime = lModificationTime;
+      lIncludedFile.aSize             = lSize;
+      lIncludedFile.aInputFilenames.assign(aInputFilenames.begin() + lFirstInputFilename,
+                                           aInputFilenames.end());
+      lIncludedFile.aObject           = lFileObject;
+      lIncludedFile.aObject->addReference();
+    }
+
+    aFlagSideEffects = (aFlagSideEffects || lFlagSideEffects);
+
+    // Files with commands acting outside of the Object (snapshot,
+    // view, ...) must be parsed every time
+    if (lUseParseCache && pError.empty() && !aFlagSideEffects) {
+      aParseCache->writeObject(pFilename, aInputFilenames, *lFileObject);
+    }
+
     aDirectoryStack .pop_back();
     aFilenameStack  .pop_back();
     aLineNumberStack.pop_back();
@@ -260,6 +419,33 @@ void Parser::parseInputFile(const std::string& pFilename,
   }
 }
 
+// Get the canonical path of pFilename, with its size and
+// modification time to know if it changed.
+// Returns false if the file can't be found
+bool Parser::getFileStamp(const std::string& pFilename,
+                          std::string&       pCanonicalPath,
+                          long long&         pSize,
+                          long long&         pModificationTime)
+{
+#ifdef WIN32
+  return false;
+#else // #ifdef WIN32
+  char        lCanonicalPath[PATH_MAX];
+  struct stat lStat;
+
+  if (realpath(pFilename.c_str(), lCanonicalPath) == 0 ||
+      stat(lCanonicalPath, &lStat) != 0) {
+    return false;
+  }
+
+  pCanonicalPath    = lCanonicalPath;
+  pSize             = lStat.st_size;
+  pModificationTime = lStat.st_mtime;
+
+  return true;
+#endif // #ifdef WIN32
+}
+
 void Parser::popObject(Object* pObjPtr)
 {
   GLV_ASSERT(!aObjectStack.empty());
@@ -337,14 +523,27 @@ void Parser::readNewDataFromStream(FILE*        pFilePtr,
         lLine = ""; // nothing else to parse
       }
       else if(lLine.find("title") == 0) {
+        aFlagSideEffects = true;
         parseLineTitle(lLine, pError);
         lLine = ""; // nothing else to parse
       }
+      else if(lLine.find("render_sequence ") == 0) {
+        aFlagSideEffects = true;
+        parseLineRenderSequence(lLine, pError);
+        lLine = ""; // nothing else to parse
+      }
       else if(lLine.find("snapshot ") == 0) {
+        aFlagSideEffects = true;
         parseLineSnapshot(lLine, pError);
         lLine = ""; // nothing else to parse
       }
+      else if(lLine.find("snapshot_ss ") == 0) {
+        aFlagSideEffects = true;
+        parseLineSnapshotSupersampled(lLine, pError);
+        lLine = ""; // nothing else to parse
+      }
       else if(lLine.find("view ") == 0) {
+        aFlagSideEffects = true;
         parseLineView(lLine, pError);
         lLine = ""; // nothing else to parse
       }
@@ -624,6 +823,89 @@ void Parser::parseLineRaw(FILE*              pFilePtr,
   }
 }
 
+void Parser::parseLineRenderSequence(const std::string& pLine,
+                                     std::string&       pError)
+{
+  GLV_ASSERT(pLine.find("render_sequence ") == 0);
+  GLV_ASSERT(pLine.size() < aMaxLineLenght);
+
+  std::string lParameters = trimString(pLine.substr(16), " \t\n");
+
+  int lWordCount = countWords(lParameters);
+
+  char lPath    [aMaxLineLenght+1];
+  char lGeometry[aMaxLineLenght+1];
+  char lPattern [aMaxLineLenght+1];
+  int  lNbFrames = -1;
+  int  lWidth    = -1;
+  int  lHeight   = -1;
+
+  if(lWordCount != 4 ||
+     sscanf(lParameters.c_str(), "%s %i %s %s", lPath, &lNbFrames, lGeometry, lPattern) != 4 ||
+     !readGeometry(lGeometry, lWidth, lHeight) ||
+     (std::string(lPath) != "views" && std::string(lPath) != "orbit")) {
+    addSyntaxError("render_sequence", "views|orbit <frames> <width>x<height> filename%04d.ext", *this, pError);
+  }
+  else if(lWidth < 1 || lHeight < 1 ||
+          static_cast<double>(lWidth)*static_cast<double>(lHeight) > Snapshot::getMaxPixmapSize()) {
+    addError("Bad geometry argument in render_sequence:\n  <width>x<height> out of range (max size is one Gigabyte)", *this, pError);
+  }
+  else if(lNbFrames < 1) {
+    addError("Bad number of frames in render_sequence", *this, pError);
+  }
+  else {
+
+    ViewManager&             lViewManager = WindowGLV::getInstance().getViewManager();
+    const std::vector<View>& lViews       = lViewManager.getViews();
+    std::vector<View>        lFrames;
+
+    if (std::string(lPath) == "orbit") {
+
+      // Turn around the global BoundingBox, starting from the
+      // current View direction and about its up direction
+      const View&  lCurrentView = lViewManager.getCurrentView();
+      const View   lStartView(lViewManager.getGraphicData().getGlobalBoundingBox(),
+                              lCurrentView.getDirection(),
+                              lCurrentView.getUp());
+      const double lPi          = 3.14159265358979323846;
+
+      for (int i=0; i<lNbFrames; ++i) {
+        View lView = lStartView;
+        lView.rotate(static_cast<float>(2.0*lPi*i/lNbFrames), 0.0f);
+        lFrames.push_back(lView);
+      }
+    }
+    else if (lViews.empty()) {
+      addError("No view defined before render_sequence views", *this, pError);
+    }
+    else {
+
+      // Frames evenly spaced on the path going through all the views
+      const int lNbSegments = static_cast<int>(lViews.size()) - 1;
+
+      for (int i=0; i<lNbFrames; ++i) {
+
+        if (lNbSegments == 0 || lNbFrames == 1) {
+          lFrames.push_back(lViews[0]);
+        }
+        else {
+          const float lPosition = static_cast<float>(i*lNbSegments)/(lNbFrames-1);
+          const int   lSegment  = std::min(static_cast<int>(lPosition), lNbSegments-1);
+          const float lRatio    = std::min(std::max(lPosition - lSegment, 0.0f), 1.0f);
+
+          lFrames.push_back(View(lViews[lSegment], lViews[lSegment+1], lRatio));
+        }
+      }
+    }
+
+    if (pError.empty()) {
+      Snapshot lSnapshot(lWidth, lHeight, 1, *this);
+
+      lSnapshot.renderSequence(lFrames, lPattern, pError);
+    }
+  }
+}
+
 void Parser::parseLineSnapshot(const std::string& pLine,
                                std::string&       pError)
 {
@@ -646,31 +928,20 @@ void Parser::parseLineSnapshot(const std::string& pLine,
     GLV_ASSERT(lGeometry != "");
     GLV_ASSERT(lFilename != "");
 
-    std::string::size_type lXIndex = lGeometry.find_first_of("xX");
-
-    std::string lWidthString;
-    std::string lHeightString;
-
-    if (lXIndex != std::string::npos) {
-      lWidthString  = lGeometry.substr(0, lXIndex);
-      lHeightString = lGeometry.substr(lXIndex+1);
-    }
-
-    int       lWidth  = -1;
-    int       lHeight = -1;
-    const int nb1     = sscanf(lWidthString .c_str(), "%i", &lWidth );
-    const int nb2     = sscanf(lHeightString.c_str(), "%i", &lHeight);
+    int        lWidth    = -1;
+    int        lHeight   = -1;
+    const bool lGeometryOk = readGeometry(lGeometry, lWidth, lHeight);
 
     const double lSize = static_cast<double>(lWidth)*static_cast<double>(lHeight);
 
-    if(nb1 != 1 || nb2 != 1) {
+    if(!lGeometryOk) {
       addSyntaxError("snapshot", "<width>x<height> filename.ext", *this, pError);
     }
     else if(lWidth < 1 || lHeight < 1 || lSize > Snapshot::getMaxPixmapSize()) {
       addError("Bad geometry argument in snapshot:\n  <width>x<height> out of range (max size is one Gigabyte)", *this, pError);
     }
     else {
-      Snapshot lSnapshot(lWidth, lHeight, *this);
+      Snapshot lSnapshot(lWidth, lHeight, 1, *this);
 
       lSnapshot.render(lFilename, pError);
     }
@@ -680,6 +951,43 @@ void Parser::parseLineSnapshot(const std::string& pLine,
   }
 }
 
+void Parser::parseLineSnapshotSupersampled(const std::string& pLine,
+                                           std::string&       pError)
+{
+  GLV_ASSERT(pLine.find("snapshot_ss ") == 0);
+  GLV_ASSERT(pLine.size() < aMaxLineLenght);
+
+  std::string lParameters = trimString(pLine.substr(12), " \t\n");
+
+  int lWordCount = countWords(lParameters);
+
+  char lGeometry[aMaxLineLenght+1];
+  char lFilename[aMaxLineLenght+1];
+  int  lSupersampling = -1;
+  int  lWidth         = -1;
+  int  lHeight        = -1;
+
+  if(lWordCount != 3 ||
+     sscanf(lParameters.c_str(), "%i %s %s", &lSupersampling, lGeometry, lFilename) != 3 ||
+     !readGeometry(lGeometry, lWidth, lHeight)) {
+    addSyntaxError("snapshot_ss", "<factor> <width>x<height> filename.ext", *this, pError);
+  }
+  else if(lSupersampling < 1 || lSupersampling > Snapshot::getMaxSupersampling()) {
+    char lMessage[128];
+    sprintf(lMessage, "Bad factor argument in snapshot_ss:\n  <factor> must be between 1 and %d", Snapshot::getMaxSupersampling());
+    addError(lMessage, *this, pError);
+  }
+  else if(lWidth < 1 || lHeight < 1 ||
+          static_cast<double>(lWidth)*static_cast<double>(lHeight) > Snapshot::getMaxPixmapSize()) {
+    addError("Bad geometry argument in snapshot_ss:\n  <width>x<height> out of range (max size is one Gigabyte)", *this, pError);
+  }
+  else {
+    Snapshot lSnapshot(lWidth, lHeight, lSupersampling, *this);
+
+    lSnapshot.render(lFilename, pError);
+  }
+}
+
 void Parser::parseLineTitle(const std::string& pLine,
                             std::string&       pError)
 {
@@ -21,11 +21,13 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include <map>
 #include <stdio.h>
 #include <string>
 #include <vector>
 
 class Object;
+class ParseCache;
 
 class Parser
 {
@@ -34,6 +36,8 @@ public:
   Parser();
   ~Parser();
 
+  void                disableParseCache    ();
+
   void                enableIgnoreErrorMode();
 
   const std::string&  getCurrentFilename   () const;
@@ -54,21 +58,45 @@ public:
 
 private:
 
-  void parseLineExit      (const std::string& pLine,
-                           std::string&       pError);
-  void parseLineInclude   (const std::string& pLine,
-                           std::string&       pError);
-  void parseLineQuit      (const std::string& pLine,
-                           std::string&       pError);
-  void parseLineRaw       (FILE*              pFilePtr,
-                           const std::string& pLine,
-                           std::string&       pError);
-  void parseLineSnapshot  (const std::string& pLine,
-                           std::string&       pError);
-  void parseLineTitle     (const std::string& pLine,
-                           std::string&       pError);
-  void parseLineView      (const std::string& pLine,
-                           std::string&       pError);
+  // Block the use of those
+  Parser(const Parser&);
+  Parser& operator=(const Parser&);
+
+  // Included file parsed once and shared by all its
+  // includes, as long as it doesn't change
+  struct IncludedFile {
+    long long                aModificationTime;
+    long long                aSize;
+    std::vector<std::string> aInputFilenames; // The file and its own includes
+    Object*                  aObject;
+  };
+
+  typedef  std::map<std::string, IncludedFile>  IncludedFiles;
+
+  static bool getFileStamp          (const std::string& pFilename,
+                                     std::string&       pCanonicalPath,
+                                     long long&         pSize,
+                                     long long&         pModificationTime);
+
+  void parseLineExit                (const std::string& pLine,
+                                     std::string&       pError);
+  void parseLineInclude             (const std::string& pLine,
+                                     std::string&       pError);
+  void parseLineQuit                (const std::string& pLine,
+                                     std::string&       pError);
+  void parseLineRaw                 (FILE*              pFilePtr,
+                                     const std::string& pLine,
+                                     std::string&       pError);
+  void parseLineRenderSequence      (const std::string& pLine,
+                                     std::string&       pError);
+  void parseLineSnapshot            (const std::string& pLine,
+                                     std::string&       pError);
+  void parseLineSnapshotSupersampled(const std::string& pLine,
+                                     std::string&       pError);
+  void parseLineTitle               (const std::string& pLine,
+                                     std::string&       pError);
+  void parseLineView                (const std::string& pLine,
+                                     std::string&       pError);
 
 
   static const char                    aDirectorySeparator;
@@ -80,7 +108,11 @@ private:
   bool                     aFlagIgnoreErrors;
   bool                     aFlagNewData;
   bool                     aFlagNewView;
+  bool                     aFlagSideEffects;
+  IncludedFiles            aIncludedFiles; // Indexed by canonical path
+  std::vector<std::string> aInputFilenames;
   std::vector<Object*>     aObjectStack;
+  ParseCache*              aParseCache;
 
 };
 
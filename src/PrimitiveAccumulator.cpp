@@ -19,8 +19,11 @@
  *****************************************************************************/
 
 #include "PrimitiveAccumulator.h"
+#include "arena_utils.h"
 #include "assert_glv.h"
-#include "limits_glv.h"
+#include "cache_utils.h"
+#include "SoftwareRasterizer.h"
+#include "VertexClustering.h"
 #include <algorithm>
 #include <cmath>
 #include <iostream>
@@ -31,8 +34,58 @@
 #define M_PI 3.14159265358979323846
 #endif
 
+// Maximum number of primitives in a leaf of the spatial hierarchy.
+// Each leaf has its own display list, so the leaves must stay large
+// enough for the display list calls to be cheap
+const PrimitiveAccumulator::SizeType PrimitiveAccumulator::aHierarchyLeafSize = 4096;
+
+// Orders the HierarchyItems along one axis
+class PrimitiveAccumulator::HierarchyItemLess
+{
+public:
+
+  explicit HierarchyItemLess(const int pAxis)
+    : aAxis(pAxis)
+  {}
+
+  bool operator()(const HierarchyItem& pItem1,
+                  const HierarchyItem& pItem2) const
+  {
+    return pItem1.aBarycenter[aAxis] < pItem2.aBarycenter[aAxis];
+  }
+
+private:
+
+  int aAxis;
+};
+
+// Selects the HierarchyItems with a given facing
+class PrimitiveAccumulator::HierarchyItemFacing
+{
+public:
+
+  explicit HierarchyItemFacing(const int pFacing)
+    : aFacing(pFacing)
+  {}
+
+  bool operator()(const HierarchyItem& pItem) const
+  {
+    return pItem.aFacing == aFacing;
+  }
+
+private:
+
+  int aFacing;
+};
+
 PrimitiveAccumulator::PrimitiveAccumulator(const bool pCreateSimplified)
   : aBoundingBox                       (),
+    aClustering                        (0),
+    aGLDisplayListBoundingBox          (0),
+    aGLDisplayListFast                 (0),
+    aGLDisplayListFull                 (0),
+    aHierarchyGLDisplayLists           (),
+    aHierarchyNodes                    (),
     aLines                             (),
     aLinesBBoxCounter                  (0),
     aLinesColored                      (),
@@ -61,6 +114,8 @@ PrimitiveAccumulator::PrimitiveAccumulator(const bool pCreateSimplified)
     aTrianglesNormalsColoredBBoxCounter(0),
     aPrimitiveOptimizerValue           (100)
 {
+  resetClustering();
+
   if (pCreateSimplified) {
     aSimplified = new PrimitiveAccumulator(false);
   }
@@ -72,6 +127,9 @@ PrimitiveAccumulator::PrimitiveAccumulator(const bool pCreateSimplified)
 
 PrimitiveAccumulator::~PrimitiveAccumulator()
 {
+  deleteDisplayLists();
+  resetClustering();
+
   GLV_ASSERT(aSimplified != 0);
 
   if (aSimplified != this) {
@@ -79,6 +137,18 @@ PrimitiveAccumulator::~PrimitiveAccumulator()
   }
 }
 
+// The PrimitiveAccumulators are nodes of the scene, see arena_utils.h
+void* PrimitiveAccumulator::operator new(size_t pBytes)
+{
+  return allocateArena(pBytes);
+}
+
+void PrimitiveAccumulator::operator delete(void*  pPtr,
+                                           size_t pBytes)
+{
+  deallocateArena(pPtr, pBytes);
+}
+
 void PrimitiveAccumulator::addArrow(const Vector3D& pP1,
                                     const Vector3D& pP2,
                                     const float     pTipProportion,
@@ -380,21 +450,254 @@ void PrimitiveAccumulator::addTriangleColored(const Vector3D& pP1,
   aSimplifiedDirty = true;
 }
 
-#ifdef GLV_DUMP_MEMORY_USAGE
+// Add to pSum the colors of the colored primitives (the mean of the
+// colors of their vertices), and count the primitives with and
+// without colors
+void PrimitiveAccumulator::addColors(Vector3D& pSum,
+                                     double&   pNbColored,
+                                     double&   pNbUncolored) const
+{
+  addColors(aLinesColored           , pSum);
+  addColors(aPointsColored          , pSum);
+  addColors(aQuadsColored           , pSum);
+  addColors(aQuadsNormalsColored    , pSum);
+  addColors(aTrianglesColored       , pSum);
+  addColors(aTrianglesNormalsColored, pSum);
+
+  pNbColored   += (aLinesColored    .size() + aPointsColored.size() +
+                   aQuadsColored    .size() + aQuadsNormalsColored.size() +
+                   aTrianglesColored.size() + aTrianglesNormalsColored.size());
+  pNbUncolored += (aLines    .size() + aPoints.size() +
+                   aQuads    .size() + aQuadsNormals.size() +
+                   aTriangles.size() + aTrianglesNormals.size());
+}
 
-template <class Container>
-inline
-std::string getStringSizeAndCapacity(const Container& pContainer)
+// Release the memory that isn't needed once the accumulator is
+// complete (at object_end): the unused capacity of the vectors, and
+// the simplified model, which is constructed again if it is used.
+// Returns the number of bytes released
+size_t PrimitiveAccumulator::compact()
+{
+  size_t lReleased = (shrinkToFit(aLines                  ) +
+                      shrinkToFit(aLinesColored           ) +
+                      shrinkToFit(aPoints                 ) +
+                      shrinkToFit(aPointsColored          ) +
+                      shrinkToFit(aQuads                  ) +
+                      shrinkToFit(aQuadsColored           ) +
+                      shrinkToFit(aQuadsNormals           ) +
+                      shrinkToFit(aQuadsNormalsColored    ) +
+                      shrinkToFit(aTriangles              ) +
+                      shrinkToFit(aTrianglesColored       ) +
+                      shrinkToFit(aTrianglesNormals       ) +
+                      shrinkToFit(aTrianglesNormalsColored) +
+                      shrinkToFit(aHierarchyNodes         ) +
+                      shrinkToFit(aHierarchyGLDisplayLists));
+
+  GLV_ASSERT(aSimplified != 0);
+  if (aSimplifiedDirty && aSimplified != this) {
+    delete aSimplified;
+    aSimplified = this;
+    lReleased  += sizeof(PrimitiveAccumulator);
+  }
+
+  return lReleased;
+}
+
+// Record the rendering of pParams.aRenderMode in a display list
+// used by renderDisplayList. Nothing is done if the display list
+// already exists. Must not be called while another display list
+// is being recorded
+void PrimitiveAccumulator::constructDisplayList(const RenderParameters& pParams)
 {
-  char lSizeAndCapacity[128];
-  sprintf(lSizeAndCapacity,"%d/%d",
-          sizeof(typename Container::value_type)*pContainer.size(),
-          sizeof(typename Container::value_type)*pContainer.capacity());
-  return std::string(lSizeAndCapacity);
+  // The level of detail depends on the view: only the display
+  // list of the accumulator at the current level is recorded
+  if (pParams.aRenderMode == RenderParameters::renderMode_level_of_detail) {
+    RenderParameters lParams = pParams;
+    lParams.aRenderMode      = RenderParameters::renderMode_full;
+
+    // Rendered leaf by leaf, without display list
+    if (isPointCloud() && !isFullDetail(pParams)) {
+      return;
+    }
+
+    getSimplified(pParams.getLevelOfDetail(getBoundingBox())).constructDisplayList(lParams);
+    return;
+  }
+
+  GLuint& lGLDisplayList = getGLDisplayList(pParams);
+
+  if (lGLDisplayList == 0) {
+
+    const bool lFlagHierarchy = (pParams.aRenderMode == RenderParameters::renderMode_full &&
+                                 !aHierarchyNodes.empty());
+
+    // With a hierarchy, each leaf has its own display list and
+    // the display list of the whole accumulator only calls them
+    if (lFlagHierarchy) {
+
+      GLV_ASSERT(aHierarchyGLDisplayLists.size() == aHierarchyNodes.size());
+
+      for (SizeType i=0; i<aHierarchyNodes.size(); ++i) {
+        if (aHierarchyNodes[i].aSecondChild < 0 && aHierarchyGLDisplayLists[i] == 0) {
+
+          aHierarchyGLDisplayLists[i] = glGenLists(1);
+
+          if (aHierarchyGLDisplayLists[i] != 0) {
+            glNewList(aHierarchyGLDisplayLists[i], GL_COMPILE);
+            renderRanges(pParams, aHierarchyNodes[i].aRanges);
+            glEndList();
+          }
+        }
+      }
+    }
+
+    lGLDisplayList = glGenLists(1);
+
+    if (lGLDisplayList != 0) {
+      glNewList(lGLDisplayList, GL_COMPILE);
+      if (lFlagHierarchy) {
+        renderHierarchy(pParams, 0, false, 0, Vector3D());
+      }
+      else {
+        render(pParams);
+      }
+      glEndList();
+    }
+  }
 }
 
-#endif // #ifdef  GLV_DUMP_MEMORY_USAGE
+// Sort the primitives in a bounding volume hierarchy: the primitives
+// are split recursively at the median of their barycenters along the
+// largest axis, until there's at most aHierarchyLeafSize primitives
+// per node. The primitive vectors are then reordered so that each node
+// covers a contiguous range of each vector. The leaves are used as
+// chunks for the display lists and the frustum culling.
+// Called once the accumulator is complete (at object_end)
+void PrimitiveAccumulator::constructHierarchy()
+{
+  deleteDisplayLists();
+
+  // The primitives are reordered below, so the counters of
+  // the clustering wouldn't match them anymore
+  resetClustering();
+  aSimplifiedDirty = true;
+  aHierarchyNodes.clear();
+  aHierarchyGLDisplayLists.clear();
+
+  const PrimitiveRanges lRanges       = getRanges();
+  SizeType              lNbPrimitives = 0;
+
+  for (int lType=0; lType<primitiveType_count; ++lType) {
+    lNbPrimitives += lRanges.aEnd[lType];
+  }
+
+  // Not worth it for a single leaf
+  if (lNbPrimitives <= 2*aHierarchyLeafSize) {
+    return;
+  }
+
+  HierarchyItems lItems;
+  lItems.reserve(lNbPrimitives);
+
+  addHierarchyItems(aLines                  , primitiveType_line                    , lItems);
+  addHierarchyItems(aLinesColored           , primitiveType_line_colored            , lItems);
+  addHierarchyItems(aPoints                 , primitiveType_point                   , lItems);
+  addHierarchyItems(aPointsColored          , primitiveType_point_colored           , lItems);
+  addHierarchyItems(aQuads                  , primitiveType_quad                    , lItems);
+  addHierarchyItems(aQuadsColored           , primitiveType_quad_colored            , lItems);
+  addHierarchyItems(aQuadsNormals           , primitiveType_quad_normals            , lItems);
+  addHierarchyItems(aQuadsNormalsColored    , primitiveType_quad_normals_colored    , lItems);
+  addHierarchyItems(aTriangles              , primitiveType_triangle                , lItems);
+  addHierarchyItems(aTrianglesColored       , primitiveType_triangle_colored        , lItems);
+  addHierarchyItems(aTrianglesNormals       , primitiveType_triangle_normals        , lItems);
+  addHierarchyItems(aTrianglesNormalsColored, primitiveType_triangle_normals_colored, lItems);
+
+  SizeType lCounters[primitiveType_count];
+  for (int lType=0; lType<primitiveType_count; ++lType) {
+    lCounters[lType] = 0;
+  }
+
+  constructHierarchyNode(lItems, 0, lItems.size(), lCounters);
+
+  reorderPrimitives(aLines                  , primitiveType_line                    , lItems);
+  reorderPrimitives(aLinesColored           , primitiveType_line_colored            , lItems);
+  reorderPrimitives(aPoints                 , primitiveType_point                   , lItems);
+  reorderPrimitives(aPointsColored          , primitiveType_point_colored           , lItems);
+  reorderPrimitives(aQuads                  , primitiveType_quad                    , lItems);
+  reorderPrimitives(aQuadsColored           , primitiveType_quad_colored            , lItems);
+  reorderPrimitives(aQuadsNormals           , primitiveType_quad_normals            , lItems);
+  reorderPrimitives(aQuadsNormalsColored    , primitiveType_quad_normals_colored    , lItems);
+  reorderPrimitives(aTriangles              , primitiveType_triangle                , lItems);
+  reorderPrimitives(aTrianglesColored       , primitiveType_triangle_colored        , lItems);
+  reorderPrimitives(aTrianglesNormals       , primitiveType_triangle_normals        , lItems);
+  reorderPrimitives(aTrianglesNormalsColored, primitiveType_triangle_normals_colored, lItems);
+
+  // Any prefix of a leaf is then a uniform sample of its points
+  // (see renderPointCloud)
+  shuffleLeaves(aPoints       , primitiveType_point        );
+  shuffleLeaves(aPointsColored, primitiveType_point_colored);
+
+  // The BoundingBoxes of the nodes, from the leaves to the root.
+  // The children are always after their parent
+  for (SizeType i=aHierarchyNodes.size(); i>0; --i) {
+
+    HierarchyNode& lNode = aHierarchyNodes[i-1];
+
+    if (lNode.aSecondChild < 0) {
+      addRangeToBoundingBox(aLines                  , primitiveType_line                    , lNode.aRanges, lNode.aBoundingBox);
+      addRangeToBoundingBox(aLinesColored           , primitiveType_line_colored            , lNode.aRanges, lNode.aBoundingBox);
+      addRangeToBoundingBox(aPoints                 , primitiveType_point                   , lNode.aRanges, lNode.aBoundingBox);
+      addRangeToBoundingBox(aPointsColored          , primitiveType_point_colored           , lNode.aRanges, lNode.aBoundingBox);
+      addRangeToBoundingBox(aQuads                  , primitiveType_quad                    , lNode.aRanges, lNode.aBoundingBox);
+      addRangeToBoundingBox(aQuadsColored           , primitiveType_quad_colored            , lNode.aRanges, lNode.aBoundingBox);
+      addRangeToBoundingBox(aQuadsNormals           , primitiveType_quad_normals            , lNode.aRanges, lNode.aBoundingBox);
+      addRangeToBoundingBox(aQuadsNormalsColored    , primitiveType_quad_normals_colored    , lNode.aRanges, lNode.aBoundingBox);
+      addRangeToBoundingBox(aTriangles              , primitiveType_triangle                , lNode.aRanges, lNode.aBoundingBox);
+      addRangeToBoundingBox(aTrianglesColored       , primitiveType_triangle_colored        , lNode.aRanges, lNode.aBoundingBox);
+      addRangeToBoundingBox(aTrianglesNormals       , primitiveType_triangle_normals        , lNode.aRanges, lNode.aBoundingBox);
+      addRangeToBoundingBox(aTrianglesNormalsColored, primitiveType_triangle_normals_colored, lNode.aRanges, lNode.aBoundingBox);
+    }
+    else {
+      lNode.aBoundingBox = aHierarchyNodes[i].aBoundingBox + aHierarchyNodes[lNode.aSecondChild].aBoundingBox;
+    }
+  }
+
+  aHierarchyGLDisplayLists.resize(aHierarchyNodes.size(), 0);
+}
+
+// Delete the display lists. Used when the OpenGL context changes
+void PrimitiveAccumulator::deleteDisplayLists()
+{
+  if (aGLDisplayListFull != 0) {
+    glDeleteLists(aGLDisplayListFull, 1);
+    aGLDisplayListFull = 0;
+  }
+  if (aGLDisplayListBoundingBox != 0) {
+    glDeleteLists(aGLDisplayListBoundingBox, 1);
+    aGLDisplayListBoundingBox = 0;
+  }
+  if (aGLDisplayListFast != 0) {
+    glDeleteLists(aGLDisplayListFast, 1);
+    aGLDisplayListFast = 0;
+  }
+
+  GLDisplayLists::iterator       lIterGLDisplayLists    = aHierarchyGLDisplayLists.begin();
+  const GLDisplayLists::iterator lIterGLDisplayListsEnd = aHierarchyGLDisplayLists.end  ();
+
+  while (lIterGLDisplayLists != lIterGLDisplayListsEnd) {
+    if (*lIterGLDisplayLists != 0) {
+      glDeleteLists(*lIterGLDisplayLists, 1);
+      *lIterGLDisplayLists = 0;
+    }
+    ++lIterGLDisplayLists;
+  }
+
+  GLV_ASSERT(aSimplified != 0);
 
+  if (aSimplified != this) {
+    aSimplified->deleteDisplayLists();
+  }
+}
 
 // Dump in ASCII the caracteristics of the PrimitiveAccumulator
 void PrimitiveAccumulator::dumpCharacteristics(std::ostream&       pOstream,
@@ -432,6 +735,7 @@ void PrimitiveAccumulator::dumpCharacteristics(std::ostream&       pOstream,
     pOstream << lIndentation << "Memory used by aQuadsColored            = " << getStringSizeAndCapacity(aQuadsColored           ) << std::endl;
     pOstream << lIndentation << "Memory used by aQuadsNormals            = " << getStringSizeAndCapacity(aQuadsNormals           ) << std::endl;
     pOstream << lIndentation << "Memory used by aQuadsNormalsColored     = " << getStringSizeAndCapacity(aQuadsNormalsColored    ) << std::endl;
+    pOstream << lIndentation << "Memory used by aHierarchyNodes          = " << getStringSizeAndCapacity(aHierarchyNodes         ) << std::endl;
 
   }
 #endif // #ifdef GLV_DUMP_MEMORY_USAGE
@@ -451,6 +755,72 @@ void PrimitiveAccumulator::dumpCharacteristics(std::ostream&       pOstream,
   pOstream << lIndentation << "Number of quad_colored     = " << lNbQuadsColored       << std::endl;
 }
 
+// The reserve functions make room for the primitives announced
+// by the count of a raw section, so the containers are allocated
+// once instead of growing while the section is read.
+// An arrow is a line and 2 triangles per polygon of its tip
+void PrimitiveAccumulator::reserveArrows(const size_t pNbArrows,
+                                         const int    pTipNbPolygons,
+                                         const bool   pFlagColor)
+{
+  GLV_ASSERT(pTipNbPolygons >= 1);
+
+  const size_t lNbTriangles = 2*(pTipNbPolygons+1)*pNbArrows;
+
+  reserveLines(pNbArrows, pFlagColor);
+
+  if (pFlagColor) {
+    aTrianglesNormalsColored.reserve(aTrianglesNormalsColored.size() + lNbTriangles);
+  }
+  else {
+    aTrianglesNormals.reserve(aTrianglesNormals.size() + lNbTriangles);
+  }
+}
+
+void PrimitiveAccumulator::reserveLines(const size_t pNbLines,
+                                        const bool   pFlagColor)
+{
+  if (pFlagColor) {
+    aLinesColored.reserve(aLinesColored.size() + pNbLines);
+  }
+  else {
+    aLines.reserve(aLines.size() + pNbLines);
+  }
+}
+
+void PrimitiveAccumulator::reservePoints(const size_t pNbPoints,
+                                         const bool   pFlagColor)
+{
+  if (pFlagColor) {
+    aPointsColored.reserve(aPointsColored.size() + pNbPoints);
+  }
+  else {
+    aPoints.reserve(aPoints.size() + pNbPoints);
+  }
+}
+
+void PrimitiveAccumulator::reserveQuads(const size_t pNbQuads,
+                                        const bool   pFlagColor)
+{
+  if (pFlagColor) {
+    aQuadsColored.reserve(aQuadsColored.size() + pNbQuads);
+  }
+  else {
+    aQuads.reserve(aQuads.size() + pNbQuads);
+  }
+}
+
+void PrimitiveAccumulator::reserveTriangles(const size_t pNbTriangles,
+                                            const bool   pFlagColor)
+{
+  if (pFlagColor) {
+    aTrianglesColored.reserve(aTrianglesColored.size() + pNbTriangles);
+  }
+  else {
+    aTriangles.reserve(aTriangles.size() + pNbTriangles);
+  }
+}
+
 const BoundingBox& PrimitiveAccumulator::getBoundingBox() const
 {
 
@@ -573,31 +943,427 @@ const BoundingBox& PrimitiveAccumulator::getBoundingBox() const
     }
   }
 
-  {
-    const SizeType lSize = aTrianglesNormals.size();
+  {
+    const SizeType lSize = aTrianglesNormals.size();
+
+    while (aTrianglesNormalsBBoxCounter < lSize) {
+      const Triangle& lTriangle = aTrianglesNormals[aTrianglesNormalsBBoxCounter];
+      aBoundingBox += lTriangle.aP1;
+      aBoundingBox += lTriangle.aP2;
+      aBoundingBox += lTriangle.aP3;
+      ++aTrianglesNormalsBBoxCounter;
+    }
+  }
+
+  {
+    const SizeType lSize = aTrianglesNormalsColored.size();
+
+    while (aTrianglesNormalsColoredBBoxCounter < lSize) {
+      const Triangle& lTriangle = aTrianglesNormalsColored[aTrianglesNormalsColoredBBoxCounter];
+      aBoundingBox += lTriangle.aP1;
+      aBoundingBox += lTriangle.aP2;
+      aBoundingBox += lTriangle.aP3;
+      ++aTrianglesNormalsColoredBBoxCounter;
+    }
+  }
+
+  return aBoundingBox;
+}
+
+// Returns the accumulator simplified pLevel times, the level 0
+// being *this. Each level is the simplified model of the previous
+// one, down to the first one too small to be simplified: it is
+// returned for all the higher levels
+PrimitiveAccumulator& PrimitiveAccumulator::getSimplified(const int pLevel)
+{
+  if (pLevel <= 0) {
+    return *this;
+  }
+
+  // Check if we have to update the Simplified model
+  if (aSimplifiedDirty) {
+    constructSimplified();
+  }
+
+  GLV_ASSERT(aSimplified != 0);
+
+  if (aSimplified == this) {
+    return *this;
+  }
+
+  return aSimplified->getSimplified(pLevel-1);
+}
+
+void PrimitiveAccumulator::Line::addToClustering(VertexClustering& pClustering) const
+{
+  pClustering.addLine(pClustering.addVertex(aP1),
+                      pClustering.addVertex(aP2),
+                      false);
+}
+
+void PrimitiveAccumulator::LineColored::addToClustering(VertexClustering& pClustering) const
+{
+  pClustering.addLine(pClustering.addVertexColored(aP1, aC1),
+                      pClustering.addVertexColored(aP2, aC2),
+                      true);
+}
+
+void PrimitiveAccumulator::Point::addToClustering(VertexClustering& pClustering) const
+{
+  pClustering.addPoint(pClustering.addVertex(aP), false);
+}
+
+void PrimitiveAccumulator::PointColored::addToClustering(VertexClustering& pClustering) const
+{
+  pClustering.addPoint(pClustering.addVertexColored(aP, aC), true);
+}
+
+void PrimitiveAccumulator::Quad::addToClustering(VertexClustering& pClustering) const
+{
+  pClustering.addQuad(pClustering.addVertex(aP1),
+                      pClustering.addVertex(aP2),
+                      pClustering.addVertex(aP3),
+                      pClustering.addVertex(aP4),
+                      false);
+}
+
+void PrimitiveAccumulator::QuadColored::addToClustering(VertexClustering& pClustering) const
+{
+  pClustering.addQuad(pClustering.addVertexColored(aP1, aC1),
+                      pClustering.addVertexColored(aP2, aC2),
+                      pClustering.addVertexColored(aP3, aC3),
+                      pClustering.addVertexColored(aP4, aC4),
+                      true);
+}
+
+void PrimitiveAccumulator::QuadNormalsColored::addToClustering(VertexClustering& pClustering) const
+{
+  pClustering.addQuad(pClustering.addVertexColored(aP1, aC1),
+                      pClustering.addVertexColored(aP2, aC2),
+                      pClustering.addVertexColored(aP3, aC3),
+                      pClustering.addVertexColored(aP4, aC4),
+                      true);
+}
+
+void PrimitiveAccumulator::Triangle::addToClustering(VertexClustering& pClustering) const
+{
+  pClustering.addTriangle(pClustering.addVertex(aP1),
+                          pClustering.addVertex(aP2),
+                          pClustering.addVertex(aP3),
+                          false);
+}
+
+void PrimitiveAccumulator::TriangleColored::addToClustering(VertexClustering& pClustering) const
+{
+  pClustering.addTriangle(pClustering.addVertexColored(aP1, aC1),
+                          pClustering.addVertexColored(aP2, aC2),
+                          pClustering.addVertexColored(aP3, aC3),
+                          true);
+}
+
+void PrimitiveAccumulator::TriangleNormalsColored::addToClustering(VertexClustering& pClustering) const
+{
+  pClustering.addTriangle(pClustering.addVertexColored(aP1, aC1),
+                          pClustering.addVertexColored(aP2, aC2),
+                          pClustering.addVertexColored(aP3, aC3),
+                          true);
+}
+
+// Unit normal of the face given by the order of the vertices;
+// null for a degenerated triangle
+Vector3D PrimitiveAccumulator::Triangle::getFaceNormal() const
+{
+  Vector3D lNormal = (aP2 - aP1).crossProduct(aP3 - aP1);
+
+  if (lNormal.getLength() <= 0.0f) {
+    return Vector3D(0.0, 0.0, 0.0);
+  }
+
+  lNormal.normalize();
+  return lNormal;
+}
+
+void PrimitiveAccumulator::Quad::rasterizeFacetsFrame(SoftwareRasterizer& pRasterizer,
+                                                      const Vector3D&     pC) const
+{
+  pRasterizer.drawLine(aP1, pC, aP2, pC);
+  pRasterizer.drawLine(aP2, pC, aP3, pC);
+  pRasterizer.drawLine(aP3, pC, aP4, pC);
+  pRasterizer.drawLine(aP4, pC, aP1, pC);
+}
+
+void PrimitiveAccumulator::Triangle::rasterizeFacetsFrame(SoftwareRasterizer& pRasterizer,
+                                                          const Vector3D&     pC) const
+{
+  pRasterizer.drawLine(aP1, pC, aP2, pC);
+  pRasterizer.drawLine(aP2, pC, aP3, pC);
+  pRasterizer.drawLine(aP3, pC, aP1, pC);
+}
+
+// Rasterizes the frame of all the facets in pFacets
+template <class Facets>
+static void rasterizeFacetsFrames(const Facets&       pFacets,
+                                  SoftwareRasterizer& pRasterizer,
+                                  const Vector3D&     pC)
+{
+  typename Facets::const_iterator       lIterFacets    = pFacets.begin();
+  const typename Facets::const_iterator lIterFacetsEnd = pFacets.end  ();
+
+  while (lIterFacets != lIterFacetsEnd) {
+    lIterFacets->rasterizeFacetsFrame(pRasterizer, pC);
+    ++lIterFacets;
+  }
+}
+
+// Renders the full content with pRasterizer instead of
+// OpenGL, in the same order as renderFull. Like OpenGL,
+// the colored primitives change the current color.
+void PrimitiveAccumulator::rasterize(SoftwareRasterizer&     pRasterizer,
+                                     const RenderParameters& pParams) const
+{
+  SoftwareRasterizer::State& lState = pRasterizer.getState();
+
+  // Facets frame
+  if(pParams.aFlagRenderFacetFrame) {
+
+    const SoftwareRasterizer::State lSavedState = lState;
+    const Vector3D                  lC(pParams.aFacetBoundaryR, pParams.aFacetBoundaryG, pParams.aFacetBoundaryB);
+
+    lState.aLineWidth = 1.0f;
+
+    rasterizeFacetsFrames(aQuads,                   pRasterizer, lC);
+    rasterizeFacetsFrames(aQuadsColored,            pRasterizer, lC);
+    rasterizeFacetsFrames(aQuadsNormals,            pRasterizer, lC);
+    rasterizeFacetsFrames(aQuadsNormalsColored,     pRasterizer, lC);
+    rasterizeFacetsFrames(aTriangles,               pRasterizer, lC);
+    rasterizeFacetsFrames(aTrianglesColored,        pRasterizer, lC);
+    rasterizeFacetsFrames(aTrianglesNormals,        pRasterizer, lC);
+    rasterizeFacetsFrames(aTrianglesNormalsColored, pRasterizer, lC);
+
+    lState = lSavedState;
+  }
+
+  // Lines
+  {
+    Lines::const_iterator       lIterLines    = aLines.begin();
+    const Lines::const_iterator lIterLinesEnd = aLines.end  ();
+
+    while (lIterLines != lIterLinesEnd) {
+      pRasterizer.drawLine(lIterLines->aP1, lState.aColor, lIterLines->aP2, lState.aColor);
+      ++lIterLines;
+    }
+  }
+
+  {
+    LinesColored::const_iterator       lIterLines    = aLinesColored.begin();
+    const LinesColored::const_iterator lIterLinesEnd = aLinesColored.end  ();
+
+    while (lIterLines != lIterLinesEnd) {
+      pRasterizer.drawLine(lIterLines->aP1, lIterLines->aC1, lIterLines->aP2, lIterLines->aC2);
+      lState.aColor = lIterLines->aC2;
+      ++lIterLines;
+    }
+  }
+
+  // Points
+  {
+    Points::const_iterator       lIterPoints    = aPoints.begin();
+    const Points::const_iterator lIterPointsEnd = aPoints.end  ();
+
+    while (lIterPoints != lIterPointsEnd) {
+      pRasterizer.drawPoint(lIterPoints->aP, lState.aColor);
+      ++lIterPoints;
+    }
+  }
+
+  {
+    PointsColored::const_iterator       lIterPoints    = aPointsColored.begin();
+    const PointsColored::const_iterator lIterPointsEnd = aPointsColored.end  ();
+
+    while (lIterPoints != lIterPointsEnd) {
+      pRasterizer.drawPoint(lIterPoints->aP, lIterPoints->aC);
+      lState.aColor = lIterPoints->aC;
+      ++lIterPoints;
+    }
+  }
+
+  // Quads
+  {
+    Quads::const_iterator       lIterQuads    = aQuads.begin();
+    const Quads::const_iterator lIterQuadsEnd = aQuads.end  ();
+
+    while (lIterQuads != lIterQuadsEnd) {
+      const Quad&     lQuad = *lIterQuads;
+      const Vector3D& lC    = lState.aColor;
+
+      pRasterizer.drawQuad(lQuad.aP1, (lQuad.aP2-lQuad.aP1).crossProduct(lQuad.aP4-lQuad.aP1), lC,
+                           lQuad.aP2, (lQuad.aP3-lQuad.aP2).crossProduct(lQuad.aP1-lQuad.aP2), lC,
+                           lQuad.aP3, (lQuad.aP4-lQuad.aP3).crossProduct(lQuad.aP2-lQuad.aP3), lC,
+                           lQuad.aP4, (lQuad.aP1-lQuad.aP4).crossProduct(lQuad.aP3-lQuad.aP4), lC);
+      ++lIterQuads;
+    }
+  }
+
+  {
+    QuadsColored::const_iterator       lIterQuads    = aQuadsColored.begin();
+    const QuadsColored::const_iterator lIterQuadsEnd = aQuadsColored.end  ();
+
+    while (lIterQuads != lIterQuadsEnd) {
+      const QuadColored& lQuad = *lIterQuads;
+
+      pRasterizer.drawQuad(lQuad.aP1, (lQuad.aP2-lQuad.aP1).crossProduct(lQuad.aP4-lQuad.aP1), lQuad.aC1,
+                           lQuad.aP2, (lQuad.aP3-lQuad.aP2).crossProduct(lQuad.aP1-lQuad.aP2), lQuad.aC2,
+                           lQuad.aP3, (lQuad.aP4-lQuad.aP3).crossProduct(lQuad.aP2-lQuad.aP3), lQuad.aC3,
+                           lQuad.aP4, (lQuad.aP1-lQuad.aP4).crossProduct(lQuad.aP3-lQuad.aP4), lQuad.aC4);
+      lState.aColor = lQuad.aC4;
+      ++lIterQuads;
+    }
+  }
+
+  {
+    QuadsNormals::const_iterator       lIterQuads    = aQuadsNormals.begin();
+    const QuadsNormals::const_iterator lIterQuadsEnd = aQuadsNormals.end  ();
+
+    while (lIterQuads != lIterQuadsEnd) {
+      const QuadNormals& lQuad = *lIterQuads;
+      const Vector3D&    lC    = lState.aColor;
+
+      pRasterizer.drawQuad(lQuad.aP1, lQuad.aN1, lC,
+                           lQuad.aP2, lQuad.aN2, lC,
+                           lQuad.aP3, lQuad.aN3, lC,
+                           lQuad.aP4, lQuad.aN4, lC);
+      ++lIterQuads;
+    }
+  }
+
+  {
+    QuadsNormalsColored::const_iterator       lIterQuads    = aQuadsNormalsColored.begin();
+    const QuadsNormalsColored::const_iterator lIterQuadsEnd = aQuadsNormalsColored.end  ();
+
+    while (lIterQuads != lIterQuadsEnd) {
+      const QuadNormalsColored& lQuad = *lIterQuads;
+
+      pRasterizer.drawQuad(lQuad.aP1, lQuad.aN1, lQuad.aC1,
+                           lQuad.aP2, lQuad.aN2, lQuad.aC2,
+                           lQuad.aP3, lQuad.aN3, lQuad.aC3,
+                           lQuad.aP4, lQuad.aN4, lQuad.aC4);
+      lState.aColor = lQuad.aC4;
+      ++lIterQuads;
+    }
+  }
+
+  // Triangles
+  {
+    Triangles::const_iterator       lIterTriangles    = aTriangles.begin();
+    const Triangles::const_iterator lIterTrianglesEnd = aTriangles.end  ();
+
+    while (lIterTriangles != lIterTrianglesEnd) {
+      const Triangle& lTriangle = *lIterTriangles;
+      const Vector3D& lC        = lState.aColor;
+      const Vector3D  lN        = (lTriangle.aP2-lTriangle.aP1).crossProduct(lTriangle.aP3-lTriangle.aP1);
+
+      pRasterizer.drawTriangle(lTriangle.aP1, lN, lC,
+                               lTriangle.aP2, lN, lC,
+                               lTriangle.aP3, lN, lC);
+      ++lIterTriangles;
+    }
+  }
+
+  {
+    TrianglesColored::const_iterator       lIterTriangles    = aTrianglesColored.begin();
+    const TrianglesColored::const_iterator lIterTrianglesEnd = aTrianglesColored.end  ();
+
+    while (lIterTriangles != lIterTrianglesEnd) {
+      const TriangleColored& lTriangle = *lIterTriangles;
+      const Vector3D         lN        = (lTriangle.aP2-lTriangle.aP1).crossProduct(lTriangle.aP3-lTriangle.aP1);
+
+      pRasterizer.drawTriangle(lTriangle.aP1, lN, lTriangle.aC1,
+                               lTriangle.aP2, lN, lTriangle.aC2,
+                               lTriangle.aP3, lN, lTriangle.aC3);
+      lState.aColor = lTriangle.aC3;
+      ++lIterTriangles;
+    }
+  }
+
+  {
+    TrianglesNormals::const_iterator       lIterTriangles    = aTrianglesNormals.begin();
+    const TrianglesNormals::const_iterator lIterTrianglesEnd = aTrianglesNormals.end  ();
+
+    while (lIterTriangles != lIterTrianglesEnd) {
+      const TriangleNormals& lTriangle = *lIterTriangles;
+      const Vector3D&        lC        = lState.aColor;
+
+      pRasterizer.drawTriangle(lTriangle.aP1, lTriangle.aN1, lC,
+                               lTriangle.aP2, lTriangle.aN2, lC,
+                               lTriangle.aP3, lTriangle.aN3, lC);
+      ++lIterTriangles;
+    }
+  }
+
+  {
+    TrianglesNormalsColored::const_iterator       lIterTriangles    = aTrianglesNormalsColored.begin();
+    const TrianglesNormalsColored::const_iterator lIterTrianglesEnd = aTrianglesNormalsColored.end  ();
+
+    while (lIterTriangles != lIterTrianglesEnd) {
+      const TriangleNormalsColored& lTriangle = *lIterTriangles;
+
+      pRasterizer.drawTriangle(lTriangle.aP1, lTriangle.aN1, lTriangle.aC1,
+                               lTriangle.aP2, lTriangle.aN2, lTriangle.aC2,
+                               lTriangle.aP3, lTriangle.aN3, lTriangle.aC3);
+      lState.aColor = lTriangle.aC3;
+      ++lIterTriangles;
+    }
+  }
+}
+
+// Read the primitives written by writeCache. The BoundingBox
+// and the simplified version are recomputed when needed.
+// Returns false if the file is corrupted
+bool PrimitiveAccumulator::readCache(FILE* pFilePtr)
+{
+  const bool lOk = (readCacheVector(pFilePtr, aLines                  ) &&
+                    readCacheVector(pFilePtr, aLinesColored           ) &&
+                    readCacheVector(pFilePtr, aPoints                 ) &&
+                    readCacheVector(pFilePtr, aPointsColored          ) &&
+                    readCacheVector(pFilePtr, aQuads                  ) &&
+                    readCacheVector(pFilePtr, aQuadsColored           ) &&
+                    readCacheVector(pFilePtr, aQuadsNormals           ) &&
+                    readCacheVector(pFilePtr, aQuadsNormalsColored    ) &&
+                    readCacheVector(pFilePtr, aTriangles              ) &&
+                    readCacheVector(pFilePtr, aTrianglesColored       ) &&
+                    readCacheVector(pFilePtr, aTrianglesNormals       ) &&
+                    readCacheVector(pFilePtr, aTrianglesNormalsColored) &&
+                    readCacheVector(pFilePtr, aHierarchyNodes         ));
+
+  resetClustering();
+  aSimplifiedDirty = true;
 
-    while (aTrianglesNormalsBBoxCounter < lSize) {
-      const Triangle& lTriangle = aTrianglesNormals[aTrianglesNormalsBBoxCounter];
-      aBoundingBox += lTriangle.aP1;
-      aBoundingBox += lTriangle.aP2;
-      aBoundingBox += lTriangle.aP3;
-      ++aTrianglesNormalsBBoxCounter;
-    }
+  if (!lOk) {
+    return false;
   }
 
-  {
-    const SizeType lSize = aTrianglesNormalsColored.size();
+  // Make sure that the hierarchy matches the primitives
+  const PrimitiveRanges lRanges = getRanges();
+  const int             lNbNodes = static_cast<int>(aHierarchyNodes.size());
 
-    while (aTrianglesNormalsColoredBBoxCounter < lSize) {
-      const Triangle& lTriangle = aTrianglesNormalsColored[aTrianglesNormalsColoredBBoxCounter];
-      aBoundingBox += lTriangle.aP1;
-      aBoundingBox += lTriangle.aP2;
-      aBoundingBox += lTriangle.aP3;
-      ++aTrianglesNormalsColoredBBoxCounter;
+  for (int i=0; i<lNbNodes; ++i) {
+
+    const HierarchyNode& lNode = aHierarchyNodes[i];
+
+    if (lNode.aSecondChild >= lNbNodes || (lNode.aSecondChild >= 0 && lNode.aSecondChild <= i+1)) {
+      return false;
+    }
+    for (int lType=0; lType<primitiveType_count; ++lType) {
+      if (lNode.aRanges.aBegin[lType] > lNode.aRanges.aEnd[lType] ||
+          lNode.aRanges.aEnd  [lType] > lRanges.aEnd[lType]) {
+        return false;
+      }
     }
   }
 
-  return aBoundingBox;
+  aHierarchyGLDisplayLists.assign(aHierarchyNodes.size(), 0);
+
+  return true;
 }
 
 void PrimitiveAccumulator::render(const RenderParameters& pParams)
@@ -613,6 +1379,9 @@ void PrimitiveAccumulator::render(const RenderParameters& pParams)
   case RenderParameters::renderMode_fast:
     renderSimplified(pParams);
     break;
+  case RenderParameters::renderMode_level_of_detail:
+    renderLevelOfDetail(pParams, false);
+    break;
   default:
     GLV_ASSERT(false);
   }
@@ -620,17 +1389,65 @@ void PrimitiveAccumulator::render(const RenderParameters& pParams)
 
 
 
-// Renders the content of aLines
-void PrimitiveAccumulator::renderFacetsFrame(const RenderParameters& pParams)
+// Same as render, but with the display list built by
+// constructDisplayList when it exists
+void PrimitiveAccumulator::renderDisplayList(const RenderParameters& pParams)
+{
+  if (pParams.aRenderMode == RenderParameters::renderMode_level_of_detail) {
+    renderLevelOfDetail(pParams, true);
+    return;
+  }
+
+  const GLuint lGLDisplayList = getGLDisplayList(pParams);
+
+  // Only the leaves of the hierarchy that are not outside
+  // of the frustum, and not facing away from the camera when
+  // OpenGL culls those faces, are rendered
+  if (pParams.aFlagFrustumCulling                                 &&
+      pParams.aRenderMode == RenderParameters::renderMode_full &&
+      !aHierarchyNodes.empty()) {
+
+    Vector3D  lEye;
+    const int lCulledFaces = (pParams.aFlagRenderFacetFrame ? 0 : NormalCone::getCulledFaces(lEye));
+
+    renderHierarchy(pParams, 0, true, lCulledFaces, lEye);
+  }
+  else if (lGLDisplayList != 0) {
+    glCallList(lGLDisplayList);
+  }
+  else {
+    render(pParams);
+  }
+}
+
+// Write the primitives in the parse cache file
+// Returns false on a write error
+bool PrimitiveAccumulator::writeCache(FILE* pFilePtr) const
+{
+  return (writeCacheVector(pFilePtr, aLines                  ) &&
+          writeCacheVector(pFilePtr, aLinesColored           ) &&
+          writeCacheVector(pFilePtr, aPoints                 ) &&
+          writeCacheVector(pFilePtr, aPointsColored          ) &&
+          writeCacheVector(pFilePtr, aQuads                  ) &&
+          writeCacheVector(pFilePtr, aQuadsColored           ) &&
+          writeCacheVector(pFilePtr, aQuadsNormals           ) &&
+          writeCacheVector(pFilePtr, aQuadsNormalsColored    ) &&
+          writeCacheVector(pFilePtr, aTriangles              ) &&
+          writeCacheVector(pFilePtr, aTrianglesColored       ) &&
+          writeCacheVector(pFilePtr, aTrianglesNormals       ) &&
+          writeCacheVector(pFilePtr, aTrianglesNormalsColored) &&
+          writeCacheVector(pFilePtr, aHierarchyNodes         ));
+}
+
+// Renders the frame of the facets in pRanges
+void PrimitiveAccumulator::renderFacetsFrame(const RenderParameters& pParams,
+                                             const PrimitiveRanges&  pRanges)
 {
-  const SizeType lNbFacets = aQuads.size()               +
-                             aQuadsColored.size()        +
-                             aQuadsNormals.size()        +
-                             aQuadsNormalsColored.size() +
-                             aTriangles.size()           +
-                             aTrianglesColored.size()    +
-                             aTrianglesNormals.size()    +
-                             aTrianglesNormalsColored.size();
+  // All the types from primitiveType_quad are facets
+  SizeType lNbFacets = 0;
+  for (int lType=primitiveType_quad; lType<primitiveType_count; ++lType) {
+    lNbFacets += pRanges.aEnd[lType] - pRanges.aBegin[lType];
+  }
 
   // If facet drawing is enabled and we've got something to draw
   if(pParams.aFlagRenderFacetFrame && lNbFacets > 0) {
@@ -644,8 +1461,8 @@ void PrimitiveAccumulator::renderFacetsFrame(const RenderParameters& pParams)
     glColor3f(pParams.aFacetBoundaryR, pParams.aFacetBoundaryG, pParams.aFacetBoundaryB);
 
     {
-      Quads::const_iterator       lIterQuads    = aQuads.begin();
-      const Quads::const_iterator lIterQuadsEnd = aQuads.end  ();
+      Quads::const_iterator       lIterQuads    = aQuads.begin() + pRanges.aBegin[primitiveType_quad];
+      const Quads::const_iterator lIterQuadsEnd = aQuads.begin() + pRanges.aEnd  [primitiveType_quad];
 
       while (lIterQuads != lIterQuadsEnd) {
         lIterQuads->renderFacetsFrame();
@@ -654,8 +1471,8 @@ void PrimitiveAccumulator::renderFacetsFrame(const RenderParameters& pParams)
     }
 
     {
-      QuadsColored::const_iterator       lIterQuads    = aQuadsColored.begin();
-      const QuadsColored::const_iterator lIterQuadsEnd = aQuadsColored.end  ();
+      QuadsColored::const_iterator       lIterQuads    = aQuadsColored.begin() + pRanges.aBegin[primitiveType_quad_colored];
+      const QuadsColored::const_iterator lIterQuadsEnd = aQuadsColored.begin() + pRanges.aEnd  [primitiveType_quad_colored];
 
       while (lIterQuads != lIterQuadsEnd) {
         lIterQuads->renderFacetsFrame();
@@ -664,8 +1481,8 @@ void PrimitiveAccumulator::renderFacetsFrame(const RenderParameters& pParams)
     }
 
     {
-      QuadsNormals::const_iterator       lIterQuads    = aQuadsNormals.begin();
-      const QuadsNormals::const_iterator lIterQuadsEnd = aQuadsNormals.end  ();
+      QuadsNormals::const_iterator       lIterQuads    = aQuadsNormals.begin() + pRanges.aBegin[primitiveType_quad_normals];
+      const QuadsNormals::const_iterator lIterQuadsEnd = aQuadsNormals.begin() + pRanges.aEnd  [primitiveType_quad_normals];
 
       while (lIterQuads != lIterQuadsEnd) {
         lIterQuads->renderFacetsFrame();
@@ -674,8 +1491,8 @@ void PrimitiveAccumulator::renderFacetsFrame(const RenderParameters& pParams)
     }
 
     {
-      QuadsNormalsColored::const_iterator       lIterQuads    = aQuadsNormalsColored.begin();
-      const QuadsNormalsColored::const_iterator lIterQuadsEnd = aQuadsNormalsColored.end  ();
+      QuadsNormalsColored::const_iterator       lIterQuads    = aQuadsNormalsColored.begin() + pRanges.aBegin[primitiveType_quad_normals_colored];
+      const QuadsNormalsColored::const_iterator lIterQuadsEnd = aQuadsNormalsColored.begin() + pRanges.aEnd  [primitiveType_quad_normals_colored];
 
       while (lIterQuads != lIterQuadsEnd) {
         lIterQuads->renderFacetsFrame();
@@ -684,8 +1501,8 @@ void PrimitiveAccumulator::renderFacetsFrame(const RenderParameters& pParams)
     }
 
     {
-      Triangles::const_iterator       lIterTriangles    = aTriangles.begin();
-      const Triangles::const_iterator lIterTrianglesEnd = aTriangles.end  ();
+      Triangles::const_iterator       lIterTriangles    = aTriangles.begin() + pRanges.aBegin[primitiveType_triangle];
+      const Triangles::const_iterator lIterTrianglesEnd = aTriangles.begin() + pRanges.aEnd  [primitiveType_triangle];
 
       while (lIterTriangles != lIterTrianglesEnd) {
         lIterTriangles->renderFacetsFrame();
@@ -694,8 +1511,8 @@ void PrimitiveAccumulator::renderFacetsFrame(const RenderParameters& pParams)
     }
 
     {
-      TrianglesColored::const_iterator       lIterTriangles    = aTrianglesColored.begin();
-      const TrianglesColored::const_iterator lIterTrianglesEnd = aTrianglesColored.end  ();
+      TrianglesColored::const_iterator       lIterTriangles    = aTrianglesColored.begin() + pRanges.aBegin[primitiveType_triangle_colored];
+      const TrianglesColored::const_iterator lIterTrianglesEnd = aTrianglesColored.begin() + pRanges.aEnd  [primitiveType_triangle_colored];
 
       while (lIterTriangles != lIterTrianglesEnd) {
         lIterTriangles->renderFacetsFrame();
@@ -704,8 +1521,8 @@ void PrimitiveAccumulator::renderFacetsFrame(const RenderParameters& pParams)
     }
 
     {
-      TrianglesNormals::const_iterator       lIterTriangles    = aTrianglesNormals.begin();
-      const TrianglesNormals::const_iterator lIterTrianglesEnd = aTrianglesNormals.end  ();
+      TrianglesNormals::const_iterator       lIterTriangles    = aTrianglesNormals.begin() + pRanges.aBegin[primitiveType_triangle_normals];
+      const TrianglesNormals::const_iterator lIterTrianglesEnd = aTrianglesNormals.begin() + pRanges.aEnd  [primitiveType_triangle_normals];
 
       while (lIterTriangles != lIterTrianglesEnd) {
         lIterTriangles->renderFacetsFrame();
@@ -714,8 +1531,8 @@ void PrimitiveAccumulator::renderFacetsFrame(const RenderParameters& pParams)
     }
 
     {
-      TrianglesNormalsColored::const_iterator       lIterTriangles    = aTrianglesNormalsColored.begin();
-      const TrianglesNormalsColored::const_iterator lIterTrianglesEnd = aTrianglesNormalsColored.end  ();
+      TrianglesNormalsColored::const_iterator       lIterTriangles    = aTrianglesNormalsColored.begin() + pRanges.aBegin[primitiveType_triangle_normals_colored];
+      const TrianglesNormalsColored::const_iterator lIterTrianglesEnd = aTrianglesNormalsColored.begin() + pRanges.aEnd  [primitiveType_triangle_normals_colored];
 
       while (lIterTriangles != lIterTrianglesEnd) {
         lIterTriangles->renderFacetsFrame();
@@ -730,35 +1547,139 @@ void PrimitiveAccumulator::renderFacetsFrame(const RenderParameters& pParams)
 
 void PrimitiveAccumulator::renderFull(const RenderParameters& pParams)
 {
-  aPrimitiveOptimizerValue = pParams.aPrimitiveOptimizerValue;
+  renderRanges(pParams, getRanges());
+}
+
+// Renders the accumulator simplified as many times as the level of
+// detail of pParams asks for its size on screen. If pFlagDisplayList
+// is true, the display list of that level is used (and recorded
+// if needed); must not be called while recording a display list then
+void PrimitiveAccumulator::renderLevelOfDetail(const RenderParameters& pParams,
+                                               const bool              pFlagDisplayList)
+{
+  if (isPointCloud() && !isFullDetail(pParams)) {
+    renderPointCloud(pParams, 0, pParams.aFlagFrustumCulling);
+    return;
+  }
+
+  RenderParameters lParams = pParams;
+  lParams.aRenderMode      = RenderParameters::renderMode_full;
+
+  PrimitiveAccumulator& lSimplified = getSimplified(pParams.getLevelOfDetail(getBoundingBox()));
+
+  if (pFlagDisplayList) {
+    lSimplified.constructDisplayList(lParams);
+    lSimplified.renderDisplayList   (lParams);
+  }
+  else {
+    lSimplified.renderFull(lParams);
+  }
+}
+
+// Renders the leaves of the hierarchy under pNode, with their display
+// list when it exists. If pFlagCulling is true, the nodes outside of
+// the frustum are skipped. The leaves whose faces would all be culled
+// by OpenGL are also skipped (see NormalCone::getCulledFaces for
+// pCulledFaces and pEye)
+void PrimitiveAccumulator::renderHierarchy(const RenderParameters& pParams,
+                                           const int               pNode,
+                                           const bool              pFlagCulling,
+                                           const int               pCulledFaces,
+                                           const Vector3D&         pEye)
+{
+  GLV_ASSERT(pNode >= 0);
+  GLV_ASSERT(pNode <  static_cast<int>(aHierarchyNodes.size()));
+
+  const HierarchyNode& lNode        = aHierarchyNodes[pNode];
+  bool                 lFlagCulling = pFlagCulling;
+
+  if (lFlagCulling) {
+    switch (lNode.aBoundingBox.getFrustumVisibility()) {
+    case BoundingBox::frustumVisibility_outside:
+      return;
+      break;
+    case BoundingBox::frustumVisibility_inside:
+      // Everything under this node is visible
+      lFlagCulling = false;
+      break;
+    default:
+      break;
+    }
+  }
 
-  renderFacetsFrame            (pParams);
-  renderLines                  ();
-  renderLinesColored           ();
-  renderPoints                 ();
-  renderPointsColored          ();
-  renderQuads                  ();
-  renderQuadsColored           ();
-  renderQuadsNormals           ();
-  renderQuadsNormalsColored    ();
-  renderTriangles              ();
-  renderTrianglesColored       ();
-  renderTrianglesNormals       ();
-  renderTrianglesNormalsColored();
+  if (lNode.aSecondChild < 0) {
+
+    if (lNode.aNormalCone.isCulled(lNode.aBoundingBox, pEye, pCulledFaces)) {
+      return;
+    }
+
+    // Each leaf starts with the current color of the accumulator,
+    // whether or not the previous leaves were culled
+    glPushAttrib(GL_CURRENT_BIT);
+
+    if (aHierarchyGLDisplayLists[pNode] != 0) {
+      glCallList(aHierarchyGLDisplayLists[pNode]);
+    }
+    else {
+      renderRanges(pParams, lNode.aRanges);
+    }
+
+    glPopAttrib();
+  }
+  else {
+    renderHierarchy(pParams, pNode+1            , lFlagCulling, pCulledFaces, pEye);
+    renderHierarchy(pParams, lNode.aSecondChild, lFlagCulling, pCulledFaces, pEye);
+  }
+}
+
+// Returns true if the primitives are split in a hierarchy
+// (see constructHierarchy)
+bool PrimitiveAccumulator::hasHierarchy() const
+{
+  return !aHierarchyNodes.empty();
+}
+
+// Returns true if the accumulator only has points, split in a
+// hierarchy: it is then simplified by rendering fewer points per
+// leaf instead of clustering them (see renderPointCloud)
+bool PrimitiveAccumulator::isPointCloud() const
+{
+  if (aHierarchyNodes.empty()) {
+    return false;
+  }
+
+  return (aLines                  .empty() &&
+          aLinesColored           .empty() &&
+          aQuads                  .empty() &&
+          aQuadsColored           .empty() &&
+          aQuadsNormals           .empty() &&
+          aQuadsNormalsColored    .empty() &&
+          aTriangles              .empty() &&
+          aTrianglesColored       .empty() &&
+          aTrianglesNormals       .empty() &&
+          aTrianglesNormalsColored.empty());
 }
 
-// Renders the content of aLines
-void PrimitiveAccumulator::renderLines()
+// Returns true if pParams asks for the accumulator
+// not simplified at all in renderMode_level_of_detail
+bool PrimitiveAccumulator::isFullDetail(const RenderParameters& pParams)
+{
+  return (pParams.aLevelOfDetail == 0 && pParams.aLevelOfDetailPixels <= 0.0f);
+}
+
+// Renders the primitives pBegin to pEnd-1 of aLines
+void PrimitiveAccumulator::renderLines(const SizeType pBegin,
+                                       const SizeType pEnd)
 {
   int lPrimitiveCount = 0;
-  if (aLines.size() > 0) {
+  if (pEnd > pBegin) {
 
     glPushAttrib(GL_LIGHTING_BIT);
     glDisable(GL_LIGHTING);
     glBegin(GL_LINES);
 
-    Lines::const_iterator       lIterLines    = aLines.begin();
-    const Lines::const_iterator lIterLinesEnd = aLines.end  ();
+    Lines::const_iterator       lIterLines    = aLines.begin() + pBegin;
+    const Lines::const_iterator lIterLinesEnd = aLines.begin() + pEnd;
 
     while (lIterLines != lIterLinesEnd) {
 
@@ -788,18 +1709,19 @@ void PrimitiveAccumulator::renderLines()
   }
 }
 
-// Renders the content of aLinesColored
-void PrimitiveAccumulator::renderLinesColored()
+// Renders the primitives pBegin to pEnd-1 of aLinesColored
+void PrimitiveAccumulator::renderLinesColored(const SizeType pBegin,
+                                              const SizeType pEnd)
 {
   int lPrimitiveCount = 0;
-  if (aLinesColored.size() > 0) {
+  if (pEnd > pBegin) {
 
     glPushAttrib(GL_LIGHTING_BIT);
     glDisable(GL_LIGHTING);
     glBegin(GL_LINES);
 
-    LinesColored::const_iterator       lIterLinesColored    = aLinesColored.begin();
-    const LinesColored::const_iterator lIterLinesColoredEnd = aLinesColored.end  ();
+    LinesColored::const_iterator       lIterLinesColored    = aLinesColored.begin() + pBegin;
+    const LinesColored::const_iterator lIterLinesColoredEnd = aLinesColored.begin() + pEnd;
 
     while (lIterLinesColored != lIterLinesColoredEnd) {
 
@@ -833,17 +1755,80 @@ void PrimitiveAccumulator::renderLinesColored()
   }
 }
 
-// Renders the content of aPoints
-void PrimitiveAccumulator::renderPoints()
+// Renders a sample of the points of the leaves of the hierarchy under
+// pNode. Since the points of each leaf are shuffled, the first quarter
+// of a leaf is a coarser version of it: a leaf simplified n times only
+// renders its first 1/4^n points, n being its level of detail in
+// renderMode_level_of_detail and pParams.aLevelOfDetail otherwise.
+// If pFlagCulling is true, the nodes outside of the frustum are skipped
+void PrimitiveAccumulator::renderPointCloud(const RenderParameters& pParams,
+                                            const int               pNode,
+                                            const bool              pFlagCulling)
+{
+  GLV_ASSERT(pNode >= 0);
+  GLV_ASSERT(pNode <  static_cast<int>(aHierarchyNodes.size()));
+
+  const HierarchyNode& lNode        = aHierarchyNodes[pNode];
+  bool                 lFlagCulling = pFlagCulling;
+
+  if (lFlagCulling) {
+    switch (lNode.aBoundingBox.getFrustumVisibility()) {
+    case BoundingBox::frustumVisibility_outside:
+      return;
+      break;
+    case BoundingBox::frustumVisibility_inside:
+      // Everything under this node is visible
+      lFlagCulling = false;
+      break;
+    default:
+      break;
+    }
+  }
+
+  if (lNode.aSecondChild < 0) {
+
+    int lLevel = pParams.aLevelOfDetail;
+
+    if (pParams.aRenderMode == RenderParameters::renderMode_level_of_detail) {
+      lLevel = pParams.getLevelOfDetail(lNode.aBoundingBox);
+    }
+
+    // Each leaf starts with the current color of the accumulator,
+    // whether or not the previous leaves were culled
+    glPushAttrib(GL_CURRENT_BIT);
+
+    const PrimitiveRanges& lRanges     = lNode.aRanges;
+    const SizeType         lBegin      = lRanges.aBegin[primitiveType_point];
+    const SizeType         lEnd        = lBegin + getPointCloudSampleSize(lRanges.aEnd[primitiveType_point] - lBegin, lLevel);
+    const SizeType         lBeginColor = lRanges.aBegin[primitiveType_point_colored];
+    const SizeType         lEndColor   = lBeginColor + getPointCloudSampleSize(lRanges.aEnd[primitiveType_point_colored] - lBeginColor, lLevel);
+
+    prefetchMapped(aPoints       , lBegin     , lEnd     );
+    prefetchMapped(aPointsColored, lBeginColor, lEndColor);
+
+    renderPoints       (lBegin     , lEnd     );
+    renderPointsColored(lBeginColor, lEndColor);
+
+    glPopAttrib();
+  }
+  else {
+    renderPointCloud(pParams, pNode+1            , lFlagCulling);
+    renderPointCloud(pParams, lNode.aSecondChild, lFlagCulling);
+  }
+}
+
+// Renders the primitives pBegin to pEnd-1 of aPoints
+void PrimitiveAccumulator::renderPoints(const SizeType pBegin,
+                                        const SizeType pEnd)
 {
-  if (aPoints.size() > 0) {
+  if (pEnd > pBegin) {
 
     glPushAttrib(GL_LIGHTING_BIT);
     glDisable(GL_LIGHTING);
     glBegin(GL_POINTS);
 
-    Points::const_iterator       lIterPoints    = aPoints.begin();
-    const Points::const_iterator lIterPointsEnd = aPoints.end  ();
+    Points::const_iterator       lIterPoints    = aPoints.begin() + pBegin;
+    const Points::const_iterator lIterPointsEnd = aPoints.begin() + pEnd;
 
     while (lIterPoints != lIterPointsEnd) {
 
@@ -863,17 +1848,18 @@ void PrimitiveAccumulator::renderPoints()
   }
 }
 
-// Renders the content of aPointsColored
-void PrimitiveAccumulator::renderPointsColored()
+// Renders the primitives pBegin to pEnd-1 of aPointsColored
+void PrimitiveAccumulator::renderPointsColored(const SizeType pBegin,
+                                               const SizeType pEnd)
 {
-  if (aPointsColored.size() > 0) {
+  if (pEnd > pBegin) {
 
     glPushAttrib(GL_LIGHTING_BIT);
     glDisable(GL_LIGHTING);
     glBegin(GL_POINTS);
 
-    PointsColored::const_iterator       lIterPointsColored    = aPointsColored.begin();
-    const PointsColored::const_iterator lIterPointsColoredEnd = aPointsColored.end  ();
+    PointsColored::const_iterator       lIterPointsColored    = aPointsColored.begin() + pBegin;
+    const PointsColored::const_iterator lIterPointsColoredEnd = aPointsColored.begin() + pEnd;
 
     while (lIterPointsColored != lIterPointsColoredEnd) {
 
@@ -895,17 +1881,18 @@ void PrimitiveAccumulator::renderPointsColored()
   }
 }
 
-// Renders the content of aQuads
-void PrimitiveAccumulator::renderQuads()
+// Renders the primitives pBegin to pEnd-1 of aQuads
+void PrimitiveAccumulator::renderQuads(const SizeType pBegin,
+                                       const SizeType pEnd)
 {
   int lPrimitiveCount = 0;
 
-  if (aQuads.size() > 0) {
+  if (pEnd > pBegin) {
 
     glBegin(GL_QUADS);
 
-    Quads::const_iterator       lIterQuads    = aQuads.begin();
-    const Quads::const_iterator lIterQuadsEnd = aQuads.end  ();
+    Quads::const_iterator       lIterQuads    = aQuads.begin() + pBegin;
+    const Quads::const_iterator lIterQuadsEnd = aQuads.begin() + pEnd;
 
     while (lIterQuads != lIterQuadsEnd) {
 
@@ -951,16 +1938,17 @@ void PrimitiveAccumulator::renderQuads()
   }
 }
 
-// Renders the content of aQuadsColored
-void PrimitiveAccumulator::renderQuadsColored()
+// Renders the primitives pBegin to pEnd-1 of aQuadsColored
+void PrimitiveAccumulator::renderQuadsColored(const SizeType pBegin,
+                                              const SizeType pEnd)
 {
   int lPrimitiveCount = 0;
-  if (aQuadsColored.size() > 0) {
+  if (pEnd > pBegin) {
 
     glBegin(GL_QUADS);
 
-    QuadsColored::const_iterator       lIterQuadsColored    = aQuadsColored.begin();
-    const QuadsColored::const_iterator lIterQuadsColoredEnd = aQuadsColored.end  ();
+    QuadsColored::const_iterator       lIterQuadsColored    = aQuadsColored.begin() + pBegin;
+    const QuadsColored::const_iterator lIterQuadsColoredEnd = aQuadsColored.begin() + pEnd;
 
     while (lIterQuadsColored != lIterQuadsColoredEnd) {
 
@@ -1014,16 +2002,17 @@ void PrimitiveAccumulator::renderQuadsColored()
   }
 }
 
-// Renders the content of aQuadsNormals
-void PrimitiveAccumulator::renderQuadsNormals()
+// Renders the primitives pBegin to pEnd-1 of aQuadsNormals
+void PrimitiveAccumulator::renderQuadsNormals(const SizeType pBegin,
+                                              const SizeType pEnd)
 {
   int lPrimitiveCount = 0;
-  if (aQuadsNormals.size() > 0) {
+  if (pEnd > pBegin) {
 
     glBegin(GL_QUADS);
 
-    QuadsNormals::const_iterator       lIterQuadsNormals    = aQuadsNormals.begin();
-    const QuadsNormals::const_iterator lIterQuadsNormalsEnd = aQuadsNormals.end  ();
+    QuadsNormals::const_iterator       lIterQuadsNormals    = aQuadsNormals.begin() + pBegin;
+    const QuadsNormals::const_iterator lIterQuadsNormalsEnd = aQuadsNormals.begin() + pEnd;
 
     while (lIterQuadsNormals != lIterQuadsNormalsEnd) {
 
@@ -1063,16 +2052,17 @@ void PrimitiveAccumulator::renderQuadsNormals()
   }
 }
 
-// Renders the content of aQuadsNormalsColored
-void PrimitiveAccumulator::renderQuadsNormalsColored()
+// Renders the primitives pBegin to pEnd-1 of aQuadsNormalsColored
+void PrimitiveAccumulator::renderQuadsNormalsColored(const SizeType pBegin,
+                                                     const SizeType pEnd)
 {
   int lPrimitiveCount = 0;
-  if (aQuadsNormalsColored.size() > 0) {
+  if (pEnd > pBegin) {
 
     glBegin(GL_QUADS);
 
-    QuadsNormalsColored::const_iterator       lIterQuadsNormalsColored    = aQuadsNormalsColored.begin();
-    const QuadsNormalsColored::const_iterator lIterQuadsNormalsColoredEnd = aQuadsNormalsColored.end  ();
+    QuadsNormalsColored::const_iterator       lIterQuadsNormalsColored    = aQuadsNormalsColored.begin() + pBegin;
+    const QuadsNormalsColored::const_iterator lIterQuadsNormalsColoredEnd = aQuadsNormalsColored.begin() + pEnd;
 
     while (lIterQuadsNormalsColored != lIterQuadsNormalsColoredEnd) {
 
@@ -1120,46 +2110,70 @@ void PrimitiveAccumulator::renderQuadsNormalsColored()
   }
 }
 
+// Renders the primitives in pRanges
+void PrimitiveAccumulator::renderRanges(const RenderParameters& pParams,
+                                        const PrimitiveRanges&  pRanges)
+{
+  aPrimitiveOptimizerValue = pParams.aPrimitiveOptimizerValue;
+
+  // The primitives are read in order: with a memory budget, the
+  // next ones are read from the disk while the first ones are
+  // rendered
+  prefetchMapped(aLines                  , pRanges.aBegin[primitiveType_line                    ], pRanges.aEnd[primitiveType_line                    ]);
+  prefetchMapped(aLinesColored           , pRanges.aBegin[primitiveType_line_colored            ], pRanges.aEnd[primitiveType_line_colored            ]);
+  prefetchMapped(aPoints                 , pRanges.aBegin[primitiveType_point                   ], pRanges.aEnd[primitiveType_point                   ]);
+  prefetchMapped(aPointsColored          , pRanges.aBegin[primitiveType_point_colored           ], pRanges.aEnd[primitiveType_point_colored           ]);
+  prefetchMapped(aQuads                  , pRanges.aBegin[primitiveType_quad                    ], pRanges.aEnd[primitiveType_quad                    ]);
+  prefetchMapped(aQuadsColored           , pRanges.aBegin[primitiveType_quad_colored            ], pRanges.aEnd[primitiveType_quad_colored            ]);
+  prefetchMapped(aQuadsNormals           , pRanges.aBegin[primitiveType_quad_normals            ], pRanges.aEnd[primitiveType_quad_normals            ]);
+  prefetchMapped(aQuadsNormalsColored    , pRanges.aBegin[primitiveType_quad_normals_colored    ], pRanges.aEnd[primitiveType_quad_normals_colored    ]);
+  prefetchMapped(aTriangles              , pRanges.aBegin[primitiveType_triangle                ], pRanges.aEnd[primitiveType_triangle                ]);
+  prefetchMapped(aTrianglesColored       , pRanges.aBegin[primitiveType_triangle_colored        ], pRanges.aEnd[primitiveType_triangle_colored        ]);
+  prefetchMapped(aTrianglesNormals       , pRanges.aBegin[primitiveType_triangle_normals        ], pRanges.aEnd[primitiveType_triangle_normals        ]);
+  prefetchMapped(aTrianglesNormalsColored, pRanges.aBegin[primitiveType_triangle_normals_colored], pRanges.aEnd[primitiveType_triangle_normals_colored]);
+
+  renderFacetsFrame            (pParams, pRanges);
+  renderLines                  (pRanges.aBegin[primitiveType_line                    ], pRanges.aEnd[primitiveType_line                    ]);
+  renderLinesColored           (pRanges.aBegin[primitiveType_line_colored            ], pRanges.aEnd[primitiveType_line_colored            ]);
+  renderPoints                 (pRanges.aBegin[primitiveType_point                   ], pRanges.aEnd[primitiveType_point                   ]);
+  renderPointsColored          (pRanges.aBegin[primitiveType_point_colored           ], pRanges.aEnd[primitiveType_point_colored           ]);
+  renderQuads                  (pRanges.aBegin[primitiveType_quad                    ], pRanges.aEnd[primitiveType_quad                    ]);
+  renderQuadsColored           (pRanges.aBegin[primitiveType_quad_colored            ], pRanges.aEnd[primitiveType_quad_colored            ]);
+  renderQuadsNormals           (pRanges.aBegin[primitiveType_quad_normals            ], pRanges.aEnd[primitiveType_quad_normals            ]);
+  renderQuadsNormalsColored    (pRanges.aBegin[primitiveType_quad_normals_colored    ], pRanges.aEnd[primitiveType_quad_normals_colored    ]);
+  renderTriangles              (pRanges.aBegin[primitiveType_triangle                ], pRanges.aEnd[primitiveType_triangle                ]);
+  renderTrianglesColored       (pRanges.aBegin[primitiveType_triangle_colored        ], pRanges.aEnd[primitiveType_triangle_colored        ]);
+  renderTrianglesNormals       (pRanges.aBegin[primitiveType_triangle_normals        ], pRanges.aEnd[primitiveType_triangle_normals        ]);
+  renderTrianglesNormalsColored(pRanges.aBegin[primitiveType_triangle_normals_colored], pRanges.aEnd[primitiveType_triangle_normals_colored]);
+}
+
 void PrimitiveAccumulator::renderSimplified(const RenderParameters& pParams)
 {
-  // Check if we have to update the Simplified model
-  if (aSimplifiedDirty) {
-    constructSimplified();
+  // The display list of the fast mode may be recorded from here,
+  // so the point cloud isn't culled
+  if (isPointCloud()) {
+    renderPointCloud(pParams, 0, false);
+    return;
   }
 
   RenderParameters lParams = pParams;
   lParams.aRenderMode      = RenderParameters::renderMode_full;
 
-  // We push the attributes on the openGL attribute stack; so
-  // we dont disturb the current values of color (current) or line width (line)
-  glPushAttrib(GL_CURRENT_BIT | GL_LINE_BIT | GL_LIGHTING_BIT);
-  // Warning: performance hit; when a lot of push(GL_LIGHTING_BIT) calls are made
-  glDisable(GL_LIGHTING);
-  glPointSize(3);
-
-  glColor3f(0.7, 0.5, 0.1);
-
-  GLV_ASSERT(aSimplified != 0);
-  aSimplified->render(lParams);
-
-  // Revert the lighting state and the line state
-  glPopAttrib();
-
-  GLV_ASSERT(aSimplified != 0);
-  aSimplified->renderFull(lParams);
+  getSimplified(pParams.aLevelOfDetail).renderFull(lParams);
 }
 
-// Renders the content of aTriangles
-void PrimitiveAccumulator::renderTriangles()
+// Renders the primitives pBegin to pEnd-1 of aTriangles
+void PrimitiveAccumulator::renderTriangles(const SizeType pBegin,
+                                           const SizeType pEnd)
 {
   int lPrimitiveCount = 0;
 
-  if (aTriangles.size() > 0) {
+  if (pEnd > pBegin) {
 
     glBegin(GL_TRIANGLES);
 
-    Triangles::const_iterator       lIterTriangles    = aTriangles.begin();
-    const Triangles::const_iterator lIterTrianglesEnd = aTriangles.end  ();
+    Triangles::const_iterator       lIterTriangles    = aTriangles.begin() + pBegin;
+    const Triangles::const_iterator lIterTrianglesEnd = aTriangles.begin() + pEnd;
 
     while (lIterTriangles != lIterTrianglesEnd) {
 
@@ -1195,17 +2209,18 @@ void PrimitiveAccumulator::renderTriangles()
   }
 }
 
-// Renders the content of aTrianglesColored
-void PrimitiveAccumulator::renderTrianglesColored()
+// Renders the primitives pBegin to pEnd-1 of aTrianglesColored
+void PrimitiveAccumulator::renderTrianglesColored(const SizeType pBegin,
+                                                  const SizeType pEnd)
 {
   int lPrimitiveCount = 0;
 
-  if (aTrianglesColored.size() > 0) {
+  if (pEnd > pBegin) {
 
     glBegin(GL_TRIANGLES);
 
-    TrianglesColored::const_iterator       lIterTrianglesColored    = aTrianglesColored.begin();
-    const TrianglesColored::const_iterator lIterTrianglesColoredEnd = aTrianglesColored.end  ();
+    TrianglesColored::const_iterator       lIterTrianglesColored    = aTrianglesColored.begin() + pBegin;
+    const TrianglesColored::const_iterator lIterTrianglesColoredEnd = aTrianglesColored.begin() + pEnd;
 
     while (lIterTrianglesColored != lIterTrianglesColoredEnd) {
 
@@ -1245,17 +2260,18 @@ void PrimitiveAccumulator::renderTrianglesColored()
   }
 }
 
-// Renders the content of aTrianglesNormals
-void PrimitiveAccumulator::renderTrianglesNormals()
+// Renders the primitives pBegin to pEnd-1 of aTrianglesNormals
+void PrimitiveAccumulator::renderTrianglesNormals(const SizeType pBegin,
+                                                  const SizeType pEnd)
 {
   int lPrimitiveCount = 0;
 
-  if (aTrianglesNormals.size() > 0) {
+  if (pEnd > pBegin) {
 
     glBegin(GL_TRIANGLES);
 
-    TrianglesNormals::const_iterator       lIterTrianglesNormals    = aTrianglesNormals.begin();
-    const TrianglesNormals::const_iterator lIterTrianglesNormalsEnd = aTrianglesNormals.end  ();
+    TrianglesNormals::const_iterator       lIterTrianglesNormals    = aTrianglesNormals.begin() + pBegin;
+    const TrianglesNormals::const_iterator lIterTrianglesNormalsEnd = aTrianglesNormals.begin() + pEnd;
 
     while (lIterTrianglesNormals != lIterTrianglesNormalsEnd) {
 
@@ -1291,17 +2307,18 @@ void PrimitiveAccumulator::renderTrianglesNormals()
   }
 }
 
-// Renders the content of aTrianglesNormalsColored
-void PrimitiveAccumulator::renderTrianglesNormalsColored()
+// Renders the primitives pBegin to pEnd-1 of aTrianglesNormalsColored
+void PrimitiveAccumulator::renderTrianglesNormalsColored(const SizeType pBegin,
+                                                         const SizeType pEnd)
 {
   int lPrimitiveCount = 0;
 
-  if (aTrianglesNormalsColored.size() > 0) {
+  if (pEnd > pBegin) {
 
     glBegin(GL_TRIANGLES);
 
-    TrianglesNormalsColored::const_iterator       lIterTrianglesNormalsColored    = aTrianglesNormalsColored.begin();
-    const TrianglesNormalsColored::const_iterator lIterTrianglesNormalsColoredEnd = aTrianglesNormalsColored.end  ();
+    TrianglesNormalsColored::const_iterator       lIterTrianglesNormalsColored    = aTrianglesNormalsColored.begin() + pBegin;
+    const TrianglesNormalsColored::const_iterator lIterTrianglesNormalsColoredEnd = aTrianglesNormalsColored.begin() + pEnd;
 
     while (lIterTrianglesNormalsColored != lIterTrianglesNormalsColoredEnd) {
 
@@ -1343,46 +2360,18 @@ void PrimitiveAccumulator::renderTrianglesNormalsColored()
   }
 }
 
-struct SimplificationPoint
-{
-
-  SimplificationPoint(const float pX,
-                      const float pY,
-                      const float pZ)
-    : aBarycenterDistance (std::numeric_limits<float>::max()),
-      aPoint              (pX, pY, pZ),
-      aPrimiticeBarycenter()
-    {}
-
-  float     aBarycenterDistance;
-  Vector3D  aPoint;
-  Vector3D  aPrimiticeBarycenter;
-
-};
-
-
+// Add the primitives of pContainer from pCounter to pClustering,
+// and update pCounter
 template <class Container>
-inline void scanForClosest(Container&           pContainer,
-                           SimplificationPoint* pIterSPBegin,
-                           SimplificationPoint* pIterSPEnd)
+inline void addToClustering(const Container&              pContainer,
+                            typename Container::size_type& pCounter,
+                            VertexClustering&             pClustering)
 {
   const typename Container::size_type lSize = pContainer.size();
 
-  for (typename Container::size_type i=0; i<lSize; ++i) {
-
-    const typename Container::value_type&  lPrimitive = pContainer[i];
-    SimplificationPoint*                   lIterSP    = pIterSPBegin;
-
-    while (lIterSP != pIterSPEnd) {
-      SimplificationPoint& lSP         = *lIterSP;
-      const Vector3D       lBarycenter = lPrimitive .getBarycenter();
-      const float          lDistance   = lBarycenter.getDistanceTo(lSP.aPoint);
-      if (lDistance < lSP.aBarycenterDistance) {
-        lSP.aPrimiticeBarycenter = lBarycenter;
-        lSP.aBarycenterDistance  = lDistance;
-      }
-      ++lIterSP;
-    }
+  while (pCounter < lSize) {
+    pContainer[pCounter].addToClustering(pClustering);
+    ++pCounter;
   }
 }
 
@@ -1486,15 +2475,13 @@ void PrimitiveAccumulator::addArrowTip(const Vector3D& pP1,
 
 void PrimitiveAccumulator::constructSimplified()
 {
-
-  // The simplified model is a set of points located
-  // at the barycenter of a subset of the primitives.
-  // These primitives are chosen so that the
-  // object shape can still be recognise by the user
-  // with a modest number of points.
-  // More precisely, they are the primitives "closest"
-  // to a set of points on a the circumscribed sphere to
-  // the BoundingBox.
+  // The simplified model is made by vertex clustering: the
+  // vertices are merged on a regular grid, and the primitives
+  // that collapse are removed. So the shape and the colors of
+  // the model are kept, with a bounded number of primitives.
+  // The clustering is kept between the updates: only the
+  // primitives added since the last one are clustered, unless
+  // the model outgrew its grid
 
   if (!aSimplifiedDirty) {
     // Just to be safe, should not pass here
@@ -1503,191 +2490,54 @@ void PrimitiveAccumulator::constructSimplified()
   }
   else {
 
-    // Start from scratch
     GLV_ASSERT(aSimplified != 0);
     if (aSimplified != this) {
       delete aSimplified;
     }
-    aSimplified = new PrimitiveAccumulator(false);
+    aSimplified = this;
+
+    const PrimitiveRanges lRanges       = getRanges();
+    SizeType              lNbPrimitives = 0;
+
+    for (int lType=0; lType<primitiveType_count; ++lType) {
+      lNbPrimitives += lRanges.aEnd[lType];
+    }
 
-    // We call getBoundingBox so that it gets updated
-    // if it needs to
-    const BoundingBox& lBoundingBox = getBoundingBox();
-    const Vector3D     lCenter      = lBoundingBox.getCenter();
-    const float        lRadius      = lBoundingBox.getCircumscribedSphereRadius();
-
-    SimplificationPoint unitSphereSampling[] = {
-      SimplificationPoint(-1.0,0.0,0.0),
-      SimplificationPoint(-0.894427191,-0.4472135955,0.0),
-      SimplificationPoint(-0.894427191,0.0,-0.4472135955),
-      SimplificationPoint(-0.894427191,0.0,0.4472135955),
-      SimplificationPoint(-0.894427191,0.4472135955,0.0),
-      SimplificationPoint(-0.816496580928,-0.408248290464,-0.408248290464),
-      SimplificationPoint(-0.816496580928,-0.408248290464,0.408248290464),
-      SimplificationPoint(-0.816496580928,0.408248290464,-0.408248290464),
-      SimplificationPoint(-0.816496580928,0.408248290464,0.408248290464),
-      SimplificationPoint(-0.707106781187,-0.707106781187,0.0),
-      SimplificationPoint(-0.707106781187,0.0,-0.707106781187),
-      SimplificationPoint(-0.707106781187,0.0,0.707106781187),
-      SimplificationPoint(-0.707106781187,0.707106781187,0.0),
-      SimplificationPoint(-0.666666666667,-0.333333333333,-0.666666666667),
-      SimplificationPoint(-0.666666666667,-0.333333333333,0.666666666667),
-      SimplificationPoint(-0.666666666667,-0.666666666667,-0.333333333333),
-      SimplificationPoint(-0.666666666667,-0.666666666667,0.333333333333),
-      SimplificationPoint(-0.666666666667,0.333333333333,-0.666666666667),
-      SimplificationPoint(-0.666666666667,0.333333333333,0.666666666667),
-      SimplificationPoint(-0.666666666667,0.666666666667,-0.333333333333),
-      SimplificationPoint(-0.666666666667,0.666666666667,0.333333333333),
-      SimplificationPoint(-0.57735026919,-0.57735026919,-0.57735026919),
-      SimplificationPoint(-0.57735026919,-0.57735026919,0.57735026919),
-      SimplificationPoint(-0.57735026919,0.57735026919,-0.57735026919),
-      SimplificationPoint(-0.57735026919,0.57735026919,0.57735026919),
-      SimplificationPoint(-0.4472135955,-0.894427191,0.0),
-      SimplificationPoint(-0.4472135955,0.0,-0.894427191),
-      SimplificationPoint(-0.4472135955,0.0,0.894427191),
-      SimplificationPoint(-0.4472135955,0.894427191,0.0),
-      SimplificationPoint(-0.408248290464,-0.408248290464,-0.816496580928),
-      SimplificationPoint(-0.408248290464,-0.408248290464,0.816496580928),
-      SimplificationPoint(-0.408248290464,-0.816496580928,-0.408248290464),
-      SimplificationPoint(-0.408248290464,-0.816496580928,0.408248290464),
-      SimplificationPoint(-0.408248290464,0.408248290464,-0.816496580928),
-      SimplificationPoint(-0.408248290464,0.408248290464,0.816496580928),
-      SimplificationPoint(-0.408248290464,0.816496580928,-0.408248290464),
-      SimplificationPoint(-0.408248290464,0.816496580928,0.408248290464),
-      SimplificationPoint(-0.333333333333,-0.666666666667,-0.666666666667),
-      SimplificationPoint(-0.333333333333,-0.666666666667,0.666666666667),
-      SimplificationPoint(-0.333333333333,0.666666666667,-0.666666666667),
-      SimplificationPoint(-0.333333333333,0.666666666667,0.666666666667),
-      SimplificationPoint(0.0,-0.4472135955,-0.894427191),
-      SimplificationPoint(0.0,-0.4472135955,0.894427191),
-      SimplificationPoint(0.0,-0.707106781187,-0.707106781187),
-      SimplificationPoint(0.0,-0.707106781187,0.707106781187),
-      SimplificationPoint(0.0,-0.894427191,-0.4472135955),
-      SimplificationPoint(0.0,-0.894427191,0.4472135955),
-      SimplificationPoint(0.0,-1.0,0.0),
-      SimplificationPoint(0.0,0.0,-1.0),
-      SimplificationPoint(0.0,0.0,1.0),
-      SimplificationPoint(0.0,0.4472135955,-0.894427191),
-      SimplificationPoint(0.0,0.4472135955,0.894427191),
-      SimplificationPoint(0.0,0.707106781187,-0.707106781187),
-      SimplificationPoint(0.0,0.707106781187,0.707106781187),
-      SimplificationPoint(0.0,0.894427191,-0.4472135955),
-      SimplificationPoint(0.0,0.894427191,0.4472135955),
-      SimplificationPoint(0.0,1.0,0.0),
-      SimplificationPoint(0.333333333333,-0.666666666667,-0.666666666667),
-      SimplificationPoint(0.333333333333,-0.666666666667,0.666666666667),
-      SimplificationPoint(0.333333333333,0.666666666667,-0.666666666667),
-      SimplificationPoint(0.333333333333,0.666666666667,0.666666666667),
-      SimplificationPoint(0.408248290464,-0.408248290464,-0.816496580928),
-      SimplificationPoint(0.408248290464,-0.408248290464,0.816496580928),
-      SimplificationPoint(0.408248290464,-0.816496580928,-0.408248290464),
-      SimplificationPoint(0.408248290464,-0.816496580928,0.408248290464),
-      SimplificationPoint(0.408248290464,0.408248290464,-0.816496580928),
-      SimplificationPoint(0.408248290464,0.408248290464,0.816496580928),
-      SimplificationPoint(0.408248290464,0.816496580928,-0.408248290464),
-      SimplificationPoint(0.408248290464,0.816496580928,0.408248290464),
-      SimplificationPoint(0.4472135955,-0.894427191,0.0),
-      SimplificationPoint(0.4472135955,0.0,-0.894427191),
-      SimplificationPoint(0.4472135955,0.0,0.894427191),
-      SimplificationPoint(0.4472135955,0.894427191,0.0),
-      SimplificationPoint(0.57735026919,-0.57735026919,-0.57735026919),
-      SimplificationPoint(0.57735026919,-0.57735026919,0.57735026919),
-      SimplificationPoint(0.57735026919,0.57735026919,-0.57735026919),
-      SimplificationPoint(0.57735026919,0.57735026919,0.57735026919),
-      SimplificationPoint(0.666666666667,-0.333333333333,-0.666666666667),
-      SimplificationPoint(0.666666666667,-0.333333333333,0.666666666667),
-      SimplificationPoint(0.666666666667,-0.666666666667,-0.333333333333),
-      SimplificationPoint(0.666666666667,-0.666666666667,0.333333333333),
-      SimplificationPoint(0.666666666667,0.333333333333,-0.666666666667),
-      SimplificationPoint(0.666666666667,0.333333333333,0.666666666667),
-      SimplificationPoint(0.666666666667,0.666666666667,-0.333333333333),
-      SimplificationPoint(0.666666666667,0.666666666667,0.333333333333),
-      SimplificationPoint(0.707106781187,-0.707106781187,0.0),
-      SimplificationPoint(0.707106781187,0.0,-0.707106781187),
-      SimplificationPoint(0.707106781187,0.0,0.707106781187),
-      SimplificationPoint(0.707106781187,0.707106781187,0.0),
-      SimplificationPoint(0.816496580928,-0.408248290464,-0.408248290464),
-      SimplificationPoint(0.816496580928,-0.408248290464,0.408248290464),
-      SimplificationPoint(0.816496580928,0.408248290464,-0.408248290464),
-      SimplificationPoint(0.816496580928,0.408248290464,0.408248290464),
-      SimplificationPoint(0.894427191,-0.4472135955,0.0),
-      SimplificationPoint(0.894427191,0.0,-0.4472135955),
-      SimplificationPoint(0.894427191,0.0,0.4472135955),
-      SimplificationPoint(0.894427191,0.4472135955,0.0),
-      SimplificationPoint(1.0,0.0,0.0)
-    };
-
-//     SimplificationPoint unitSphereSampling[] = {
-//       SimplificationPoint(-1.0,0.0,0.0),
-//       SimplificationPoint(-0.707106781187,-0.707106781187,0.0),
-//       SimplificationPoint(-0.707106781187,0.0,-0.707106781187),
-//       SimplificationPoint(-0.707106781187,0.0,0.707106781187),
-//       SimplificationPoint(-0.707106781187,0.707106781187,0.0),
-//       SimplificationPoint(-0.57735026919,-0.57735026919,-0.57735026919),
-//       SimplificationPoint(-0.57735026919,-0.57735026919,0.57735026919),
-//       SimplificationPoint(-0.57735026919,0.57735026919,-0.57735026919),
-//       SimplificationPoint(-0.57735026919,0.57735026919,0.57735026919),
-//       SimplificationPoint(0.0,-0.707106781187,-0.707106781187),
-//       SimplificationPoint(0.0,-0.707106781187,0.707106781187),
-//       SimplificationPoint(0.0,-1.0,0.0),
-//       SimplificationPoint(0.0,0.0,-1.0),
-//       SimplificationPoint(0.0,0.0,1.0),
-//       SimplificationPoint(0.0,0.707106781187,-0.707106781187),
-//       SimplificationPoint(0.0,0.707106781187,0.707106781187),
-//       SimplificationPoint(0.0,1.0,0.0),
-//       SimplificationPoint(0.57735026919,-0.57735026919,-0.57735026919),
-//       SimplificationPoint(0.57735026919,-0.57735026919,0.57735026919),
-//       SimplificationPoint(0.57735026919,0.57735026919,-0.57735026919),
-//       SimplificationPoint(0.57735026919,0.57735026919,0.57735026919),
-//       SimplificationPoint(0.707106781187,-0.707106781187,0.0),
-//       SimplificationPoint(0.707106781187,0.0,-0.707106781187),
-//       SimplificationPoint(0.707106781187,0.0,0.707106781187),
-//       SimplificationPoint(0.707106781187,0.707106781187,0.0),
-//       SimplificationPoint(1.0,0.0,0.0)
-//     };
-
-    SimplificationPoint* lBegin = unitSphereSampling;
-    SimplificationPoint* lIter  = lBegin;
-    SimplificationPoint* lEnd   = unitSphereSampling + (sizeof(unitSphereSampling)/sizeof(SimplificationPoint));
-
-    // Scale the point from the unit sphere to the circumscribed sphere
-    GLV_ASSERT(lBegin != 0);
-    GLV_ASSERT(lEnd   != 0);
-
-    while (lIter != lEnd) {
-      GLV_ASSERT(lIter != 0);
-      lIter->aPoint *= lRadius;
-      lIter->aPoint += lCenter;
-      ++lIter;
-    }
-
-    // Scan all the primitives to find the closest ones
-    // For now, we choose only one primitive in all the types
-    // for each point on the shere. Again, we'll have to see
-    // if if wouldn't be better to have a separate simplication
-    // for each type of primitive.  We'll see.
-    // Scan only the new primitives for each type
-    scanForClosest(aLines,                   lBegin, lEnd);
-    scanForClosest(aLinesColored,            lBegin, lEnd);
-    scanForClosest(aPoints,                  lBegin, lEnd);
-    scanForClosest(aPointsColored,           lBegin, lEnd);
-    scanForClosest(aQuads,                   lBegin, lEnd);
-    scanForClosest(aQuadsColored,            lBegin, lEnd);
-    scanForClosest(aQuadsNormals,            lBegin, lEnd);
-    scanForClosest(aQuadsNormalsColored,     lBegin, lEnd);
-    scanForClosest(aTriangles,               lBegin, lEnd);
-    scanForClosest(aTrianglesColored,        lBegin, lEnd);
-    scanForClosest(aTrianglesNormals,        lBegin, lEnd);
-    scanForClosest(aTrianglesNormalsColored, lBegin, lEnd);
-
-    // Now add Points to aSimplified for each primitive barycenter chosen
-    lIter = lBegin;
-
-    while (lIter != lEnd) {
-      GLV_ASSERT(lIter != 0);
-      GLV_ASSERT(aSimplified != 0);
-      aSimplified->addPoint(lIter->aPrimiticeBarycenter);
-      ++lIter;
+    // A small model is its own simplified version
+    if (!VertexClustering::isWorthSimplifying(lNbPrimitives)) {
+      resetClustering();
+    }
+    else {
+
+      // We call getBoundingBox so that it gets updated
+      // if it needs to
+      if (aClustering == 0 || !aClustering->canContain(getBoundingBox(), lNbPrimitives)) {
+
+        // A model that outgrew its grid is likely to grow
+        // again: leave some room around the new one
+        const float lMargin = (aClustering == 0 ? 0.0f : 0.5f);
+
+        resetClustering();
+        aClustering = new VertexClustering(getBoundingBox(), lNbPrimitives, lMargin);
+      }
+
+      GLV_ASSERT(aClustering != 0);
+
+      addToClustering(aLines,                   aClusteringCounters[primitiveType_line                    ], *aClustering);
+      addToClustering(aLinesColored,            aClusteringCounters[primitiveType_line_colored            ], *aClustering);
+      addToClustering(aPoints,                  aClusteringCounters[primitiveType_point                   ], *aClustering);
+      addToClustering(aPointsColored,           aClusteringCounters[primitiveType_point_colored           ], *aClustering);
+      addToClustering(aQuads,                   aClusteringCounters[primitiveType_quad                    ], *aClustering);
+      addToClustering(aQuadsColored,            aClusteringCounters[primitiveType_quad_colored            ], *aClustering);
+      addToClustering(aQuadsNormals,            aClusteringCounters[primitiveType_quad_normals            ], *aClustering);
+      addToClustering(aQuadsNormalsColored,     aClusteringCounters[primitiveType_quad_normals_colored    ], *aClustering);
+      addToClustering(aTriangles,               aClusteringCounters[primitiveType_triangle                ], *aClustering);
+      addToClustering(aTrianglesColored,        aClusteringCounters[primitiveType_triangle_colored        ], *aClustering);
+      addToClustering(aTrianglesNormals,        aClusteringCounters[primitiveType_triangle_normals        ], *aClustering);
+      addToClustering(aTrianglesNormalsColored, aClusteringCounters[primitiveType_triangle_normals_colored], *aClustering);
+
+      aSimplified = new PrimitiveAccumulator(false);
+      aClustering->constructSimplified(*aSimplified);
     }
   }
 
@@ -1695,3 +2545,268 @@ void PrimitiveAccumulator::constructSimplified()
   aSimplifiedDirty = false;
 }
 
+// Delete the clustering used by constructSimplified, so that
+// the next one starts from scratch
+void PrimitiveAccumulator::resetClustering()
+{
+  delete aClustering;
+  aClustering = 0;
+
+  for (int lType=0; lType<primitiveType_count; ++lType) {
+    aClusteringCounters[lType] = 0;
+  }
+}
+
+GLuint& PrimitiveAccumulator::getGLDisplayList(const RenderParameters& pParams)
+{
+  switch (pParams.aRenderMode) {
+  case RenderParameters::renderMode_full:
+    return aGLDisplayListFull;
+    break;
+  case RenderParameters::renderMode_bounding_box:
+    return aGLDisplayListBoundingBox;
+    break;
+  case RenderParameters::renderMode_fast:
+    return aGLDisplayListFast;
+    break;
+  default:
+    GLV_ASSERT(false);
+    break;
+  }
+  return aGLDisplayListFast;
+}
+
+// Number of points rendered out of the pNbPoints of a leaf
+// simplified pLevel times: a quarter of them for each level,
+// but at least one
+PrimitiveAccumulator::SizeType PrimitiveAccumulator::getPointCloudSampleSize(const SizeType pNbPoints,
+                                                                             const int      pLevel)
+{
+  if (pLevel <= 0) {
+    return pNbPoints;
+  }
+
+  const SizeType lNbPoints = (pLevel < 16 ? (pNbPoints >> (2*pLevel)) : 0);
+
+  return std::min(pNbPoints, std::max(lNbPoints, static_cast<SizeType>(1)));
+}
+
+// Returns the ranges covering all the primitives
+PrimitiveAccumulator::PrimitiveRanges PrimitiveAccumulator::getRanges() const
+{
+  PrimitiveRanges lRanges;
+
+  for (int lType=0; lType<primitiveType_count; ++lType) {
+    lRanges.aBegin[lType] = 0;
+  }
+
+  lRanges.aEnd[primitiveType_line                    ] = aLines                  .size();
+  lRanges.aEnd[primitiveType_line_colored            ] = aLinesColored           .size();
+  lRanges.aEnd[primitiveType_point                   ] = aPoints                 .size();
+  lRanges.aEnd[primitiveType_point_colored           ] = aPointsColored          .size();
+  lRanges.aEnd[primitiveType_quad                    ] = aQuads                  .size();
+  lRanges.aEnd[primitiveType_quad_colored            ] = aQuadsColored           .size();
+  lRanges.aEnd[primitiveType_quad_normals            ] = aQuadsNormals           .size();
+  lRanges.aEnd[primitiveType_quad_normals_colored    ] = aQuadsNormalsColored    .size();
+  lRanges.aEnd[primitiveType_triangle                ] = aTriangles              .size();
+  lRanges.aEnd[primitiveType_triangle_colored        ] = aTrianglesColored       .size();
+  lRanges.aEnd[primitiveType_triangle_normals        ] = aTrianglesNormals       .size();
+  lRanges.aEnd[primitiveType_triangle_normals_colored] = aTrianglesNormalsColored.size();
+
+  return lRanges;
+}
+
+// Construct the node for the items pFirst to pLast-1 and its children.
+// pCounters is the number of primitives of each type already in the
+// previous leaves; the leaves are created in the final order of the
+// primitives. Returns the index of the node
+int PrimitiveAccumulator::constructHierarchyNode(HierarchyItems& pItems,
+                                                 const SizeType  pFirst,
+                                                 const SizeType  pLast,
+                                                 SizeType*       pCounters)
+{
+  GLV_ASSERT(pFirst < pLast);
+
+  const int lNode = static_cast<int>(aHierarchyNodes.size());
+
+  aHierarchyNodes.push_back(HierarchyNode());
+  aHierarchyNodes[lNode].aSecondChild = -1;
+
+  for (int lType=0; lType<primitiveType_count; ++lType) {
+    aHierarchyNodes[lNode].aRanges.aBegin[lType] = pCounters[lType];
+  }
+
+  // A leaf only has faces of the same facing, so that
+  // its NormalCone is narrow enough to be culled
+  SizeType lFacingEnd = pLast;
+
+  if (pLast - pFirst <= aHierarchyLeafSize) {
+    lFacingEnd = std::partition(pItems.begin() + pFirst,
+                                pItems.begin() + pLast,
+                                HierarchyItemFacing(pItems[pFirst].aFacing)) - pItems.begin();
+  }
+
+  if (lFacingEnd == pLast && pLast - pFirst <= aHierarchyLeafSize) {
+
+    std::vector<Vector3D> lFaceNormals;
+    lFaceNormals.reserve(pLast - pFirst);
+
+    for (SizeType i=pFirst; i<pLast; ++i) {
+      ++pCounters[pItems[i].aType];
+      lFaceNormals.push_back(pItems[i].aFaceNormal);
+    }
+
+    aHierarchyNodes[lNode].aNormalCone.construct(lFaceNormals);
+  }
+  else if (lFacingEnd != pLast) {
+
+    constructHierarchyNode(pItems, pFirst, lFacingEnd, pCounters);
+
+    const int lSecondChild = constructHierarchyNode(pItems, lFacingEnd, pLast, pCounters);
+
+    aHierarchyNodes[lNode].aSecondChild = lSecondChild;
+  }
+  else {
+
+    // Split along the largest extent of the barycenters
+    Vector3D lMin = pItems[pFirst].aBarycenter;
+    Vector3D lMax = pItems[pFirst].aBarycenter;
+
+    for (SizeType i=pFirst+1; i<pLast; ++i) {
+      const Vector3D& lBarycenter = pItems[i].aBarycenter;
+
+      lMin = Vector3D(std::min(lMin.x(), lBarycenter.x()),
+                      std::min(lMin.y(), lBarycenter.y()),
+                      std::min(lMin.z(), lBarycenter.z()));
+      lMax = Vector3D(std::max(lMax.x(), lBarycenter.x()),
+                      std::max(lMax.y(), lBarycenter.y()),
+                      std::max(lMax.z(), lBarycenter.z()));
+    }
+
+    const Vector3D lExtent = lMax - lMin;
+    int            lAxis   = 0;
+
+    if (lExtent.y() > lExtent[lAxis]) {
+      lAxis = 1;
+    }
+    if (lExtent.z() > lExtent[lAxis]) {
+      lAxis = 2;
+    }
+
+    const SizeType lMiddle = pFirst + (pLast - pFirst)/2;
+
+    std::nth_element(pItems.begin() + pFirst,
+                     pItems.begin() + lMiddle,
+                     pItems.begin() + pLast,
+                     HierarchyItemLess(lAxis));
+
+    constructHierarchyNode(pItems, pFirst, lMiddle, pCounters);
+
+    const int lSecondChild = constructHierarchyNode(pItems, lMiddle, pLast, pCounters);
+
+    aHierarchyNodes[lNode].aSecondChild = lSecondChild;
+  }
+
+  for (int lType=0; lType<primitiveType_count; ++lType) {
+    aHierarchyNodes[lNode].aRanges.aEnd[lType] = pCounters[lType];
+  }
+
+  return lNode;
+}
+
+template <class Container>
+void PrimitiveAccumulator::addColors(const Container& pContainer,
+                                     Vector3D&        pSum)
+{
+  typename Container::const_iterator       lIter    = pContainer.begin();
+  const typename Container::const_iterator lIterEnd = pContainer.end  ();
+
+  while (lIter != lIterEnd) {
+    pSum += lIter->getColor();
+    ++lIter;
+  }
+}
+
+template <class Container>
+void PrimitiveAccumulator::addHierarchyItems(const Container&    pContainer,
+                                             const PrimitiveType pType,
+                                             HierarchyItems&     pItems) const
+{
+  HierarchyItem lItem;
+  lItem.aType = pType;
+
+  for (SizeType i=0; i<pContainer.size(); ++i) {
+    lItem.aBarycenter = pContainer[i].getBarycenter();
+    lItem.aFaceNormal = pContainer[i].getFaceNormal();
+    lItem.aFacing     = NormalCone::getFacing(lItem.aFaceNormal);
+    lItem.aIndex      = i;
+    pItems.push_back(lItem);
+  }
+}
+
+template <class Container>
+void PrimitiveAccumulator::addRangeToBoundingBox(const Container&       pContainer,
+                                                 const PrimitiveType    pType,
+                                                 const PrimitiveRanges& pRanges,
+                                                 BoundingBox&           pBoundingBox) const
+{
+  for (SizeType i=pRanges.aBegin[pType]; i<pRanges.aEnd[pType]; ++i) {
+    pContainer[i].addToBoundingBox(pBoundingBox);
+  }
+}
+
+// Put the primitives of type pType in the order of pItems
+// Shuffles the primitives of pType inside each leaf of the hierarchy.
+// The shuffle is deterministic, so that the parse cache keeps the same
+// order
+template <class Container>
+void PrimitiveAccumulator::shuffleLeaves(Container&          pContainer,
+                                         const PrimitiveType pType)
+{
+  unsigned int lSeed = 1;
+
+  HierarchyNodes::const_iterator       lIterNodes    = aHierarchyNodes.begin();
+  const HierarchyNodes::const_iterator lIterNodesEnd = aHierarchyNodes.end  ();
+
+  while (lIterNodes != lIterNodesEnd) {
+    if (lIterNodes->aSecondChild < 0) {
+
+      const SizeType lBegin = lIterNodes->aRanges.aBegin[pType];
+      const SizeType lEnd   = lIterNodes->aRanges.aEnd  [pType];
+
+      // Fisher-Yates, with a linear congruential generator
+      for (SizeType i=lEnd-lBegin; i>1; --i) {
+        lSeed = lSeed*1103515245u + 12345u;
+        std::swap(pContainer[lBegin+i-1], pContainer[lBegin + (lSeed >> 8) % i]);
+      }
+    }
+    ++lIterNodes;
+  }
+}
+
+template <class Container>
+void PrimitiveAccumulator::reorderPrimitives(Container&            pContainer,
+                                             const PrimitiveType   pType,
+                                             const HierarchyItems& pItems)
+{
+  if (pContainer.empty()) {
+    return;
+  }
+
+  // Reordered in place, to avoid a second copy of the primitives
+  std::vector<SizeType> lSources;
+  lSources.reserve(pContainer.size());
+
+  HierarchyItems::const_iterator       lIterItems    = pItems.begin();
+  const HierarchyItems::const_iterator lIterItemsEnd = pItems.end  ();
+
+  while (lIterItems != lIterItemsEnd) {
+    if (lIterItems->aType == pType) {
+      lSources.push_back(lIterItems->aIndex);
+    }
+    ++lIterItems;
+  }
+
+  GLV_ASSERT(lSources.size() == pContainer.size());
+  pContainer.permute(lSources);
+}
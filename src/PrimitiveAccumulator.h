@@ -23,10 +23,17 @@
 
 #include "BoundingBox.h"
 #include "glinclude.h"
+#include "mapped_utils.h"
+#include "NormalCone.h"
+#include "PackedColor.h"
+#include "PackedNormal.h"
 #include "RenderParameters.h"
+#include <stdio.h>
 #include <string>
 #include <vector>
 
+class SoftwareRasterizer;
+class VertexClustering;
 
 // Class used to accumulate OpenGL
 // primitives and create an optimized order to
@@ -38,6 +45,10 @@ public:
   PrimitiveAccumulator (const bool pCreateSimplified);
   ~PrimitiveAccumulator();
 
+  static void* operator new   (size_t pBytes);
+  static void  operator delete(void*  pPtr,
+                               size_t pBytes);
+
   void  addArrow           (const Vector3D& pP1,
                             const Vector3D& pP2,
                             const float     pTipProportion,
@@ -87,13 +98,47 @@ public:
                             const Vector3D& pP2, const Vector3D& pC2,
                             const Vector3D& pP3, const Vector3D& pC3);
 
-  void  dumpCharacteristics(std::ostream&      pOstream,
-                            const std::string& pIndentation,
-                            const Matrix4x4&   pTransformation);
+  size_t compact            ();
+
+  void  constructDisplayList(const RenderParameters& pParams);
+
+  void  constructHierarchy  ();
+
+  void  deleteDisplayLists  ();
+
+  void  dumpCharacteristics (std::ostream&      pOstream,
+                             const std::string& pIndentation,
+                             const Matrix4x4&   pTransformation);
+
+  void  reserveArrows       (const size_t       pNbArrows,
+                             const int          pTipNbPolygons,
+                             const bool         pFlagColor);
+
+  void  reserveLines        (const size_t       pNbLines,
+                             const bool         pFlagColor);
+
+  void  reservePoints       (const size_t       pNbPoints,
+                             const bool         pFlagColor);
 
+  void  reserveQuads        (const size_t       pNbQuads,
+                             const bool         pFlagColor);
 
-  const  BoundingBox&  getBoundingBox() const;
-  void                 render        (const RenderParameters& pParams);
+  void  reserveTriangles    (const size_t       pNbTriangles,
+                             const bool         pFlagColor);
+
+
+  void                 addColors        (Vector3D&               pSum,
+                                         double&                 pNbColored,
+                                         double&                 pNbUncolored) const;
+  const  BoundingBox&  getBoundingBox   () const;
+  PrimitiveAccumulator& getSimplified   (const int               pLevel);
+  bool                 hasHierarchy     () const;
+  void                 rasterize        (SoftwareRasterizer&     pRasterizer,
+                                         const RenderParameters& pParams) const;
+  bool                 readCache        (FILE*                   pFilePtr);
+  void                 render           (const RenderParameters& pParams);
+  void                 renderDisplayList(const RenderParameters& pParams);
+  bool                 writeCache       (FILE*                   pFilePtr) const;
 
 private:
 
@@ -107,26 +152,61 @@ private:
     Vector3D aP1;
     Vector3D aP2;
 
+    void addToBoundingBox(BoundingBox& pBoundingBox) const {
+      pBoundingBox += aP1;
+      pBoundingBox += aP2;
+    }
+
+    void addToClustering(VertexClustering& pClustering) const;
+
     Vector3D getBarycenter() const {
       return 0.5*(aP1 + aP2);
     }
+
+    // Not culled by the NormalCones
+    Vector3D getFaceNormal() const {
+      return Vector3D(0.0, 0.0, 0.0);
+    }
   };
 
   struct LineColored : public Line {
-    Vector3D aC1;
-    Vector3D aC2;
+    StoredColor aC1;
+    StoredColor aC2;
+
+    void addToClustering(VertexClustering& pClustering) const;
+
+    Vector3D getColor() const {
+      return 0.5*(Vector3D(aC1) + aC2);
+    }
   };
 
   struct Point {
     Vector3D aP;
 
+    void addToBoundingBox(BoundingBox& pBoundingBox) const {
+      pBoundingBox += aP;
+    }
+
+    void addToClustering(VertexClustering& pClustering) const;
+
     Vector3D getBarycenter() const {
       return aP;
     }
+
+    // Not culled by the NormalCones
+    Vector3D getFaceNormal() const {
+      return Vector3D(0.0, 0.0, 0.0);
+    }
   };
 
   struct PointColored : public Point {
-    Vector3D aC;
+    StoredColor aC;
+
+    void addToClustering(VertexClustering& pClustering) const;
+
+    Vector3D getColor() const {
+      return aC;
+    }
   };
 
   struct Quad {
@@ -135,10 +215,27 @@ private:
     Vector3D aP3;
     Vector3D aP4;
 
+    void addToBoundingBox(BoundingBox& pBoundingBox) const {
+      pBoundingBox += aP1;
+      pBoundingBox += aP2;
+      pBoundingBox += aP3;
+      pBoundingBox += aP4;
+    }
+
+    void addToClustering(VertexClustering& pClustering) const;
+
     Vector3D getBarycenter() const {
       return 0.25*(aP1 + aP2 + aP3 + aP4);
     }
 
+    // Not culled by the NormalCones: a quad isn't always planar
+    Vector3D getFaceNormal() const {
+      return Vector3D(0.0, 0.0, 0.0);
+    }
+
+    void rasterizeFacetsFrame(SoftwareRasterizer& pRasterizer,
+                              const Vector3D&     pC) const;
+
     void renderFacetsFrame() const {
       glBegin(GL_LINE_LOOP);
       glVertex3f(aP1.x(), aP1.y(), aP1.z());
@@ -150,24 +247,36 @@ private:
   };
 
   struct QuadColored : public Quad {
-    Vector3D aC1;
-    Vector3D aC2;
-    Vector3D aC3;
-    Vector3D aC4;
+    StoredColor aC1;
+    StoredColor aC2;
+    StoredColor aC3;
+    StoredColor aC4;
+
+    void addToClustering(VertexClustering& pClustering) const;
+
+    Vector3D getColor() const {
+      return 0.25*(Vector3D(aC1) + aC2 + aC3 + aC4);
+    }
   };
 
   struct QuadNormals : public Quad {
-    Vector3D aN1;
-    Vector3D aN2;
-    Vector3D aN3;
-    Vector3D aN4;
+    StoredNormal aN1;
+    StoredNormal aN2;
+    StoredNormal aN3;
+    StoredNormal aN4;
   };
 
   struct QuadNormalsColored : public QuadNormals {
-    Vector3D aC1;
-    Vector3D aC2;
-    Vector3D aC3;
-    Vector3D aC4;
+    StoredColor aC1;
+    StoredColor aC2;
+    StoredColor aC3;
+    StoredColor aC4;
+
+    void addToClustering(VertexClustering& pClustering) const;
+
+    Vector3D getColor() const {
+      return 0.25*(Vector3D(aC1) + aC2 + aC3 + aC4);
+    }
   };
 
   struct Triangle {
@@ -175,10 +284,23 @@ private:
     Vector3D aP2;
     Vector3D aP3;
 
+    void addToBoundingBox(BoundingBox& pBoundingBox) const {
+      pBoundingBox += aP1;
+      pBoundingBox += aP2;
+      pBoundingBox += aP3;
+    }
+
+    void addToClustering(VertexClustering& pClustering) const;
+
     Vector3D getBarycenter() const {
       return (1.0/3.0)*(aP1 + aP2 + aP3);
     }
 
+    Vector3D getFaceNormal() const;
+
+    void rasterizeFacetsFrame(SoftwareRasterizer& pRasterizer,
+                              const Vector3D&     pC) const;
+
     void renderFacetsFrame() const {
       glBegin(GL_LINE_LOOP);
       glVertex3f(aP1.x(), aP1.y(), aP1.z());
@@ -189,23 +311,96 @@ private:
   };
 
   struct TriangleColored : public Triangle {
-    Vector3D aC1;
-    Vector3D aC2;
-    Vector3D aC3;
+    StoredColor aC1;
+    StoredColor aC2;
+    StoredColor aC3;
+
+    void addToClustering(VertexClustering& pClustering) const;
+
+    Vector3D getColor() const {
+      return (1.0/3.0)*(Vector3D(aC1) + aC2 + aC3);
+    }
   };
 
   struct TriangleNormals : public Triangle {
-    Vector3D aN1;
-    Vector3D aN2;
-    Vector3D aN3;
+    StoredNormal aN1;
+    StoredNormal aN2;
+    StoredNormal aN3;
   };
 
   struct TriangleNormalsColored : public TriangleNormals {
-    Vector3D aC1;
-    Vector3D aC2;
-    Vector3D aC3;
+    StoredColor aC1;
+    StoredColor aC2;
+    StoredColor aC3;
+
+    void addToClustering(VertexClustering& pClustering) const;
+
+    Vector3D getColor() const {
+      return (1.0/3.0)*(Vector3D(aC1) + aC2 + aC3);
+    }
+  };
+
+
+  typedef  MappedVector<Line>::Type                    Lines;
+  typedef  MappedVector<LineColored>::Type             LinesColored;
+  typedef  MappedVector<Point>::Type                   Points;
+  typedef  MappedVector<PointColored>::Type            PointsColored;
+  typedef  MappedVector<Quad>::Type                    Quads;
+  typedef  MappedVector<QuadColored>::Type             QuadsColored;
+  typedef  MappedVector<QuadNormals>::Type             QuadsNormals;
+  typedef  MappedVector<QuadNormalsColored>::Type      QuadsNormalsColored;
+  typedef  MappedVector<Triangle>::Type                Triangles;
+  typedef  MappedVector<TriangleColored>::Type         TrianglesColored;
+  typedef  MappedVector<TriangleNormals>::Type         TrianglesNormals;
+  typedef  MappedVector<TriangleNormalsColored>::Type  TrianglesNormalsColored;
+  typedef  Lines::size_type                            SizeType;
+
+  // The order is the one of the primitive vectors in the parse cache
+  enum PrimitiveType {primitiveType_line,
+                      primitiveType_line_colored,
+                      primitiveType_point,
+                      primitiveType_point_colored,
+                      primitiveType_quad,
+                      primitiveType_quad_colored,
+                      primitiveType_quad_normals,
+                      primitiveType_quad_normals_colored,
+                      primitiveType_triangle,
+                      primitiveType_triangle_colored,
+                      primitiveType_triangle_normals,
+                      primitiveType_triangle_normals_colored,
+                      primitiveType_count};
+
+  // Range [aBegin, aEnd[ of each primitive vector
+  struct PrimitiveRanges {
+    SizeType aBegin[primitiveType_count];
+    SizeType aEnd  [primitiveType_count];
   };
 
+  // Node of the spatial hierarchy. The nodes are stored in
+  // depth-first order: the first child of a node is the next node,
+  // and the primitives of a node are contiguous in each vector
+  struct HierarchyNode {
+    BoundingBox     aBoundingBox;
+    PrimitiveRanges aRanges;
+    NormalCone      aNormalCone;  // Only for a leaf
+    int             aSecondChild; // -1 for a leaf
+  };
+
+  // Primitive sorted during the construction of the hierarchy
+  struct HierarchyItem {
+    Vector3D      aBarycenter;
+    Vector3D      aFaceNormal;
+    int           aFacing;     // See NormalCone::getFacing
+    PrimitiveType aType;
+    SizeType      aIndex;
+  };
+
+  class HierarchyItemFacing;
+  class HierarchyItemLess;
+
+  typedef  std::vector<GLuint>                  GLDisplayLists;
+  typedef  std::vector<HierarchyItem>           HierarchyItems;
+  typedef  std::vector<HierarchyNode>           HierarchyNodes;
 
   void  addArrowTip                  (const Vector3D&         pP1,
                                       const Vector3D&         pP2,
@@ -215,38 +410,78 @@ private:
                                       const int               pTipNbPolygons);
 
   void  constructSimplified          ();
-  void  renderFacetsFrame            (const RenderParameters& pParams);
+  GLuint& getGLDisplayList           (const RenderParameters& pParams);
+  bool  isPointCloud                 () const;
+  void  renderFacetsFrame            (const RenderParameters& pParams,
+                                      const PrimitiveRanges&  pRanges);
   void  renderFull                   (const RenderParameters& pParams);
-  void  renderLines                  ();
-  void  renderLinesColored           ();
-  void  renderPoints                 ();
-  void  renderPointsColored          ();
-  void  renderQuads                  ();
-  void  renderQuadsColored           ();
-  void  renderQuadsNormals           ();
-  void  renderQuadsNormalsColored    ();
+  void  renderHierarchy              (const RenderParameters& pParams,
+                                      const int               pNode,
+                                      const bool              pFlagCulling,
+                                      const int               pCulledFaces,
+                                      const Vector3D&         pEye);
+  void  renderLevelOfDetail          (const RenderParameters& pParams,
+                                      const bool              pFlagDisplayList);
+  void  renderLines                  (const SizeType pBegin, const SizeType pEnd);
+  void  renderLinesColored           (const SizeType pBegin, const SizeType pEnd);
+  void  renderPointCloud             (const RenderParameters& pParams,
+                                      const int               pNode,
+                                      const bool              pFlagCulling);
+  void  renderPoints                 (const SizeType pBegin, const SizeType pEnd);
+  void  renderPointsColored          (const SizeType pBegin, const SizeType pEnd);
+  void  renderQuads                  (const SizeType pBegin, const SizeType pEnd);
+  void  renderQuadsColored           (const SizeType pBegin, const SizeType pEnd);
+  void  renderQuadsNormals           (const SizeType pBegin, const SizeType pEnd);
+  void  renderQuadsNormalsColored    (const SizeType pBegin, const SizeType pEnd);
+  void  renderRanges                 (const RenderParameters& pParams,
+                                      const PrimitiveRanges&  pRanges);
   void  renderSimplified             (const RenderParameters& pParams);
-  void  renderTriangles              ();
-  void  renderTrianglesColored       ();
-  void  renderTrianglesNormals       ();
-  void  renderTrianglesNormalsColored();
-
-
-  typedef  std::vector<Line>                    Lines;
-  typedef  std::vector<LineColored>             LinesColored;
-  typedef  std::vector<Point>                   Points;
-  typedef  std::vector<PointColored>            PointsColored;
-  typedef  std::vector<Quad>                    Quads;
-  typedef  std::vector<QuadColored>             QuadsColored;
-  typedef  std::vector<QuadNormals>             QuadsNormals;
-  typedef  std::vector<QuadNormalsColored>      QuadsNormalsColored;
-  typedef  std::vector<Triangle>                Triangles;
-  typedef  std::vector<TriangleColored>         TrianglesColored;
-  typedef  std::vector<TriangleNormals>         TrianglesNormals;
-  typedef  std::vector<TriangleNormalsColored>  TrianglesNormalsColored;
-  typedef  Lines::size_type                     SizeType;
+  void  renderTriangles              (const SizeType pBegin, const SizeType pEnd);
+  void  renderTrianglesColored       (const SizeType pBegin, const SizeType pEnd);
+  void  renderTrianglesNormals       (const SizeType pBegin, const SizeType pEnd);
+  void  renderTrianglesNormalsColored(const SizeType pBegin, const SizeType pEnd);
+  void  resetClustering              ();
+
+  // Spatial hierarchy construction
+  int   constructHierarchyNode       (HierarchyItems&         pItems,
+                                      const SizeType          pFirst,
+                                      const SizeType          pLast,
+                                      SizeType*               pCounters);
+  PrimitiveRanges getRanges          () const;
+
+  static bool     isFullDetail           (const RenderParameters& pParams);
+  static SizeType getPointCloudSampleSize(const SizeType          pNbPoints,
+                                          const int               pLevel);
+
+  template <class Container>
+  static void addColors              (const Container&        pContainer,
+                                      Vector3D&               pSum);
+  template <class Container>
+  void  addHierarchyItems            (const Container&        pContainer,
+                                      const PrimitiveType     pType,
+                                      HierarchyItems&         pItems) const;
+  template <class Container>
+  void  addRangeToBoundingBox        (const Container&        pContainer,
+                                      const PrimitiveType     pType,
+                                      const PrimitiveRanges&  pRanges,
+                                      BoundingBox&            pBoundingBox) const;
+  template <class Container>
+  void  shuffleLeaves                (Container&              pContainer,
+                                      const PrimitiveType     pType);
+  template <class Container>
+  void  reorderPrimitives            (Container&              pContainer,
+                                      const PrimitiveType     pType,
+                                      const HierarchyItems&   pItems);
+
 
   mutable BoundingBox      aBoundingBox;
+  VertexClustering*        aClustering;
+  SizeType                 aClusteringCounters[primitiveType_count]; // Primitives already in aClustering
+  GLuint                   aGLDisplayListBoundingBox;
+  GLuint                   aGLDisplayListFast;
+  GLuint                   aGLDisplayListFull;
+  GLDisplayLists           aHierarchyGLDisplayLists;
+  HierarchyNodes           aHierarchyNodes;
   Lines                    aLines;
   mutable SizeType         aLinesBBoxCounter;
   LinesColored             aLinesColored;
@@ -275,6 +510,8 @@ private:
   mutable SizeType         aTrianglesNormalsColoredBBoxCounter;
   int                      aPrimitiveOptimizerValue;
 
+  static const SizeType    aHierarchyLeafSize;
+
 };
 
 #endif // PRIMITIVEACCUMULATOR_H
@@ -21,6 +21,8 @@
 #ifndef RENDERPARAMETERS_H
 #define RENDERPARAMETERS_H
 
+#include "BoundingBox.h"
+
 // Parameter structure to share parameters
 // with the cmd_* commands.
 class RenderParameters
@@ -29,11 +31,19 @@ public:
 
   enum RenderMode {renderMode_full,
                    renderMode_bounding_box,
-                   renderMode_fast};
+                   renderMode_fast,
+                   renderMode_level_of_detail};
 
   bool       aFlagSmoothNormals;    // Smooth normals, where applicable, and apply them to the primitive
   bool       aFlagRenderFacetFrame; // Render the boundaries of a facet
   bool       aFlagDoubleSided;      // polygons are not culled but also drawn if seen from the back side
+  bool       aFlagFrustumCulling;   // Skip the frozen Objects and accumulators outside of the view frustum
+  int        aLevelOfDetail;        // Number of simplifications of the accumulators in renderMode_fast and
+                                    //  renderMode_level_of_detail. Each level has about 4 times less primitives
+  float      aLevelOfDetailPixels;  // In renderMode_level_of_detail, an accumulator smaller than this on screen
+                                    //  is simplified once more each time its size is halved. 0 to disable
+  float      aSmallFeaturePixels;   // The frozen Objects smaller than this on screen are rendered as a point
+                                    //  of their mean color. 0 to disable
   float      aFacetBoundaryR;
   float      aFacetBoundaryG;
   float      aFacetBoundaryB;
@@ -46,6 +56,10 @@ public:
     : aFlagSmoothNormals      (false),
       aFlagRenderFacetFrame   (false),
       aFlagDoubleSided        (false),
+      aFlagFrustumCulling     (false),
+      aLevelOfDetail          (2),
+      aLevelOfDetailPixels    (0.0f),
+      aSmallFeaturePixels     (0.0f),
       aFacetBoundaryR         (0.0f),
       aFacetBoundaryG         (0.0f),
       aFacetBoundaryB         (0.0f),
@@ -53,6 +67,23 @@ public:
       aRenderMode             (renderMode_full)
     {}
 
+  // Number of simplifications of an accumulator with pBoundingBox
+  // in renderMode_level_of_detail
+  int getLevelOfDetail(const BoundingBox& pBoundingBox) const
+    {
+      int lLevel = aLevelOfDetail;
+
+      if (aLevelOfDetailPixels > 0.0f) {
+        float lSize = pBoundingBox.getProjectedSize();
+        while (lSize < aLevelOfDetailPixels && lLevel < aLevelOfDetail + 8) {
+          lSize *= 2.0f;
+          ++lLevel;
+        }
+      }
+
+      return lLevel;
+    }
+
 private:
 
 };
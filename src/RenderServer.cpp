@@ -0,0 +1,181 @@
+//  glv - OpenGL viewer command line tool
+/*****************************************************************************
+ * Copyright (C) 2003 Patrick Lagace <bl4cklight@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+*****************************************************************************/
+
+#include "RenderServer.h"
+#include "assert_glv.h"
+#include "GraphicData.h"
+
+#include <iostream>
+#include <sstream>
+#include <stdio.h>
+
+#ifndef WIN32
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif // #ifndef WIN32
+
+const int RenderServer::aListenQueueLength = 16;
+
+#ifndef WIN32
+// Wall clock time in milliseconds
+static double getMilliseconds()
+{
+  struct timeval lTime;
+  gettimeofday(&lTime, 0);
+  return lTime.tv_sec*1000.0 + lTime.tv_usec/1000.0;
+}
+#endif // #ifndef WIN32
+
+RenderServer::RenderServer(GraphicData& pGraphicData)
+  : aGraphicData       (pGraphicData),
+    aNbRequests        (0),
+    aSocket            (-1),
+    aSocketPath        (),
+    aTotalMilliseconds (0.0)
+{
+}
+
+// Close the socket and remove it from the file system
+RenderServer::~RenderServer()
+{
+#ifndef WIN32
+  if(aSocket >= 0) {
+    close(aSocket);
+    unlink(aSocketPath.c_str());
+  }
+#endif // #ifndef WIN32
+}
+
+// Create the socket at pSocketPath and start listening on it.
+// If pError.empty() is true on exit, then everything was fine
+void RenderServer::open(const std::string& pSocketPath,
+                        std::string&       pError)
+{
+  GLV_ASSERT(pError.empty());
+  GLV_ASSERT(aSocket < 0);
+
+#ifdef WIN32
+  pError = "The render daemon is not available on this platform";
+#else // #ifdef WIN32
+  struct sockaddr_un lAddress;
+
+  if(pSocketPath.empty() || pSocketPath.size() >= sizeof(lAddress.sun_path)) {
+    pError = "Invalid daemon socket path: \"" + pSocketPath + "\"";
+    return;
+  }
+
+  aSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(aSocket < 0) {
+    pError = "Unable to create the daemon socket";
+    return;
+  }
+
+  lAddress.sun_family = AF_UNIX;
+  pSocketPath.copy(lAddress.sun_path, pSocketPath.size());
+  lAddress.sun_path[pSocketPath.size()] = '\0';
+
+  // A socket file left by a previous daemon would make bind fail
+  unlink(pSocketPath.c_str());
+
+  if(bind  (aSocket, (struct sockaddr*)&lAddress, sizeof(lAddress)) != 0 ||
+     listen(aSocket, aListenQueueLength)                            != 0) {
+    close(aSocket);
+    aSocket = -1;
+    pError  = "Unable to listen on the daemon socket \"" + pSocketPath + "\"";
+    return;
+  }
+
+  aSocketPath = pSocketPath;
+
+  // A client leaving before reading its status line must not
+  // terminate the daemon
+  signal(SIGPIPE, SIG_IGN);
+#endif // #ifdef WIN32
+}
+
+// Serve the requests until the program is terminated
+// (signal, or "exit" or "quit" command sent by a client)
+void RenderServer::run()
+{
+  GLV_ASSERT(aSocket >= 0);
+
+#ifndef WIN32
+  std::cerr << "glv daemon listening on " << aSocketPath << std::endl;
+
+  while(true) {
+    const int lConnection = accept(aSocket, 0, 0);
+    if(lConnection >= 0) {
+      serveRequest(lConnection);
+    }
+  }
+#endif // #ifndef WIN32
+}
+
+// Parse all the commands of a request, then send back
+// the status line:
+//   ok <request number> <milliseconds>
+//   error <request number> <milliseconds> <error message>
+void RenderServer::serveRequest(const int pConnection)
+{
+#ifndef WIN32
+  FILE* lStream = fdopen(pConnection, "r");
+  if(lStream == 0) {
+    close(pConnection);
+    return;
+  }
+
+  const double lStart = getMilliseconds();
+
+  std::string lError;
+  aGraphicData.readDataStream(lStream, lError);
+
+  const double lElapsed = getMilliseconds() - lStart;
+
+  ++aNbRequests;
+  aTotalMilliseconds += lElapsed;
+
+  // Errors are reported on a single line
+  std::string::size_type lPos = 0;
+  while((lPos = lError.find('\n', lPos)) != std::string::npos) {
+    lError[lPos] = ' ';
+  }
+
+  std::ostringstream lStatus;
+  lStatus << (lError.empty() ? "ok " : "error ") << aNbRequests << " " << lElapsed;
+  if(!lError.empty()) {
+    lStatus << " " << lError;
+  }
+  lStatus << std::endl;
+
+  const std::string lStatusString = lStatus.str();
+  if(write(pConnection, lStatusString.c_str(), lStatusString.size()) < 0) {
+    std::cerr << "glv daemon: unable to answer request " << aNbRequests << std::endl;
+  }
+
+  std::cerr << "glv daemon: " << lStatusString
+            << "glv daemon: " << aNbRequests << " requests, "
+            << aTotalMilliseconds/aNbRequests << " ms average" << std::endl;
+
+  fclose(lStream);
+#endif // #ifndef WIN32
+}
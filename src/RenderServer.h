@@ -0,0 +1,67 @@
+//  glv - OpenGL viewer command line tool
+/*****************************************************************************
+ * Copyright (C) 2003 Patrick Lagace <bl4cklight@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+*****************************************************************************/
+
+#ifndef RENDERSERVER_H
+#define RENDERSERVER_H
+
+#include <string>
+
+class GraphicData;
+
+// Keeps the loaded GraphicData resident and answers requests
+// coming on a local (Unix domain) socket (-daemon=<path>).
+// Each connection is one request: the client sends command
+// lines in the usual file format (typically view and snapshot
+// commands), closes its writing side and reads back one
+// status line with the render statistics of the request.
+// Pending connections wait in the listen queue and are served
+// one at a time, in order of arrival.
+class RenderServer
+{
+public:
+
+  RenderServer (GraphicData& pGraphicData);
+  ~RenderServer();
+
+  void open(const std::string& pSocketPath,
+            std::string&       pError);
+
+  void run ();
+
+private:
+
+  // Block the use of those
+  RenderServer();
+  RenderServer(const RenderServer&);
+  RenderServer& operator=(const RenderServer&);
+
+  void serveRequest(const int pConnection);
+
+  static const int aListenQueueLength;
+
+  GraphicData& aGraphicData;
+  int          aNbRequests;
+  int          aSocket;
+  std::string  aSocketPath;
+  double       aTotalMilliseconds;
+
+};
+
+#endif // RENDERSERVER_H
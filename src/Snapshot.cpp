@@ -22,10 +22,15 @@
 #include "assert_glv.h"
 #include "glinclude.h"
 #include "Parser.h"
+#include "SoftwareRasterizer.h"
 #include "Tile.h"
+#include "View.h"
 #include "WindowGLV.h"
 
+#include <cctype>
+#include <cstring>
 #include <string>
+#include <vector>
 
 #ifdef GLV_USE_GLX
 #include "glx.h"
@@ -43,17 +48,25 @@
 int Snapshot::aTileWidthAndHeight = 800;
 
 
+// pSupersampling is the number of rendered pixels per
+// image pixel, in each direction. Only the final image
+// is kept in memory, the tiles are downsampled as soon
+// as they are rendered.
 Snapshot::Snapshot(const int     pWidth,
                    const int     pHeight,
+                   const int     pSupersampling,
                    const Parser& pCurrentParser)
   : aBufferImage  (0),
     aBufferTile   (0),
     aCurrentParser(pCurrentParser),
     aHeight       (pHeight),
+    aSupersampling(pSupersampling),
     aWidth        (pWidth)
 {
   GLV_ASSERT(pWidth > 0);
   GLV_ASSERT(pHeight > 0);
+  GLV_ASSERT(pSupersampling >= 1);
+  GLV_ASSERT(pSupersampling <= getMaxSupersampling());
   GLV_ASSERT(static_cast<double>(pWidth)*static_cast<double>(pHeight) <= getMaxPixmapSize());
 
   // 24 bits RGB images
@@ -78,13 +91,16 @@ int Snapshot::getMaxPixmapSize()
   return 357913941;
 }
 
-void Snapshot::render(const std::string& pFilename,
-                      std::string&       pError)
+// Returns the maximum supersampling factor. The tiles
+// must contain at least a few image pixels.
+int Snapshot::getMaxSupersampling()
 {
-  GLV_ASSERT(aBufferImage   != 0);
-  GLV_ASSERT(aBufferTile    != 0);
+  return 16;
+}
 
-  // Get the filename extension
+// Returns the lowercase extension of pFilename
+static std::string getExtension(const std::string& pFilename)
+{
   std::string::size_type lLastDotIndex = pFilename.find_last_of(".");
   std::string            lExtension;
 
@@ -102,6 +118,121 @@ void Snapshot::render(const std::string& pFilename,
     ++lIter;
   }
 
+  return lExtension;
+}
+
+// Replace the only "%d" (or "%0Nd") in pPattern by pIndex.
+// We don't hand pPattern to sprintf directly since it
+// comes from the input file.
+// Returns false if pPattern is not a valid pattern
+static bool getSequenceFilename(const std::string& pPattern,
+                                const int          pIndex,
+                                std::string&       pFilename)
+{
+  const std::string::size_type lPercentIndex = pPattern.find('%');
+
+  if (lPercentIndex == std::string::npos ||
+      pPattern.find('%', lPercentIndex + 1) != std::string::npos) {
+    return false;
+  }
+
+  std::string::size_type lIndex     = lPercentIndex + 1;
+  const bool             lZeroPad   = (lIndex < pPattern.size() && pPattern[lIndex] == '0');
+  int                    lWidth     = 0;
+
+  while (lIndex < pPattern.size() && isdigit(pPattern[lIndex])) {
+    lWidth = 10*lWidth + (pPattern[lIndex] - '0');
+    ++lIndex;
+  }
+
+  if (lIndex >= pPattern.size() || pPattern[lIndex] != 'd' || lWidth > 32) {
+    return false;
+  }
+
+  char lIndexString[64];
+  sprintf(lIndexString, lZeroPad ? "%0*d" : "%*d", lWidth, pIndex);
+
+  pFilename = pPattern.substr(0, lPercentIndex) + lIndexString + pPattern.substr(lIndex + 1);
+
+  return true;
+}
+
+void Snapshot::render(const std::string& pFilename,
+                      std::string&       pError)
+{
+  GLV_ASSERT(aBufferImage   != 0);
+  GLV_ASSERT(aBufferTile    != 0);
+
+  if (checkFileType(pFilename, "snapshot", pError)) {
+
+    ViewManager& lViewManager = WindowGLV::getInstance().getViewManager();
+
+    const std::vector<View>        lViews    (1, lViewManager.getCurrentView());
+    const std::vector<std::string> lFilenames(1, pFilename);
+
+    if (lViewManager.getUserSettings().aFlagSoftwareRendering) {
+      renderSoftware(lViews, lFilenames, pError);
+    }
+    else {
+#ifdef GLV_USE_GLX
+      renderGLX(lViews, lFilenames, pError);
+#endif // #ifdef GLV_USE_GLX
+    }
+  }
+}
+
+// Renders one image per View in pViews. The filenames
+// are given by pFilenamePattern (ex: "frame%04d.png")
+// where the "%d" is replaced by the frame number.
+// All the frames are rendered in the same context, so
+// the display lists are only compiled once.
+void Snapshot::renderSequence(const std::vector<View>& pViews,
+                              const std::string&       pFilenamePattern,
+                              std::string&             pError)
+{
+  GLV_ASSERT(aBufferImage   != 0);
+  GLV_ASSERT(aBufferTile    != 0);
+
+  std::vector<std::string> lFilenames;
+  const int                lNbFrames = static_cast<int>(pViews.size());
+
+  for (int i=0; i<lNbFrames && pError.empty(); ++i) {
+
+    std::string lFilename;
+
+    if (!getSequenceFilename(pFilenamePattern, i, lFilename)) {
+      addError(std::string("Bad filename pattern \"") +
+               pFilenamePattern +
+               std::string("\" in \"render_sequence\":\n  it must contain exactly one %d or %0Nd"),
+               aCurrentParser, pError);
+    }
+    else {
+      lFilenames.push_back(lFilename);
+    }
+  }
+
+  if (pError.empty() && checkFileType(pFilenamePattern, "render_sequence", pError)) {
+
+    ViewManager& lViewManager = WindowGLV::getInstance().getViewManager();
+
+    if (lViewManager.getUserSettings().aFlagSoftwareRendering) {
+      renderSoftware(pViews, lFilenames, pError);
+    }
+    else {
+#ifdef GLV_USE_GLX
+      renderGLX(pViews, lFilenames, pError);
+#endif // #ifdef GLV_USE_GLX
+    }
+  }
+}
+
+// Returns true if we can render and write pFilename
+bool Snapshot::checkFileType(const std::string& pFilename,
+                             const std::string& pCommand,
+                             std::string&       pError) const
+{
+  const std::string lExtension = getExtension(pFilename);
+
   bool lFileTypeAvailable = false;
   bool lSnapshotAvailable = false;
 
@@ -115,48 +246,212 @@ void Snapshot::render(const std::string& pFilename,
   lSnapshotAvailable = true;
 #endif // #ifdef GLV_USE_GLX
 
+  // The software rendering is always available
+  if (WindowGLV::getInstance().getViewManager().getUserSettings().aFlagSoftwareRendering) {
+    lSnapshotAvailable = true;
+  }
+
   if(!lFileTypeAvailable) {
     std::string lString  = std::string("Unsupported file format extension \"") +
                            lExtension +
-                           std::string("\" in \"snapshot\"");
+                           std::string("\" in \"") +
+                           pCommand +
+                           std::string("\"");
     addError(lString, aCurrentParser, pError);
   }
   else if (!lSnapshotAvailable) {
     addError("Snapshots support not compiled", aCurrentParser, pError);
   }
-  else {
 
-    std::cerr << "Rendering and writing: " << pFilename << std::endl;
+  return pError.empty();
+}
 
-#ifdef GLV_USE_GLX
-    renderGLX();
-#endif // #ifdef GLV_USE_GLX
+// Copies the pixels rendered in pBufferTile in aBufferImage.
+// The tile position and size are given in the supersampled
+// image. Each image pixel is the mean of the corresponding
+// aSupersampling x aSupersampling rendered pixels (box filter).
+// pRowSize is the number of bytes between two rows of
+// pBufferTile. If pBottomUp is true, the first row of
+// pBufferTile is the bottom of the tile (OpenGL order).
+void Snapshot::copyTile(const unsigned char* pBufferTile,
+                        const int            pRowSize,
+                        const bool           pBottomUp,
+                        const int            pTileXMin,
+                        const int            pTileYMin,
+                        const int            pTileWidth,
+                        const int            pTileHeight)
+{
+  GLV_ASSERT(aBufferImage != 0);
+  GLV_ASSERT(pBufferTile  != 0);
+  GLV_ASSERT(pTileXMin   % aSupersampling == 0);
+  GLV_ASSERT(pTileYMin   % aSupersampling == 0);
+  GLV_ASSERT(pTileWidth  % aSupersampling == 0);
+  GLV_ASSERT(pTileHeight % aSupersampling == 0);
 
-#ifdef GLV_USE_PNG
-    if(lExtension == "png") {
+  const int lImageXMin  = pTileXMin  /aSupersampling;
+  const int lImageYMin  = pTileYMin  /aSupersampling;
+  const int lImageWidth = pTileWidth /aSupersampling;
+  const int lNbRows     = pTileHeight/aSupersampling;
+
+  GLV_ASSERT(lImageXMin + lImageWidth <= aWidth);
+  GLV_ASSERT(lImageYMin + lNbRows     <= aHeight);
+
+  std::vector<unsigned int> lSums(3*lImageWidth);
+
+  const unsigned int lNbSamples = aSupersampling*aSupersampling;
+
+  for (int lRow=0; lRow<lNbRows; ++lRow) {
+
+    unsigned char* lImageRow = aBufferImage + 3*((lImageYMin + lRow)*aWidth + lImageXMin);
+
+    if (aSupersampling == 1) {
+      const int lTileRow = pBottomUp ? (pTileHeight - 1 - lRow) : lRow;
+      memcpy(lImageRow, pBufferTile + lTileRow*pRowSize, 3*lImageWidth);
+      continue;
+    }
+
+    std::fill(lSums.begin(), lSums.end(), 0);
 
-      saveAsPNG(pFilename, pError);
+    for (int lSubRow=0; lSubRow<aSupersampling; ++lSubRow) {
 
-      lFileTypeAvailable = true;
+      const int            lTileRow    = lRow*aSupersampling + lSubRow;
+      const unsigned char* lTilePixels = pBufferTile + (pBottomUp ? (pTileHeight - 1 - lTileRow) : lTileRow)*pRowSize;
 
-      if (pError.empty()) {
-        std::cerr << "Successful writing: " << pFilename << std::endl;
+      for (int lX=0; lX<lImageWidth; ++lX) {
+        for (int lSubX=0; lSubX<aSupersampling; ++lSubX) {
+          lSums[3*lX    ] += lTilePixels[0];
+          lSums[3*lX + 1] += lTilePixels[1];
+          lSums[3*lX + 2] += lTilePixels[2];
+          lTilePixels += 3;
+        }
       }
     }
-#endif // #ifdef GLV_USE_PNG
 
+    for (int i=0; i<3*lImageWidth; ++i) {
+      lImageRow[i] = static_cast<unsigned char>((lSums[i] + lNbSamples/2)/lNbSamples);
+    }
   }
+}
 
+// Returns the distance between two tiles in the supersampled
+// image. It is a multiple of aSupersampling so that no image
+// pixel is split between two tiles
+int Snapshot::getTileStep() const
+{
+  return aTileWidthAndHeight - aTileWidthAndHeight % aSupersampling;
 }
 
-#ifdef GLV_USE_GLX
+// Renders the images in memory with a SoftwareRasterizer
+// and writes them. pViews[i] is written in pFilenames[i].
+// No OpenGL context is needed.
+void Snapshot::renderSoftware(const std::vector<View>&        pViews,
+                              const std::vector<std::string>& pFilenames,
+                              std::string&                    pError)
+{
+  GLV_ASSERT(aBufferImage != 0);
+  GLV_ASSERT(pViews.size() == pFilenames.size());
+
+  ViewManager&       lViewManager = WindowGLV::getInstance().getViewManager();
+  SoftwareRasterizer lRasterizer(aTileWidthAndHeight, aTileWidthAndHeight);
+
+  const View                         lCurrentView = lViewManager.getCurrentView();
+  const std::vector<View>::size_type lNbFrames    = pViews.size();
+
+  for (std::vector<View>::size_type i=0; i<lNbFrames && pError.empty(); ++i) {
 
-// Renders tiles in memory using the GLX extension
+    std::cerr << "Rendering and writing: " << pFilenames[i] << std::endl;
+
+    lViewManager.setCurrentView(pViews[i]);
+
+    renderTilesSoftware(lRasterizer);
+
+    saveImage(pFilenames[i], pError);
+  }
+
+  lViewManager.setCurrentView(lCurrentView);
+}
+
+// Renders all the tiles of the image with pRasterizer
 // and puts the result in aBufferImage
-void Snapshot::renderGLX()
+void Snapshot::renderTilesSoftware(SoftwareRasterizer& pRasterizer)
+{
+  GLV_ASSERT(aBufferImage != 0);
+
+  ViewManager& lViewManager = WindowGLV::getInstance().getViewManager();
+
+  // Size of the supersampled image
+  const int lRenderWidth  = aWidth *aSupersampling;
+  const int lRenderHeight = aHeight*aSupersampling;
+  const int lTileStep     = getTileStep();
+
+  const int lNbTilesX = (lRenderWidth-1) /lTileStep + 1;
+  const int lNbTilesY = (lRenderHeight-1)/lTileStep + 1;
+
+  for(int lTileIndexX=0; lTileIndexX<lNbTilesX; ++lTileIndexX) {
+
+    const int lTileXMin  = lTileIndexX*lTileStep;
+    const int lTileXMax  = lTileXMin + aTileWidthAndHeight - 1;
+    const int lTileWidth = std::min(lTileStep, lRenderWidth - lTileXMin);
+
+    for(int lTileIndexY=0; lTileIndexY<lNbTilesY; ++lTileIndexY) {
+
+      const int lTileYMin   = lTileIndexY*lTileStep;
+      const int lTileYMax   = lTileYMin + aTileWidthAndHeight - 1;
+      const int lTileHeight = std::min(lTileStep, lRenderHeight - lTileYMin);
+
+      const Tile lTile(lRenderWidth,
+                       lRenderHeight,
+                       lTileXMin,
+                       lTileXMax,
+                       lTileYMin,
+                       lTileYMax);
+
+      lViewManager.rasterize(pRasterizer, lTile);
+
+      // The rasterizer has the origin in the upper left
+      // corner, like the image
+      copyTile(pRasterizer.getColorBuffer(),
+               3*aTileWidthAndHeight,
+               false,
+               lTileXMin,
+               lTileYMin,
+               lTileWidth,
+               lTileHeight);
+    }
+  }
+}
+
+// Writes aBufferImage in pFilename. The file
+// format is given by the extension
+void Snapshot::saveImage(const std::string& pFilename,
+                         std::string&       pError)
+{
+  const std::string lExtension = getExtension(pFilename);
+
+#ifdef GLV_USE_PNG
+  if(lExtension == "png") {
+
+    saveAsPNG(pFilename, pError);
+
+    if (pError.empty()) {
+      std::cerr << "Successful writing: " << pFilename << std::endl;
+    }
+  }
+#endif // #ifdef GLV_USE_PNG
+
+}
+
+#ifdef GLV_USE_GLX
+
+// Renders the images in memory using the GLX extension
+// and writes them. pViews[i] is written in pFilenames[i]
+void Snapshot::renderGLX(const std::vector<View>&        pViews,
+                         const std::vector<std::string>& pFilenames,
+                         std::string&                    pError)
 {
   GLV_ASSERT(aBufferImage != 0);
   GLV_ASSERT(aBufferTile  != 0);
+  GLV_ASSERT(pViews.size() == pFilenames.size());
 
   ViewManager& lViewManager = WindowGLV::getInstance().getViewManager();
 
@@ -218,31 +513,77 @@ void Snapshot::renderGLX()
                  lGLXPixmap,
                  lGLXContext);
 
-  const int lNbTilesX = (aWidth-1) /aTileWidthAndHeight + 1;
-  const int lNbTilesY = (aHeight-1)/aTileWidthAndHeight + 1;
+  // The display lists compiled for the first
+  // frame are reused by all the following ones
+  const View                         lCurrentView = lViewManager.getCurrentView();
+  const std::vector<View>::size_type lNbFrames    = pViews.size();
+
+  for (std::vector<View>::size_type i=0; i<lNbFrames && pError.empty(); ++i) {
+
+    std::cerr << "Rendering and writing: " << pFilenames[i] << std::endl;
+
+    lViewManager.setCurrentView(pViews[i]);
+
+    renderTilesGLX();
+
+    saveImage(pFilenames[i], pError);
+  }
+
+  lViewManager.setCurrentView(lCurrentView);
+
+  // Destroy the context used for the offsreen rendering
+  XDestroyWindow     (lDisplay, lWindow);
+  glXDestroyContext  (lDisplay, lGLXContext);
+  glXDestroyGLXPixmap(lDisplay, lGLXPixmap);
+  XFreePixmap        (lDisplay, lPixmap);
+
+  // Force the reconstruction of the display lists
+  // for the display in WindowGLV
+  lViewManager.getGraphicData().deleteDisplayLists();
+
+}
+
+// Renders all the tiles of the image with the current
+// context and puts the result in aBufferImage
+void Snapshot::renderTilesGLX()
+{
+  GLV_ASSERT(aBufferImage != 0);
+  GLV_ASSERT(aBufferTile  != 0);
+
+  ViewManager& lViewManager = WindowGLV::getInstance().getViewManager();
+
+  // Size of the supersampled image
+  const int lRenderWidth  = aWidth *aSupersampling;
+  const int lRenderHeight = aHeight*aSupersampling;
+  const int lTileStep     = getTileStep();
+
+  const int lNbTilesX = (lRenderWidth-1) /lTileStep + 1;
+  const int lNbTilesY = (lRenderHeight-1)/lTileStep + 1;
 
   for(int lTileIndexX=0; lTileIndexX<lNbTilesX; ++lTileIndexX) {
 
     // Since the Pixmap is of fixed size, we allow the
     // tile to go outside of the image
-    const int lTileXMin  = lTileIndexX*aTileWidthAndHeight;
+    const int lTileXMin  = lTileIndexX*lTileStep;
     const int lTileXMax  = lTileXMin + aTileWidthAndHeight - 1;
 
     // But we'll only copy the pixels that are located inside the image
-    const int lTileWidth = std::min(lTileXMax - lTileXMin + 1, aWidth - lTileXMin);;
+    // and that are not rendered by the next tile
+    const int lTileWidth = std::min(lTileStep, lRenderWidth - lTileXMin);
 
     for(int lTileIndexY=0; lTileIndexY<lNbTilesY; ++lTileIndexY) {
 
       // Since the Pixmap is of fixed size, we allow the
       // tile to go outside of the image
-      const int lTileYMin  = lTileIndexY*aTileWidthAndHeight;
+      const int lTileYMin  = lTileIndexY*lTileStep;
       const int lTileYMax  = lTileYMin + aTileWidthAndHeight - 1;
 
       // But we'll only copy the pixels that are located inside the image
-      const int lTileHeight = std::min(lTileYMax - lTileYMin + 1, aHeight - lTileYMin);;
+      // and that are not rendered by the next tile
+      const int lTileHeight = std::min(lTileStep, lRenderHeight - lTileYMin);
 
-      const Tile lTile(aWidth,
-                       aHeight,
+      const Tile lTile(lRenderWidth,
+                       lRenderHeight,
                        lTileXMin,
                        lTileXMax,
                        lTileYMin,
@@ -277,28 +618,16 @@ void Snapshot::renderGLX()
                    aBufferTile);
 
       // Copy tile buffer in the image buffer
-      // OpenGL has the origin in the lower left corner, that's
-      // why we are using "--lImageI"
-      for(int i=0, lImageI=lTileYMin+lTileHeight-1; i<lTileHeight; ++i, --lImageI) {
-        GLV_ASSERT(lImageI >= 0);
-        GLV_ASSERT(lImageI < aHeight);
-        GLV_ASSERT(lTileXMin + lTileWidth <= aWidth);
-        memcpy(aBufferImage + 3*(lImageI*aWidth + lTileXMin), aBufferTile + 3*i*lPaddedTileWidth, 3*lTileWidth);
-      }
+      // OpenGL has the origin in the lower left corner
+      copyTile(aBufferTile,
+               3*lPaddedTileWidth,
+               true,
+               lTileXMin,
+               lTileYMin,
+               lTileWidth,
+               lTileHeight);
     }
   }
-
-
-  // Destroy the context used for the offsreen rendering
-  XDestroyWindow     (lDisplay, lWindow);
-  glXDestroyContext  (lDisplay, lGLXContext);
-  glXDestroyGLXPixmap(lDisplay, lGLXPixmap);
-  XFreePixmap        (lDisplay, lPixmap);
-
-  // Force the reconstruction of the display lists
-  // for the display in WindowGLV
-  lViewManager.getGraphicData().deleteDisplayLists();
-
 }
 #endif // #ifdef GLV_USE_GLX
 
@@ -22,8 +22,11 @@
 #define SNAPSHOT_H
 
 #include <string>
+#include <vector>
 
 class Parser;
+class SoftwareRasterizer;
+class View;
 
 class Snapshot
 {
@@ -31,13 +34,20 @@ public:
 
   Snapshot (const int     pWidth,
             const int     pHeight,
+            const int     pSupersampling,
             const Parser& pCurrentParser);
   ~Snapshot();
 
   static int getMaxPixmapSize();
 
-  void       render          (const std::string& pFilename,
-                              std::string&       pError);
+  static int getMaxSupersampling();
+
+  void       render          (const std::string&       pFilename,
+                              std::string&             pError);
+
+  void       renderSequence  (const std::vector<View>& pViews,
+                              const std::string&       pFilenamePattern,
+                              std::string&             pError);
 private:
 
   // Block the use of those
@@ -46,10 +56,35 @@ private:
   Snapshot& operator=(const Snapshot&);
 
 
+  bool checkFileType      (const std::string&              pFilename,
+                           const std::string&              pCommand,
+                           std::string&                    pError) const;
+
+  void copyTile           (const unsigned char*            pBufferTile,
+                           const int                       pRowSize,
+                           const bool                      pBottomUp,
+                           const int                       pTileXMin,
+                           const int                       pTileYMin,
+                           const int                       pTileWidth,
+                           const int                       pTileHeight);
+
+  int  getTileStep        () const;
+
 #ifdef GLV_USE_GLX
-  void renderGLX();
+  void renderGLX          (const std::vector<View>&        pViews,
+                           const std::vector<std::string>& pFilenames,
+                           std::string&                    pError);
+  void renderTilesGLX     ();
 #endif // #ifdef GLV_USE_GLX
 
+  void renderSoftware     (const std::vector<View>&        pViews,
+                           const std::vector<std::string>& pFilenames,
+                           std::string&                    pError);
+  void renderTilesSoftware(SoftwareRasterizer&             pRasterizer);
+
+  void saveImage          (const std::string&              pFilename,
+                           std::string&                    pError);
+
 #ifdef GLV_USE_PNG
   void saveAsPNG(const std::string& pFilename,
                  std::string&       pError);
@@ -62,6 +97,7 @@ private:
   unsigned char* aBufferTile;
   const Parser&  aCurrentParser;
   int            aHeight;
+  int            aSupersampling;
   int            aWidth;
 
 
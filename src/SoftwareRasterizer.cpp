@@ -0,0 +1,620 @@
+//  glv - OpenGL viewer command line tool
+/*****************************************************************************
+ * Copyright (C) 2003 Patrick Lagace <bl4cklight@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+*****************************************************************************/
+
+#include "SoftwareRasterizer.h"
+#include "assert_glv.h"
+#include "Tile.h"
+#include "View.h"
+
+#include <algorithm>
+#include <cmath>
+
+// OpenGL default values for the light model
+// ambient and the material ambient
+const float SoftwareRasterizer::aGlobalAmbient       = 0.2f;
+const float SoftwareRasterizer::aMaterialAmbient     = 0.2f;
+
+// Relative depth offset used to approximate
+// glPolygonOffset(1,1) on filled polygons
+const float SoftwareRasterizer::aPolygonOffsetFactor = 1.0E-4f;
+
+
+SoftwareRasterizer::SoftwareRasterizer(const int pWidth,
+                                       const int pHeight)
+  : aColorBuffer      (3*pWidth*pHeight, 0),
+    aCameraDirection  (0.0f, 0.0f, -1.0f),
+    aCameraPosition   (),
+    aCameraRight      (1.0f, 0.0f,  0.0f),
+    aCameraUp         (0.0f, 1.0f,  0.0f),
+    aDepthBuffer      (pWidth*pHeight, 0.0f),
+    aFrustrumXMax     ( 1.0f),
+    aFrustrumXMin     (-1.0f),
+    aFrustrumYMax     ( 1.0f),
+    aFrustrumYMin     (-1.0f),
+    aHeight           (pHeight),
+    aLightAmbient     (0.0f),
+    aLightDiffuse     (0.0f),
+    aLightLocal       (false),
+    aLightPosition    (),
+    aOrtho2DXMax      (1.0f),
+    aOrtho2DXMin      (0.0f),
+    aOrtho2DYMax      (1.0f),
+    aOrtho2DYMin      (0.0f),
+    aPrimitiveMode    (primitiveMode_none),
+    aPrimitiveVertices(),
+    aState            (),
+    aTileHeight       (pHeight),
+    aTileWidth        (pWidth),
+    aWidth            (pWidth),
+    aZFar             (10.0f),
+    aZNear            (0.1f)
+{
+  GLV_ASSERT(pWidth  > 0);
+  GLV_ASSERT(pHeight > 0);
+}
+
+SoftwareRasterizer::~SoftwareRasterizer()
+{
+}
+
+// Equivalent of glVertex between beginPrimitive
+// and endPrimitive. The primitive is drawn with
+// the current color as soon as it is complete
+void SoftwareRasterizer::addVertex(const Vector3D& pP)
+{
+  aPrimitiveVertices.push_back(pP);
+
+  const Vector3D& lColor = aState.aColor;
+
+  switch (aPrimitiveMode) {
+  case primitiveMode_points:
+    drawPoint(aPrimitiveVertices[0], lColor);
+    aPrimitiveVertices.clear();
+    break;
+  case primitiveMode_lines:
+    if (aPrimitiveVertices.size() == 2) {
+      drawLine(aPrimitiveVertices[0], lColor,
+               aPrimitiveVertices[1], lColor);
+      aPrimitiveVertices.clear();
+    }
+    break;
+  case primitiveMode_triangles:
+    if (aPrimitiveVertices.size() == 3) {
+      const Vector3D& lP1 = aPrimitiveVertices[0];
+      const Vector3D& lP2 = aPrimitiveVertices[1];
+      const Vector3D& lP3 = aPrimitiveVertices[2];
+
+      // No normal is specified with glvertex; we
+      // use the normal of the triangle
+      const Vector3D lN = (lP2-lP1).crossProduct(lP3-lP1);
+
+      drawTriangle(lP1, lN, lColor,
+                   lP2, lN, lColor,
+                   lP3, lN, lColor);
+      aPrimitiveVertices.clear();
+    }
+    break;
+  default:
+    // Vertex outside of a primitive, ignored like OpenGL does
+    aPrimitiveVertices.clear();
+  }
+}
+
+// Prepares the rendering of pTile of the image seen
+// from pView. The state is reset to the OpenGL defaults
+// used by glv, the buffers are not cleared
+void SoftwareRasterizer::begin(const Tile& pTile,
+                               const View& pView)
+{
+  aTileWidth  = pTile.getWidth ();
+  aTileHeight = pTile.getHeight();
+
+  GLV_ASSERT(aTileWidth  <= aWidth);
+  GLV_ASSERT(aTileHeight <= aHeight);
+
+  // Same planes as View::initCamera
+  aZNear = pView.getDistance()/10.0f;
+  aZFar  = pView.getDistance()*10.0f;
+
+  pTile.getFrustrumBounds(pView.getFOVDegrees(), aZNear,
+                          aFrustrumXMin, aFrustrumXMax,
+                          aFrustrumYMin, aFrustrumYMax);
+
+  pTile.getOrtho2DBounds(aOrtho2DXMin, aOrtho2DXMax,
+                         aOrtho2DYMin, aOrtho2DYMax);
+
+  // Same basis as gluLookAt
+  aCameraPosition  = pView.getPosition();
+  aCameraDirection = -1.0f*pView.getDirection();
+  aCameraDirection.normalize();
+
+  aCameraRight = aCameraDirection.crossProduct(pView.getUp());
+  aCameraRight.normalize();
+
+  aCameraUp = aCameraRight.crossProduct(aCameraDirection);
+
+  aState.aColor            = Vector3D(1.0f, 1.0f, 1.0f);
+  aState.aCullBackFaces    = false;
+  aState.aDepthTest        = true;
+  aState.aLighting         = false;
+  aState.aLineWidth        = 1.0f;
+  aState.aPointSize        = 1.0f;
+  aState.aPolygonOffset    = false;
+  aState.aTransformation   = Matrix4x4();
+  aState.aTwoSidedLighting = true;
+
+  aPrimitiveMode = primitiveMode_none;
+  aPrimitiveVertices.clear();
+}
+
+// Equivalent of glBegin
+void SoftwareRasterizer::beginPrimitive(const PrimitiveMode pMode)
+{
+  aPrimitiveMode = pMode;
+  aPrimitiveVertices.clear();
+}
+
+// Equivalent of glClear on the color and depth buffers
+void SoftwareRasterizer::clear(const Vector3D& pColor)
+{
+  const unsigned char lR = static_cast<unsigned char>(255.0f*std::min(std::max(pColor.x(), 0.0f), 1.0f) + 0.5f);
+  const unsigned char lG = static_cast<unsigned char>(255.0f*std::min(std::max(pColor.y(), 0.0f), 1.0f) + 0.5f);
+  const unsigned char lB = static_cast<unsigned char>(255.0f*std::min(std::max(pColor.z(), 0.0f), 1.0f) + 0.5f);
+
+  const int lNbPixels = aWidth*aHeight;
+
+  for (int i=0; i<lNbPixels; ++i) {
+    aColorBuffer[3*i    ] = lR;
+    aColorBuffer[3*i + 1] = lG;
+    aColorBuffer[3*i + 2] = lB;
+  }
+
+  // Nothing is closer than 1/w = 0
+  std::fill(aDepthBuffer.begin(), aDepthBuffer.end(), 0.0f);
+}
+
+// Draws a quad covering the whole image with the colors
+// pC1 to pC4 at the corners (0,0), (0,1), (1,1) and (1,0)
+// of the OpenGL [0,1]x[0,1] 2D coordinates. The depth
+// buffer is not used.
+void SoftwareRasterizer::drawBackground(const Vector3D& pC1,
+                                        const Vector3D& pC2,
+                                        const Vector3D& pC3,
+                                        const Vector3D& pC4)
+{
+  const float lCornersX[4] = {0.0f, 0.0f, 1.0f, 1.0f};
+  const float lCornersY[4] = {0.0f, 1.0f, 1.0f, 0.0f};
+  const Vector3D* lColors[4] = {&pC1, &pC2, &pC3, &pC4};
+
+  ScreenVertex lVertices[4];
+
+  for (int i=0; i<4; ++i) {
+    lVertices[i].aX               = (lCornersX[i] - aOrtho2DXMin)/(aOrtho2DXMax - aOrtho2DXMin)*aTileWidth;
+    lVertices[i].aY               = (aOrtho2DYMax - lCornersY[i])/(aOrtho2DYMax - aOrtho2DYMin)*aTileHeight;
+    lVertices[i].aInvW            = 1.0f;
+    lVertices[i].aFrontColorOverW = *lColors[i];
+    lVertices[i].aBackColorOverW  = *lColors[i];
+  }
+
+  const State lState = aState;
+
+  aState.aCullBackFaces = false;
+  aState.aDepthTest     = false;
+  aState.aPolygonOffset = false;
+
+  // Same split as the one used for the quads
+  rasterizeTriangle(lVertices[0], lVertices[1], lVertices[2]);
+  rasterizeTriangle(lVertices[0], lVertices[2], lVertices[3]);
+
+  aState = lState;
+}
+
+// Draws a line that is never lit
+void SoftwareRasterizer::drawLine(const Vector3D& pP1, const Vector3D& pC1,
+                                  const Vector3D& pP2, const Vector3D& pC2)
+{
+  const Vector3D lNullVector;
+
+  rasterizeLine(getEyeVertex(pP1, lNullVector, pC1, false),
+                getEyeVertex(pP2, lNullVector, pC2, false));
+}
+
+// Draws a point that is never lit
+void SoftwareRasterizer::drawPoint(const Vector3D& pP,  const Vector3D& pC)
+{
+  const EyeVertex lEyeVertex = getEyeVertex(pP, Vector3D(), pC, false);
+
+  if (lEyeVertex.aW >= aZNear && lEyeVertex.aW <= aZFar) {
+    const ScreenVertex lScreenVertex = getScreenVertex(lEyeVertex);
+
+    writeStamp(lScreenVertex.aX,
+               lScreenVertex.aY,
+               lScreenVertex.aInvW,
+               lEyeVertex.aFrontColor,
+               aState.aPointSize);
+  }
+}
+
+// Draws a quad the way OpenGL usually splits it
+void SoftwareRasterizer::drawQuad(const Vector3D& pP1, const Vector3D& pN1, const Vector3D& pC1,
+                                  const Vector3D& pP2, const Vector3D& pN2, const Vector3D& pC2,
+                                  const Vector3D& pP3, const Vector3D& pN3, const Vector3D& pC3,
+                                  const Vector3D& pP4, const Vector3D& pN4, const Vector3D& pC4)
+{
+  drawTriangle(pP1, pN1, pC1, pP2, pN2, pC2, pP3, pN3, pC3);
+  drawTriangle(pP1, pN1, pC1, pP3, pN3, pC3, pP4, pN4, pC4);
+}
+
+// Draws a triangle lit with the current light, if
+// the lighting is enabled
+void SoftwareRasterizer::drawTriangle(const Vector3D& pP1, const Vector3D& pN1, const Vector3D& pC1,
+                                      const Vector3D& pP2, const Vector3D& pN2, const Vector3D& pC2,
+                                      const Vector3D& pP3, const Vector3D& pN3, const Vector3D& pC3)
+{
+  const EyeVertex lVertices[3] = {getEyeVertex(pP1, pN1, pC1, true),
+                                  getEyeVertex(pP2, pN2, pC2, true),
+                                  getEyeVertex(pP3, pN3, pC3, true)};
+
+  rasterizePolygon(lVertices, 3);
+}
+
+// Equivalent of glEnd
+void SoftwareRasterizer::endPrimitive()
+{
+  aPrimitiveMode = primitiveMode_none;
+  aPrimitiveVertices.clear();
+}
+
+// Returns the RGB pixels of the last rendered tile. The
+// first row is the top of the tile and the rows are
+// the width given to the constructor apart
+const unsigned char* SoftwareRasterizer::getColorBuffer() const
+{
+  return &aColorBuffer[0];
+}
+
+SoftwareRasterizer::State& SoftwareRasterizer::getState()
+{
+  return aState;
+}
+
+// Equivalent of the setup of GL_LIGHT0. pPosition is in
+// world coordinates. If pLocal is false, pPosition is
+// the direction of the light
+void SoftwareRasterizer::setLight(const Vector3D& pPosition,
+                                  const bool      pLocal,
+                                  const float     pAmbient,
+                                  const float     pDiffuse)
+{
+  aLightPosition = pPosition;
+  aLightLocal    = pLocal;
+  aLightAmbient  = pAmbient;
+  aLightDiffuse  = pDiffuse;
+
+  if (!aLightLocal && aLightPosition != Vector3D()) {
+    aLightPosition.normalize();
+  }
+}
+
+// Clips the polygon pVertices against the near plane.
+// pClipped must have room for pNbVertices+1 vertices.
+// Returns the number of vertices in pClipped.
+int SoftwareRasterizer::clipNearPlane(const EyeVertex* pVertices,
+                                      const int        pNbVertices,
+                                      EyeVertex*       pClipped) const
+{
+  int lNbClipped = 0;
+
+  for (int i=0; i<pNbVertices; ++i) {
+
+    const EyeVertex& lV1      = pVertices[i];
+    const EyeVertex& lV2      = pVertices[(i+1) % pNbVertices];
+    const bool       lInside1 = (lV1.aW >= aZNear);
+    const bool       lInside2 = (lV2.aW >= aZNear);
+
+    if (lInside1) {
+      pClipped[lNbClipped++] = lV1;
+    }
+
+    if (lInside1 != lInside2) {
+      // Eye coordinates are linear, so we can
+      // interpolate everything directly
+      const float lT = (aZNear - lV1.aW)/(lV2.aW - lV1.aW);
+
+      EyeVertex& lV = pClipped[lNbClipped++];
+      lV.aX          = lV1.aX + lT*(lV2.aX - lV1.aX);
+      lV.aY          = lV1.aY + lT*(lV2.aY - lV1.aY);
+      lV.aW          = aZNear;
+      lV.aFrontColor = lV1.aFrontColor + lT*(lV2.aFrontColor - lV1.aFrontColor);
+      lV.aBackColor  = lV1.aBackColor  + lT*(lV2.aBackColor  - lV1.aBackColor);
+    }
+  }
+
+  GLV_ASSERT(lNbClipped <= pNbVertices+1);
+  return lNbClipped;
+}
+
+// Transforms pP in eye coordinates and computes its
+// colors (front and back) with the current state
+SoftwareRasterizer::EyeVertex SoftwareRasterizer::getEyeVertex(const Vector3D& pP,
+                                                               const Vector3D& pN,
+                                                               const Vector3D& pC,
+                                                               const bool      pLit) const
+{
+  const Vector3D lWorldP = aState.aTransformation * pP;
+  const Vector3D lDelta  = lWorldP - aCameraPosition;
+
+  EyeVertex lEyeVertex;
+  lEyeVertex.aX = lDelta.dotProduct(aCameraRight);
+  lEyeVertex.aY = lDelta.dotProduct(aCameraUp);
+  lEyeVertex.aW = lDelta.dotProduct(aCameraDirection);
+
+  if (pLit && aState.aLighting) {
+
+    Vector3D lWorldN = aState.aTransformation.transformNormal(pN);
+
+    if (lWorldN != Vector3D()) {
+      lWorldN.normalize();
+    }
+
+    lEyeVertex.aFrontColor = getLitColor(lWorldP, lWorldN, pC);
+
+    if (aState.aTwoSidedLighting) {
+      lEyeVertex.aBackColor = getLitColor(lWorldP, -1.0f*lWorldN, pC);
+    }
+    else {
+      lEyeVertex.aBackColor = lEyeVertex.aFrontColor;
+    }
+  }
+  else {
+    lEyeVertex.aFrontColor = pC;
+    lEyeVertex.aBackColor  = pC;
+  }
+
+  return lEyeVertex;
+}
+
+// OpenGL lighting equation with GL_COLOR_MATERIAL on
+// the diffuse term only and without specular
+Vector3D SoftwareRasterizer::getLitColor(const Vector3D& pWorldP,
+                                         const Vector3D& pWorldN,
+                                         const Vector3D& pC) const
+{
+  Vector3D lL = aLightPosition;
+
+  if (aLightLocal) {
+    lL = aLightPosition - pWorldP;
+    if (lL != Vector3D()) {
+      lL.normalize();
+    }
+  }
+
+  const float lAmbient = aGlobalAmbient*aMaterialAmbient + aLightAmbient*aMaterialAmbient;
+  const float lDiffuse = aLightDiffuse*std::max(pWorldN.dotProduct(lL), 0.0f);
+
+  return Vector3D(lAmbient + lDiffuse*pC.x(),
+                  lAmbient + lDiffuse*pC.y(),
+                  lAmbient + lDiffuse*pC.z());
+}
+
+// Projects pV (in front of the near plane) in the tile
+SoftwareRasterizer::ScreenVertex SoftwareRasterizer::getScreenVertex(const EyeVertex& pV) const
+{
+  GLV_ASSERT(pV.aW > 0.0f);
+
+  const float lInvW  = 1.0f/pV.aW;
+  const float lNearX = aZNear*pV.aX*lInvW;
+  const float lNearY = aZNear*pV.aY*lInvW;
+
+  ScreenVertex lScreenVertex;
+  lScreenVertex.aX               = (lNearX - aFrustrumXMin)/(aFrustrumXMax - aFrustrumXMin)*aTileWidth;
+  lScreenVertex.aY               = (aFrustrumYMax - lNearY)/(aFrustrumYMax - aFrustrumYMin)*aTileHeight;
+  lScreenVertex.aInvW            = lInvW;
+  lScreenVertex.aFrontColorOverW = lInvW*pV.aFrontColor;
+  lScreenVertex.aBackColorOverW  = lInvW*pV.aBackColor;
+
+  return lScreenVertex;
+}
+
+void SoftwareRasterizer::rasterizeLine(const EyeVertex& pV1,
+                                       const EyeVertex& pV2)
+{
+  // Clip the segment against the near plane
+  EyeVertex lV1 = pV1;
+  EyeVertex lV2 = pV2;
+
+  if (lV1.aW < aZNear && lV2.aW < aZNear) {
+    return;
+  }
+
+  if (lV1.aW < aZNear || lV2.aW < aZNear) {
+    EyeVertex& lOutside = (lV1.aW < aZNear) ? lV1 : lV2;
+    EyeVertex& lInside  = (lV1.aW < aZNear) ? lV2 : lV1;
+
+    const float lT = (aZNear - lInside.aW)/(lOutside.aW - lInside.aW);
+
+    lOutside.aX          = lInside.aX + lT*(lOutside.aX - lInside.aX);
+    lOutside.aY          = lInside.aY + lT*(lOutside.aY - lInside.aY);
+    lOutside.aW          = aZNear;
+    lOutside.aFrontColor = lInside.aFrontColor + lT*(lOutside.aFrontColor - lInside.aFrontColor);
+  }
+
+  const ScreenVertex lS1 = getScreenVertex(lV1);
+  const ScreenVertex lS2 = getScreenVertex(lV2);
+
+  // Skip the segments that are completely outside of the tile
+  const float lMargin = 0.5f*aState.aLineWidth + 1.0f;
+
+  if ((lS1.aX < -lMargin && lS2.aX < -lMargin)                 ||
+      (lS1.aY < -lMargin && lS2.aY < -lMargin)                 ||
+      (lS1.aX > aTileWidth  + lMargin && lS2.aX > aTileWidth  + lMargin) ||
+      (lS1.aY > aTileHeight + lMargin && lS2.aY > aTileHeight + lMargin)) {
+    return;
+  }
+
+  const float lDeltaX  = lS2.aX - lS1.aX;
+  const float lDeltaY  = lS2.aY - lS1.aY;
+  const int   lNbSteps = static_cast<int>(std::max(fabs(lDeltaX), fabs(lDeltaY))) + 1;
+
+  for (int i=0; i<=lNbSteps; ++i) {
+
+    const float lT    = static_cast<float>(i)/lNbSteps;
+    const float lInvW = lS1.aInvW + lT*(lS2.aInvW - lS1.aInvW);
+
+    if (lInvW >= 1.0f/aZFar) {
+      const Vector3D lColorOverW = lS1.aFrontColorOverW + lT*(lS2.aFrontColorOverW - lS1.aFrontColorOverW);
+
+      writeStamp(lS1.aX + lT*lDeltaX,
+                 lS1.aY + lT*lDeltaY,
+                 lInvW,
+                 lColorOverW/lInvW,
+                 aState.aLineWidth);
+    }
+  }
+}
+
+// Clips the convex polygon pVertices and rasterizes
+// it as a fan of triangles
+void SoftwareRasterizer::rasterizePolygon(const EyeVertex* pVertices,
+                                          const int        pNbVertices)
+{
+  GLV_ASSERT(pNbVertices == 3);
+
+  EyeVertex lClipped[4];
+
+  const int lNbClipped = clipNearPlane(pVertices, pNbVertices, lClipped);
+
+  if (lNbClipped >= 3) {
+
+    ScreenVertex lScreenVertices[4];
+
+    for (int i=0; i<lNbClipped; ++i) {
+      lScreenVertices[i] = getScreenVertex(lClipped[i]);
+    }
+
+    for (int i=2; i<lNbClipped; ++i) {
+      rasterizeTriangle(lScreenVertices[0], lScreenVertices[i-1], lScreenVertices[i]);
+    }
+  }
+}
+
+// Rasterizes the triangle by sampling the pixel centers
+// with edge functions. The colors are interpolated with
+// perspective correction.
+void SoftwareRasterizer::rasterizeTriangle(const ScreenVertex& pV1,
+                                           const ScreenVertex& pV2,
+                                           const ScreenVertex& pV3)
+{
+  const float lArea = (pV2.aX - pV1.aX)*(pV3.aY - pV1.aY) - (pV3.aX - pV1.aX)*(pV2.aY - pV1.aY);
+
+  if (lArea == 0.0f) {
+    return;
+  }
+
+  // The y axis points down in the tile, so counter clockwise
+  // triangles in OpenGL (front faces) have a negative area
+  const bool lFrontFacing = (lArea < 0.0f);
+
+  if (aState.aCullBackFaces && !lFrontFacing) {
+    return;
+  }
+
+  const int lXMin = std::max(static_cast<int>(floor(std::min(pV1.aX, std::min(pV2.aX, pV3.aX)))), 0);
+  const int lXMax = std::min(static_cast<int>(ceil (std::max(pV1.aX, std::max(pV2.aX, pV3.aX)))), aTileWidth  - 1);
+  const int lYMin = std::max(static_cast<int>(floor(std::min(pV1.aY, std::min(pV2.aY, pV3.aY)))), 0);
+  const int lYMax = std::min(static_cast<int>(ceil (std::max(pV1.aY, std::max(pV2.aY, pV3.aY)))), aTileHeight - 1);
+
+  const Vector3D& lC1 = lFrontFacing ? pV1.aFrontColorOverW : pV1.aBackColorOverW;
+  const Vector3D& lC2 = lFrontFacing ? pV2.aFrontColorOverW : pV2.aBackColorOverW;
+  const Vector3D& lC3 = lFrontFacing ? pV3.aFrontColorOverW : pV3.aBackColorOverW;
+
+  const float lInvArea      = 1.0f/lArea;
+  const float lMinInvW      = 1.0f/aZFar;
+  const float lOffsetFactor = aState.aPolygonOffset ? (1.0f - aPolygonOffsetFactor) : 1.0f;
+
+  for (int y=lYMin; y<=lYMax; ++y) {
+
+    const float lY = y + 0.5f;
+
+    for (int x=lXMin; x<=lXMax; ++x) {
+
+      const float lX = x + 0.5f;
+
+      // Barycentric coordinates of the pixel center
+      const float lB1 = ((pV2.aX - lX)*(pV3.aY - lY) - (pV3.aX - lX)*(pV2.aY - lY))*lInvArea;
+      const float lB2 = ((pV3.aX - lX)*(pV1.aY - lY) - (pV1.aX - lX)*(pV3.aY - lY))*lInvArea;
+      const float lB3 = 1.0f - lB1 - lB2;
+
+      if (lB1 >= 0.0f && lB2 >= 0.0f && lB3 >= 0.0f) {
+
+        const float lInvW = lB1*pV1.aInvW + lB2*pV2.aInvW + lB3*pV3.aInvW;
+
+        if (lInvW >= lMinInvW) {
+          writeFragment(x, y, lInvW*lOffsetFactor, (lB1*lC1 + lB2*lC2 + lB3*lC3)/lInvW);
+        }
+      }
+    }
+  }
+}
+
+// Writes one pixel with the depth test if it is enabled.
+// The depth buffer stores 1/w, so bigger is closer.
+void SoftwareRasterizer::writeFragment(const int       pX,
+                                       const int       pY,
+                                       const float     pInvW,
+                                       const Vector3D& pC)
+{
+  if (pX < 0 || pX >= aTileWidth || pY < 0 || pY >= aTileHeight) {
+    return;
+  }
+
+  const int lIndex = pY*aWidth + pX;
+
+  if (aState.aDepthTest) {
+    // Equivalent of GL_LESS
+    if (pInvW <= aDepthBuffer[lIndex]) {
+      return;
+    }
+    aDepthBuffer[lIndex] = pInvW;
+  }
+
+  aColorBuffer[3*lIndex    ] = static_cast<unsigned char>(255.0f*std::min(std::max(pC.x(), 0.0f), 1.0f) + 0.5f);
+  aColorBuffer[3*lIndex + 1] = static_cast<unsigned char>(255.0f*std::min(std::max(pC.y(), 0.0f), 1.0f) + 0.5f);
+  aColorBuffer[3*lIndex + 2] = static_cast<unsigned char>(255.0f*std::min(std::max(pC.z(), 0.0f), 1.0f) + 0.5f);
+}
+
+// Writes a square of pSize pixels centered on
+// (pX,pY), like non antialiased points and lines
+void SoftwareRasterizer::writeStamp(const float     pX,
+                                    const float     pY,
+                                    const float     pInvW,
+                                    const Vector3D& pC,
+                                    const float     pSize)
+{
+  const int lSize = std::max(static_cast<int>(pSize + 0.5f), 1);
+  const int lXMin = static_cast<int>(floor(pX - 0.5f*lSize + 0.5f));
+  const int lYMin = static_cast<int>(floor(pY - 0.5f*lSize + 0.5f));
+
+  for (int y=lYMin; y<lYMin+lSize; ++y) {
+    for (int x=lXMin; x<lXMin+lSize; ++x) {
+      writeFragment(x, y, pInvW, pC);
+    }
+  }
+}
@@ -0,0 +1,201 @@
+//  glv - OpenGL viewer command line tool
+/*****************************************************************************
+ * Copyright (C) 2003 Patrick Lagace <bl4cklight@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+*****************************************************************************/
+
+#ifndef SOFTWARERASTERIZER_H
+#define SOFTWARERASTERIZER_H
+
+#include "Matrix4x4.h"
+#include "Vector3D.h"
+#include <vector>
+
+class Tile;
+class View;
+
+// Pure CPU renderer used for the snapshots when the
+// software rendering is enabled (-soft). It renders one
+// Tile at a time in its own color and depth buffers,
+// without any OpenGL call. It mimics the OpenGL state
+// used by glv: one light, color material on the
+// diffuse term and two sided lighting.
+class SoftwareRasterizer
+{
+public:
+
+  enum PrimitiveMode {primitiveMode_none,
+                      primitiveMode_lines,
+                      primitiveMode_points,
+                      primitiveMode_triangles};
+
+  // Equivalent of the OpenGL state saved by glPushMatrix
+  // and glPushAttrib when rendering a sub-Object
+  struct State {
+    Vector3D  aColor;
+    bool      aCullBackFaces;
+    bool      aDepthTest;
+    bool      aLighting;
+    float     aLineWidth;
+    float     aPointSize;
+    bool      aPolygonOffset;
+    Matrix4x4 aTransformation;
+    bool      aTwoSidedLighting;
+  };
+
+  SoftwareRasterizer (const int pWidth,
+                      const int pHeight);
+  ~SoftwareRasterizer();
+
+  void                 addVertex     (const Vector3D& pP);
+
+  void                 begin         (const Tile&     pTile,
+                                      const View&     pView);
+
+  void                 beginPrimitive(const PrimitiveMode pMode);
+
+  void                 clear         (const Vector3D& pColor);
+
+  void                 drawBackground(const Vector3D& pC1,
+                                      const Vector3D& pC2,
+                                      const Vector3D& pC3,
+                                      const Vector3D& pC4);
+
+  void                 drawLine      (const Vector3D& pP1, const Vector3D& pC1,
+                                      const Vector3D& pP2, const Vector3D& pC2);
+
+  void                 drawPoint     (const Vector3D& pP,  const Vector3D& pC);
+
+  void                 drawQuad      (const Vector3D& pP1, const Vector3D& pN1, const Vector3D& pC1,
+                                      const Vector3D& pP2, const Vector3D& pN2, const Vector3D& pC2,
+                                      const Vector3D& pP3, const Vector3D& pN3, const Vector3D& pC3,
+                                      const Vector3D& pP4, const Vector3D& pN4, const Vector3D& pC4);
+
+  void                 drawTriangle  (const Vector3D& pP1, const Vector3D& pN1, const Vector3D& pC1,
+                                      const Vector3D& pP2, const Vector3D& pN2, const Vector3D& pC2,
+                                      const Vector3D& pP3, const Vector3D& pN3, const Vector3D& pC3);
+
+  void                 endPrimitive  ();
+
+  const unsigned char* getColorBuffer() const;
+
+  State&               getState      ();
+
+  void                 setLight      (const Vector3D& pPosition,
+                                      const bool      pLocal,
+                                      const float     pAmbient,
+                                      const float     pDiffuse);
+
+private:
+
+  // Block the use of those
+  SoftwareRasterizer();
+  SoftwareRasterizer(const SoftwareRasterizer&);
+  SoftwareRasterizer& operator=(const SoftwareRasterizer&);
+
+  // Vertex in eye coordinates. aW is the distance
+  // in front of the camera
+  struct EyeVertex {
+    float    aX;
+    float    aY;
+    float    aW;
+    Vector3D aFrontColor;
+    Vector3D aBackColor;
+  };
+
+  // Vertex in tile coordinates (origin at the upper
+  // left corner). Attributes are divided by aW
+  // for the perspective correct interpolation
+  struct ScreenVertex {
+    float    aX;
+    float    aY;
+    float    aInvW;
+    Vector3D aFrontColorOverW;
+    Vector3D aBackColorOverW;
+  };
+
+  EyeVertex    getEyeVertex     (const Vector3D&     pP,
+                                 const Vector3D&     pN,
+                                 const Vector3D&     pC,
+                                 const bool          pLit) const;
+
+  Vector3D     getLitColor      (const Vector3D&     pWorldP,
+                                 const Vector3D&     pWorldN,
+                                 const Vector3D&     pC) const;
+
+  ScreenVertex getScreenVertex  (const EyeVertex&    pV) const;
+
+  int          clipNearPlane    (const EyeVertex*    pVertices,
+                                 const int           pNbVertices,
+                                 EyeVertex*          pClipped) const;
+
+  void         rasterizeLine    (const EyeVertex&    pV1,
+                                 const EyeVertex&    pV2);
+
+  void         rasterizePolygon (const EyeVertex*    pVertices,
+                                 const int           pNbVertices);
+
+  void         rasterizeTriangle(const ScreenVertex& pV1,
+                                 const ScreenVertex& pV2,
+                                 const ScreenVertex& pV3);
+
+  void         writeFragment    (const int           pX,
+                                 const int           pY,
+                                 const float         pInvW,
+                                 const Vector3D&     pC);
+
+  void         writeStamp       (const float         pX,
+                                 const float         pY,
+                                 const float         pInvW,
+                                 const Vector3D&     pC,
+                                 const float         pSize);
+
+  static const float aGlobalAmbient;
+  static const float aMaterialAmbient;
+  static const float aPolygonOffsetFactor;
+
+  std::vector<unsigned char> aColorBuffer;
+  Vector3D                   aCameraDirection;
+  Vector3D                   aCameraPosition;
+  Vector3D                   aCameraRight;
+  Vector3D                   aCameraUp;
+  std::vector<float>         aDepthBuffer;
+  float                      aFrustrumXMax;
+  float                      aFrustrumXMin;
+  float                      aFrustrumYMax;
+  float                      aFrustrumYMin;
+  int                        aHeight;
+  float                      aLightAmbient;
+  float                      aLightDiffuse;
+  bool                       aLightLocal;
+  Vector3D                   aLightPosition;
+  float                      aOrtho2DXMax;
+  float                      aOrtho2DXMin;
+  float                      aOrtho2DYMax;
+  float                      aOrtho2DYMin;
+  PrimitiveMode              aPrimitiveMode;
+  std::vector<Vector3D>      aPrimitiveVertices;
+  State                      aState;
+  int                        aTileHeight;
+  int                        aTileWidth;
+  int                        aWidth;
+  float                      aZFar;
+  float                      aZNear;
+
+};
+
+#endif // SOFTWARERASTERIZER_H
@@ -78,17 +78,18 @@ Tile::~Tile()
   GLV_CHECK_INVARIANTS;
 }
 
-void Tile::initFrustrumMatrix(const float pFOVDegrees,
-                              const float pZNear,
-                              const float pZFar) const
+// Computes the glFrustum parameters (at pZNear) needed
+// to display only the current tile of the image
+void Tile::getFrustrumBounds(const float pFOVDegrees,
+                             const float pZNear,
+                             float&      pXMin,
+                             float&      pXMax,
+                             float&      pYMin,
+                             float&      pYMax) const
 {
   GLV_CHECK_INVARIANTS;
   GLV_ASSERT(pFOVDegrees > 0.0);
   GLV_ASSERT(pZNear      > 0.0);
-  GLV_ASSERT(pZFar       > pZNear);
-
-  glMatrixMode  (GL_PROJECTION);
-  glLoadIdentity();
 
   // Replace the call to gluPerspective to the
   // equivalent call to glFrustum in order to be
@@ -114,17 +115,27 @@ void Tile::initFrustrumMatrix(const float pFOVDegrees,
   const float lOpenGLTileYMax = aImageHeight - aYMin;
   const float lOpenGLTileYMin = aImageHeight - aYMax - 1;
 
-  const float lXMinTile = (lOpenGLTileXMin/aImageWidth )*(lXMax-lXMin) + lXMin;
-  const float lXMaxTile = (lOpenGLTileXMax/aImageWidth )*(lXMax-lXMin) + lXMin;
-  const float lYMinTile = (lOpenGLTileYMin/aImageHeight)*(lYMax-lYMin) + lYMin;
-  const float lYMaxTile = (lOpenGLTileYMax/aImageHeight)*(lYMax-lYMin) + lYMin;
+  pXMin = (lOpenGLTileXMin/aImageWidth )*(lXMax-lXMin) + lXMin;
+  pXMax = (lOpenGLTileXMax/aImageWidth )*(lXMax-lXMin) + lXMin;
+  pYMin = (lOpenGLTileYMin/aImageHeight)*(lYMax-lYMin) + lYMin;
+  pYMax = (lOpenGLTileYMax/aImageHeight)*(lYMax-lYMin) + lYMin;
 
-  glFrustum(lXMinTile, lXMaxTile, lYMinTile, lYMaxTile, pZNear, pZFar);
+  GLV_CHECK_INVARIANTS;
+}
 
+// Height of the tile in pixels
+int Tile::getHeight() const
+{
   GLV_CHECK_INVARIANTS;
+  return static_cast<int>(aYMax-aYMin+1);
 }
 
-void Tile::initOrtho2DMatrix() const
+// Computes the gluOrtho2D parameters needed to display
+// only the current tile of the [0,1]x[0,1] image
+void Tile::getOrtho2DBounds(float& pXMin,
+                            float& pXMax,
+                            float& pYMin,
+                            float& pYMax) const
 {
   GLV_CHECK_INVARIANTS;
 
@@ -135,10 +146,55 @@ void Tile::initOrtho2DMatrix() const
   const float lOpenGLTileYMax = aImageHeight - aYMin;
   const float lOpenGLTileYMin = aImageHeight - aYMax - 1;
 
-  const float lXMinTile = (lOpenGLTileXMin/aImageWidth);
-  const float lXMaxTile = (lOpenGLTileXMax/aImageWidth);
-  const float lYMinTile = (lOpenGLTileYMin/aImageHeight);
-  const float lYMaxTile = (lOpenGLTileYMax/aImageHeight);
+  pXMin = (lOpenGLTileXMin/aImageWidth);
+  pXMax = (lOpenGLTileXMax/aImageWidth);
+  pYMin = (lOpenGLTileYMin/aImageHeight);
+  pYMax = (lOpenGLTileYMax/aImageHeight);
+
+  GLV_CHECK_INVARIANTS;
+}
+
+// Width of the tile in pixels
+int Tile::getWidth() const
+{
+  GLV_CHECK_INVARIANTS;
+  return static_cast<int>(aXMax-aXMin+1);
+}
+
+void Tile::initFrustrumMatrix(const float pFOVDegrees,
+                              const float pZNear,
+                              const float pZFar) const
+{
+  GLV_CHECK_INVARIANTS;
+  GLV_ASSERT(pFOVDegrees > 0.0);
+  GLV_ASSERT(pZNear      > 0.0);
+  GLV_ASSERT(pZFar       > pZNear);
+
+  glMatrixMode  (GL_PROJECTION);
+  glLoadIdentity();
+
+  float lXMinTile;
+  float lXMaxTile;
+  float lYMinTile;
+  float lYMaxTile;
+
+  getFrustrumBounds(pFOVDegrees, pZNear, lXMinTile, lXMaxTile, lYMinTile, lYMaxTile);
+
+  glFrustum(lXMinTile, lXMaxTile, lYMinTile, lYMaxTile, pZNear, pZFar);
+
+  GLV_CHECK_INVARIANTS;
+}
+
+void Tile::initOrtho2DMatrix() const
+{
+  GLV_CHECK_INVARIANTS;
+
+  float lXMinTile;
+  float lXMaxTile;
+  float lYMinTile;
+  float lYMaxTile;
+
+  getOrtho2DBounds(lXMinTile, lXMaxTile, lYMinTile, lYMaxTile);
 
   glMatrixMode  (GL_PROJECTION);
   glLoadIdentity();
@@ -150,7 +206,7 @@ void Tile::initOrtho2DMatrix() const
 void Tile::initViewport() const
 {
   GLV_CHECK_INVARIANTS;
-  glViewport(0, 0, static_cast<int>(aXMax-aXMin+1), static_cast<int>(aYMax-aYMin+1));
+  glViewport(0, 0, getWidth(), getHeight());
   GLV_CHECK_INVARIANTS;
 }
 
@@ -39,6 +39,22 @@ public:
 
   ~Tile();
 
+  void getFrustrumBounds (const float pFOVDegrees,
+                          const float pZNear,
+                          float&      pXMin,
+                          float&      pXMax,
+                          float&      pYMin,
+                          float&      pYMax) const;
+
+  int  getHeight         () const;
+
+  void getOrtho2DBounds  (float&      pXMin,
+                          float&      pXMax,
+                          float&      pYMin,
+                          float&      pYMax) const;
+
+  int  getWidth          () const;
+
   void initFrustrumMatrix(const float pFOVDegrees,
                           const float pZNear,
                           const float pZFar) const;
@@ -26,18 +26,22 @@
 #include "limits_glv.h"
 
 // By default, distant light
+// aFlagSoftwareRendering is only set from the
+// command line; it is not saved in the file
 UserSettings::UserSettings()
-  : aBackgroundB       (0.0f),
-    aBackgroundG       (0.0f),
-    aBackgroundMode    (0),
-    aBackgroundR       (0.0f),
-    aFlagGrid          (true),
-    aFlagAxes          (false),
-    aLightAmbient      (0.5f),
-    aLightModel        (1),
-    aLightPositionLocal(0),
-    aLightPosition     (1.0f, 1.0f, 1.0f),
-    aSimplicationMode  (simplificationMode_none)
+  : aBackgroundB          (0.0f),
+    aBackgroundG          (0.0f),
+    aBackgroundMode       (0),
+    aBackgroundR          (0.0f),
+    aFlagGrid             (true),
+    aFlagAxes             (false),
+    aFlagSoftwareRendering(false),
+    aLightAmbient         (0.5f),
+    aLightModel           (1),
+    aLightPositionLocal   (0),
+    aLightPosition        (1.0f, 1.0f, 1.0f),
+    aSimplicationMode     (simplificationMode_none),
+    aSmallFeaturePixels   (0.0f)
 {}
 
 UserSettings::~UserSettings()
@@ -121,10 +125,17 @@ int UserSettings::loadFile(const std::string& pFilename, std::string& pError)
       else if (lSimplificationMode == 2) {
         aSimplicationMode = simplificationMode_fast;
       }
+      else if (lSimplificationMode == 3) {
+        aSimplicationMode = simplificationMode_level_of_detail;
+      }
       else {
         aSimplicationMode = simplificationMode_none;
       }
     }
+    else if(lVariable == "small_feature_pixels") {
+      sscanf(lParam.c_str(),"%f",&aSmallFeaturePixels);
+      aSmallFeaturePixels = std::max(aSmallFeaturePixels, 0.0f);
+    }
     else if(lVariable == "light_model") {
       sscanf(lParam.c_str(),"%d",&aLightModel);
     }
@@ -174,12 +185,15 @@ void UserSettings::saveFile(const std::string& pFilename, std::string& pError)
     fprintf(file,"enable_grid=%d\n\n",aFlagGrid);
     fprintf(file,"# Show axes [0,1]\n");
     fprintf(file,"enable_axes=%d\n\n",aFlagAxes);
-    fprintf(file,"# Graphic simplification [0,1,2]\n");
+    fprintf(file,"# Graphic simplification [0,1,2,3]\n");
     fprintf(file,"#   0 = no simplification\n");
     fprintf(file,"#   1 = using bounding Boxes for simplification (-bbox)\n");
     fprintf(file,"#   2 = using a small subset of the primitives for simplification (-fast)\n");
+    fprintf(file,"#   3 = automatic level of detail, chosen from the frame rate (-lod)\n");
     fprintf(file,"#  If 1 or 2 is selected, the 3D model is hidden while using the mouse to rotate, translate, zoom\n");
     fprintf(file,"#    thus, enabling a faster user interaction.  Use this for large models\n");
+    fprintf(file,"#  If 3 is selected, the 3D model is simplified as much as needed to keep the interaction smooth,\n");
+    fprintf(file,"#    then refined back to full detail once the camera stops\n");
     switch (aSimplicationMode) {
     case simplificationMode_none:
       fprintf(file,"graphic_simplication=0\n\n");
@@ -187,11 +201,17 @@ void UserSettings::saveFile(const std::string& pFilename, std::string& pError)
     case simplificationMode_bounding_box:
       fprintf(file,"graphic_simplication=1\n\n");
       break;
-    default:
-      GLV_ASSERT(aSimplicationMode == simplificationMode_fast);
+    case simplificationMode_fast:
       fprintf(file,"graphic_simplication=2\n\n");
       break;
+    default:
+      GLV_ASSERT(aSimplicationMode == simplificationMode_level_of_detail);
+      fprintf(file,"graphic_simplication=3\n\n");
+      break;
     }
+    fprintf(file,"# Small features: floating point size in pixels (-small)\n");
+    fprintf(file,"#   The objects smaller than this on screen are drawn as a single point. 0 to disable\n");
+    fprintf(file,"small_feature_pixels=%f\n\n",aSmallFeaturePixels);
     fprintf(file,"# Light model [0,2]\n");
     fprintf(file,"#  0 = Flag shading, no lighting\n");
     fprintf(file,"#  1 = Light is camera  (default)\n");
@@ -31,7 +31,8 @@ public:
 
   enum SimplificationMode {simplificationMode_none,
                            simplificationMode_bounding_box,
-                           simplificationMode_fast};
+                           simplificationMode_fast,
+                           simplificationMode_level_of_detail};
   UserSettings();
   ~UserSettings();
 
@@ -47,11 +48,13 @@ public:
   float              aBackgroundR;
   bool               aFlagGrid;
   bool               aFlagAxes;
+  bool               aFlagSoftwareRendering;
   float              aLightAmbient;
   int                aLightModel;
   int                aLightPositionLocal;
   Vector3D           aLightPosition;
   SimplificationMode aSimplicationMode;
+  float              aSmallFeaturePixels;
 
 };
 
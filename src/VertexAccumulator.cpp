@@ -19,6 +19,8 @@
 *****************************************************************************/
 
 #include "VertexAccumulator.h"
+#include "arena_utils.h"
+#include "cache_utils.h"
 #include "limits_glv.h"
 #include <cmath>
 #include <iostream>
@@ -39,6 +41,18 @@ VertexAccumulator::~VertexAccumulator()
 {
 }
 
+// The VertexAccumulators are nodes of the scene, see arena_utils.h
+void* VertexAccumulator::operator new(size_t pBytes)
+{
+  return allocateArena(pBytes);
+}
+
+void VertexAccumulator::operator delete(void*  pPtr,
+                                        size_t pBytes)
+{
+  deallocateArena(pPtr, pBytes);
+}
+
 void VertexAccumulator::addColor(const Vector3D& pColor)
 {
   aColors.push_back(pColor);
@@ -48,26 +62,20 @@ void VertexAccumulator::addColor(const Vector3D& pColor)
 
 void VertexAccumulator::addVertex(const Vector3D& pVertex)
 {
-  aVertices.push_back(pVertex);
+  aVertices.addPosition(pVertex);
 
   aSimplifiedDirty = true;
 }
 
-#ifdef GLV_DUMP_MEMORY_USAGE
-
-template <class Container>
-inline
-std::string getStringSizeAndCapacity(const Container& pContainer)
+// Release the unused capacity of the vectors once the
+// Object is complete. Returns the number of bytes released
+size_t VertexAccumulator::compact()
 {
-  char lSizeAndCapacity[128];
-  sprintf(lSizeAndCapacity,"%d/%d",
-          sizeof(typename Container::value_type)*pContainer.size(),
-          sizeof(typename Container::value_type)*pContainer.capacity());
-  return std::string(lSizeAndCapacity);
+  return (shrinkToFit(aColors ) +
+          shrinkToFit(aNormals) +
+          aVertices.compact());
 }
 
-#endif // #ifdef  GLV_DUMP_MEMORY_USAGE
-
 // Dump in ASCII the caracteristics of the VertexAccumulator
 void VertexAccumulator::dumpCharacteristics(std::ostream&       pOstream,
                                             const std::string&  pIndentation,
@@ -96,13 +104,21 @@ void VertexAccumulator::dumpCharacteristics(std::ostream&       pOstream,
 
     pOstream << lIndentation << "Memory used by aColors   = " << getStringSizeAndCapacity(aColors  ) << std::endl;
     pOstream << lIndentation << "Memory used by aNormals  = " << getStringSizeAndCapacity(aNormals ) << std::endl;
-    pOstream << lIndentation << "Memory used by aVertices = " << getStringSizeAndCapacity(aVertices) << std::endl;
+    char lSizeAndCapacity[128];
+    sprintf(lSizeAndCapacity, "%lu/%lu",
+            static_cast<unsigned long>(aVertices.getMemorySize    ()),
+            static_cast<unsigned long>(aVertices.getMemoryCapacity()));
+    pOstream << lIndentation << "Memory used by aVertices = " << lSizeAndCapacity << std::endl;
 
   }
 #endif // #ifdef GLV_DUMP_MEMORY_USAGE
 
   pOstream << lIndentation << "Number of vertex  = " << aVertices  .size() << std::endl;
   pOstream << lIndentation << "Number of color_v = " << aColors    .size() << std::endl;
+
+  if (aVertices.isQuantized()) {
+    pOstream << lIndentation << "Quantization error <= " << aVertices.getErrorBound() << std::endl;
+  }
 }
 
 // Tell the VertexAccumulator that no more colors
@@ -119,7 +135,7 @@ bool VertexAccumulator::freezeColors()
 
   if (!lColorsOk) {
     // Remove the colors since they're not usable
-    std::vector<Vector3D> lTmp;
+    Colors lTmp;
     aColors.swap(lTmp);
   }
 
@@ -127,11 +143,56 @@ bool VertexAccumulator::freezeColors()
 }
 
 // Tell the VertexAccumulator that no more vertices
-// will be added to *this.
+// will be added to *this. They are quantized from
+// now on, if enabled (see setPositionQuantization)
 void VertexAccumulator::freezeVertices()
 {
   GLV_ASSERT(!aColorsFrozen);
   aVerticesFrozen = true;
+
+  aVertices.quantize();
+}
+
+// Read the vertices and colors written by writeCache. The normals
+// are not stored: they are computed again when needed.
+// Returns false if the file is corrupted
+bool VertexAccumulator::readCache(FILE* pFilePtr)
+{
+  const bool lOk = (readCacheVector    (pFilePtr, aColors        ) &&
+                    readCacheValue     (pFilePtr, aColorsFrozen  ) &&
+                    aVertices.readCache(pFilePtr                 ) &&
+                    readCacheValue     (pFilePtr, aVerticesFrozen));
+
+  // Cached before the quantization was enabled
+  if (lOk && aVerticesFrozen) {
+    aVertices.quantize();
+  }
+
+  aSimplifiedDirty = true;
+
+  return lOk;
+}
+
+// Make room for the colors announced by the count of a raw_color_v
+void VertexAccumulator::reserveColors(const size_t pNbColors)
+{
+  aColors.reserve(aColors.size() + pNbColors);
+}
+
+// Make room for the vertices announced by the count of a raw_vertex
+void VertexAccumulator::reserveVertices(const size_t pNbVertices)
+{
+  aVertices.reserve(pNbVertices);
+}
+
+// Write the vertices and colors in the parse cache file
+// Returns false on a write error
+bool VertexAccumulator::writeCache(FILE* pFilePtr) const
+{
+  return (writeCacheVector    (pFilePtr, aColors        ) &&
+          writeCacheValue     (pFilePtr, aColorsFrozen  ) &&
+          aVertices.writeCache(pFilePtr                 ) &&
+          writeCacheValue     (pFilePtr, aVerticesFrozen));
 }
 
 // Return a reference to the internal data
@@ -25,7 +25,12 @@
 #include "BoundingBox.h"
 #include "glinclude.h"
 #include "limits_glv.h"
+#include "mapped_utils.h"
+#include "PackedColor.h"
+#include "PackedNormal.h"
 #include "RenderParameters.h"
+#include "VertexPositions.h"
+#include <stdio.h>
 #include <string>
 #include <vector>
 
@@ -42,10 +47,16 @@ public:
   VertexAccumulator ();
   ~VertexAccumulator();
 
+  static void* operator new   (size_t pBytes);
+  static void  operator delete(void*  pPtr,
+                               size_t pBytes);
+
   void  addColor           (const Vector3D&     pColor);
 
   void  addVertex          (const Vector3D&     pVertex);
 
+  size_t compact           ();
+
   void  dumpCharacteristics(std::ostream&       pOstream,
                             const std::string&  pIndentation,
                             const Matrix4x4&    pTransformation) const;
@@ -57,9 +68,17 @@ public:
 
   void  freezeVertices     ();
 
-  typedef  std::vector<Vector3D>  Colors;
-  typedef  std::vector<Vector3D>  Normals;
-  typedef  std::vector<Vector3D>  Vertices;
+  bool  readCache          (FILE*               pFilePtr);
+
+  void  reserveColors      (const size_t        pNbColors);
+
+  void  reserveVertices    (const size_t        pNbVertices);
+
+  bool  writeCache         (FILE*               pFilePtr) const;
+
+  typedef  MappedVector<StoredColor>::Type   Colors;
+  typedef  MappedVector<StoredNormal>::Type  Normals;
+  typedef  VertexPositions                   Vertices;
   
 private:
 
@@ -0,0 +1,348 @@
+//  glv - OpenGL viewer command line tool
+/*****************************************************************************
+ * Copyright (C) 2003 Patrick Lagace <bl4cklight@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+*****************************************************************************/
+
+#include "VertexClustering.h"
+#include "assert_glv.h"
+#include "PrimitiveAccumulator.h"
+#include <algorithm>
+#include <cmath>
+
+// Largest number of cells along one axis of the grid
+const int          VertexClustering::aMaximumGridSize     = 128;
+
+// Bounds of the number of primitives wanted in the simplified model
+const unsigned int VertexClustering::aMaximumNbPrimitives = 32768;
+const unsigned int VertexClustering::aMinimumNbPrimitives = 512;
+
+// Wanted ratio between the number of primitives before and after
+// the simplification, when the bounds above allow it. This is the
+// ratio between two consecutive levels of detail
+const unsigned int VertexClustering::aReductionFactor     = 4;
+
+// The grid is made for the pNbPrimitives primitives in pBoundingBox,
+// but covers pMargin times its size more on each side, so that the
+// primitives added later around it don't need a new grid
+VertexClustering::VertexClustering(const BoundingBox& pBoundingBox,
+                                   const unsigned int pNbPrimitives,
+                                   const float        pMargin)
+  : aCells        (),
+    aCellSize     (1.0f),
+    aClusters     (),
+    aLines        (),
+    aLinesKeys    (),
+    aMinimum      (pBoundingBox.getMinimum()),
+    aNbCellsX     (1),
+    aNbCellsY     (1),
+    aNbCellsZ     (1),
+    aNbPrimitives (pNbPrimitives),
+    aTriangles    (),
+    aTrianglesKeys()
+{
+  GLV_ASSERT(pMargin >= 0.0f);
+
+  // Initial size of the hash table of the cells (a power of 2)
+  const Cell lEmptyCell = {-1, -1};
+  aCells.assign(1024, lEmptyCell);
+
+  const unsigned int lNbPrimitives = std::min(aMaximumNbPrimitives,
+                                              std::max(aMinimumNbPrimitives,
+                                                       pNbPrimitives/aReductionFactor));
+
+  // A surface cut by a grid of N*N*N cells gives about 2*N*N triangles
+  const int lGridSize = std::min(aMaximumGridSize,
+                                 std::max(2, static_cast<int>(sqrt(0.5*lNbPrimitives))));
+
+  const Vector3D lExtent  = pBoundingBox.getMaximum() - aMinimum;
+  const float    lLargest = std::max(lExtent.x(), std::max(lExtent.y(), lExtent.z()));
+
+  if (lLargest > 0.0f) {
+    aCellSize = lLargest / lGridSize;
+    aMinimum  = aMinimum - (pMargin*lLargest)*Vector3D(1.0f, 1.0f, 1.0f);
+
+    const Vector3D lGridExtent = lExtent + (2.0f*pMargin*lLargest)*Vector3D(1.0f, 1.0f, 1.0f);
+    const int      lMargin     = static_cast<int>(2.0f*pMargin*lGridSize) + 1;
+
+    aNbCellsX = std::min(lGridSize + lMargin, static_cast<int>(lGridExtent.x() / aCellSize) + 1);
+    aNbCellsY = std::min(lGridSize + lMargin, static_cast<int>(lGridExtent.y() / aCellSize) + 1);
+    aNbCellsZ = std::min(lGridSize + lMargin, static_cast<int>(lGridExtent.z() / aCellSize) + 1);
+  }
+}
+
+VertexClustering::~VertexClustering()
+{
+}
+
+// Add a vertex; returns the index of its cluster
+int VertexClustering::addVertex(const Vector3D& pP)
+{
+  const int lCluster = getCluster(pP);
+
+  aClusters[lCluster].aPositionSum += pP;
+  ++aClusters[lCluster].aNbVertices;
+
+  return lCluster;
+}
+
+// Add a colored vertex; returns the index of its cluster
+int VertexClustering::addVertexColored(const Vector3D& pP,
+                                       const Vector3D& pC)
+{
+  const int lCluster = addVertex(pP);
+
+  aClusters[lCluster].aColorSum += pC;
+  ++aClusters[lCluster].aNbColors;
+
+  return lCluster;
+}
+
+void VertexClustering::addLine(const int  pCluster1,
+                               const int  pCluster2,
+                               const bool pColored)
+{
+  // Collapsed or already there
+  if (pCluster1 == pCluster2) {
+    return;
+  }
+
+  const unsigned long long lKey = ((static_cast<unsigned long long>(std::min(pCluster1, pCluster2)) << 21) |
+                                   static_cast<unsigned long long>(std::max(pCluster1, pCluster2)));
+
+  if (aLinesKeys.insert(lKey).second) {
+    ClusteredPrimitive lLine;
+    lLine.aCluster1 = pCluster1;
+    lLine.aCluster2 = pCluster2;
+    lLine.aCluster3 = -1;
+    lLine.aColored  = pColored;
+    aLines.push_back(lLine);
+  }
+}
+
+void VertexClustering::addPoint(const int  pCluster,
+                                const bool pColored)
+{
+  GLV_ASSERT(pCluster >= 0 && pCluster < static_cast<int>(aClusters.size()));
+
+  aClusters[pCluster].aFlagPoint         = true;
+  aClusters[pCluster].aFlagPointColored |= pColored;
+}
+
+// The quad is split in two triangles
+void VertexClustering::addQuad(const int  pCluster1,
+                               const int  pCluster2,
+                               const int  pCluster3,
+                               const int  pCluster4,
+                               const bool pColored)
+{
+  addTriangle(pCluster1, pCluster2, pCluster3, pColored);
+  addTriangle(pCluster1, pCluster3, pCluster4, pColored);
+}
+
+void VertexClustering::addTriangle(const int  pCluster1,
+                                   const int  pCluster2,
+                                   const int  pCluster3,
+                                   const bool pColored)
+{
+  // Collapsed
+  if (pCluster1 == pCluster2 || pCluster2 == pCluster3 || pCluster3 == pCluster1) {
+    return;
+  }
+
+  // The key doesn't depend on the order of the vertices, so the
+  // two sides of a surface are merged in one triangle
+  int lSorted[3] = {pCluster1, pCluster2, pCluster3};
+  std::sort(lSorted, lSorted + 3);
+
+  const unsigned long long lKey = ((static_cast<unsigned long long>(lSorted[0]) << 42) |
+                                   (static_cast<unsigned long long>(lSorted[1]) << 21) |
+                                   static_cast<unsigned long long>(lSorted[2]));
+
+  if (aTrianglesKeys.insert(lKey).second) {
+    ClusteredPrimitive lTriangle;
+    lTriangle.aCluster1 = pCluster1;
+    lTriangle.aCluster2 = pCluster2;
+    lTriangle.aCluster3 = pCluster3;
+    lTriangle.aColored  = pColored;
+    aTriangles.push_back(lTriangle);
+  }
+}
+
+// Returns true if the primitives of pBoundingBox, pNbPrimitives in
+// total with the ones already added, can still be simplified with
+// this grid: they are inside of it, and not so many that the
+// simplified model would be much coarser than a new grid would give
+bool VertexClustering::canContain(const BoundingBox& pBoundingBox,
+                                  const unsigned int pNbPrimitives) const
+{
+  const Vector3D lMinimum = pBoundingBox.getMinimum();
+  const Vector3D lMaximum = pBoundingBox.getMaximum();
+
+  return (pNbPrimitives <= 2*aNbPrimitives                  &&
+          lMinimum.x() >= aMinimum.x()                      &&
+          lMinimum.y() >= aMinimum.y()                      &&
+          lMinimum.z() >= aMinimum.z()                      &&
+          lMaximum.x() <= aMinimum.x() + aNbCellsX*aCellSize &&
+          lMaximum.y() <= aMinimum.y() + aNbCellsY*aCellSize &&
+          lMaximum.z() <= aMinimum.z() + aNbCellsZ*aCellSize);
+}
+
+// Add the simplified primitives to pSimplified. Each cluster
+// is replaced by the average of its vertices
+void VertexClustering::constructSimplified(PrimitiveAccumulator& pSimplified) const
+{
+  {
+    ClusteredPrimitives::const_iterator       lIter    = aLines.begin();
+    const ClusteredPrimitives::const_iterator lIterEnd = aLines.end  ();
+
+    while (lIter != lIterEnd) {
+      if (lIter->aColored) {
+        pSimplified.addLineColored(getPosition(lIter->aCluster1), getColor(lIter->aCluster1),
+                                   getPosition(lIter->aCluster2), getColor(lIter->aCluster2));
+      }
+      else {
+        pSimplified.addLine(getPosition(lIter->aCluster1),
+                            getPosition(lIter->aCluster2));
+      }
+      ++lIter;
+    }
+  }
+
+  {
+    ClusteredPrimitives::const_iterator       lIter    = aTriangles.begin();
+    const ClusteredPrimitives::const_iterator lIterEnd = aTriangles.end  ();
+
+    while (lIter != lIterEnd) {
+      if (lIter->aColored) {
+        pSimplified.addTriangleColored(getPosition(lIter->aCluster1), getColor(lIter->aCluster1),
+                                       getPosition(lIter->aCluster2), getColor(lIter->aCluster2),
+                                       getPosition(lIter->aCluster3), getColor(lIter->aCluster3));
+      }
+      else {
+        pSimplified.addTriangle(getPosition(lIter->aCluster1),
+                                getPosition(lIter->aCluster2),
+                                getPosition(lIter->aCluster3));
+      }
+      ++lIter;
+    }
+  }
+
+  for (int i=0; i<static_cast<int>(aClusters.size()); ++i) {
+    if (aClusters[i].aFlagPointColored) {
+      pSimplified.addPointColored(getPosition(i), getColor(i));
+    }
+    else if (aClusters[i].aFlagPoint) {
+      pSimplified.addPoint(getPosition(i));
+    }
+  }
+}
+
+// Returns true if pNbPrimitives primitives are enough to
+// get a simplified model significantly smaller
+bool VertexClustering::isWorthSimplifying(const unsigned int pNbPrimitives)
+{
+  return pNbPrimitives > 2*aMinimumNbPrimitives;
+}
+
+// Returns the cluster of the cell containing pP,
+// creating it if needed
+int VertexClustering::getCluster(const Vector3D& pP)
+{
+  const Vector3D lP = (pP - aMinimum) / aCellSize;
+
+  const int lX = std::max(0, std::min(aNbCellsX-1, static_cast<int>(lP.x())));
+  const int lY = std::max(0, std::min(aNbCellsY-1, static_cast<int>(lP.y())));
+  const int lZ = std::max(0, std::min(aNbCellsZ-1, static_cast<int>(lP.z())));
+
+  const int lIndex = lX + aNbCellsX*(lY + aNbCellsY*lZ);
+
+  // Only the cells with vertices are stored, in a hash table
+  // with linear probing, kept at most half full
+  if (2*(aClusters.size()+1) > aCells.size()) {
+    growCells();
+  }
+
+  const unsigned int lMask = static_cast<unsigned int>(aCells.size()) - 1;
+  unsigned int       lSlot = (static_cast<unsigned int>(lIndex) * 2654435761u) & lMask;
+
+  while (aCells[lSlot].aIndex != lIndex && aCells[lSlot].aIndex >= 0) {
+    lSlot = (lSlot + 1) & lMask;
+  }
+
+  Cell& lCell = aCells[lSlot];
+
+  if (lCell.aIndex < 0) {
+    Cluster lNewCluster;
+    lNewCluster.aFlagPoint        = false;
+    lNewCluster.aFlagPointColored = false;
+    lNewCluster.aNbColors         = 0;
+    lNewCluster.aNbVertices       = 0;
+
+    lCell.aIndex   = lIndex;
+    lCell.aCluster = static_cast<int>(aClusters.size());
+    aClusters.push_back(lNewCluster);
+  }
+
+  return lCell.aCluster;
+}
+
+// Double the size of the hash table of the cells
+void VertexClustering::growCells()
+{
+  const Cell lEmptyCell = {-1, -1};
+
+  Cells lCells(2*aCells.size(), lEmptyCell);
+
+  const unsigned int lMask = static_cast<unsigned int>(lCells.size()) - 1;
+
+  Cells::const_iterator       lIter    = aCells.begin();
+  const Cells::const_iterator lIterEnd = aCells.end  ();
+
+  while (lIter != lIterEnd) {
+    if (lIter->aIndex >= 0) {
+      unsigned int lSlot = (static_cast<unsigned int>(lIter->aIndex) * 2654435761u) & lMask;
+      while (lCells[lSlot].aIndex >= 0) {
+        lSlot = (lSlot + 1) & lMask;
+      }
+      lCells[lSlot] = *lIter;
+    }
+    ++lIter;
+  }
+
+  aCells.swap(lCells);
+}
+
+Vector3D VertexClustering::getColor(const int pCluster) const
+{
+  GLV_ASSERT(pCluster >= 0 && pCluster < static_cast<int>(aClusters.size()));
+  const Cluster& lCluster = aClusters[pCluster];
+
+  if (lCluster.aNbColors == 0) {
+    return Vector3D(1.0f, 1.0f, 1.0f);
+  }
+  return lCluster.aColorSum / lCluster.aNbColors;
+}
+
+Vector3D VertexClustering::getPosition(const int pCluster) const
+{
+  GLV_ASSERT(pCluster >= 0 && pCluster < static_cast<int>(aClusters.size()));
+  const Cluster& lCluster = aClusters[pCluster];
+
+  GLV_ASSERT(lCluster.aNbVertices > 0);
+  return lCluster.aPositionSum / lCluster.aNbVertices;
+}
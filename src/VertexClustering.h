@@ -0,0 +1,135 @@
+//  glv - OpenGL viewer command line tool
+/*****************************************************************************
+ * Copyright (C) 2003 Patrick Lagace <bl4cklight@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+*****************************************************************************/
+
+#ifndef VERTEXCLUSTERING_H
+#define VERTEXCLUSTERING_H
+
+#include "BoundingBox.h"
+#include "Vector3D.h"
+#include <set>
+#include <vector>
+
+class PrimitiveAccumulator;
+
+// Simplification of a set of primitives by vertex clustering: the
+// vertices are merged with the other vertices in the same cell of a
+// regular grid, and the primitives collapsed by the merge are removed.
+// The grid resolution is chosen from the number of primitives to
+// simplify, so that the result stays around a fixed primitive budget.
+// Primitives can be added after constructSimplified, as long as
+// canContain allows it, to update the simplification incrementally
+class VertexClustering
+{
+public:
+
+  VertexClustering (const BoundingBox& pBoundingBox,
+                    const unsigned int pNbPrimitives,
+                    const float        pMargin);
+  ~VertexClustering();
+
+  int   addVertex          (const Vector3D&       pP);
+  int   addVertexColored   (const Vector3D&       pP,
+                            const Vector3D&       pC);
+
+  void  addLine            (const int             pCluster1,
+                            const int             pCluster2,
+                            const bool            pColored);
+
+  void  addPoint           (const int             pCluster,
+                            const bool            pColored);
+
+  void  addQuad            (const int             pCluster1,
+                            const int             pCluster2,
+                            const int             pCluster3,
+                            const int             pCluster4,
+                            const bool            pColored);
+
+  void  addTriangle        (const int             pCluster1,
+                            const int             pCluster2,
+                            const int             pCluster3,
+                            const bool            pColored);
+
+  bool  canContain         (const BoundingBox&    pBoundingBox,
+                            const unsigned int    pNbPrimitives) const;
+
+  void  constructSimplified(PrimitiveAccumulator& pSimplified) const;
+
+  static bool isWorthSimplifying(const unsigned int pNbPrimitives);
+
+private:
+
+  // Block the use of those
+  VertexClustering();
+  VertexClustering(const VertexClustering&);
+  VertexClustering& operator=(const VertexClustering&);
+
+  struct Cluster {
+    Vector3D aColorSum;
+    bool     aFlagPoint;
+    bool     aFlagPointColored;
+    int      aNbColors;
+    int      aNbVertices;
+    Vector3D aPositionSum;
+  };
+
+  // Slot of the hash table of the cells with vertices
+  struct Cell {
+    int aIndex;   // Index of the cell in the grid, -1 for an empty slot
+    int aCluster;
+  };
+
+  struct ClusteredPrimitive {
+    int  aCluster1;
+    int  aCluster2;
+    int  aCluster3;
+    bool aColored;
+  };
+
+  typedef  std::vector<Cell>                Cells;
+  typedef  std::vector<Cluster>             Clusters;
+  typedef  std::vector<ClusteredPrimitive>  ClusteredPrimitives;
+  typedef  std::set<unsigned long long>     Keys;
+
+  int       getCluster  (const Vector3D& pP);
+  void      growCells   ();
+  Vector3D  getColor    (const int       pCluster) const;
+  Vector3D  getPosition (const int       pCluster) const;
+
+  Cells                aCells;
+  float                aCellSize;
+  Clusters             aClusters;
+  ClusteredPrimitives  aLines;
+  Keys                 aLinesKeys;
+  Vector3D             aMinimum;
+  int                  aNbCellsX;
+  int                  aNbCellsY;
+  int                  aNbCellsZ;
+  unsigned int         aNbPrimitives;
+  ClusteredPrimitives  aTriangles;
+  Keys                 aTrianglesKeys;
+
+  static const int          aMaximumGridSize;
+  static const unsigned int aMaximumNbPrimitives;
+  static const unsigned int aMinimumNbPrimitives;
+  static const unsigned int aReductionFactor;
+
+};
+
+#endif // VERTEXCLUSTERING_H
@@ -0,0 +1,220 @@
+//  glv - OpenGL viewer command line tool
+/*****************************************************************************
+ * Copyright (C) 2003 Patrick Lagace <bl4cklight@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *****************************************************************************/
+
+#include "VertexPositions.h"
+#include "cache_utils.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Chunks of 1024 vertices: the bounds stay tight on most meshes,
+// and the 24 bytes of a Chunk are negligible per vertex
+const unsigned int VertexPositions::aChunkShift = 10;
+
+// Bits per quantized coordinate, 0 when disabled
+static int gQuantizationBits = 0;
+
+void setPositionQuantization(const int pBits)
+{
+  GLV_ASSERT(pBits == 0 || pBits == 16);
+  gQuantizationBits = pBits;
+}
+
+VertexPositions::VertexPositions()
+  : aChunks            (),
+    aErrorBound        (0.0f),
+    aFlagQuantized     (false),
+    aPositions         (),
+    aQuantizedPositions()
+{}
+
+VertexPositions::~VertexPositions()
+{}
+
+// A new raw_vertex section can extend the vertices of an Object
+// after their quantization: they are then decoded until the
+// next call to quantize
+void VertexPositions::addPosition(const Vector3D& pPosition)
+{
+  if (aFlagQuantized) {
+    Positions lPositions;
+    lPositions.reserve(aQuantizedPositions.size() + 1);
+    for (size_t i=0; i<aQuantizedPositions.size(); ++i) {
+      lPositions.push_back((*this)[i]);
+    }
+    aPositions.swap(lPositions);
+
+    Chunks             lTmpChunks;
+    QuantizedPositions lTmpQuantizedPositions;
+    aChunks            .swap(lTmpChunks);
+    aQuantizedPositions.swap(lTmpQuantizedPositions);
+    aFlagQuantized = false;
+  }
+
+  aPositions.push_back(pPosition);
+}
+
+// Release the unused capacity of the vectors.
+// Returns the number of bytes released
+size_t VertexPositions::compact()
+{
+  return (shrinkToFit(aChunks            ) +
+          shrinkToFit(aPositions         ) +
+          shrinkToFit(aQuantizedPositions));
+}
+
+// Returns the largest distance between a position and
+// its quantized version (0 if not quantized)
+float VertexPositions::getErrorBound() const
+{
+  return aErrorBound;
+}
+
+// Returns the memory allocated for the positions, in bytes
+size_t VertexPositions::getMemoryCapacity() const
+{
+  return (sizeof(Chunk)            *aChunks            .capacity() +
+          sizeof(Vector3D)         *aPositions         .capacity() +
+          sizeof(QuantizedPosition)*aQuantizedPositions.capacity());
+}
+
+// Returns the memory used by the positions, in bytes
+size_t VertexPositions::getMemorySize() const
+{
+  return (sizeof(Chunk)            *aChunks            .size() +
+          sizeof(Vector3D)         *aPositions         .size() +
+          sizeof(QuantizedPosition)*aQuantizedPositions.size());
+}
+
+bool VertexPositions::isQuantized() const
+{
+  return aFlagQuantized;
+}
+
+// Hint that all the positions are about to be read
+void VertexPositions::prefetch() const
+{
+  if (aFlagQuantized) {
+    prefetchMapped(aQuantizedPositions, 0, aQuantizedPositions.size());
+  }
+  else {
+    prefetchMapped(aPositions, 0, aPositions.size());
+  }
+}
+
+// Replace the positions by their quantized version, if
+// enabled by setPositionQuantization. No position can be
+// added afterwards.
+void VertexPositions::quantize()
+{
+  if (gQuantizationBits == 0 || aFlagQuantized) {
+    return;
+  }
+
+  const float  lMaxValue  = 65535.0f;
+  const size_t lNb        = aPositions.size();
+  const size_t lChunkSize = static_cast<size_t>(1) << aChunkShift;
+
+  aChunks            .reserve((lNb + lChunkSize - 1) >> aChunkShift);
+  aQuantizedPositions.reserve(lNb);
+  aErrorBound = 0.0f;
+
+  for (size_t lBegin=0; lBegin<lNb; lBegin+=lChunkSize) {
+
+    const size_t lEnd = std::min(lBegin + lChunkSize, lNb);
+
+    float lMin[3] = {aPositions[lBegin].x(), aPositions[lBegin].y(), aPositions[lBegin].z()};
+    float lMax[3] = {lMin[0], lMin[1], lMin[2]};
+    for (size_t i=lBegin+1; i<lEnd; ++i) {
+      for (int j=0; j<3; ++j) {
+        lMin[j] = std::min(lMin[j], aPositions[i][j]);
+        lMax[j] = std::max(lMax[j], aPositions[i][j]);
+      }
+    }
+
+    Chunk lChunk;
+    lChunk.aMinimum = Vector3D(lMin[0], lMin[1], lMin[2]);
+    lChunk.aStep    = Vector3D((lMax[0]-lMin[0])/lMaxValue,
+                               (lMax[1]-lMin[1])/lMaxValue,
+                               (lMax[2]-lMin[2])/lMaxValue);
+    aChunks.push_back(lChunk);
+
+    // Rounding to the nearest step: at most half a step on each axis
+    aErrorBound = std::max(aErrorBound, 0.5f*lChunk.aStep.getLength());
+
+    for (size_t i=lBegin; i<lEnd; ++i) {
+      QuantizedPosition lPosition;
+      for (int j=0; j<3; ++j) {
+        const float lStep  = lChunk.aStep[j];
+        const float lValue = (lStep > 0.0f) ? std::floor((aPositions[i][j] - lMin[j])/lStep + 0.5f) : 0.0f;
+        lPosition.aVals[j] = static_cast<unsigned short>(std::min(lValue, lMaxValue));
+      }
+      aQuantizedPositions.push_back(lPosition);
+    }
+  }
+
+  Positions lTmp;
+  aPositions.swap(lTmp);
+
+  aFlagQuantized = true;
+}
+
+// Read the positions written by writeCache.
+// Returns false if the file is corrupted, or if the quantization
+// of the cached positions can't be undone
+bool VertexPositions::readCache(FILE* pFilePtr)
+{
+  if (!readCacheValue(pFilePtr, aFlagQuantized)) {
+    return false;
+  }
+
+  if (aFlagQuantized) {
+    return (gQuantizationBits != 0                         &&
+            readCacheVector(pFilePtr, aChunks            ) &&
+            readCacheValue (pFilePtr, aErrorBound        ) &&
+            readCacheVector(pFilePtr, aQuantizedPositions));
+  }
+  return readCacheVector(pFilePtr, aPositions);
+}
+
+// Make room for pNb more positions. Quantized positions are
+// decoded by the next addPosition, so nothing is reserved then
+void VertexPositions::reserve(const size_t pNb)
+{
+  if (!aFlagQuantized) {
+    aPositions.reserve(aPositions.size() + pNb);
+  }
+}
+
+// Write the positions in the parse cache file
+// Returns false on a write error
+bool VertexPositions::writeCache(FILE* pFilePtr) const
+{
+  if (!writeCacheValue(pFilePtr, aFlagQuantized)) {
+    return false;
+  }
+
+  if (aFlagQuantized) {
+    return (writeCacheVector(pFilePtr, aChunks            ) &&
+            writeCacheValue (pFilePtr, aErrorBound        ) &&
+            writeCacheVector(pFilePtr, aQuantizedPositions));
+  }
+  return writeCacheVector(pFilePtr, aPositions);
+}
@@ -0,0 +1,116 @@
+//  glv - OpenGL viewer command line tool
+/*****************************************************************************
+ * Copyright (C) 2003 Patrick Lagace <bl4cklight@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *****************************************************************************/
+
+#ifndef VERTEXPOSITIONS_H
+#define VERTEXPOSITIONS_H
+
+#include "mapped_utils.h"
+#include "Vector3D.h"
+#include <stdio.h>
+
+// Enables the quantization of the vertices frozen afterwards,
+// on pBits bits per coordinate. Only 16 is supported; 0 (the
+// default) disables the quantization.
+void setPositionQuantization(const int pBits);
+
+// Positions of the vertices of a VertexAccumulator. Once quantized,
+// the positions are split in chunks of consecutive vertices (close
+// to each other in most meshes and scans), and each coordinate is
+// stored on 16 bits relative to the bounding box of its chunk: 6
+// bytes per vertex instead of 12. The positions are decoded when
+// read, with the scale and the offset of their chunk.
+class VertexPositions
+{
+public:
+
+  VertexPositions ();
+  ~VertexPositions();
+
+  void      addPosition         (const Vector3D& pPosition);
+
+  size_t    compact             ();
+
+  bool      empty               () const {
+    return size() == 0;
+  }
+
+  float     getErrorBound       () const;
+
+  size_t    getMemoryCapacity   () const;
+  size_t    getMemorySize       () const;
+
+  bool      isQuantized         () const;
+
+  void      prefetch            () const;
+
+  void      quantize            ();
+
+  bool      readCache           (FILE*           pFilePtr);
+
+  void      reserve             (const size_t    pNb);
+
+  size_t    size                () const {
+    return aFlagQuantized ? aQuantizedPositions.size() : aPositions.size();
+  }
+
+  bool      writeCache          (FILE*           pFilePtr) const;
+
+  Vector3D operator[](const size_t pIndex) const {
+    if (!aFlagQuantized) {
+      return aPositions[pIndex];
+    }
+    const Chunk&             lChunk    = aChunks[pIndex >> aChunkShift];
+    const QuantizedPosition& lPosition = aQuantizedPositions[pIndex];
+    return Vector3D(lChunk.aMinimum.x() + lPosition.aVals[0]*lChunk.aStep.x(),
+                    lChunk.aMinimum.y() + lPosition.aVals[1]*lChunk.aStep.y(),
+                    lChunk.aMinimum.z() + lPosition.aVals[2]*lChunk.aStep.z());
+  }
+
+private:
+
+  // Block the use of those
+  VertexPositions(const VertexPositions&);
+  VertexPositions& operator=(const VertexPositions&);
+
+  // Offset and scale of the quantized coordinates of a chunk
+  struct Chunk {
+    Vector3D aMinimum;
+    Vector3D aStep;
+  };
+
+  struct QuantizedPosition {
+    unsigned short aVals[3];
+  };
+
+  typedef  MappedVector<Chunk>::Type              Chunks;
+  typedef  MappedVector<Vector3D>::Type           Positions;
+  typedef  MappedVector<QuantizedPosition>::Type  QuantizedPositions;
+
+  static const unsigned int aChunkShift;
+
+  Chunks              aChunks;
+  float               aErrorBound; // Largest distance between a position and its quantized version
+  bool                aFlagQuantized;
+  Positions           aPositions;
+  QuantizedPositions  aQuantizedPositions;
+
+};
+
+#endif // VERTEXPOSITIONS_H
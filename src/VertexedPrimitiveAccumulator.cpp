@@ -19,29 +19,71 @@
  *****************************************************************************/
 
 #include "VertexedPrimitiveAccumulator.h"
+#include "arena_utils.h"
 #include "VertexAccumulator.h"
-#include "limits_glv.h"
+#include "cache_utils.h"
 #include "PrimitiveAccumulator.h"
+#include "SoftwareRasterizer.h"
+#include "VertexClustering.h"
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <cstdio>
-#include <limits>
+
+// Maximum number of triangles in a cluster. Each cluster has its own
+// display list, so it must stay large enough for the display list
+// calls to be cheap, but small enough for its faces to be culled
+// together
+const VertexedPrimitiveAccumulator::SizeType VertexedPrimitiveAccumulator::aClusterSize = 1024;
+
+// Triangle sorted during the construction of the clusters: along
+// a Morton curve in the BoundingBox, then by facing in each chunk
+struct VertexedPrimitiveAccumulator::ClusterItem {
+  int          aFacing;
+  unsigned int aMortonCode;
+  SizeType     aIndex;
+
+  bool operator<(const ClusterItem& pItem) const {
+    if (aFacing != pItem.aFacing) {
+      return aFacing < pItem.aFacing;
+    }
+    return aMortonCode < pItem.aMortonCode;
+  }
+
+  static bool isMortonLess(const ClusterItem& pItem1,
+                           const ClusterItem& pItem2) {
+    return pItem1.aMortonCode < pItem2.aMortonCode;
+  }
+};
 
 VertexedPrimitiveAccumulator::VertexedPrimitiveAccumulator(VertexAccumulator& pVertexes)
   : aBoundingBox                (),
+    aClusters                   (),
+    aClustersGLDisplayLists     (),
+    aClustering                 (0),
+    aClusteringColored          (false),
+    aClusteringVertices         (),
     aColors                     (pVertexes.getColors()),
+    aGLDisplayListBoundingBox   (0),
+    aGLDisplayListFast          (0),
+    aGLDisplayListFull          (0),
+    aGLDisplayListFullExceptTriangles(0),
     aLines                      (),
     aLinesBBoxCounter           (0),
+    aLinesClusteringCounter     (0),
     aPoints                     (),
     aPointsBBoxCounter          (0),
+    aPointsClusteringCounter    (0),
     aQuads                      (),
     aQuadsBBoxCounter           (0),
+    aQuadsClusteringCounter     (0),
     aNormals                    (pVertexes.getNormals()),
     aSimplified                 (),
     aSimplifiedDirty            (true),
     aSimplifiedSelf             (false),
     aTriangles                  (),
     aTrianglesBBoxCounter       (0),
+    aTrianglesClusteringCounter (0),
     aVertices                   (pVertexes.getVertices()),
     aPrimitiveOptimizerValue    (100),
     aVertexAccumulator          (pVertexes)
@@ -52,10 +94,25 @@ VertexedPrimitiveAccumulator::VertexedPrimitiveAccumulator(VertexAccumulator& pV
 
 VertexedPrimitiveAccumulator::~VertexedPrimitiveAccumulator()
 {
-  GLV_ASSERT(aSimplified != 0);
+  deleteDisplayLists();
+  resetClustering();
+
+  // Might have been released by compact
   delete aSimplified;
 }
 
+// The VertexedPrimitiveAccumulators are nodes of the scene, see arena_utils.h
+void* VertexedPrimitiveAccumulator::operator new(size_t pBytes)
+{
+  return allocateArena(pBytes);
+}
+
+void VertexedPrimitiveAccumulator::operator delete(void*  pPtr,
+                                                   size_t pBytes)
+{
+  deallocateArena(pPtr, pBytes);
+}
+
 // Returns false if one of the parameters
 // is out of range
 bool VertexedPrimitiveAccumulator::addLine(const int pP1,
@@ -158,20 +215,277 @@ bool VertexedPrimitiveAccumulator::addTriangle(const int pP1,
   return lIndicesOk;
 }
 
-#ifdef GLV_DUMP_MEMORY_USAGE
+// Add to pSum the mean color of the vertices once per primitive,
+// when the vertices are colored, and count the primitives
+void VertexedPrimitiveAccumulator::addColors(Vector3D& pSum,
+                                             double&   pNbColored,
+                                             double&   pNbUncolored) const
+{
+  const double lNbPrimitives = (aLines.size() + aPoints.size() + aQuads.size() + aTriangles.size());
+
+  if (aColors.size() != aVertices.size() || aColors.empty()) {
+    pNbUncolored += lNbPrimitives;
+    return;
+  }
+
+  Vector3D lSum;
+
+  VertexAccumulator::Colors::const_iterator       lIterColors    = aColors.begin();
+  const VertexAccumulator::Colors::const_iterator lIterColorsEnd = aColors.end  ();
+
+  while (lIterColors != lIterColorsEnd) {
+    lSum += *lIterColors;
+    ++lIterColors;
+  }
 
-template <class Container>
-inline
-std::string getStringSizeAndCapacity(const Container& pContainer)
+  pSum       += lSum*static_cast<float>(lNbPrimitives/aColors.size());
+  pNbColored += lNbPrimitives;
+}
+
+// Interleaves the bits of the position of pPoint in pBoundingBox,
+// quantized on 10 bits per axis: the points close to each other
+// are mostly close in the order of their codes
+static unsigned int getMortonCode(const Vector3D&    pPoint,
+                                  const BoundingBox& pBoundingBox)
+{
+  const Vector3D lMinimum = pBoundingBox.getMinimum();
+  const Vector3D lExtent  = pBoundingBox.getMaximum() - lMinimum;
+
+  unsigned int lCode = 0;
+
+  for (int lAxis=0; lAxis<3; ++lAxis) {
+
+    unsigned int lCell = 0;
+
+    if (lExtent[lAxis] > 0.0f) {
+      const float lPosition = 1024.0f*(pPoint[lAxis] - lMinimum[lAxis])/lExtent[lAxis];
+      lCell = static_cast<unsigned int>(std::max(0.0f, std::min(1023.0f, lPosition)));
+    }
+
+    for (int lBit=0; lBit<10; ++lBit) {
+      lCode |= ((lCell >> lBit) & 1u) << (3*lBit + lAxis);
+    }
+  }
+
+  return lCode;
+}
+
+// Release the memory that isn't needed once the accumulator is
+// complete (at object_end): the unused capacity of the vectors, and
+// the simplified model, which is constructed again if it is used.
+// Returns the number of bytes released
+size_t VertexedPrimitiveAccumulator::compact()
 {
-  char lSizeAndCapacity[128];
-  sprintf(lSizeAndCapacity,"%d/%d",
-          sizeof(typename Container::value_type)*pContainer.size(),
-          sizeof(typename Container::value_type)*pContainer.capacity());
-  return std::string(lSizeAndCapacity);
+  size_t lReleased = (shrinkToFit(aLines             ) +
+                      shrinkToFit(aPoints            ) +
+                      shrinkToFit(aQuads             ) +
+                      shrinkToFit(aTriangles         ) +
+                      shrinkToFit(aClusters          ) +
+                      shrinkToFit(aClusteringVertices));
+
+  if (aSimplifiedDirty && aSimplified != 0) {
+    delete aSimplified;
+    aSimplified = 0;
+    lReleased  += sizeof(PrimitiveAccumulator);
+  }
+
+  return lReleased;
+}
+
+// Sort aTriangles in clusters of at most aClusterSize triangles that
+// have the same facing and are close to each other, so that a whole
+// cluster facing away from the camera can be skipped (see
+// renderClusters). Called once the accumulator is complete (at
+// object_end)
+void VertexedPrimitiveAccumulator::constructClusters()
+{
+  deleteDisplayLists();
+
+  aClusters.clear();
+  aClustersGLDisplayLists.clear();
+
+  // Not worth it for a few clusters
+  if (aTriangles.size() <= 2*aClusterSize) {
+    return;
+  }
+
+  // The triangles are reordered below, so the counters of
+  // the clustering wouldn't match them anymore
+  resetClustering();
+  aSimplifiedDirty = true;
+
+  const BoundingBox& lBoundingBox = getBoundingBox();
+
+  std::vector<ClusterItem> lItems(aTriangles.size());
+
+  for (SizeType i=0; i<aTriangles.size(); ++i) {
+    lItems[i].aFacing     = NormalCone::getFacing(aTriangles[i].getFaceNormal(aVertices));
+    lItems[i].aMortonCode = getMortonCode(aTriangles[i].getBarycenter(aVertices), lBoundingBox);
+    lItems[i].aIndex      = i;
+  }
+
+  // Chunks of triangles close to each other, split by facing
+  std::sort(lItems.begin(), lItems.end(), ClusterItem::isMortonLess);
+
+  for (SizeType lChunk=0; lChunk<lItems.size(); lChunk+=aClusterSize) {
+    std::sort(lItems.begin() + lChunk,
+              lItems.begin() + std::min(lChunk + aClusterSize, lItems.size()));
+  }
+
+  std::vector<SizeType> lSources(lItems.size());
+
+  for (SizeType i=0; i<lItems.size(); ++i) {
+    lSources[i] = lItems[i].aIndex;
+  }
+
+  aTriangles.permute(lSources);
+
+  std::vector<Vector3D> lFaceNormals;
+  SizeType              lBegin = 0;
+
+  while (lBegin < lItems.size()) {
+
+    const SizeType lChunkEnd = std::min(lBegin - lBegin%aClusterSize + aClusterSize, lItems.size());
+    SizeType       lEnd      = lBegin + 1;
+
+    while (lEnd < lChunkEnd && lItems[lEnd].aFacing == lItems[lBegin].aFacing) {
+      ++lEnd;
+    }
+
+    Cluster lCluster;
+    lCluster.aBegin = lBegin;
+    lCluster.aEnd   = lEnd;
+
+    lFaceNormals.clear();
+
+    for (SizeType i=lBegin; i<lEnd; ++i) {
+      const Triangle& lTriangle = aTriangles[i];
+
+      lCluster.aBoundingBox += aVertices[lTriangle.aP1];
+      lCluster.aBoundingBox += aVertices[lTriangle.aP2];
+      lCluster.aBoundingBox += aVertices[lTriangle.aP3];
+      lFaceNormals.push_back(lTriangle.getFaceNormal(aVertices));
+    }
+
+    lCluster.aNormalCone.construct(lFaceNormals);
+    aClusters.push_back(lCluster);
+
+    lBegin = lEnd;
+  }
+
+  aClustersGLDisplayLists.resize(aClusters.size(), 0);
 }
 
-#endif // #ifdef  GLV_DUMP_MEMORY_USAGE
+// Record the rendering of pParams.aRenderMode in a display list
+// used by renderDisplayList. Nothing is done if the display list
+// already exists. Must not be called while another display list
+// is being recorded
+void VertexedPrimitiveAccumulator::constructDisplayList(const RenderParameters& pParams)
+{
+  // The level of detail depends on the view: only the display
+  // list of the accumulator at the current level is recorded
+  if (pParams.aRenderMode == RenderParameters::renderMode_level_of_detail) {
+    RenderParameters lParams = pParams;
+    lParams.aRenderMode      = RenderParameters::renderMode_full;
+
+    PrimitiveAccumulator* lSimplified = getSimplified(pParams.getLevelOfDetail(getBoundingBox()));
+
+    if (lSimplified != 0) {
+      lSimplified->constructDisplayList(lParams);
+    }
+    else {
+      constructDisplayList(lParams);
+    }
+    return;
+  }
+
+  GLuint& lGLDisplayList = getGLDisplayList(pParams);
+
+  // The clusters have their own display lists, called by the
+  // one of the accumulator or one by one by renderClusters
+  const bool lFlagClusters = (pParams.aRenderMode == RenderParameters::renderMode_full &&
+                              !aClusters.empty());
+
+  if (lFlagClusters) {
+
+    if (aGLDisplayListFullExceptTriangles == 0) {
+
+      aGLDisplayListFullExceptTriangles = glGenLists(1);
+
+      if (aGLDisplayListFullExceptTriangles != 0) {
+        glNewList(aGLDisplayListFullExceptTriangles, GL_COMPILE);
+        renderFullExceptTriangles(pParams);
+        glEndList();
+      }
+    }
+
+    GLV_ASSERT(aClustersGLDisplayLists.size() == aClusters.size());
+
+    for (SizeType i=0; i<aClusters.size(); ++i) {
+      if (aClustersGLDisplayLists[i] == 0) {
+
+        aClustersGLDisplayLists[i] = glGenLists(1);
+
+        if (aClustersGLDisplayLists[i] != 0) {
+          glNewList(aClustersGLDisplayLists[i], GL_COMPILE);
+          renderTriangles(aClusters[i].aBegin, aClusters[i].aEnd);
+          glEndList();
+        }
+      }
+    }
+  }
+
+  if (lGLDisplayList == 0) {
+    lGLDisplayList = glGenLists(1);
+
+    if (lGLDisplayList != 0) {
+      glNewList(lGLDisplayList, GL_COMPILE);
+      if (lFlagClusters) {
+        renderClusters(pParams, false, 0, Vector3D());
+      }
+      else {
+        render(pParams);
+      }
+      glEndList();
+    }
+  }
+}
+
+// Delete the display lists. Used when the OpenGL context changes
+void VertexedPrimitiveAccumulator::deleteDisplayLists()
+{
+  if (aGLDisplayListFull != 0) {
+    glDeleteLists(aGLDisplayListFull, 1);
+    aGLDisplayListFull = 0;
+  }
+  if (aGLDisplayListBoundingBox != 0) {
+    glDeleteLists(aGLDisplayListBoundingBox, 1);
+    aGLDisplayListBoundingBox = 0;
+  }
+  if (aGLDisplayListFast != 0) {
+    glDeleteLists(aGLDisplayListFast, 1);
+    aGLDisplayListFast = 0;
+  }
+  if (aGLDisplayListFullExceptTriangles != 0) {
+    glDeleteLists(aGLDisplayListFullExceptTriangles, 1);
+    aGLDisplayListFullExceptTriangles = 0;
+  }
+
+  GLDisplayLists::iterator       lIter    = aClustersGLDisplayLists.begin();
+  const GLDisplayLists::iterator lIterEnd = aClustersGLDisplayLists.end  ();
+
+  while (lIter != lIterEnd) {
+    if (*lIter != 0) {
+      glDeleteLists(*lIter, 1);
+      *lIter = 0;
+    }
+    ++lIter;
+  }
+
+  if (aSimplified != 0) {
+    aSimplified->deleteDisplayLists();
+  }
+}
 
 // Dump in ASCII the caracteristics of the VertexedPrimitiveAccumulator
 void VertexedPrimitiveAccumulator::dumpCharacteristics(std::ostream&       pOstream,
@@ -190,7 +504,7 @@ void VertexedPrimitiveAccumulator::dumpCharacteristics(std::ostream&       pOstr
   aBoundingBox.dumpCharacteristics(pOstream, lIndentation, pTransformation);
 
 #ifdef GLV_DUMP_SIMPLICATION
-  if (!aSimplifiedSelf) {
+  if (!aSimplifiedSelf && aSimplified != 0) {
     pOstream << lIndentation << "Simplified "  << std::endl;
     aSimplified->dumpCharacteristics(pOstream, lIndentation + "  ", pTransformation);
   }
@@ -205,6 +519,7 @@ void VertexedPrimitiveAccumulator::dumpCharacteristics(std::ostream&       pOstr
     pOstream << lIndentation << "Memory used by aLines     = " << getStringSizeAndCapacity(aLines    ) << std::endl;
     pOstream << lIndentation << "Memory used by aTriangles = " << getStringSizeAndCapacity(aTriangles) << std::endl;
     pOstream << lIndentation << "Memory used by aQuads     = " << getStringSizeAndCapacity(aQuads    ) << std::endl;
+    pOstream << lIndentation << "Memory used by aClusters  = " << getStringSizeAndCapacity(aClusters ) << std::endl;
 
   }
 #endif // #ifdef GLV_DUMP_MEMORY_USAGE
@@ -215,6 +530,27 @@ void VertexedPrimitiveAccumulator::dumpCharacteristics(std::ostream&       pOstr
   pOstream << lIndentation << "Number of quad_v     = " << aQuads     .size() << std::endl;
 }
 
+// Make room for the primitives announced by the count of a raw section
+void VertexedPrimitiveAccumulator::reserveLines(const size_t pNbLines)
+{
+  aLines.reserve(aLines.size() + pNbLines);
+}
+
+void VertexedPrimitiveAccumulator::reservePoints(const size_t pNbPoints)
+{
+  aPoints.reserve(aPoints.size() + pNbPoints);
+}
+
+void VertexedPrimitiveAccumulator::reserveQuads(const size_t pNbQuads)
+{
+  aQuads.reserve(aQuads.size() + pNbQuads);
+}
+
+void VertexedPrimitiveAccumulator::reserveTriangles(const size_t pNbTriangles)
+{
+  aTriangles.reserve(aTriangles.size() + pNbTriangles);
+}
+
 const BoundingBox& VertexedPrimitiveAccumulator::getBoundingBox() const
 {
 
@@ -288,6 +624,19 @@ const BoundingBox& VertexedPrimitiveAccumulator::getBoundingBox() const
   return aBoundingBox;
 }
 
+// Return the VertexAccumulator given at construction
+const VertexAccumulator& VertexedPrimitiveAccumulator::getVertexAccumulator() const
+{
+  return aVertexAccumulator;
+}
+
+// Returns true if the triangles are split in clusters
+// (see constructClusters)
+bool VertexedPrimitiveAccumulator::hasClusters() const
+{
+  return !aClusters.empty();
+}
+
 void VertexedPrimitiveAccumulator::computeNormals()
 {
   GLV_ASSERT(aNormals.size() != aVertices.size() || aVertices.size() == 0);
@@ -295,8 +644,9 @@ void VertexedPrimitiveAccumulator::computeNormals()
   const Vector3D lNullVector     (0.0f, 0.0f, 0.0f);
   const Vector3D lArbitraryNormal(1.0f, 0.0f, 0.0f);
 
-  aNormals.resize(aVertices.size());
-  std::fill(aNormals.begin(), aNormals.end(), lNullVector);
+  // The sums are kept apart from aNormals, whose type may not
+  // keep their length (see StoredNormal)
+  std::vector<Vector3D> lSums(aVertices.size(), lNullVector);
 
   Quads::const_iterator       lIterQuads    = aQuads.begin();
   const Quads::const_iterator lIterQuadsEnd = aQuads.end  ();
@@ -322,10 +672,10 @@ void VertexedPrimitiveAccumulator::computeNormals()
     // We do not normalize the normals at this points
     // This plays the role of weights giving more
     // importance to bigger polygons
-    aNormals[lQuad.aP1] += lN1;
-    aNormals[lQuad.aP2] += lN2;
-    aNormals[lQuad.aP3] += lN3;
-    aNormals[lQuad.aP4] += lN4;
+    lSums[lQuad.aP1] += lN1;
+    lSums[lQuad.aP2] += lN2;
+    lSums[lQuad.aP3] += lN3;
+    lSums[lQuad.aP4] += lN4;
 
     ++lIterQuads;
   }
@@ -349,21 +699,21 @@ void VertexedPrimitiveAccumulator::computeNormals()
     // We do not normalize the normals at this points
     // This plays the role of weights giving more
     // importance to bigger polygons
-    aNormals[lTriangle.aP1] += lN;
-    aNormals[lTriangle.aP2] += lN;
-    aNormals[lTriangle.aP3] += lN;
+    lSums[lTriangle.aP1] += lN;
+    lSums[lTriangle.aP2] += lN;
+    lSums[lTriangle.aP3] += lN;
 
     ++lIterTriangles;
   }
 
-  Normals::iterator       lIterNormals    = aNormals.begin();
-  const Normals::iterator lIterNormalsEnd = aNormals.end  ();
+  std::vector<Vector3D>::iterator       lIterSums    = lSums.begin();
+  const std::vector<Vector3D>::iterator lIterSumsEnd = lSums.end  ();
 
-  while (lIterNormals != lIterNormalsEnd) {
+  while (lIterSums != lIterSumsEnd) {
     // There is the possibility that a vertex doesn't
     // have adjacent Quads or Triangles. So we have to
     // check that
-    Vector3D& lNormal = *lIterNormals;
+    Vector3D& lNormal = *lIterSums;
     if (!(lNormal == lNullVector)) {
       lNormal.normalize();
     }
@@ -375,8 +725,201 @@ void VertexedPrimitiveAccumulator::computeNormals()
       // for the normal
       lNormal = lArbitraryNormal;
     }
-    ++lIterNormals;
+    ++lIterSums;
   }
+
+  aNormals.assign(lSums.begin(), lSums.end());
+}
+
+// Renders the full content with pRasterizer instead of
+// OpenGL, in the same order as renderFull
+void VertexedPrimitiveAccumulator::rasterize(SoftwareRasterizer&     pRasterizer,
+                                             const RenderParameters& pParams)
+{
+  if (pParams.aFlagSmoothNormals == true) {
+    if (aNormals.size() != aVertices.size()) {
+      computeNormals();
+    }
+  }
+
+  SoftwareRasterizer::State& lState     = pRasterizer.getState();
+  const bool                 lUseColors  = (aColors.size() == aVertices.size() && !aColors.empty());
+  const bool                 lUseNormals = (aNormals.size() == aVertices.size() && !aNormals.empty());
+
+  // Facets frame
+  if(pParams.aFlagRenderFacetFrame) {
+
+    const SoftwareRasterizer::State lSavedState = lState;
+    const Vector3D                  lC(pParams.aFacetBoundaryR, pParams.aFacetBoundaryG, pParams.aFacetBoundaryB);
+
+    lState.aLineWidth = 1.0f;
+
+    Quads::const_iterator       lIterQuads    = aQuads.begin();
+    const Quads::const_iterator lIterQuadsEnd = aQuads.end  ();
+
+    while (lIterQuads != lIterQuadsEnd) {
+      const Vector3D& lP1 = aVertices[lIterQuads->aP1];
+      const Vector3D& lP2 = aVertices[lIterQuads->aP2];
+      const Vector3D& lP3 = aVertices[lIterQuads->aP3];
+      const Vector3D& lP4 = aVertices[lIterQuads->aP4];
+
+      pRasterizer.drawLine(lP1, lC, lP2, lC);
+      pRasterizer.drawLine(lP2, lC, lP3, lC);
+      pRasterizer.drawLine(lP3, lC, lP4, lC);
+      pRasterizer.drawLine(lP4, lC, lP1, lC);
+      ++lIterQuads;
+    }
+
+    Triangles::const_iterator       lIterTriangles    = aTriangles.begin();
+    const Triangles::const_iterator lIterTrianglesEnd = aTriangles.end  ();
+
+    while (lIterTriangles != lIterTrianglesEnd) {
+      const Vector3D& lP1 = aVertices[lIterTriangles->aP1];
+      const Vector3D& lP2 = aVertices[lIterTriangles->aP2];
+      const Vector3D& lP3 = aVertices[lIterTriangles->aP3];
+
+      pRasterizer.drawLine(lP1, lC, lP2, lC);
+      pRasterizer.drawLine(lP2, lC, lP3, lC);
+      pRasterizer.drawLine(lP3, lC, lP1, lC);
+      ++lIterTriangles;
+    }
+
+    lState = lSavedState;
+  }
+
+  // Lines
+  {
+    Lines::const_iterator       lIterLines    = aLines.begin();
+    const Lines::const_iterator lIterLinesEnd = aLines.end  ();
+
+    while (lIterLines != lIterLinesEnd) {
+      const Line& lLine = *lIterLines;
+
+      if (lUseColors) {
+        pRasterizer.drawLine(aVertices[lLine.aP1], aColors[lLine.aP1],
+                             aVertices[lLine.aP2], aColors[lLine.aP2]);
+        lState.aColor = aColors[lLine.aP2];
+      }
+      else {
+        pRasterizer.drawLine(aVertices[lLine.aP1], lState.aColor,
+                             aVertices[lLine.aP2], lState.aColor);
+      }
+      ++lIterLines;
+    }
+  }
+
+  // Points
+  {
+    Points::const_iterator       lIterPoints    = aPoints.begin();
+    const Points::const_iterator lIterPointsEnd = aPoints.end  ();
+
+    while (lIterPoints != lIterPointsEnd) {
+      const Point& lPoint = *lIterPoints;
+
+      if (lUseColors) {
+        pRasterizer.drawPoint(aVertices[lPoint.aP], aColors[lPoint.aP]);
+        lState.aColor = aColors[lPoint.aP];
+      }
+      else {
+        pRasterizer.drawPoint(aVertices[lPoint.aP], lState.aColor);
+      }
+      ++lIterPoints;
+    }
+  }
+
+  // Quads
+  {
+    Quads::const_iterator       lIterQuads    = aQuads.begin();
+    const Quads::const_iterator lIterQuadsEnd = aQuads.end  ();
+
+    while (lIterQuads != lIterQuadsEnd) {
+      const Quad&     lQuad = *lIterQuads;
+      const Vector3D& lP1   = aVertices[lQuad.aP1];
+      const Vector3D& lP2   = aVertices[lQuad.aP2];
+      const Vector3D& lP3   = aVertices[lQuad.aP3];
+      const Vector3D& lP4   = aVertices[lQuad.aP4];
+
+      const Vector3D lN1 = lUseNormals ? Vector3D(aNormals[lQuad.aP1]) : (lP2-lP1).crossProduct(lP4-lP1);
+      const Vector3D lN2 = lUseNormals ? Vector3D(aNormals[lQuad.aP2]) : (lP3-lP2).crossProduct(lP1-lP2);
+      const Vector3D lN3 = lUseNormals ? Vector3D(aNormals[lQuad.aP3]) : (lP4-lP3).crossProduct(lP2-lP3);
+      const Vector3D lN4 = lUseNormals ? Vector3D(aNormals[lQuad.aP4]) : (lP1-lP4).crossProduct(lP3-lP4);
+
+      const Vector3D lC1 = lUseColors  ? Vector3D(aColors [lQuad.aP1]) : lState.aColor;
+      const Vector3D lC2 = lUseColors  ? Vector3D(aColors [lQuad.aP2]) : lState.aColor;
+      const Vector3D lC3 = lUseColors  ? Vector3D(aColors [lQuad.aP3]) : lState.aColor;
+      const Vector3D lC4 = lUseColors  ? Vector3D(aColors [lQuad.aP4]) : lState.aColor;
+
+      pRasterizer.drawQuad(lP1, lN1, lC1,
+                           lP2, lN2, lC2,
+                           lP3, lN3, lC3,
+                           lP4, lN4, lC4);
+      lState.aColor = lC4;
+      ++lIterQuads;
+    }
+  }
+
+  // Triangles
+  {
+    Triangles::const_iterator       lIterTriangles    = aTriangles.begin();
+    const Triangles::const_iterator lIterTrianglesEnd = aTriangles.end  ();
+
+    while (lIterTriangles != lIterTrianglesEnd) {
+      const Triangle& lTriangle = *lIterTriangles;
+      const Vector3D& lP1       = aVertices[lTriangle.aP1];
+      const Vector3D& lP2       = aVertices[lTriangle.aP2];
+      const Vector3D& lP3       = aVertices[lTriangle.aP3];
+      const Vector3D  lN        = (lP2-lP1).crossProduct(lP3-lP1);
+
+      const Vector3D lN1 = lUseNormals ? Vector3D(aNormals[lTriangle.aP1]) : lN;
+      const Vector3D lN2 = lUseNormals ? Vector3D(aNormals[lTriangle.aP2]) : lN;
+      const Vector3D lN3 = lUseNormals ? Vector3D(aNormals[lTriangle.aP3]) : lN;
+
+      const Vector3D lC1 = lUseColors  ? Vector3D(aColors [lTriangle.aP1]) : lState.aColor;
+      const Vector3D lC2 = lUseColors  ? Vector3D(aColors [lTriangle.aP2]) : lState.aColor;
+      const Vector3D lC3 = lUseColors  ? Vector3D(aColors [lTriangle.aP3]) : lState.aColor;
+
+      pRasterizer.drawTriangle(lP1, lN1, lC1,
+                               lP2, lN2, lC2,
+                               lP3, lN3, lC3);
+      lState.aColor = lC3;
+      ++lIterTriangles;
+    }
+  }
+}
+
+// Read the primitives written by writeCache. The vertices
+// are read by the VertexAccumulator given at construction.
+// Returns false if the file is corrupted
+bool VertexedPrimitiveAccumulator::readCache(FILE* pFilePtr)
+{
+  const bool lOk = (readCacheVector(pFilePtr, aLines    ) &&
+                    readCacheVector(pFilePtr, aPoints   ) &&
+                    readCacheVector(pFilePtr, aQuads    ) &&
+                    readCacheVector(pFilePtr, aTriangles) &&
+                    readCacheVector(pFilePtr, aClusters ));
+
+  resetClustering();
+  aSimplifiedDirty = true;
+
+  if (!lOk) {
+    return false;
+  }
+
+  // Make sure that the clusters match the triangles
+  Clusters::const_iterator       lIterClusters    = aClusters.begin();
+  const Clusters::const_iterator lIterClustersEnd = aClusters.end  ();
+
+  while (lIterClusters != lIterClustersEnd) {
+    if (lIterClusters->aBegin > lIterClusters->aEnd ||
+        lIterClusters->aEnd   > aTriangles.size()) {
+      return false;
+    }
+    ++lIterClusters;
+  }
+
+  aClustersGLDisplayLists.assign(aClusters.size(), 0);
+
+  return true;
 }
 
 void VertexedPrimitiveAccumulator::render(const RenderParameters& pParams)
@@ -393,12 +936,98 @@ void VertexedPrimitiveAccumulator::render(const RenderParameters& pParams)
   case RenderParameters::renderMode_fast:
     renderSimplified(pParams);
     break;
+  case RenderParameters::renderMode_level_of_detail:
+    renderLevelOfDetail(pParams, false);
+    break;
   default:
     // Should not happen!
     GLV_ASSERT(false);
   }
 }
 
+// Same as render, but with the display list built by
+// constructDisplayList when it exists
+void VertexedPrimitiveAccumulator::renderDisplayList(const RenderParameters& pParams)
+{
+  if (pParams.aRenderMode == RenderParameters::renderMode_level_of_detail) {
+    renderLevelOfDetail(pParams, true);
+    return;
+  }
+
+  const GLuint lGLDisplayList = getGLDisplayList(pParams);
+
+  // Only the clusters that are not outside of the frustum, and
+  // not facing away from the camera when OpenGL culls those
+  // faces, are rendered
+  if (pParams.aFlagFrustumCulling                              &&
+      pParams.aRenderMode == RenderParameters::renderMode_full &&
+      !aClusters.empty()) {
+
+    Vector3D  lEye;
+    const int lCulledFaces = (pParams.aFlagRenderFacetFrame ? 0 : NormalCone::getCulledFaces(lEye));
+
+    renderClusters(pParams, true, lCulledFaces, lEye);
+  }
+  else if (lGLDisplayList != 0) {
+    glCallList(lGLDisplayList);
+  }
+  else {
+    render(pParams);
+  }
+}
+
+// Write the primitives in the parse cache file
+// Returns false on a write error
+bool VertexedPrimitiveAccumulator::writeCache(FILE* pFilePtr) const
+{
+  return (writeCacheVector(pFilePtr, aLines    ) &&
+          writeCacheVector(pFilePtr, aPoints   ) &&
+          writeCacheVector(pFilePtr, aQuads    ) &&
+          writeCacheVector(pFilePtr, aTriangles) &&
+          writeCacheVector(pFilePtr, aClusters ));
+}
+
+// Renders everything but the triangles, then the clusters of
+// triangles, with their display lists when they exist. If
+// pFlagCulling is true, the clusters outside of the frustum
+// or whose faces would all be culled by OpenGL are skipped
+// (see NormalCone::getCulledFaces for pCulledFaces and pEye)
+void VertexedPrimitiveAccumulator::renderClusters(const RenderParameters& pParams,
+                                                  const bool              pFlagCulling,
+                                                  const int               pCulledFaces,
+                                                  const Vector3D&         pEye)
+{
+  if (aGLDisplayListFullExceptTriangles != 0) {
+    glCallList(aGLDisplayListFullExceptTriangles);
+  }
+  else {
+    renderFullExceptTriangles(pParams);
+  }
+
+  // The current color after the accumulator doesn't
+  // depend on the clusters culled
+  glPushAttrib(GL_CURRENT_BIT);
+  for (SizeType i=0; i<aClusters.size(); ++i) {
+
+    const Cluster& lCluster = aClusters[i];
+
+    if (pFlagCulling &&
+        (lCluster.aBoundingBox.getFrustumVisibility() == BoundingBox::frustumVisibility_outside ||
+         lCluster.aNormalCone.isCulled(lCluster.aBoundingBox, pEye, pCulledFaces))) {
+      continue;
+    }
+
+    if (i < aClustersGLDisplayLists.size() && aClustersGLDisplayLists[i] != 0) {
+      glCallList(aClustersGLDisplayLists[i]);
+    }
+    else {
+      renderTriangles(lCluster.aBegin, lCluster.aEnd);
+    }
+  }
+
+  glPopAttrib();
+}
+
 // Renders the content of aLines
 void VertexedPrimitiveAccumulator::renderFacetsFrame(const RenderParameters& pParams)
 {
@@ -468,6 +1097,13 @@ void VertexedPrimitiveAccumulator::renderFacetsFrame(const RenderParameters& pPa
 }
 
 void VertexedPrimitiveAccumulator::renderFull(const RenderParameters& pParams)
+{
+  renderFullExceptTriangles(pParams);
+  renderTriangles          (0, aTriangles.size());
+}
+
+// Same as renderFull, without aTriangles (see renderClusters)
+void VertexedPrimitiveAccumulator::renderFullExceptTriangles(const RenderParameters& pParams)
 {
   aPrimitiveOptimizerValue = pParams.aPrimitiveOptimizerValue;
   if (pParams.aFlagSmoothNormals == true) {
@@ -475,11 +1111,19 @@ void VertexedPrimitiveAccumulator::renderFull(const RenderParameters& pParams)
       computeNormals();
     }
   }
+
+  // Read in advance from the disk with a memory budget
+  aVertices.prefetch();
+  prefetchMapped(aColors   , 0, aColors   .size());
+  prefetchMapped(aNormals  , 0, aNormals  .size());
+  prefetchMapped(aLines    , 0, aLines    .size());
+  prefetchMapped(aPoints   , 0, aPoints   .size());
+  prefetchMapped(aQuads    , 0, aQuads    .size());
+
   renderFacetsFrame(pParams);
   renderLines      ();
   renderPoints     ();
   renderQuads      ();
-  renderTriangles  ();
 }
 
 // Renders the content of aLines
@@ -710,54 +1354,70 @@ void VertexedPrimitiveAccumulator::renderQuads()
   }
 }
 
-void VertexedPrimitiveAccumulator::renderSimplified(const RenderParameters& pParams)
+// Renders the accumulator simplified as many times as the level of
+// detail of pParams asks for its size on screen. If pFlagDisplayList
+// is true, the display list of that level is used (and recorded
+// if needed); must not be called while recording a display list then
+void VertexedPrimitiveAccumulator::renderLevelOfDetail(const RenderParameters& pParams,
+                                                       const bool              pFlagDisplayList)
 {
-  // Check if we have to update the Simplified model
-  if (aSimplifiedDirty) {
-    constructSimplified();
+  RenderParameters lParams = pParams;
+  lParams.aRenderMode      = RenderParameters::renderMode_full;
+
+  PrimitiveAccumulator* lSimplified = getSimplified(pParams.getLevelOfDetail(getBoundingBox()));
+
+  if (lSimplified == 0) {
+    if (pFlagDisplayList) {
+      constructDisplayList(lParams);
+      renderDisplayList   (lParams);
+    }
+    else {
+      renderFull(lParams);
+    }
+  }
+  else if (pFlagDisplayList) {
+    lSimplified->constructDisplayList(lParams);
+    lSimplified->renderDisplayList   (lParams);
+  }
+  else {
+    lSimplified->render(lParams);
   }
+}
 
+void VertexedPrimitiveAccumulator::renderSimplified(const RenderParameters& pParams)
+{
   RenderParameters lParams = pParams;
   lParams.aRenderMode      = RenderParameters::renderMode_full;
 
+  PrimitiveAccumulator* lSimplified = getSimplified(pParams.aLevelOfDetail);
+
   // If there is no need for simplication, we
   // just render *this
-  if (aSimplifiedSelf) {
+  if (lSimplified == 0) {
     renderFull(lParams);
   }
   else {
-
-    // We push the attributes on the openGL attribute stack; so
-    // we dont disturb the current values of color (current) or line width (line)
-    glPushAttrib(GL_CURRENT_BIT | GL_LINE_BIT | GL_LIGHTING_BIT);
-    // Warning: performance hit; when a lot of push(GL_LIGHTING_BIT) calls are made
-    glDisable(GL_LIGHTING);
-    glPointSize(3);
-
-    glColor3f(0.7, 0.5, 0.1);
-
-    GLV_ASSERT(aSimplified != 0);
-    aSimplified->render(lParams);
-
-    // Revert the lighting state and the line state
-    glPopAttrib();
+    lSimplified->render(lParams);
   }
 }
 
-// Renders the content of aTriangles
-void VertexedPrimitiveAccumulator::renderTriangles()
+// Renders the triangles pBegin to pEnd-1 of aTriangles
+void VertexedPrimitiveAccumulator::renderTriangles(const SizeType pBegin,
+                                                   const SizeType pEnd)
 {
   int lPrimitiveCount = 0;
 
-  if (aTriangles.size() > 0) {
+  if (pBegin < pEnd) {
+
+    prefetchMapped(aTriangles, pBegin, pEnd);
 
     glBegin(GL_TRIANGLES);
 
     const Vector3D lNullVector     (0.0f, 0.0f, 0.0f);
     const Vector3D lArbitraryNormal(1.0f, 0.0f, 0.0f);
 
-    Triangles::const_iterator       lIterTriangles    = aTriangles.begin();
-    const Triangles::const_iterator lIterTrianglesEnd = aTriangles.end  ();
+    Triangles::const_iterator       lIterTriangles    = aTriangles.begin() + pBegin;
+    const Triangles::const_iterator lIterTrianglesEnd = aTriangles.begin() + pEnd;
 
     while (lIterTriangles != lIterTrianglesEnd) {
 
@@ -843,60 +1503,57 @@ void VertexedPrimitiveAccumulator::renderTriangles()
   }
 }
 
-struct SimplificationPoint
+// Unit normal of the face given by the order of the vertices;
+// null for a degenerated triangle
+Vector3D VertexedPrimitiveAccumulator::Triangle::getFaceNormal(const Vertices& pVertices) const
 {
+  GLV_ASSERT(aP1 >= 0 && aP1 < static_cast<int>(pVertices.size()));
+  GLV_ASSERT(aP2 >= 0 && aP2 < static_cast<int>(pVertices.size()));
+  GLV_ASSERT(aP3 >= 0 && aP3 < static_cast<int>(pVertices.size()));
 
-  SimplificationPoint(const float pX,
-                      const float pY,
-                      const float pZ)
-    : aBarycenterDistance (std::numeric_limits<float>::max()),
-      aPoint              (pX, pY, pZ),
-      aPrimiticeBarycenter()
-    {}
+  Vector3D lNormal = (pVertices[aP2] - pVertices[aP1]).crossProduct(pVertices[aP3] - pVertices[aP1]);
 
-  float     aBarycenterDistance;
-  Vector3D  aPoint;
-  Vector3D  aPrimiticeBarycenter;
+  if (lNormal.getLength() <= 0.0f) {
+    return Vector3D(0.0, 0.0, 0.0);
+  }
 
-};
+  lNormal.normalize();
+  return lNormal;
+}
 
-template <class Container, class Vertices>
-inline void scanForClosest(Container&           pContainer,
-                           SimplificationPoint* pIterSPBegin,
-                           SimplificationPoint* pIterSPEnd,
-                           const Vertices&      aVertices)
+// Returns the cluster of the vertex pVertex; the vertex is
+// added to pClustering the first time only
+static int getVertexCluster(VertexClustering&                  pClustering,
+                            std::vector<int>&                  pVertexClusters,
+                            const VertexAccumulator::Vertices& pVertices,
+                            const VertexAccumulator::Colors&   pColors,
+                            const int                          pVertex)
 {
-  const typename Container::size_type lSize = pContainer.size();
+  GLV_ASSERT(pVertex >= 0 && pVertex < static_cast<int>(pVertices.size()));
 
-  for (typename Container::size_type i=0; i<lSize; ++i) {
+  int& lCluster = pVertexClusters[pVertex];
 
-    const typename Container::value_type&  lPrimitive = pContainer[i];
-    SimplificationPoint*                   lIterSP    = pIterSPBegin;
-
-    while (lIterSP != pIterSPEnd) {
-      SimplificationPoint& lSP         = *lIterSP;
-      const Vector3D       lBarycenter = lPrimitive .getBarycenter(aVertices);
-      const float          lDistance   = lBarycenter.getDistanceTo(lSP.aPoint);
-      if (lDistance < lSP.aBarycenterDistance) {
-        lSP.aPrimiticeBarycenter = lBarycenter;
-        lSP.aBarycenterDistance  = lDistance;
-      }
-      ++lIterSP;
+  if (lCluster < 0) {
+    if (pColors.size() == pVertices.size()) {
+      lCluster = pClustering.addVertexColored(pVertices[pVertex], pColors[pVertex]);
+    }
+    else {
+      lCluster = pClustering.addVertex(pVertices[pVertex]);
     }
   }
+
+  return lCluster;
 }
 
 void VertexedPrimitiveAccumulator::constructSimplified()
 {
-
-  // The simplified model is a set of points located
-  // at the barycenter of a subset of the primitives.
-  // These primitives are chosen so that the
-  // object shape can still be recognise by the user
-  // with a modest number of points.
-  // More precisely, they are the primitives "closest"
-  // to a set of points on a the circumscribed sphere to
-  // the BoundingBox.
+  // The simplified model is made by vertex clustering: the
+  // vertices are merged on a regular grid, and the primitives
+  // that collapse are removed. So the shape and the colors of
+  // the model are kept, with a bounded number of primitives.
+  // The clustering is kept between the updates: only the
+  // primitives added since the last one are clustered, unless
+  // the model outgrew its grid
 
   if (!aSimplifiedDirty) {
     // Just to be safe, should not pass here
@@ -905,183 +1562,76 @@ void VertexedPrimitiveAccumulator::constructSimplified()
   }
   else {
 
-    // Start from scratch
-    GLV_ASSERT(aSimplified != 0);
     delete aSimplified;
-    aSimplified     = new PrimitiveAccumulator(false);
-    aSimplifiedSelf = false;
-
-    // We call getBoundingBox so that it gets updated
-    // if it needs to
-    const BoundingBox& lBoundingBox = getBoundingBox();
-    const Vector3D     lCenter      = lBoundingBox.getCenter();
-    const float        lRadius      = lBoundingBox.getCircumscribedSphereRadius();
-
-    SimplificationPoint unitSphereSampling[] = {
-      SimplificationPoint(-1.0,0.0,0.0),
-      SimplificationPoint(-0.894427191,-0.4472135955,0.0),
-      SimplificationPoint(-0.894427191,0.0,-0.4472135955),
-      SimplificationPoint(-0.894427191,0.0,0.4472135955),
-      SimplificationPoint(-0.894427191,0.4472135955,0.0),
-      SimplificationPoint(-0.816496580928,-0.408248290464,-0.408248290464),
-      SimplificationPoint(-0.816496580928,-0.408248290464,0.408248290464),
-      SimplificationPoint(-0.816496580928,0.408248290464,-0.408248290464),
-      SimplificationPoint(-0.816496580928,0.408248290464,0.408248290464),
-      SimplificationPoint(-0.707106781187,-0.707106781187,0.0),
-      SimplificationPoint(-0.707106781187,0.0,-0.707106781187),
-      SimplificationPoint(-0.707106781187,0.0,0.707106781187),
-      SimplificationPoint(-0.707106781187,0.707106781187,0.0),
-      SimplificationPoint(-0.666666666667,-0.333333333333,-0.666666666667),
-      SimplificationPoint(-0.666666666667,-0.333333333333,0.666666666667),
-      SimplificationPoint(-0.666666666667,-0.666666666667,-0.333333333333),
-      SimplificationPoint(-0.666666666667,-0.666666666667,0.333333333333),
-      SimplificationPoint(-0.666666666667,0.333333333333,-0.666666666667),
-      SimplificationPoint(-0.666666666667,0.333333333333,0.666666666667),
-      SimplificationPoint(-0.666666666667,0.666666666667,-0.333333333333),
-      SimplificationPoint(-0.666666666667,0.666666666667,0.333333333333),
-      SimplificationPoint(-0.57735026919,-0.57735026919,-0.57735026919),
-      SimplificationPoint(-0.57735026919,-0.57735026919,0.57735026919),
-      SimplificationPoint(-0.57735026919,0.57735026919,-0.57735026919),
-      SimplificationPoint(-0.57735026919,0.57735026919,0.57735026919),
-      SimplificationPoint(-0.4472135955,-0.894427191,0.0),
-      SimplificationPoint(-0.4472135955,0.0,-0.894427191),
-      SimplificationPoint(-0.4472135955,0.0,0.894427191),
-      SimplificationPoint(-0.4472135955,0.894427191,0.0),
-      SimplificationPoint(-0.408248290464,-0.408248290464,-0.816496580928),
-      SimplificationPoint(-0.408248290464,-0.408248290464,0.816496580928),
-      SimplificationPoint(-0.408248290464,-0.816496580928,-0.408248290464),
-      SimplificationPoint(-0.408248290464,-0.816496580928,0.408248290464),
-      SimplificationPoint(-0.408248290464,0.408248290464,-0.816496580928),
-      SimplificationPoint(-0.408248290464,0.408248290464,0.816496580928),
-      SimplificationPoint(-0.408248290464,0.816496580928,-0.408248290464),
-      SimplificationPoint(-0.408248290464,0.816496580928,0.408248290464),
-      SimplificationPoint(-0.333333333333,-0.666666666667,-0.666666666667),
-      SimplificationPoint(-0.333333333333,-0.666666666667,0.666666666667),
-      SimplificationPoint(-0.333333333333,0.666666666667,-0.666666666667),
-      SimplificationPoint(-0.333333333333,0.666666666667,0.666666666667),
-      SimplificationPoint(0.0,-0.4472135955,-0.894427191),
-      SimplificationPoint(0.0,-0.4472135955,0.894427191),
-      SimplificationPoint(0.0,-0.707106781187,-0.707106781187),
-      SimplificationPoint(0.0,-0.707106781187,0.707106781187),
-      SimplificationPoint(0.0,-0.894427191,-0.4472135955),
-      SimplificationPoint(0.0,-0.894427191,0.4472135955),
-      SimplificationPoint(0.0,-1.0,0.0),
-      SimplificationPoint(0.0,0.0,-1.0),
-      SimplificationPoint(0.0,0.0,1.0),
-      SimplificationPoint(0.0,0.4472135955,-0.894427191),
-      SimplificationPoint(0.0,0.4472135955,0.894427191),
-      SimplificationPoint(0.0,0.707106781187,-0.707106781187),
-      SimplificationPoint(0.0,0.707106781187,0.707106781187),
-      SimplificationPoint(0.0,0.894427191,-0.4472135955),
-      SimplificationPoint(0.0,0.894427191,0.4472135955),
-      SimplificationPoint(0.0,1.0,0.0),
-      SimplificationPoint(0.333333333333,-0.666666666667,-0.666666666667),
-      SimplificationPoint(0.333333333333,-0.666666666667,0.666666666667),
-      SimplificationPoint(0.333333333333,0.666666666667,-0.666666666667),
-      SimplificationPoint(0.333333333333,0.666666666667,0.666666666667),
-      SimplificationPoint(0.408248290464,-0.408248290464,-0.816496580928),
-      SimplificationPoint(0.408248290464,-0.408248290464,0.816496580928),
-      SimplificationPoint(0.408248290464,-0.816496580928,-0.408248290464),
-      SimplificationPoint(0.408248290464,-0.816496580928,0.408248290464),
-      SimplificationPoint(0.408248290464,0.408248290464,-0.816496580928),
-      SimplificationPoint(0.408248290464,0.408248290464,0.816496580928),
-      SimplificationPoint(0.408248290464,0.816496580928,-0.408248290464),
-      SimplificationPoint(0.408248290464,0.816496580928,0.408248290464),
-      SimplificationPoint(0.4472135955,-0.894427191,0.0),
-      SimplificationPoint(0.4472135955,0.0,-0.894427191),
-      SimplificationPoint(0.4472135955,0.0,0.894427191),
-      SimplificationPoint(0.4472135955,0.894427191,0.0),
-      SimplificationPoint(0.57735026919,-0.57735026919,-0.57735026919),
-      SimplificationPoint(0.57735026919,-0.57735026919,0.57735026919),
-      SimplificationPoint(0.57735026919,0.57735026919,-0.57735026919),
-      SimplificationPoint(0.57735026919,0.57735026919,0.57735026919),
-      SimplificationPoint(0.666666666667,-0.333333333333,-0.666666666667),
-      SimplificationPoint(0.666666666667,-0.333333333333,0.666666666667),
-      SimplificationPoint(0.666666666667,-0.666666666667,-0.333333333333),
-      SimplificationPoint(0.666666666667,-0.666666666667,0.333333333333),
-      SimplificationPoint(0.666666666667,0.333333333333,-0.666666666667),
-      SimplificationPoint(0.666666666667,0.333333333333,0.666666666667),
-      SimplificationPoint(0.666666666667,0.666666666667,-0.333333333333),
-      SimplificationPoint(0.666666666667,0.666666666667,0.333333333333),
-      SimplificationPoint(0.707106781187,-0.707106781187,0.0),
-      SimplificationPoint(0.707106781187,0.0,-0.707106781187),
-      SimplificationPoint(0.707106781187,0.0,0.707106781187),
-      SimplificationPoint(0.707106781187,0.707106781187,0.0),
-      SimplificationPoint(0.816496580928,-0.408248290464,-0.408248290464),
-      SimplificationPoint(0.816496580928,-0.408248290464,0.408248290464),
-      SimplificationPoint(0.816496580928,0.408248290464,-0.408248290464),
-      SimplificationPoint(0.816496580928,0.408248290464,0.408248290464),
-      SimplificationPoint(0.894427191,-0.4472135955,0.0),
-      SimplificationPoint(0.894427191,0.0,-0.4472135955),
-      SimplificationPoint(0.894427191,0.0,0.4472135955),
-      SimplificationPoint(0.894427191,0.4472135955,0.0),
-      SimplificationPoint(1.0,0.0,0.0)
-    };
-
-//     SimplificationPoint unitSphereSampling[] = {
-//       SimplificationPoint(-1.0,0.0,0.0),
-//       SimplificationPoint(-0.707106781187,-0.707106781187,0.0),
-//       SimplificationPoint(-0.707106781187,0.0,-0.707106781187),
-//       SimplificationPoint(-0.707106781187,0.0,0.707106781187),
-//       SimplificationPoint(-0.707106781187,0.707106781187,0.0),
-//       SimplificationPoint(-0.57735026919,-0.57735026919,-0.57735026919),
-//       SimplificationPoint(-0.57735026919,-0.57735026919,0.57735026919),
-//       SimplificationPoint(-0.57735026919,0.57735026919,-0.57735026919),
-//       SimplificationPoint(-0.57735026919,0.57735026919,0.57735026919),
-//       SimplificationPoint(0.0,-0.707106781187,-0.707106781187),
-//       SimplificationPoint(0.0,-0.707106781187,0.707106781187),
-//       SimplificationPoint(0.0,-1.0,0.0),
-//       SimplificationPoint(0.0,0.0,-1.0),
-//       SimplificationPoint(0.0,0.0,1.0),
-//       SimplificationPoint(0.0,0.707106781187,-0.707106781187),
-//       SimplificationPoint(0.0,0.707106781187,0.707106781187),
-//       SimplificationPoint(0.0,1.0,0.0),
-//       SimplificationPoint(0.57735026919,-0.57735026919,-0.57735026919),
-//       SimplificationPoint(0.57735026919,-0.57735026919,0.57735026919),
-//       SimplificationPoint(0.57735026919,0.57735026919,-0.57735026919),
-//       SimplificationPoint(0.57735026919,0.57735026919,0.57735026919),
-//       SimplificationPoint(0.707106781187,-0.707106781187,0.0),
-//       SimplificationPoint(0.707106781187,0.0,-0.707106781187),
-//       SimplificationPoint(0.707106781187,0.0,0.707106781187),
-//       SimplificationPoint(0.707106781187,0.707106781187,0.0),
-//       SimplificationPoint(1.0,0.0,0.0)
-//     };
-
-    SimplificationPoint* lBegin = unitSphereSampling;
-    SimplificationPoint* lIter  = lBegin;
-    SimplificationPoint* lEnd   = unitSphereSampling + (sizeof(unitSphereSampling)/sizeof(SimplificationPoint));
-
-    // Scale the point from the unit sphere to the circumscribed sphere
-    GLV_ASSERT(lBegin != 0);
-    GLV_ASSERT(lEnd   != 0);
-
-    while (lIter != lEnd) {
-      GLV_ASSERT(lIter != 0);
-      lIter->aPoint *= lRadius;
-      lIter->aPoint += lCenter;
-      ++lIter;
+    aSimplified = new PrimitiveAccumulator(false);
+
+    const SizeType lNbPrimitives = aLines.size() + aPoints.size() + aQuads.size() + aTriangles.size();
+
+    // A small model is its own simplified version
+    aSimplifiedSelf = !VertexClustering::isWorthSimplifying(lNbPrimitives);
+
+    if (aSimplifiedSelf) {
+      resetClustering();
     }
+    else {
+
+      const bool lColored = (aColors.size() == aVertices.size() && !aColors.empty());
 
-    // Scan all the primitives to find the closest ones
-    // For now, we choose only one primitive in all the types
-    // for each point on the shere. Again, we'll have to see
-    // if if wouldn't be better to have a separate simplication
-    // for each type of primitive.  We'll see.
-    // Scan only the new primitives for each type
-
-    scanForClosest(aLines,     lBegin, lEnd, aVertices);
-    scanForClosest(aPoints,    lBegin, lEnd, aVertices);
-    scanForClosest(aQuads,     lBegin, lEnd, aVertices);
-    scanForClosest(aTriangles, lBegin, lEnd, aVertices);
-
-    // Now add Points to aSimplified for each primitive barycenter chosen
-    lIter = lBegin;
-
-    while (lIter != lEnd) {
-      GLV_ASSERT(lIter != 0);
-      GLV_ASSERT(aSimplified != 0);
-      aSimplified->addPoint(lIter->aPrimiticeBarycenter);
-      ++lIter;
+      // We call getBoundingBox so that it gets updated
+      // if it needs to
+      if (aClustering == 0                                          ||
+          aClusteringColored != lColored                            ||
+          !aClustering->canContain(getBoundingBox(), lNbPrimitives)) {
+
+        // A model that outgrew its grid is likely to grow
+        // again: leave some room around the new one
+        const float lMargin = (aClustering == 0 ? 0.0f : 0.5f);
+
+        resetClustering();
+        aClustering        = new VertexClustering(getBoundingBox(), lNbPrimitives, lMargin);
+        aClusteringColored = lColored;
+      }
+
+      GLV_ASSERT(aClustering != 0);
+      VertexClustering& lClustering = *aClustering;
+
+      aClusteringVertices.resize(aVertices.size(), -1);
+
+      while (aLinesClusteringCounter < aLines.size()) {
+        const Line& lLine = aLines[aLinesClusteringCounter];
+        lClustering.addLine(getVertexCluster(lClustering, aClusteringVertices, aVertices, aColors, lLine.aP1),
+                            getVertexCluster(lClustering, aClusteringVertices, aVertices, aColors, lLine.aP2),
+                            lColored);
+        ++aLinesClusteringCounter;
+      }
+
+      while (aPointsClusteringCounter < aPoints.size()) {
+        const Point& lPoint = aPoints[aPointsClusteringCounter];
+        lClustering.addPoint(getVertexCluster(lClustering, aClusteringVertices, aVertices, aColors, lPoint.aP),
+                             lColored);
+        ++aPointsClusteringCounter;
+      }
+
+      while (aQuadsClusteringCounter < aQuads.size()) {
+        const Quad& lQuad = aQuads[aQuadsClusteringCounter];
+        lClustering.addQuad(getVertexCluster(lClustering, aClusteringVertices, aVertices, aColors, lQuad.aP1),
+                            getVertexCluster(lClustering, aClusteringVertices, aVertices, aColors, lQuad.aP2),
+                            getVertexCluster(lClustering, aClusteringVertices, aVertices, aColors, lQuad.aP3),
+                            getVertexCluster(lClustering, aClusteringVertices, aVertices, aColors, lQuad.aP4),
+                            lColored);
+        ++aQuadsClusteringCounter;
+      }
+
+      while (aTrianglesClusteringCounter < aTriangles.size()) {
+        const Triangle& lTriangle = aTriangles[aTrianglesClusteringCounter];
+        lClustering.addTriangle(getVertexCluster(lClustering, aClusteringVertices, aVertices, aColors, lTriangle.aP1),
+                                getVertexCluster(lClustering, aClusteringVertices, aVertices, aColors, lTriangle.aP2),
+                                getVertexCluster(lClustering, aClusteringVertices, aVertices, aColors, lTriangle.aP3),
+                                lColored);
+        ++aTrianglesClusteringCounter;
+      }
+
+      lClustering.constructSimplified(*aSimplified);
     }
   }
 
@@ -1089,3 +1639,57 @@ void VertexedPrimitiveAccumulator::constructSimplified()
   aSimplifiedDirty = false;
 }
 
+// Delete the clustering used by constructSimplified, so that
+// the next one starts from scratch
+void VertexedPrimitiveAccumulator::resetClustering()
+{
+  delete aClustering;
+  aClustering = 0;
+
+  aClusteringColored = false;
+  aClusteringVertices.clear();
+  aLinesClusteringCounter     = 0;
+  aPointsClusteringCounter    = 0;
+  aQuadsClusteringCounter     = 0;
+  aTrianglesClusteringCounter = 0;
+}
+
+// Returns the accumulator simplified pLevel times (see
+// PrimitiveAccumulator::getSimplified), or 0 if it is *this
+PrimitiveAccumulator* VertexedPrimitiveAccumulator::getSimplified(const int pLevel)
+{
+  if (pLevel <= 0) {
+    return 0;
+  }
+
+  // Check if we have to update the Simplified model
+  if (aSimplifiedDirty) {
+    constructSimplified();
+  }
+
+  if (aSimplifiedSelf) {
+    return 0;
+  }
+
+  GLV_ASSERT(aSimplified != 0);
+  return &aSimplified->getSimplified(pLevel-1);
+}
+
+GLuint& VertexedPrimitiveAccumulator::getGLDisplayList(const RenderParameters& pParams)
+{
+  switch (pParams.aRenderMode) {
+  case RenderParameters::renderMode_full:
+    return aGLDisplayListFull;
+    break;
+  case RenderParameters::renderMode_bounding_box:
+    return aGLDisplayListBoundingBox;
+    break;
+  case RenderParameters::renderMode_fast:
+    return aGLDisplayListFast;
+    break;
+  default:
+    GLV_ASSERT(false);
+    break;
+  }
+  return aGLDisplayListFast;
+}
@@ -25,12 +25,17 @@
 #include "BoundingBox.h"
 #include "glinclude.h"
 #include "limits_glv.h"
+#include "mapped_utils.h"
+#include "NormalCone.h"
 #include "RenderParameters.h"
 #include "VertexAccumulator.h"
+#include <stdio.h>
 #include <string>
 #include <vector>
 
 class PrimitiveAccumulator;
+class SoftwareRasterizer;
+class VertexClustering;
 
 // Class used to accumulate OpenGL based on a mesh
 // (vertices) and create an optimized order to display
@@ -42,6 +47,10 @@ public:
   VertexedPrimitiveAccumulator (VertexAccumulator& pVertexes);
   ~VertexedPrimitiveAccumulator();
 
+  static void* operator new   (size_t pBytes);
+  static void  operator delete(void*  pPtr,
+                               size_t pBytes);
+
   bool  addLine            (const int           pVertexIndex1,
                             const int           pVertexIndex2);
 
@@ -56,13 +65,46 @@ public:
                             const int           pVertexIndex2,
                             const int           pVertexIndex3);
 
-  void  dumpCharacteristics(std::ostream&       pOstream,
-                            const std::string&  pIndentation,
-                            const Matrix4x4&    pTransformation);
+  void  addColors           (Vector3D&           pSum,
+                             double&             pNbColored,
+                             double&             pNbUncolored) const;
+
+  size_t compact            ();
+
+  void  constructClusters   ();
+
+  void  constructDisplayList(const RenderParameters& pParams);
+
+  void  deleteDisplayLists  ();
+
+  void  dumpCharacteristics (std::ostream&       pOstream,
+                             const std::string&  pIndentation,
+                             const Matrix4x4&    pTransformation);
+
+  void  reserveLines        (const size_t        pNbLines);
+
+  void  reservePoints       (const size_t        pNbPoints);
+
+  void  reserveQuads        (const size_t        pNbQuads);
+
+  void  reserveTriangles    (const size_t        pNbTriangles);
+
+  const  BoundingBox&        getBoundingBox      () const;
 
-  const  BoundingBox&  getBoundingBox() const;
+  const  VertexAccumulator&  getVertexAccumulator() const;
 
-  void                 render        (const RenderParameters& pParams);
+  bool                       hasClusters         () const;
+
+  void                       rasterize           (SoftwareRasterizer&     pRasterizer,
+                                                  const RenderParameters& pParams);
+
+  bool                       readCache           (FILE*                   pFilePtr);
+
+  void                       render              (const RenderParameters& pParams);
+
+  void                       renderDisplayList   (const RenderParameters& pParams);
+
+  bool                       writeCache          (FILE*                   pFilePtr) const;
 
 private:
 
@@ -118,19 +160,45 @@ private:
       GLV_ASSERT(aP3 >= 0 && aP3 < static_cast<int>(pVertices.size()));
       return (1.0/3.0)*(pVertices[aP1] + pVertices[aP2] + pVertices[aP3]);
     }
+
+    Vector3D getFaceNormal(const Vertices& pVertices) const;
+  };
+
+  typedef  MappedVector<Line>::Type      Lines;
+  typedef  MappedVector<Point>::Type     Points;
+  typedef  MappedVector<Quad>::Type      Quads;
+  typedef  MappedVector<Triangle>::Type  Triangles;
+  typedef  Lines::size_type              SizeType;
+
+  // Triangles aBegin to aEnd-1, with the same facing. A cluster
+  // is skipped when it's outside of the view frustum or when all
+  // its faces are culled by OpenGL
+  struct Cluster {
+    BoundingBox aBoundingBox;
+    NormalCone  aNormalCone;
+    SizeType    aBegin;
+    SizeType    aEnd;
   };
 
-  typedef  std::vector<Line>      Lines;
-  typedef  std::vector<Point>     Points;
-  typedef  std::vector<Quad>      Quads;
-  typedef  std::vector<Triangle>  Triangles;
-  typedef  Lines::size_type       SizeType;
+  struct ClusterItem;
+
+  typedef  std::vector<Cluster>          Clusters;
+  typedef  std::vector<GLuint>           GLDisplayLists;
 
 
   void  computeNormals        ();
   void  constructSimplified   ();
+  GLuint& getGLDisplayList    (const RenderParameters& pParams);
+  PrimitiveAccumulator* getSimplified(const int pLevel);
   void  renderFacetsFrame     (const RenderParameters& pParams);
+  void  renderClusters        (const RenderParameters& pParams,
+                               const bool              pFlagCulling,
+                               const int               pCulledFaces,
+                               const Vector3D&         pEye);
   void  renderFull            (const RenderParameters& pParams);
+  void  renderFullExceptTriangles(const RenderParameters& pParams);
+  void  renderLevelOfDetail   (const RenderParameters& pParams,
+                               const bool              pFlagDisplayList);
   void  renderLines           ();
   void  renderLinesColored    ();
   void  renderPoints          ();
@@ -138,28 +206,44 @@ private:
   void  renderQuads           ();
   void  renderQuadsColored    ();
   void  renderSimplified      (const RenderParameters& pParams);
-  void  renderTriangles       ();
+  void  renderTriangles       (const SizeType pBegin, const SizeType pEnd);
   void  renderTrianglesColored();
+  void  resetClustering       ();
 
 
   mutable BoundingBox    aBoundingBox;
+  Clusters               aClusters;
+  GLDisplayLists         aClustersGLDisplayLists;
+  VertexClustering*      aClustering;
+  bool                   aClusteringColored;
+  std::vector<int>       aClusteringVertices; // Cluster of each vertex, -1 if not in aClustering yet
   const VertexAccumulator::Colors& aColors;
+  GLuint                 aGLDisplayListBoundingBox;
+  GLuint                 aGLDisplayListFast;
+  GLuint                 aGLDisplayListFull;
+  GLuint                 aGLDisplayListFullExceptTriangles;
   Lines                  aLines;
   mutable SizeType       aLinesBBoxCounter;
+  SizeType               aLinesClusteringCounter;
   Points                 aPoints;
   mutable SizeType       aPointsBBoxCounter;
+  SizeType               aPointsClusteringCounter;
   Quads                  aQuads;
   mutable SizeType       aQuadsBBoxCounter;
+  SizeType               aQuadsClusteringCounter;
   VertexAccumulator::Normals& aNormals;
   PrimitiveAccumulator*  aSimplified;
   bool                   aSimplifiedDirty;
   bool                   aSimplifiedSelf;
   Triangles              aTriangles;
   mutable SizeType       aTrianglesBBoxCounter;
+  SizeType               aTrianglesClusteringCounter;
   const VertexAccumulator::Vertices& aVertices;
   int                    aPrimitiveOptimizerValue;
 
   const VertexAccumulator& aVertexAccumulator;
+
+  static const SizeType  aClusterSize;
 };
 
 #endif // VERTEXEDPRIMITIVEACCUMULATOR_H
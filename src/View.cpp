@@ -44,6 +44,26 @@ const float    View::aMinFOVDegrees              (0.001f);
 #define GLV_CHECK_INVARIANTS
 #endif // #ifdef GLV_BEBUG
 
+
+// Spherical interpolation between two directions so that
+// a camera path turns at a constant angular speed.
+// Falls back to a linear interpolation when the two
+// directions are (almost) parallel or opposite.
+static Vector3D interpolateDirection(const Vector3D& pDirection1,
+                                     const Vector3D& pDirection2,
+                                     const float     pRatio)
+{
+  const float lAngle    = pDirection1.getAngleTo(pDirection2);
+  const float lSinAngle = sin(lAngle);
+
+  if (lSinAngle < 1.0E-4) {
+    return (1.0f - pRatio)*pDirection1 + pRatio*pDirection2;
+  }
+
+  return (sin((1.0f - pRatio)*lAngle)/lSinAngle)*pDirection1 +
+         (sin(        pRatio *lAngle)/lSinAngle)*pDirection2;
+}
+
 View::View()
 {
   init();
@@ -89,6 +109,28 @@ View::View(const BoundingBox& pBoundingBox,
   ajust(pBoundingBox);
 }
 
+// Intermediate View between pView1 (pRatio == 0) and pView2 (pRatio == 1)
+View::View(const View& pView1,
+           const View& pView2,
+           const float pRatio)
+{
+  GLV_ASSERT(pRatio >= 0.0f && pRatio <= 1.0f);
+
+  Vector3D lDirection = interpolateDirection(pView1.aDirection, pView2.aDirection, pRatio);
+
+  // Opposite directions: keep the first one, the
+  // camera would otherwise go through its center
+  if (lDirection.getLength() < 1.0E-6) {
+    lDirection = pView1.aDirection;
+  }
+
+  init((1.0f - pRatio)*pView1.aCenter      + pRatio*pView2.aCenter,
+       lDirection,
+       interpolateDirection(pView1.aUp, pView2.aUp, pRatio),
+       (1.0f - pRatio)*pView1.aDistance    + pRatio*pView2.aDistance,
+       (1.0f - pRatio)*pView1.aFOVDegrees  + pRatio*pView2.aFOVDegrees);
+}
+
 View::~View()
 {}
 
@@ -155,6 +197,30 @@ void View::dump(std::ostream& pOstream) const
   GLV_CHECK_INVARIANTS;
 }
 
+// Returns the direction from the center to the camera
+Vector3D View::getDirection() const
+{
+  GLV_CHECK_INVARIANTS;
+
+  return aDirection;
+}
+
+// Returns the distance between the camera and the center
+float View::getDistance() const
+{
+  GLV_CHECK_INVARIANTS;
+
+  return aDistance;
+}
+
+// Returns the vertical field of view in degrees
+float View::getFOVDegrees() const
+{
+  GLV_CHECK_INVARIANTS;
+
+  return aFOVDegrees;
+}
+
 // Returns the position of the camera
 Vector3D View::getPosition() const
 {
@@ -163,6 +229,14 @@ Vector3D View::getPosition() const
   return  aCenter + aDistance*aDirection;
 }
 
+// Returns the up direction of the camera
+Vector3D View::getUp() const
+{
+  GLV_CHECK_INVARIANTS;
+
+  return aUp;
+}
+
 void View::initCamera(const Tile& pTile) const
 {
   GLV_CHECK_INVARIANTS;
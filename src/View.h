@@ -55,27 +55,39 @@ public:
         const Vector3D&    pDirection,
         const Vector3D&    pUp);
 
+  View (const View&        pView1,
+        const View&        pView2,
+        const float        pRatio);
+
   ~View();
 
-  void     drawCenter () const;
+  void     drawCenter   () const;
+
+  void     dump         (ViewManager&  pViewManager) const;
+
+  void     dump         (std::ostream& pOstream) const;
+
+  Vector3D getDirection () const;
+
+  float    getDistance  () const;
 
-  void     dump       (ViewManager&  pViewManager) const;
+  float    getFOVDegrees() const;
 
-  void     dump       (std::ostream& pOstream) const;
+  Vector3D getPosition  () const;
 
-  Vector3D getPosition() const;
+  Vector3D getUp        () const;
 
-  void     initCamera (const Tile&   pTile) const;
+  void     initCamera   (const Tile&   pTile) const;
 
-  View&    operator=  (const View&   pView);
+  View&    operator=    (const View&   pView);
 
-  void     rotate     (const float   pDeltaX,
-                       const float   pDeltaY);
+  void     rotate       (const float   pDeltaX,
+                         const float   pDeltaY);
 
-  void     scaleFOV   (const float   pFOVFactor);
+  void     scaleFOV     (const float   pFOVFactor);
 
-  void     translate  (const float   pDeltaX,
-                       const float   pDeltaY);
+  void     translate    (const float   pDeltaX,
+                         const float   pDeltaY);
 
 private:
 
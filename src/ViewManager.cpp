@@ -24,24 +24,53 @@
 #include "glut_utils.h"
 #include "Parser.h"
 #include "RenderParameters.h"
+#include "SoftwareRasterizer.h"
 #include "string_utils.h"
 #include "Tile.h"
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 #ifndef WIN32
+#include <sys/time.h>
 #include <unistd.h>
 #endif
 
+// Frame time (in milliseconds) wanted while the camera
+// moves in automatic level of detail
+const double ViewManager::aLevelOfDetailFrameTime = 40.0;
+
+// Size on screen (in pixels) under which an accumulator is
+// simplified once more in automatic level of detail
+const float  ViewManager::aLevelOfDetailPixels    = 256.0f;
+
+// Coarsest level of detail used while the camera moves
+const int    ViewManager::aMaximumLevelOfDetail   = 8;
+
+// Wall clock time in milliseconds
+static double getMilliseconds()
+{
+#ifdef WIN32
+  return glutGet(GLUT_ELAPSED_TIME);
+#else // #ifdef WIN32
+  struct timeval lTime;
+  gettimeofday(&lTime, 0);
+  return lTime.tv_sec*1000.0 + lTime.tv_usec/1000.0;
+#endif // #ifdef WIN32
+}
+
 // Constructor; initialize the viewport and load preferences
 ViewManager::ViewManager()
-  : aAxes          (),
-    aCurrentView   (),
-    aGraphicData   (),
-    aGrid          (),
-    aLastMouseX    (0),
-    aLastMouseY    (0),
-    aMoveMode      (mouseMove_none),
+  : aAxes                     (),
+    aCurrentView              (),
+    aFlagLevelOfDetailRefining(false),
+    aGraphicData              (),
+    aGrid                     (),
+    aLastMouseX               (0),
+    aLastMouseY               (0),
+    aLevelOfDetail            (0),
+    aLevelOfDetailRefined     (0),
+    aMoveMode                 (mouseMove_none),
     aNewViewAdded  (false),
     aStatusMessages(),
     aTitle         (),
@@ -224,6 +253,12 @@ void ViewManager::displayCallback()
   display(Tile(aWindowWidth, aWindowHeight));
 }
 
+// Return the View used for the rendering
+const View& ViewManager::getCurrentView() const
+{
+  return aCurrentView;
+}
+
 // Return the graphic data structure; used to load input data
 GraphicData& ViewManager::getGraphicData()
 {
@@ -236,9 +271,16 @@ UserSettings& ViewManager::getUserSettings()
   return aUserSettings;
 }
 
+// Return the views added with the "view" command
+const std::vector<View>& ViewManager::getViews() const
+{
+  return aViews;
+}
+
 // Callback: Called when the app is idle.
-// We check if there is new data available.
-// If so, we return true (that will tell the window to redraw)
+// We check if there is new data available, or if the level of
+// detail is being refined. If so, we return true (that will
+// tell the window to redraw)
 bool ViewManager::idleCallback()
 {
   const bool lNewDataParsed = aGraphicData.timerCallback();
@@ -251,7 +293,7 @@ bool ViewManager::idleCallback()
 
   aNewViewAdded = false;
 
-  return lNewDataParsed;
+  return lNewDataParsed || aFlagLevelOfDetailRefining;
 }
 
 // Callback: Called when the keyboard is used
@@ -291,9 +333,15 @@ bool ViewManager::keyboardCallback(unsigned char pKey)
   else if(pKey == 'S') {
     menuCallback("view_fast");
   }
+  else if(pKey == 'O') {
+    menuCallback("view_level_of_detail");
+  }
   else if(pKey == 'V') {
     menuCallback("view_echo");
   }
+  else if(pKey == 'H') {
+    menuCallback("general_show_hidden_objects");
+  }
   else if(pKey == '~') {
     menuCallback("view_bookmark");
   }
@@ -339,6 +387,10 @@ bool ViewManager::menuCallback(const char* pMenuEvent)
     aGraphicData.dumpCharacteristics(std::cerr, "");
     std::cerr.flush();
   }
+  else if(lEvent == "general_show_hidden_objects") {
+    aGraphicData.showHiddenObjects();
+    addStatusMessage("Hidden objects shown");
+  }
   else if(lEvent == "general_exit") {
     // The exit is handled in WindowQt/WindowGLUT,
     // after general_exit has processed
@@ -458,6 +510,9 @@ bool ViewManager::menuCallback(const char* pMenuEvent)
   else if(lEvent == "view_fast") {
     aUserSettings.aSimplicationMode = UserSettings::simplificationMode_fast;
   }
+  else if(lEvent == "view_level_of_detail") {
+    aUserSettings.aSimplicationMode = UserSettings::simplificationMode_level_of_detail;
+  }
   else if(lEvent == "view_echo") {
     aCurrentView.dump(std::cerr);
     aCurrentView.dump(*this);
@@ -620,12 +675,107 @@ bool ViewManager::mouseMotionCallback(int pX, int pY)
 }
 
 // Callback: Called when the window was resized
+// Renders pTile with pRasterizer instead of OpenGL. This
+// is the equivalent of display, without the text layer
+void ViewManager::rasterize(SoftwareRasterizer& pRasterizer,
+                            const Tile&         pTile)
+{
+  pRasterizer.begin(pTile, aCurrentView);
+
+  pRasterizer.clear(Vector3D(aUserSettings.aBackgroundR,
+                             aUserSettings.aBackgroundG,
+                             aUserSettings.aBackgroundB));
+
+  GLV_ASSERT(aUserSettings.aBackgroundMode >= 0);
+  GLV_ASSERT(aUserSettings.aBackgroundMode <  5);
+
+  if(aUserSettings.aBackgroundMode == 3) {
+    pRasterizer.drawBackground(Vector3D(0.7f, 0.7f, 0.7f),
+                               Vector3D(0.7f, 0.7f, 0.7f),
+                               Vector3D(0.4f, 0.4f, 0.4f),
+                               Vector3D(0.3f, 0.3f, 0.3f));
+  }
+  else if(aUserSettings.aBackgroundMode == 4) {
+    pRasterizer.drawBackground(Vector3D(0.0f, 0.0f, 0.0f),
+                               Vector3D(0.0f, 0.0f, 0.0f),
+                               Vector3D(0.3f, 0.3f, 0.3f),
+                               Vector3D(0.2f, 0.2f, 0.2f));
+  }
+
+  SoftwareRasterizer::State& lState       = pRasterizer.getState();
+  const BoundingBox          lBoundingBox = aGraphicData.getGlobalBoundingBox();
+  const Vector3D&            lCenter      = lBoundingBox.getCenter();
+  const float                lRadius      = lBoundingBox.getCircumscribedSphereRadius();
+
+  // Same transformations as drawGrid
+  if(aUserSettings.aFlagGrid) {
+    const SoftwareRasterizer::State lSavedState = lState;
+    const float                     lLength     = (lRadius == 0.0f) ? 4.0f : 4.0f*lRadius;
+
+    lState.aDepthTest = false;
+    lState.aTransformation.translate(Vector3D(lCenter.x(), lCenter.y() - lRadius, lCenter.z()));
+    lState.aTransformation.scale    (Vector3D(lLength, lLength, lLength));
+
+    RenderParameters lParams;
+    aGrid.rasterize(pRasterizer, lParams);
+
+    lState = lSavedState;
+  }
+
+  // Same light as setupLighting
+  if(aUserSettings.aLightModel) {
+    lState.aLighting = true;
+
+    if(aUserSettings.aLightModel == 1) {
+      pRasterizer.setLight(aCurrentView.getPosition(), false, 0.3f*aUserSettings.aLightAmbient, 0.7f);
+    }
+    else {
+      pRasterizer.setLight(aUserSettings.aLightPosition,
+                           aUserSettings.aLightPositionLocal != 0,
+                           0.3f*aUserSettings.aLightAmbient,
+                           0.7f);
+    }
+  }
+
+  lState.aTwoSidedLighting = true;
+  lState.aColor            = Vector3D(1.0f, 1.0f, 1.0f);
+
+  // Like with OpenGL, the state changes made by the root
+  // Object are still active when the axes are drawn
+  RenderParameters lParams;
+  lParams.aRenderMode = RenderParameters::renderMode_full;
+  aGraphicData.rasterize(pRasterizer, lParams);
+
+  lState.aLighting = false;
+
+  // Same transformations as drawAxes
+  if(aUserSettings.aFlagAxes) {
+    const SoftwareRasterizer::State lSavedState = lState;
+    const float                     lLength     = (lRadius == 0.0f) ? 1.2f : 1.2f*lRadius;
+
+    lState.aTransformation.translate(lCenter);
+    lState.aTransformation.scale    (Vector3D(lLength, lLength, lLength));
+
+    RenderParameters lAxesParams;
+    aAxes.rasterize(pRasterizer, lAxesParams);
+
+    lState = lSavedState;
+  }
+}
+
 void ViewManager::reshapeCallback(int pWidth, int pHeight)
 {
   aWindowWidth  = pWidth;
   aWindowHeight = pHeight;
 }
 
+// Change the View used for the rendering without
+// adding it to the list of views
+void ViewManager::setCurrentView(const View& pView)
+{
+  aCurrentView = pView;
+}
+
 void ViewManager::setTitle(const std::string& pTitle)
 {
   aTitle = pTitle;
@@ -753,21 +903,32 @@ void ViewManager::render(const Tile& pTile)
   glEnable       (GL_COLOR_MATERIAL);
   glColor3f      (1.0f,1.0f,1.0f);
 
+  aFlagLevelOfDetailRefining = false;
+
   // Object rendering. only if the mouse button is not down OR graphic simplification
   // is disabled.
-  if(aMoveMode == mouseMove_none || aUserSettings.aSimplicationMode == UserSettings::simplificationMode_none) {
+  if(aUserSettings.aSimplicationMode == UserSettings::simplificationMode_level_of_detail) {
+    renderLevelOfDetail();
+  }
+  else if(aMoveMode == mouseMove_none || aUserSettings.aSimplicationMode == UserSettings::simplificationMode_none) {
     RenderParameters lParams;
-    lParams.aRenderMode = RenderParameters::renderMode_full;
+    lParams.aRenderMode         = RenderParameters::renderMode_full;
+    lParams.aFlagFrustumCulling = true;
+    lParams.aSmallFeaturePixels = aUserSettings.aSmallFeaturePixels;
     aGraphicData.render(lParams);
   }
   else if(aMoveMode != mouseMove_none && aUserSettings.aSimplicationMode == UserSettings::simplificationMode_fast) {
     RenderParameters lParams;
-    lParams.aRenderMode = RenderParameters::renderMode_fast;
+    lParams.aRenderMode         = RenderParameters::renderMode_fast;
+    lParams.aFlagFrustumCulling = true;
+    lParams.aSmallFeaturePixels = aUserSettings.aSmallFeaturePixels;
     aGraphicData.render(lParams);
   }
   else if(aMoveMode != mouseMove_none && aUserSettings.aSimplicationMode == UserSettings::simplificationMode_bounding_box) {
     RenderParameters lParams;
-    lParams.aRenderMode = RenderParameters::renderMode_bounding_box;
+    lParams.aRenderMode         = RenderParameters::renderMode_bounding_box;
+    lParams.aFlagFrustumCulling = true;
+    lParams.aSmallFeaturePixels = aUserSettings.aSmallFeaturePixels;
     aGraphicData.render(lParams);
   }
 
@@ -785,6 +946,52 @@ void ViewManager::render(const Tile& pTile)
   drawTextLayer(pTile);
 }
 
+// Render the graphic data in automatic level of detail. While the
+// camera moves, the level is raised when a frame takes longer than
+// aLevelOfDetailFrameTime, and lowered when the next finer level
+// (about 4 times more primitives) should still fit in it. Once the
+// camera stops, the level is lowered by one at each frame (see
+// idleCallback) until the full model is rendered.
+// From level 1, the accumulators small on screen are simplified
+// once more each time their size is halved
+void ViewManager::renderLevelOfDetail()
+{
+  if (aMoveMode != mouseMove_none) {
+    aLevelOfDetailRefined = aLevelOfDetail;
+  }
+
+  const int lLevel = aLevelOfDetailRefined;
+
+  RenderParameters lParams;
+  lParams.aRenderMode          = RenderParameters::renderMode_level_of_detail;
+  lParams.aFlagFrustumCulling  = true;
+  lParams.aLevelOfDetail       = std::max(0, lLevel-1);
+  lParams.aLevelOfDetailPixels = (lLevel > 0 ? aLevelOfDetailPixels : 0.0f);
+  lParams.aSmallFeaturePixels  = aUserSettings.aSmallFeaturePixels;
+
+  const double lStart = getMilliseconds();
+
+  aGraphicData.render(lParams);
+
+  // Wait for the rendering to be really done
+  glFinish();
+
+  const double lFrameTime = getMilliseconds() - lStart;
+
+  if (aMoveMode != mouseMove_none) {
+    if (lFrameTime > aLevelOfDetailFrameTime) {
+      aLevelOfDetail = std::min(aLevelOfDetail+1, aMaximumLevelOfDetail);
+    }
+    else if (4.0*lFrameTime < aLevelOfDetailFrameTime) {
+      aLevelOfDetail = std::max(aLevelOfDetail-1, 0);
+    }
+  }
+  else if (lLevel > 0) {
+    aLevelOfDetailRefined      = lLevel-1;
+    aFlagLevelOfDetailRefining = true;
+  }
+}
+
 void ViewManager::setupLighting()
 {
   glEnable(GL_LIGHTING);
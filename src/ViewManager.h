@@ -28,6 +28,7 @@
 #include "View.h"
 #include <vector>
 
+class SoftwareRasterizer;
 class Tile;
 
 // ViewManager
@@ -51,10 +52,14 @@ public:
 
   void          displayCallback        ();
 
+  const View&   getCurrentView         () const;
+
   GraphicData&  getGraphicData         ();
 
   UserSettings& getUserSettings        ();
 
+  const std::vector<View>& getViews    () const;
+
   bool          idleCallback           ();
 
   bool          keyboardCallback       (unsigned char      pKey);
@@ -72,9 +77,14 @@ public:
   bool          mouseMotionCallback    (int                pX,
                                         int                pY);
 
+  void          rasterize              (SoftwareRasterizer& pRasterizer,
+                                        const Tile&         pTile);
+
   void          reshapeCallback        (int                pWidth,
                                         int                pHeight);
 
+  void          setCurrentView         (const View&        pView);
+
   void          setTitle               (const std::string& pTitle);
 
 private:
@@ -93,15 +103,19 @@ private:
   void drawMouseMovementIndicators();
   void drawTextLayer              (const Tile& pTile);
   void render                     (const Tile& pTile);
+  void renderLevelOfDetail        ();
   void resetCamera                ();
   void setupLighting              ();
 
   Object                   aAxes;
   View                     aCurrentView;
+  bool                     aFlagLevelOfDetailRefining;
   GraphicData              aGraphicData;
   Object                   aGrid;
   int                      aLastMouseX;
   int                      aLastMouseY;
+  int                      aLevelOfDetail;
+  int                      aLevelOfDetailRefined;
   MouseMoveMode            aMoveMode;
   bool                     aNewViewAdded;
   std::vector<std::string> aStatusMessages;
@@ -111,6 +125,10 @@ private:
   std::vector<View>        aViews;
   int                      aWindowHeight;
   int                      aWindowWidth;
+
+  static const double      aLevelOfDetailFrameTime;
+  static const float       aLevelOfDetailPixels;
+  static const int         aMaximumLevelOfDetail;
 };
 
 #endif // VIEWMANAGER_H
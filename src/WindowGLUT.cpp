@@ -43,6 +43,7 @@
 #define MENU_VIEW_FAST 16
 #define MENU_VIEW_BOOKMARK 17
 #define MENU_VIEW_ECHO_ALL 18
+#define MENU_VIEW_LEVEL_OF_DETAIL 19
 
 #define MENU_CONFIG_AXES 0
 #define MENU_CONFIG_GRID 1
@@ -54,6 +55,7 @@
 #define MENU_GENERAL_RESET 0
 #define MENU_GENERAL_DUMP_CHARACTERISTICS 1
 #define MENU_GENERAL_EXIT 2
+#define MENU_GENERAL_SHOW_HIDDEN_OBJECTS 3
 
 // GLUT callbacks initialized in constructor
 //  All these functions will call the associated method
@@ -128,6 +130,9 @@ void viewMenuFunc(int pFuncId)
   else if( pFuncId == MENU_VIEW_FAST ) {
     lWindow.menu("view_fast");
   }
+  else if( pFuncId == MENU_VIEW_LEVEL_OF_DETAIL ) {
+    lWindow.menu("view_level_of_detail");
+  }
   else if( pFuncId == MENU_VIEW_RESET_ID ) {
     lWindow.menu("view_reset");
   }
@@ -194,6 +199,9 @@ void generalMenuFunc(int pFuncId)
   else if (pFuncId == MENU_GENERAL_DUMP_CHARACTERISTICS) {
     lWindow.menu("general_dump_characteristics");
   }
+  else if (pFuncId == MENU_GENERAL_SHOW_HIDDEN_OBJECTS) {
+    lWindow.menu("general_show_hidden_objects");
+  }
   else if (pFuncId == MENU_GENERAL_EXIT) {
     lWindow.menu("general_exit");
     exit(0);
@@ -255,6 +263,7 @@ WindowGLUT::WindowGLUT()
   glutAddMenuEntry("\"Full\" mode (F)",MENU_VIEW_FULL);
   glutAddMenuEntry("\"Bounding Box\" mode (D)",MENU_VIEW_BOUNDINGBOX);
   glutAddMenuEntry("\"Fast\" mode (S)",MENU_VIEW_FAST);
+  glutAddMenuEntry("Automatic level of detail (O)",MENU_VIEW_LEVEL_OF_DETAIL);
   glutAddMenuEntry("---------------",-1);
   glutAddMenuEntry("Add view to user-defined views (~)",MENU_VIEW_BOOKMARK);
   glutAddMenuEntry("Echo current settings (V)",MENU_VIEW_ECHO);
@@ -274,6 +283,7 @@ WindowGLUT::WindowGLUT()
   int lMenuGeneralId = glutCreateMenu(generalMenuFunc);
   glutAddMenuEntry("Clear data",MENU_GENERAL_RESET);
   glutAddMenuEntry("Dump characteristics",MENU_GENERAL_DUMP_CHARACTERISTICS);
+  glutAddMenuEntry("Show hidden objects (H)",MENU_GENERAL_SHOW_HIDDEN_OBJECTS);
   glutAddMenuEntry("Exit program (ctrl-q)",MENU_GENERAL_EXIT);
 
   glutCreateMenu(mainMenuFunc);
@@ -218,6 +218,7 @@ WindowQt::WindowQt()
   lFileMenu->insertItem("Open",this,SLOT(menu_File_Open()),Qt::CTRL+Qt::Key_O);
   lFileMenu->insertItem("Clear data",this,SLOT(menu_File_Clear()));
   lFileMenu->insertItem("Dump characteristics",this,SLOT(menu_File_Dump()));
+  lFileMenu->insertItem("Show hidden objects",this,SLOT(menu_File_ShowHidden()),Qt::SHIFT+Qt::Key_H);
   lFileMenu->insertSeparator();
   lFileMenu->insertItem("Exit",this,SLOT(menu_File_Exit()),Qt::CTRL+Qt::Key_Q);
   menuBar()->insertItem("File",lFileMenu);
@@ -235,6 +236,7 @@ WindowQt::WindowQt()
   lViewMenu->insertItem("\"Full\" mode",this,SLOT(menu_View_Full()),Qt::SHIFT+Qt::Key_F);
   lViewMenu->insertItem("\"Bounding box\" mode",this,SLOT(menu_View_BoundingBox()),Qt::SHIFT+Qt::Key_D);
   lViewMenu->insertItem("\"Fast\" mode",this,SLOT(menu_View_Fast()),Qt::SHIFT+Qt::Key_S);
+  lViewMenu->insertItem("Automatic level of detail",this,SLOT(menu_View_LevelOfDetail()),Qt::SHIFT+Qt::Key_O);
   lViewMenu->insertSeparator();
   lViewMenu->insertItem("Add view to list",this,SLOT(menu_View_Add()),Qt::Key_AsciiTilde);
   lViewMenu->insertItem("Echo current view",this,SLOT(menu_View_EchoView()),Qt::SHIFT+Qt::Key_V);
@@ -386,6 +388,13 @@ void WindowQt::menu_File_Open()
   aOpenGLWidget->repaint();
 }
 
+void WindowQt::menu_File_ShowHidden()
+{
+  if(getViewManager().menuCallback("general_show_hidden_objects")) {
+    aOpenGLWidget->repaint();
+  }
+}
+
 void WindowQt::menu_View_Add()
 {
   if(getViewManager().menuCallback("view_bookmark")) {
@@ -456,6 +465,13 @@ void WindowQt::menu_View_Left()
   }
 }
 
+void WindowQt::menu_View_LevelOfDetail()
+{
+  if(getViewManager().menuCallback("view_level_of_detail")) {
+    aOpenGLWidget->repaint();
+  }
+}
+
 void WindowQt::menu_View_Next()
 {
   if(getViewManager().menuCallback("view_next")) {
@@ -96,10 +96,11 @@ private slots:
   void menu_Config_Lighting  ();
   void menu_Config_SaveGLRC  ();
 
-  void menu_File_Clear();
-  void menu_File_Dump ();
-  void menu_File_Exit ();
-  void menu_File_Open ();
+  void menu_File_Clear      ();
+  void menu_File_Dump       ();
+  void menu_File_Exit       ();
+  void menu_File_Open       ();
+  void menu_File_ShowHidden ();
 
   void menu_View_Add        ();
   void menu_View_Back       ();
@@ -111,6 +112,7 @@ private slots:
   void menu_View_Front      ();
   void menu_View_Full       ();
   void menu_View_Left       ();
+  void menu_View_LevelOfDetail();
   void menu_View_Next       ();
   void menu_View_Previous   ();
   void menu_View_Reset      ();
@@ -0,0 +1,134 @@
+//  glv - OpenGL viewer command line tool
+/*****************************************************************************
+ * Copyright (C) 2003 Patrick Lagace <bl4cklight@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *****************************************************************************/
+
+#include "arena_utils.h"
+#include "assert_glv.h"
+
+#include <vector>
+
+typedef std::vector<char*> Chunks;
+
+// The nodes are rounded up to a multiple of gAlignment. Those
+// larger than gMaximumNodeSize are allocated on the heap as usual
+static const size_t gAlignment       = 16;
+static const size_t gMaximumNodeSize = 4096;
+static const size_t gChunkSize       = 256*1024;
+
+// Free nodes of each size, linked through their first bytes
+static void*  gFreeNodes[gMaximumNodeSize/gAlignment + 1];
+
+static char*  gChunkPtr  = 0; // Free part of the last chunk
+static size_t gChunkLeft = 0;
+static size_t gSize      = 0;
+
+static Chunks& getChunks()
+{
+  static Chunks lChunks;
+  return lChunks;
+}
+
+void* allocateArena(const size_t pBytes)
+{
+  if (pBytes > gMaximumNodeSize) {
+    return ::operator new(pBytes);
+  }
+
+  const size_t lIndex = (pBytes + gAlignment - 1) / gAlignment;
+  const size_t lBytes = (lIndex == 0 ? 1 : lIndex) * gAlignment;
+
+  gSize += lBytes;
+
+  void*& lFreeNode = gFreeNodes[lIndex];
+  if (lFreeNode != 0) {
+    void* lPtr = lFreeNode;
+    lFreeNode  = *static_cast<void**>(lPtr);
+    return lPtr;
+  }
+
+  if (gChunkLeft < lBytes) {
+    // The end of the last chunk is lost: at most a node
+    gChunkPtr  = static_cast<char*>(::operator new(gChunkSize));
+    gChunkLeft = gChunkSize;
+    getChunks().push_back(gChunkPtr);
+  }
+
+  void* lPtr = gChunkPtr;
+  gChunkPtr  += lBytes;
+  gChunkLeft -= lBytes;
+
+  return lPtr;
+}
+
+void deallocateArena(void*        pPtr,
+                     const size_t pBytes)
+{
+  if (pPtr == 0) {
+    return;
+  }
+
+  if (pBytes > gMaximumNodeSize) {
+    ::operator delete(pPtr);
+    return;
+  }
+
+  const size_t lIndex = (pBytes + gAlignment - 1) / gAlignment;
+  const size_t lBytes = (lIndex == 0 ? 1 : lIndex) * gAlignment;
+
+  GLV_ASSERT(gSize >= lBytes);
+  gSize -= lBytes;
+
+  *static_cast<void**>(pPtr) = gFreeNodes[lIndex];
+  gFreeNodes[lIndex]         = pPtr;
+}
+
+size_t getArenaCapacity()
+{
+  return getChunks().size()*gChunkSize;
+}
+
+size_t getArenaSize()
+{
+  return gSize;
+}
+
+// Called once the scene is deleted: its nodes are all on the free
+// lists, which are dropped with the chunks instead of node by node
+void releaseArena()
+{
+  if (gSize != 0) {
+    return;
+  }
+
+  Chunks& lChunks = getChunks();
+
+  for (size_t i=0; i<lChunks.size(); ++i) {
+    ::operator delete(lChunks[i]);
+  }
+
+  Chunks lEmpty;
+  lChunks.swap(lEmpty);
+
+  for (size_t i=0; i<=gMaximumNodeSize/gAlignment; ++i) {
+    gFreeNodes[i] = 0;
+  }
+
+  gChunkPtr  = 0;
+  gChunkLeft = 0;
+}
@@ -0,0 +1,119 @@
+//  glv - OpenGL viewer command line tool
+/*****************************************************************************
+ * Copyright (C) 2003 Patrick Lagace <bl4cklight@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *****************************************************************************/
+
+#ifndef ARENA_UTILS_H
+#define ARENA_UTILS_H
+
+#include <cstddef>
+#include <new>
+
+// Storage of the nodes of the scene: the Objects, their accumulators
+// and their small vectors. A scene made of millions of small Objects
+// would otherwise spend its loading and its reset in malloc and free.
+// The nodes are carved from large chunks, and a freed node is kept
+// for the next node of the same size. Once the scene is deleted,
+// releaseArena gives all the chunks back at once. The larger blocks
+// (the primitives and the vertices) are not in the arena, see
+// mapped_utils.h
+
+void*  allocateArena    (const size_t pBytes);
+void   deallocateArena  (void*        pPtr,
+                         const size_t pBytes);
+
+// Bytes of the chunks, and of the nodes in use
+size_t getArenaCapacity ();
+size_t getArenaSize     ();
+
+// Free the chunks. Nothing is done while a node is in use
+void   releaseArena     ();
+
+// Allocator of the vectors using allocateArena
+template <class T>
+class ArenaAllocator
+{
+public:
+
+  typedef size_t     size_type;
+  typedef ptrdiff_t  difference_type;
+  typedef T*         pointer;
+  typedef const T*   const_pointer;
+  typedef T&         reference;
+  typedef const T&   const_reference;
+  typedef T          value_type;
+
+  template <class U>
+  struct rebind {
+    typedef ArenaAllocator<U> other;
+  };
+
+  ArenaAllocator () {}
+  ArenaAllocator (const ArenaAllocator&) {}
+  template <class U>
+  ArenaAllocator (const ArenaAllocator<U>&) {}
+  ~ArenaAllocator() {}
+
+  pointer       address(reference       pValue) const {return &pValue;}
+  const_pointer address(const_reference pValue) const {return &pValue;}
+
+  pointer allocate(const size_type pNb, const void* = 0)
+    {
+      if (pNb > max_size()) {
+        throw std::bad_alloc();
+      }
+      return static_cast<pointer>(allocateArena(pNb*sizeof(T)));
+    }
+
+  void deallocate(pointer pPtr, const size_type pNb)
+    {
+      deallocateArena(pPtr, pNb*sizeof(T));
+    }
+
+  size_type max_size() const
+    {
+      return static_cast<size_type>(-1) / sizeof(T);
+    }
+
+  void construct(pointer pPtr, const T& pValue)
+    {
+      new(static_cast<void*>(pPtr)) T(pValue);
+    }
+
+  void destroy(pointer pPtr)
+    {
+      pPtr->~T();
+    }
+};
+
+// All the ArenaAllocators are interchangeable
+template <class T, class U>
+inline
+bool operator==(const ArenaAllocator<T>&, const ArenaAllocator<U>&)
+{
+  return true;
+}
+
+template <class T, class U>
+inline
+bool operator!=(const ArenaAllocator<T>&, const ArenaAllocator<U>&)
+{
+  return false;
+}
+
+#endif // ARENA_UTILS_H
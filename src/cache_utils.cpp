@@ -0,0 +1,51 @@
+//  glv - OpenGL viewer command line tool
+/*****************************************************************************
+ * Copyright (C) 2003 Patrick Lagace <bl4cklight@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *****************************************************************************/
+
+#include "cache_utils.h"
+
+bool readCacheString(FILE* pFilePtr, std::string& pString)
+{
+  // Upper bound on the length of a stored string, to detect
+  // corrupted files before trying to allocate the string
+  const unsigned long lMaxSize = 1UL << 24;
+
+  unsigned long lSize = 0;
+  if (!readCacheValue(pFilePtr, lSize) || lSize > lMaxSize) {
+    return false;
+  }
+
+  std::vector<char> lBuffer(lSize+1, '\0');
+  if (lSize > 0 && fread(&lBuffer[0], 1, lSize, pFilePtr) != lSize) {
+    return false;
+  }
+
+  pString.assign(&lBuffer[0], lSize);
+  return true;
+}
+
+bool writeCacheString(FILE* pFilePtr, const std::string& pString)
+{
+  const unsigned long lSize = pString.size();
+  if (!writeCacheValue(pFilePtr, lSize)) {
+    return false;
+  }
+
+  return lSize == 0 || fwrite(pString.data(), 1, lSize, pFilePtr) == lSize;
+}
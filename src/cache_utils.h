@@ -0,0 +1,126 @@
+//  glv - OpenGL viewer command line tool
+/*****************************************************************************
+ * Copyright (C) 2003 Patrick Lagace <bl4cklight@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *****************************************************************************/
+
+#ifndef CACHE_UTILS_H
+#define CACHE_UTILS_H
+
+#include "mapped_utils.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// Binary read/write of the parsed data in the parse cache files.
+// The read functions return false on a truncated or corrupted file.
+// The values are stored in the native representation: a cache file
+// is only valid for the glv executable that wrote it.
+
+template <class T>
+inline
+bool readCacheValue(FILE* pFilePtr, T& pValue)
+{
+  return fread(&pValue, sizeof(T), 1, pFilePtr) == 1;
+}
+
+template <class T>
+inline
+bool writeCacheValue(FILE* pFilePtr, const T& pValue)
+{
+  return fwrite(&pValue, sizeof(T), 1, pFilePtr) == 1;
+}
+
+// Only for vectors of plain structures (Vector3D, primitives, ...)
+template <class T, class A>
+inline
+bool readCacheVector(FILE* pFilePtr, std::vector<T, A>& pVector)
+{
+  unsigned long lSize = 0;
+  if (!readCacheValue(pFilePtr, lSize)) {
+    return false;
+  }
+
+  pVector.clear();
+  if (lSize == 0) {
+    return true;
+  }
+
+  pVector.resize(lSize);
+  return fread(&pVector[0], sizeof(T), lSize, pFilePtr) == lSize;
+}
+
+template <class T, class A>
+inline
+bool writeCacheVector(FILE* pFilePtr, const std::vector<T, A>& pVector)
+{
+  const unsigned long lSize = pVector.size();
+  if (!writeCacheValue(pFilePtr, lSize)) {
+    return false;
+  }
+
+  if (lSize == 0) {
+    return true;
+  }
+
+  return fwrite(&pVector[0], sizeof(T), lSize, pFilePtr) == lSize;
+}
+
+// Same as readCacheVector, block by block
+template <class T>
+inline
+bool readCacheVector(FILE* pFilePtr, SegmentedVector<T>& pVector)
+{
+  unsigned long lSize = 0;
+  if (!readCacheValue(pFilePtr, lSize)) {
+    return false;
+  }
+
+  pVector.clear();
+  pVector.resize(lSize);
+
+  for (size_t i=0; i<pVector.getNbBlocks(); ++i) {
+    const size_t lLength = pVector.getBlockLength(i);
+    if (fread(pVector.getBlock(i), sizeof(T), lLength, pFilePtr) != lLength) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <class T>
+inline
+bool writeCacheVector(FILE* pFilePtr, const SegmentedVector<T>& pVector)
+{
+  const unsigned long lSize = pVector.size();
+  if (!writeCacheValue(pFilePtr, lSize)) {
+    return false;
+  }
+
+  for (size_t i=0; i<pVector.getNbBlocks(); ++i) {
+    const size_t lLength = pVector.getBlockLength(i);
+    if (fwrite(pVector.getBlock(i), sizeof(T), lLength, pFilePtr) != lLength) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool readCacheString (FILE* pFilePtr, std::string&       pString);
+bool writeCacheString(FILE* pFilePtr, const std::string& pString);
+
+#endif // CACHE_UTILS_H
@@ -26,7 +26,11 @@
 #endif
 
 #include "GraphicData.h"
+#include "mapped_utils.h"
+#include "RenderServer.h"
+#include "VertexPositions.h"
 
+#include <algorithm>
 #include <iostream>
 #include <map>
 #include <set>
@@ -86,6 +90,11 @@ int main(int argc,char** argv)
     std::cout << " General options:" << std::endl;
     std::cout << "   -i : Enable standart input command processing. Even if filenames are given as arguments" << std::endl;
     std::cout << "   -nogui : Use only offscreen snapshots" << std::endl;
+    std::cout << "   -soft : Render the snapshots in software, without OpenGL" << std::endl;
+#ifndef WIN32
+    std::cout << "   -daemon=<socket> : Keep the data loaded and serve requests (view, snapshot, ...)" << std::endl;
+    std::cout << "                      sent on the Unix socket <socket>. Implies -nogui" << std::endl;
+#endif // WIN32
     std::cout << " View options: (most of these options are accessible in the GUI right-click menu" << std::endl;
     std::cout << "                or in the ~/.glvrc)" << std::endl;
     std::cout << "   -plain: disable grid and axes display; showing only the object" << std::endl;
@@ -93,10 +102,20 @@ int main(int argc,char** argv)
     std::cout << "   -black -white: change background color" << std::endl;
     std::cout << "   -fast : Enable graphic simplification. Disables the rendering of object when using mouse" << std::endl;
     std::cout << "   -bbox : Enable bounding box mode. Disables the rendering of object when using mouse" << std::endl;
+    std::cout << "   -lod : Enable automatic level of detail. Simplifies the objects to keep a smooth frame rate" << std::endl;
+    std::cout << "          when using mouse, then refines them back to full detail" << std::endl;
+    std::cout << "   -small=# : Draw the objects smaller than # pixels on screen as a single point" << std::endl;
     std::cout << " Preprocessing:" << std::endl;
     std::cout << "   -smooth : Smooth normals of triangular raw meshes" << std::endl;
     std::cout << "   -optim=# : Optimizer threshold [100]. Higher values may incur slower loading," << std::endl;
     std::cout << "              but faster display onto some video cards. Very large datasets only." << std::endl;
+    std::cout << "   -quantize=16 : Store the vertices of the raw meshes on 16 bits per coordinate," << std::endl;
+    std::cout << "                  relative to the bounds of each chunk of 1024 vertices" << std::endl;
+#ifndef WIN32
+    std::cout << "   -nocache : Do not use the cache of parsed files (~/.cache/glv)" << std::endl;
+    std::cout << "   -memory=# : Memory budget of the data, in MB. Beyond it, the data is stored in" << std::endl;
+    std::cout << "               temporary files ($TMPDIR or /var/tmp) mapped in memory [unlimited]" << std::endl;
+#endif // WIN32
     return 0;
   }
 
@@ -127,6 +146,27 @@ int main(int argc,char** argv)
   }
 #endif
 
+  if(lSetSwitchs.find("-nocache") != lSetSwitchs.end()) {
+    lGraphicData.disableParseCache();
+  }
+  if(lIndexOptions.find("-memory") != lIndexOptions.end()) {
+    const int lVal = atoi(lIndexOptions["-memory"].c_str());
+    if(lVal < 1) {
+      std::cerr << "Warning = memory budget too low; ignored" << std::endl;
+    }
+    else {
+      setMappedMemoryBudget(static_cast<size_t>(lVal)*1024*1024);
+    }
+  }
+  if(lIndexOptions.find("-quantize") != lIndexOptions.end()) {
+    const int lVal = atoi(lIndexOptions["-quantize"].c_str());
+    if(lVal != 16) {
+      std::cerr << "Warning = only 16 bits quantization is supported; ignored" << std::endl;
+    }
+    else {
+      setPositionQuantization(lVal);
+    }
+  }
   if(lSetSwitchs.find("-smooth") != lSetSwitchs.end()) {
     lGraphicData.enableSmoothingMode();
   }
@@ -144,6 +184,16 @@ int main(int argc,char** argv)
   if(lSetSwitchs.find("-fast") != lSetSwitchs.end()) {
     lUserSettings.aSimplicationMode = UserSettings::simplificationMode_fast;
   }
+  if(lSetSwitchs.find("-lod") != lSetSwitchs.end()) {
+    lUserSettings.aSimplicationMode = UserSettings::simplificationMode_level_of_detail;
+  }
+  if(lIndexOptions.find("-small") != lIndexOptions.end()) {
+    const float lVal = atof(lIndexOptions["-small"].c_str());
+    if(lVal < 0.0f) {
+      std::cerr << "Warning = small feature size negative; set to 0" << std::endl;
+    }
+    lUserSettings.aSmallFeaturePixels = std::max(lVal, 0.0f);
+  }
   if(lSetSwitchs.find("-plain") != lSetSwitchs.end()) {
     lUserSettings.aFlagAxes = false;
     lUserSettings.aFlagGrid = false;
@@ -166,6 +216,9 @@ int main(int argc,char** argv)
     lUserSettings.aBackgroundG    = 1.0f;
     lUserSettings.aBackgroundB    = 1.0f;
   }
+  if(lSetSwitchs.find("-soft") != lSetSwitchs.end()) {
+    lUserSettings.aFlagSoftwareRendering = true;
+  }
 
 #ifndef WIN32
   // If no files are given; or the "-i" switch used; the program
@@ -195,7 +248,19 @@ int main(int argc,char** argv)
     ++lFilenameIter;
   }
 
-  if(lSetSwitchs.find("-nogui") == lSetSwitchs.end()) {
+  if(lIndexOptions.find("-daemon") != lIndexOptions.end()) {
+
+    // Serve the snapshot requests from the loaded data
+    RenderServer lRenderServer(lGraphicData);
+
+    lRenderServer.open(lIndexOptions["-daemon"], lError);
+    if (!lError.empty()) {
+      std::cerr << lError << std::endl;
+      return 1;
+    }
+    lRenderServer.run();
+  }
+  else if(lSetSwitchs.find("-nogui") == lSetSwitchs.end()) {
 
     // Execute the GUI
 #ifdef GLV_USE_QT
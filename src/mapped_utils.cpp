@@ -0,0 +1,168 @@
+//  glv - OpenGL viewer command line tool
+/*****************************************************************************
+ * Copyright (C) 2003 Patrick Lagace <bl4cklight@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *****************************************************************************/
+
+#include "mapped_utils.h"
+#include "arena_utils.h"
+#include "assert_glv.h"
+
+#include <map>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif // #ifndef WIN32
+
+typedef std::map<void*, size_t> Mappings;
+
+// Smaller blocks always stay on the heap: they aren't worth a file
+static const size_t gMinimumMappedSize = 1024*1024;
+
+static size_t gMemoryBudget = 0;
+static size_t gHeapSize     = 0;
+
+static Mappings& getMappings()
+{
+  static Mappings lMappings;
+  return lMappings;
+}
+
+#ifndef WIN32
+// Returns a shared mapping of a new unlinked file of pBytes,
+// or 0 if it can't be created
+static void* mapTemporaryFile(const size_t pBytes)
+{
+  const char* lTmpDir = getenv("TMPDIR");
+
+  // /tmp is often in memory
+  std::string lTemplate = std::string(lTmpDir != 0 && lTmpDir[0] == '/' ? lTmpDir : "/var/tmp") + "/glv-XXXXXX";
+
+  std::vector<char> lFilename(lTemplate.begin(), lTemplate.end());
+  lFilename.push_back('\0');
+
+  const int lFd = mkstemp(&lFilename[0]);
+
+  if (lFd < 0) {
+    return 0;
+  }
+
+  // The file disappears with its last mapping
+  unlink(&lFilename[0]);
+
+  void* lPtr = MAP_FAILED;
+
+  // Reserve the blocks now: a full disk would otherwise be
+  // reported by a SIGBUS on the first write to the mapping
+  if (posix_fallocate(lFd, 0, pBytes) == 0) {
+    lPtr = mmap(0, pBytes, PROT_READ | PROT_WRITE, MAP_SHARED, lFd, 0);
+  }
+
+  close(lFd);
+
+  if (lPtr == MAP_FAILED) {
+    return 0;
+  }
+
+  madvise(lPtr, pBytes, MADV_SEQUENTIAL);
+
+  return lPtr;
+}
+#endif // #ifndef WIN32
+
+// Set the memory budget, in bytes, of the heap blocks
+// allocated with allocateMapped
+void setMappedMemoryBudget(const size_t pBytes)
+{
+  gMemoryBudget = pBytes;
+}
+
+void* allocateMapped(const size_t pBytes)
+{
+#ifndef WIN32
+  if (gMemoryBudget > 0                 &&
+      pBytes >= gMinimumMappedSize      &&
+      gHeapSize + pBytes > gMemoryBudget) {
+
+    void* lPtr = mapTemporaryFile(pBytes);
+
+    // Otherwise, try the heap anyway
+    if (lPtr != 0) {
+      getMappings()[lPtr] = pBytes;
+      return lPtr;
+    }
+  }
+#endif // #ifndef WIN32
+
+  // The first blocks of the small vectors are nodes of the scene
+  void* lPtr = allocateArena(pBytes);
+  gHeapSize += pBytes;
+
+  return lPtr;
+}
+
+void deallocateMapped(void*        pPtr,
+                      const size_t pBytes)
+{
+  if (pPtr == 0) {
+    return;
+  }
+
+#ifndef WIN32
+  Mappings& lMappings = getMappings();
+
+  if (!lMappings.empty()) {
+
+    Mappings::iterator lIter = lMappings.find(pPtr);
+
+    if (lIter != lMappings.end()) {
+      GLV_ASSERT(lIter->second == pBytes);
+      munmap(pPtr, lIter->second);
+      lMappings.erase(lIter);
+      return;
+    }
+  }
+#endif // #ifndef WIN32
+
+  GLV_ASSERT(gHeapSize >= pBytes);
+  gHeapSize -= pBytes;
+  deallocateArena(pPtr, pBytes);
+}
+
+// Start reading the pages in advance. Nothing is done
+// as long as nothing is mapped
+void prefetchMapped(const void*  pPtr,
+                    const size_t pBytes)
+{
+#ifndef WIN32
+  if (getMappings().empty() || pBytes == 0) {
+    return;
+  }
+
+  // madvise needs an address aligned on a page
+  static const size_t lPageSize = sysconf(_SC_PAGESIZE);
+
+  const size_t lOffset = reinterpret_cast<size_t>(pPtr) % lPageSize;
+
+  madvise(static_cast<char*>(const_cast<void*>(pPtr)) - lOffset, pBytes + lOffset, MADV_WILLNEED);
+#endif // #ifndef WIN32
+}
@@ -0,0 +1,481 @@
+//  glv - OpenGL viewer command line tool
+/*****************************************************************************
+ * Copyright (C) 2003 Patrick Lagace <bl4cklight@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *****************************************************************************/
+
+#ifndef MAPPED_UTILS_H
+#define MAPPED_UTILS_H
+
+#include "arena_utils.h"
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// Storage of the large primitive and vertex vectors. Below the
+// memory budget, the vectors are on the heap as usual. Beyond it,
+// each new large block is a shared mapping of an unlinked temporary
+// file ($TMPDIR, or /var/tmp), so the page cache keeps in memory
+// only the parts that are used and writes the others back to the
+// disk instead of swapping. A budget of 0 (the default) disables
+// the mappings.
+
+void  setMappedMemoryBudget(const size_t pBytes);
+
+void* allocateMapped       (const size_t pBytes);
+void  deallocateMapped     (void*        pPtr,
+                            const size_t pBytes);
+
+// Hint that pBytes from pPtr are about to be read in order
+void  prefetchMapped       (const void*  pPtr,
+                            const size_t pBytes);
+
+// Allocator of the vectors using allocateMapped
+template <class T>
+class MappedAllocator
+{
+public:
+
+  typedef size_t     size_type;
+  typedef ptrdiff_t  difference_type;
+  typedef T*         pointer;
+  typedef const T*   const_pointer;
+  typedef T&         reference;
+  typedef const T&   const_reference;
+  typedef T          value_type;
+
+  template <class U>
+  struct rebind {
+    typedef MappedAllocator<U> other;
+  };
+
+  MappedAllocator () {}
+  MappedAllocator (const MappedAllocator&) {}
+  template <class U>
+  MappedAllocator (const MappedAllocator<U>&) {}
+  ~MappedAllocator() {}
+
+  pointer       address(reference       pValue) const {return &pValue;}
+  const_pointer address(const_reference pValue) const {return &pValue;}
+
+  pointer allocate(const size_type pNb, const void* = 0)
+    {
+      if (pNb > max_size()) {
+        throw std::bad_alloc();
+      }
+      return static_cast<pointer>(allocateMapped(pNb*sizeof(T)));
+    }
+
+  void deallocate(pointer pPtr, const size_type pNb)
+    {
+      deallocateMapped(pPtr, pNb*sizeof(T));
+    }
+
+  size_type max_size() const
+    {
+      return static_cast<size_type>(-1) / sizeof(T);
+    }
+
+  void construct(pointer pPtr, const T& pValue)
+    {
+      new(static_cast<void*>(pPtr)) T(pValue);
+    }
+
+  void destroy(pointer pPtr)
+    {
+      pPtr->~T();
+    }
+};
+
+// All the MappedAllocators are interchangeable
+template <class T, class U>
+inline
+bool operator==(const MappedAllocator<T>&, const MappedAllocator<U>&)
+{
+  return true;
+}
+
+template <class T, class U>
+inline
+bool operator!=(const MappedAllocator<T>&, const MappedAllocator<U>&)
+{
+  return false;
+}
+
+// Random access iterator of a SegmentedVector. V is the
+// SegmentedVector, const for the const_iterator
+template <class V, class R, class P>
+class SegmentedIterator
+{
+public:
+
+  typedef std::random_access_iterator_tag  iterator_category;
+  typedef typename V::value_type           value_type;
+  typedef ptrdiff_t                        difference_type;
+  typedef P                                pointer;
+  typedef R                                reference;
+
+  SegmentedIterator() : aIndex(0), aVector(0) {}
+  SegmentedIterator(V* pVector, const size_t pIndex) : aIndex(pIndex), aVector(pVector) {}
+
+  // Conversion of an iterator in a const_iterator
+  template <class V2, class R2, class P2>
+  SegmentedIterator(const SegmentedIterator<V2, R2, P2>& pIter)
+    : aIndex(pIter.getIndex()), aVector(pIter.getVector()) {}
+
+  size_t getIndex () const {return aIndex; }
+  V*     getVector() const {return aVector;}
+
+  reference operator* () const {return (*aVector)[aIndex];}
+  pointer   operator->() const {return &(*aVector)[aIndex];}
+  reference operator[](const difference_type pOffset) const {return (*aVector)[aIndex + pOffset];}
+
+  SegmentedIterator& operator++() {++aIndex; return *this;}
+  SegmentedIterator& operator--() {--aIndex; return *this;}
+  SegmentedIterator  operator++(int) {SegmentedIterator lIter(*this); ++aIndex; return lIter;}
+  SegmentedIterator  operator--(int) {SegmentedIterator lIter(*this); --aIndex; return lIter;}
+
+  SegmentedIterator& operator+=(const difference_type pOffset) {aIndex += pOffset; return *this;}
+  SegmentedIterator& operator-=(const difference_type pOffset) {aIndex -= pOffset; return *this;}
+
+  SegmentedIterator operator+(const difference_type pOffset) const {return SegmentedIterator(aVector, aIndex + pOffset);}
+  SegmentedIterator operator-(const difference_type pOffset) const {return SegmentedIterator(aVector, aIndex - pOffset);}
+
+  template <class V2, class R2, class P2>
+  difference_type operator-(const SegmentedIterator<V2, R2, P2>& pIter) const {
+    return static_cast<difference_type>(aIndex) - static_cast<difference_type>(pIter.getIndex());
+  }
+
+  template <class V2, class R2, class P2>
+  bool operator==(const SegmentedIterator<V2, R2, P2>& pIter) const {return aIndex == pIter.getIndex();}
+  template <class V2, class R2, class P2>
+  bool operator!=(const SegmentedIterator<V2, R2, P2>& pIter) const {return aIndex != pIter.getIndex();}
+  template <class V2, class R2, class P2>
+  bool operator< (const SegmentedIterator<V2, R2, P2>& pIter) const {return aIndex <  pIter.getIndex();}
+  template <class V2, class R2, class P2>
+  bool operator> (const SegmentedIterator<V2, R2, P2>& pIter) const {return aIndex >  pIter.getIndex();}
+  template <class V2, class R2, class P2>
+  bool operator<=(const SegmentedIterator<V2, R2, P2>& pIter) const {return aIndex <= pIter.getIndex();}
+  template <class V2, class R2, class P2>
+  bool operator>=(const SegmentedIterator<V2, R2, P2>& pIter) const {return aIndex >= pIter.getIndex();}
+
+private:
+
+  size_t aIndex;
+  V*     aVector;
+
+};
+
+// Vector made of blocks of aBlockSize elements allocated with
+// MappedAllocator. Unlike a std::vector, a full block is never
+// moved: growing to millions of elements doesn't copy them, and
+// the peak memory during the loading stays close to the final
+// size. Only the first block grows (and moves) like a std::vector
+// until it is full, so that small vectors stay small.
+template <class T>
+class SegmentedVector
+{
+public:
+
+  typedef T                                                                    value_type;
+  typedef size_t                                                               size_type;
+  typedef ptrdiff_t                                                            difference_type;
+  typedef T&                                                                   reference;
+  typedef const T&                                                             const_reference;
+  typedef SegmentedIterator<SegmentedVector<T>,       T&,       T*>            iterator;
+  typedef SegmentedIterator<const SegmentedVector<T>, const T&, const T*>      const_iterator;
+
+  // 64K elements per block
+  enum {aBlockShift = 16,
+        aBlockSize  = 1 << aBlockShift,
+        aBlockMask  = aBlockSize - 1};
+
+  SegmentedVector() : aBlocks(), aFirstBlockCapacity(0), aSize(0) {}
+
+  SegmentedVector(const SegmentedVector& pVector)
+    : aBlocks(), aFirstBlockCapacity(0), aSize(0)
+    {
+      assign(pVector.begin(), pVector.end());
+    }
+
+  ~SegmentedVector()
+    {
+      clear();
+      releaseBlocks();
+    }
+
+  SegmentedVector& operator=(const SegmentedVector& pVector)
+    {
+      if (this != &pVector) {
+        SegmentedVector lCopy(pVector);
+        swap(lCopy);
+      }
+      return *this;
+    }
+
+  reference       operator[](const size_type pIndex)       {return aBlocks[pIndex >> aBlockShift][pIndex & aBlockMask];}
+  const_reference operator[](const size_type pIndex) const {return aBlocks[pIndex >> aBlockShift][pIndex & aBlockMask];}
+
+  reference       back ()       {return (*this)[aSize-1];}
+  const_reference back () const {return (*this)[aSize-1];}
+  reference       front()       {return (*this)[0];}
+  const_reference front() const {return (*this)[0];}
+
+  iterator        begin()       {return iterator      (this, 0    );}
+  const_iterator  begin() const {return const_iterator(this, 0    );}
+  iterator        end  ()       {return iterator      (this, aSize);}
+  const_iterator  end  () const {return const_iterator(this, aSize);}
+
+  bool      empty   () const {return aSize == 0;}
+  size_type size    () const {return aSize;}
+  size_type capacity() const
+    {
+      return aBlocks.empty() ? 0 : aFirstBlockCapacity + (aBlocks.size()-1)*aBlockSize;
+    }
+
+  // Number of blocks, and the elements of a block (for the
+  // operations on contiguous memory, like the reads and writes)
+  size_type getNbBlocks   ()                      const {return (aSize + aBlockMask) >> aBlockShift;}
+  T*        getBlock      (const size_type pBlock)      {return aBlocks[pBlock];}
+  const T*  getBlock      (const size_type pBlock) const {return aBlocks[pBlock];}
+  size_type getBlockLength(const size_type pBlock) const
+    {
+      return std::min(static_cast<size_type>(aBlockSize), aSize - (pBlock << aBlockShift));
+    }
+
+  template <class I>
+  void assign(I pBegin, const I pEnd)
+    {
+      clear();
+      for (; pBegin != pEnd; ++pBegin) {
+        push_back(*pBegin);
+      }
+    }
+
+  void assign(const size_type pNb, const T& pValue)
+    {
+      clear();
+      resize(pNb, pValue);
+    }
+
+  // Destroys the elements but keeps the blocks, like std::vector
+  void clear()
+    {
+      while (aSize > 0) {
+        pop_back();
+      }
+    }
+
+  void pop_back()
+    {
+      --aSize;
+      MappedAllocator<T>().destroy(&(*this)[aSize]);
+    }
+
+  void push_back(const T& pValue)
+    {
+      if (aSize == capacity()) {
+        grow(aSize + 1);
+      }
+      MappedAllocator<T>().construct(&aBlocks[aSize >> aBlockShift][aSize & aBlockMask], pValue);
+      ++aSize;
+    }
+
+  void reserve(const size_type pNb)
+    {
+      if (pNb > capacity()) {
+        grow(pNb);
+      }
+    }
+
+  void resize(const size_type pNb, const T& pValue = T())
+    {
+      reserve(pNb);
+      while (aSize > pNb) {
+        pop_back();
+      }
+      while (aSize < pNb) {
+        push_back(pValue);
+      }
+    }
+
+  // Releases the unused end of the first block, once the vector is
+  // complete. The other blocks are kept: they are full, except the
+  // last one
+  void shrink_to_fit()
+    {
+      if (aBlocks.size() == 1 && aFirstBlockCapacity > aSize) {
+        if (aSize == 0) {
+          releaseBlocks();
+        }
+        else {
+          MappedAllocator<T> lAllocator;
+
+          T* lBlock = lAllocator.allocate(aSize);
+          for (size_type i=0; i<aSize; ++i) {
+            lAllocator.construct(&lBlock[i], aBlocks[0][i]);
+            lAllocator.destroy  (&aBlocks[0][i]);
+          }
+          lAllocator.deallocate(aBlocks[0], aFirstBlockCapacity);
+          aBlocks[0]          = lBlock;
+          aFirstBlockCapacity = aSize;
+        }
+      }
+      std::vector<T*, ArenaAllocator<T*> >(aBlocks).swap(aBlocks);
+    }
+
+  // Moves the element pSources[i] at i, in place: the cycles of
+  // the permutation are followed with a single temporary element
+  void permute(const std::vector<size_type>& pSources)
+    {
+      std::vector<bool> lDone(aSize, false);
+
+      for (size_type i=0; i<aSize; ++i) {
+        if (lDone[i]) {
+          continue;
+        }
+        const T   lFirst = (*this)[i];
+        size_type lDest  = i;
+        while (pSources[lDest] != i) {
+          (*this)[lDest] = (*this)[pSources[lDest]];
+          lDone[lDest]   = true;
+          lDest          = pSources[lDest];
+        }
+        (*this)[lDest] = lFirst;
+        lDone[lDest]   = true;
+      }
+    }
+
+  void swap(SegmentedVector& pVector)
+    {
+      aBlocks.swap(pVector.aBlocks);
+      std::swap(aFirstBlockCapacity, pVector.aFirstBlockCapacity);
+      std::swap(aSize,               pVector.aSize              );
+    }
+
+private:
+
+  // Makes room for pNb elements: the first block doubles up
+  // to aBlockSize, then full blocks are added
+  void grow(const size_type pNb)
+    {
+      MappedAllocator<T> lAllocator;
+
+      if (aFirstBlockCapacity < static_cast<size_type>(aBlockSize)) {
+        size_type lCapacity = std::max(static_cast<size_type>(16), 2*aFirstBlockCapacity);
+        lCapacity = std::min(std::max(lCapacity, pNb), static_cast<size_type>(aBlockSize));
+
+        T* lBlock = lAllocator.allocate(lCapacity);
+        for (size_type i=0; i<aSize; ++i) {
+          lAllocator.construct(&lBlock[i], aBlocks[0][i]);
+          lAllocator.destroy  (&aBlocks[0][i]);
+        }
+        if (aBlocks.empty()) {
+          aBlocks.push_back(lBlock);
+        }
+        else {
+          lAllocator.deallocate(aBlocks[0], aFirstBlockCapacity);
+          aBlocks[0] = lBlock;
+        }
+        aFirstBlockCapacity = lCapacity;
+      }
+
+      while (capacity() < pNb) {
+        aBlocks.push_back(lAllocator.allocate(aBlockSize));
+      }
+    }
+
+  void releaseBlocks()
+    {
+      MappedAllocator<T> lAllocator;
+      for (size_type i=0; i<aBlocks.size(); ++i) {
+        lAllocator.deallocate(aBlocks[i], (i == 0) ? aFirstBlockCapacity : aBlockSize);
+      }
+      aBlocks.clear();
+      aFirstBlockCapacity = 0;
+    }
+
+  std::vector<T*, ArenaAllocator<T*> >  aBlocks;
+  size_type                             aFirstBlockCapacity;
+  size_type                             aSize;
+
+};
+
+// Storage of the large vectors of T
+template <class T>
+struct MappedVector {
+  typedef SegmentedVector<T> Type;
+};
+
+// Same as prefetchMapped, for the elements pBegin
+// to pEnd-1 of pVector
+template <class T>
+inline
+void prefetchMapped(const SegmentedVector<T>& pVector,
+                    const size_t              pBegin,
+                    const size_t              pEnd)
+{
+  size_t lBegin = pBegin;
+  while (lBegin < pEnd) {
+    // Up to the end of the block of lBegin
+    const size_t lEnd = std::min(pEnd, (lBegin | SegmentedVector<T>::aBlockMask) + 1);
+    prefetchMapped(&pVector[lBegin], (lEnd-lBegin)*sizeof(T));
+    lBegin = lEnd;
+  }
+}
+
+// Release the unused capacity of pVector, once it is complete.
+// Returns the number of bytes released
+template <class T, class A>
+inline
+size_t shrinkToFit(std::vector<T, A>& pVector)
+{
+  const size_t lCapacity = pVector.capacity();
+  std::vector<T, A>(pVector).swap(pVector);
+  return (lCapacity - pVector.capacity())*sizeof(T);
+}
+
+template <class T>
+inline
+size_t shrinkToFit(SegmentedVector<T>& pVector)
+{
+  const size_t lCapacity = pVector.capacity();
+  pVector.shrink_to_fit();
+  return (lCapacity - pVector.capacity())*sizeof(T);
+}
+
+#ifdef GLV_DUMP_MEMORY_USAGE
+
+// Returns "size/capacity" of pContainer, in bytes
+template <class Container>
+inline
+std::string getStringSizeAndCapacity(const Container& pContainer)
+{
+  char lSizeAndCapacity[128];
+  sprintf(lSizeAndCapacity,"%lu/%lu",
+          static_cast<unsigned long>(sizeof(typename Container::value_type)*pContainer.size()),
+          static_cast<unsigned long>(sizeof(typename Container::value_type)*pContainer.capacity()));
+  return std::string(lSizeAndCapacity);
+}
+
+#endif // #ifdef GLV_DUMP_MEMORY_USAGE
+
+#endif // MAPPED_UTILS_H
@@ -239,3 +239,31 @@ std::string trimString(const std::string& pString,
 
   return lTrimmed;
 }
+
+// Remove the optional last word "count=#" of pParameters, and
+// return its value in pCount (0 when there's none).
+// Returns false if the value isn't a positive integer
+bool extractCountHint(std::string&   pParameters,
+                      unsigned long& pCount)
+{
+  pCount = 0;
+
+  const std::string            lPrefix("count=");
+  const std::string::size_type lBegin = pParameters.find_last_of(' ') + 1;
+
+  if (pParameters.compare(lBegin, lPrefix.size(), lPrefix) != 0) {
+    return true;
+  }
+
+  const std::string lValue = pParameters.substr(lBegin + lPrefix.size());
+
+  if (lValue.empty()                                              ||
+      lValue.find_first_not_of("0123456789") != std::string::npos ||
+      sscanf(lValue.c_str(), "%lu", &pCount) != 1) {
+    pCount = 0;
+    return false;
+  }
+
+  pParameters = trimString(pParameters.substr(0, lBegin), " ");
+  return true;
+}
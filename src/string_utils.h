@@ -34,6 +34,8 @@ int findFirstNotOf(const char* pSourceString,const char* pSet,int pStartPos=0);
 bool extractParameterDictionaryFromLine(const std::string& pString,std::map<std::string,std::string>& pDictionary,int& pEndOfLine);
 
 int         countWords(const std::string& pString);
+bool        extractCountHint(std::string&   pParameters,
+                             unsigned long& pCount);
 std::string trimString(const std::string& pString,
                        const std::string& pToTrim);
 